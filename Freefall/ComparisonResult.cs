@@ -0,0 +1,122 @@
+﻿//-----------------------------------------------------------------------
+// <copyright file="ComparisonResult.cs" company="dc1394's software">
+//     Copyright © 2018 @dc1394 All Rights Reserved.
+// </copyright>
+//-----------------------------------------------------------------------
+namespace Freefall
+{
+    using System;
+
+    /// <summary>
+    /// 複数の条件を同時に解いた際の、一つの条件の各事象の時間と、基準の条件（最初の条件）との差を表す、比較結果の表の一行
+    /// </summary>
+    public sealed class ComparisonResult
+    {
+        #region 構築
+
+        /// <summary>
+        /// 比較結果の表の一行のコンストラクタ
+        /// </summary>
+        /// <param name="condition">条件の名前</param>
+        /// <param name="timpact">地面に衝突した際の時間（秒）（衝突しなかった場合はnull）</param>
+        /// <param name="thmax">最高到達高度の際の時間（秒）（発見できなかった場合はnull）</param>
+        /// <param name="tvmax">最高速度の際の時間（秒）（発見できなかった場合はnull）</param>
+        /// <param name="reference">基準の条件の比較結果（自身が基準の場合はnull）</param>
+        internal ComparisonResult(String condition, Double? timpact, Double? thmax, Double? tvmax, ComparisonResult reference)
+        {
+            this.条件 = condition;
+            this.TImpact = timpact;
+            this.THmax = thmax;
+            this.TVmax = tvmax;
+
+            this.地面衝突時間 = ComparisonResult.時間文字列(timpact);
+            this.最高到達高度時間 = ComparisonResult.時間文字列(thmax);
+            this.最高速度時間 = ComparisonResult.時間文字列(tvmax);
+
+            this.地面衝突時間の差 = ComparisonResult.差文字列(timpact, reference?.TImpact);
+            this.最高到達高度時間の差 = ComparisonResult.差文字列(thmax, reference?.THmax);
+            this.最高速度時間の差 = ComparisonResult.差文字列(tvmax, reference?.TVmax);
+        }
+
+        #endregion 構築
+
+        #region プロパティ
+
+        /// <summary>
+        /// 条件の名前
+        /// </summary>
+        public String 条件 { get; }
+
+        /// <summary>
+        /// 地面に衝突した際の時間（秒）
+        /// </summary>
+        public String 地面衝突時間 { get; }
+
+        /// <summary>
+        /// 地面に衝突した際の時間の、基準の条件との差（秒）
+        /// </summary>
+        public String 地面衝突時間の差 { get; }
+
+        /// <summary>
+        /// 最高到達高度の際の時間（秒）
+        /// </summary>
+        public String 最高到達高度時間 { get; }
+
+        /// <summary>
+        /// 最高到達高度の際の時間の、基準の条件との差（秒）
+        /// </summary>
+        public String 最高到達高度時間の差 { get; }
+
+        /// <summary>
+        /// 最高速度の際の時間（秒）
+        /// </summary>
+        public String 最高速度時間 { get; }
+
+        /// <summary>
+        /// 最高速度の際の時間の、基準の条件との差（秒）
+        /// </summary>
+        public String 最高速度時間の差 { get; }
+
+        /// <summary>
+        /// 地面に衝突した際の時間（秒）
+        /// </summary>
+        private Double? TImpact { get; }
+
+        /// <summary>
+        /// 最高到達高度の際の時間（秒）
+        /// </summary>
+        private Double? THmax { get; }
+
+        /// <summary>
+        /// 最高速度の際の時間（秒）
+        /// </summary>
+        private Double? TVmax { get; }
+
+        #endregion プロパティ
+
+        #region メソッド
+
+        /// <summary>
+        /// 時間を表の文字列にする
+        /// </summary>
+        /// <param name="t">時間（秒）（事象が発生しなかった場合はnull）</param>
+        /// <returns>表の文字列</returns>
+        private static String 時間文字列(Double? t)
+        {
+            return t != null ? $"{t.Value:F3}" : "－";
+        }
+
+        /// <summary>
+        /// 基準の条件との時間の差を表の文字列にする
+        /// </summary>
+        /// <param name="t">時間（秒）（事象が発生しなかった場合はnull）</param>
+        /// <param name="tref">基準の条件の時間（秒）（自身が基準の場合か、事象が発生しなかった場合はnull）</param>
+        /// <returns>表の文字列</returns>
+        private static String 差文字列(Double? t, Double? tref)
+        {
+            return t != null && tref != null ? $"{t.Value - tref.Value:+0.000;-0.000;0.000}" : "－";
+        }
+
+        #endregion メソッド
+    }
+}
@@ -6,6 +6,7 @@
 namespace Freefall
 {
     using System;
+    using System.Diagnostics;
     using System.Linq;
     using MyLogic;
     using OxyPlot;
@@ -14,10 +15,26 @@ namespace Freefall
     /// <summary>
     /// 空気抵抗のある自由落下系に対して運動方程式を1ステップ解くクラス
     /// </summary>
-    internal sealed class FreefallSolveEom
+    internal sealed class FreefallSolveEom : IDisposable
     {
         #region フィールド
 
+        /// <summary>
+        /// グラフの点を間引く際の、グラフの縦軸の範囲に対する許容誤差（おおよそ1ピクセル）
+        /// </summary>
+        private static readonly Double グラフ許容誤差 = 1.0E-3;
+
+        /// <summary>
+        /// グラフの点を間引く際の、点の最大の間隔の、グラフプロット用の時間間隔に対する倍率
+        /// </summary>
+        private static readonly Double グラフ最大間隔倍率 = 100.0;
+
+        /// <summary>
+        /// どの事象からも遠い区間で緩める、常微分方程式の数値解法の許容誤差の最大の倍率
+        /// （緩めると事象の時刻がずれるので、設定で有効にした場合だけ用いる。ずれが表示の精度に十分収まることはfreefalltestで確かめている）
+        /// </summary>
+        private static readonly Double 許容誤差緩和倍率 = 100.0;
+
         /// <summary>
         /// 経過時間－高度の関係のグラフの縦軸の単位をkmにするかどうかの閾値
         /// </summary>
@@ -38,6 +55,11 @@ namespace Freefall
         /// </summary>
         private readonly LineSeries velocityLineSeries;
 
+        /// <summary>
+        /// DLL側で生成したオブジェクトのハンドル（nullの場合はFreefallInitで生成したものを使う）
+        /// </summary>
+        private Int32? handle;
+
         #endregion フィールド
 
         #region 構築
@@ -71,6 +93,53 @@ namespace Freefall
             {
                 UnsafeNativeMethods.FreefallInit(dt, tintervalgraphplot, eps, m, r, h0, v0, odesolver);
             }
+
+            // 終端速度に近い区間のように直線に近い部分の点を間引き、グラフに追加する点の数を減らす
+            UnsafeNativeMethods.EnableAdaptiveSampling(FreefallSolveEom.グラフ許容誤差, FreefallSolveEom.グラフ最大間隔倍率 * tintervalgraphplot);
+
+            // 設定で有効にした場合は、事象から遠い区間では、複数のステップを許容誤差を緩めて一度に積分する（CSVファイルに出力する場合は、時間刻みごとに積分する）
+            if (sd.IsToleranceSchedule)
+            {
+                UnsafeNativeMethods.EnableToleranceSchedule(FreefallSolveEom.許容誤差緩和倍率 * eps);
+            }
+
+            // 点はDLL側に記録し、LineSeriesにはGraph点更新で表示に必要な点だけを格納する（長時間の計算でも点が増え続けないようにする）
+            UnsafeNativeMethods.EnableTrajectoryPyramid();
+        }
+
+        /// <summary>
+        /// 空気抵抗のある自由落下系に対して運動方程式を1ステップ解くクラスの、複数の条件を同時に解くためのコンストラクタ
+        /// DLL側に専用のオブジェクトを生成するので、他のオブジェクトと別のスレッドで同時に解くことができる（CSVファイルには出力しない）
+        /// </summary>
+        /// <param name="altitudeLineSeries">経過時間－高度グラフのプロット用のLineSeries</param>
+        /// <param name="velocityLineSeries">経過時間－速度グラフのプロット用のLineSeries</param>
+        /// <param name="dt">常微分方程式の数値解法の時間刻み（秒）</param>
+        /// <param name="tintervalgraphplot">グラフプロット用の時間間隔（秒）</param>
+        /// <param name="eps">常微分方程式の数値解法の許容誤差</param>
+        /// <param name="m">球の質量（kg）</param>
+        /// <param name="r">球の半径（m）</param>
+        /// <param name="h0">初期高度（m）</param>
+        /// <param name="v0">初期速度（m/s）</param>
+        /// <param name="odesolver">常微分方程式の数値解法</param>
+        /// <param name="istoleranceschedule">事象から遠い区間で許容誤差を緩めるかどうか</param>
+        internal FreefallSolveEom(LineSeries altitudeLineSeries, LineSeries velocityLineSeries, Double dt, Double tintervalgraphplot, Double eps, Double m, Double r, Double h0, Double v0, Int32 odesolver, Boolean istoleranceschedule)
+        {
+            this.altitudeLineSeries = altitudeLineSeries;
+
+            this.velocityLineSeries = velocityLineSeries;
+
+            this.handle = UnsafeNativeMethods.CreateInstance(dt, tintervalgraphplot, eps, m, r, h0, v0, odesolver);
+
+            UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.EnableAdaptiveSampling(this.handle.Value, FreefallSolveEom.グラフ許容誤差, FreefallSolveEom.グラフ最大間隔倍率 * tintervalgraphplot));
+
+            // 設定で有効にした場合は、事象から遠い区間では、複数のステップを許容誤差を緩めて一度に積分する
+            if (istoleranceschedule)
+            {
+                UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.EnableToleranceSchedule(this.handle.Value, FreefallSolveEom.許容誤差緩和倍率 * eps));
+            }
+
+            // 点はDLL側に条件ごとに記録し、LineSeriesにはGraph点更新で表示に必要な点だけを格納する
+            UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.EnableTrajectoryPyramid(this.handle.Value));
         }
 
         #endregion 構築
@@ -106,79 +175,127 @@ namespace Freefall
 
         #region メソッド
 
+        /// <summary>
+        /// DLL側に専用のオブジェクトを生成していた場合は、それを破棄する
+        /// </summary>
+        public void Dispose()
+        {
+            if (this.handle != null)
+            {
+                UnsafeNativeMethods.DestroyInstance(this.handle.Value);
+                this.handle = null;
+            }
+        }
+
         /// <summary>
         /// 空気抵抗のある自由落下系における運動方程式を与えられた時間だけ解き、状態を求める
         /// </summary>
         /// <returns>系の状態が詰まったSystem.ValueTuple</returns>
         public (Double t, Double h, Double v, (Double, Double)?, (Double, Double, Double)?, (Double, Double)?, (Double, Double, Boolean)?) FreefallSolveEomNextStep()
         {
-            var (t, h, v, hmaxstate, vmaxstate, stateofkarmanline, stateofexosphere) = UnsafeNativeMethods.FreefallSolveEomNextStep();
+            var (t, h, v, hmaxstate, vmaxstate, stateofkarmanline, stateofexosphere) =
+                this.handle != null ? UnsafeNativeMethods.FreefallSolveEomNextStep(this.handle.Value) : UnsafeNativeMethods.FreefallSolveEomNextStep();
             
-            if (!FreefallSolveEom.高度単位km変更フラグ && h >= FreefallSolveEom.高度kmグラフ閾値)
-            {
-                FreefallSolveEom.Is高度単位km = true;
-                FreefallSolveEom.高度単位km変更フラグ = true;
+            // 点はDLL側に記録されるので、LineSeriesにはGraph点更新で格納する
+            FreefallSolveEom.Graph縦軸単位判定(h, v);
+                        
+            // 物体が地面に衝突したときの時間と速度を記録
+            this.地面衝突時間And速度 = new DataPoint(t, v);
 
-                lock (this.altitudeLineSeries)
-                {
-                    var altitudeDataPoints = this.altitudeLineSeries.Points
-                                                 .Select(item => new DataPoint(item.X, item.Y / 1000.0))
-                                                 .ToList();
-                    this.altitudeLineSeries.Points.Clear();
-                    altitudeDataPoints.ForEach(item => this.altitudeLineSeries.Points.Add(item));
-                }
-            }
-            
-            if (!FreefallSolveEom.速度単位km_s変更フラグ && Math.Abs(v) >= FreefallSolveEom.速度km_sグラフ閾値)
-            {
-                FreefallSolveEom.Is速度単位km_s = true;
-                FreefallSolveEom.速度単位km_s変更フラグ = true;
+            return (t, h, v, hmaxstate, vmaxstate, stateofkarmanline, stateofexosphere);
+        }
 
-                lock (this.velocityLineSeries)
-                {
-                    var velocityDataPoints = this.velocityLineSeries.Points
-                                                 .Select(item => new DataPoint(item.X, item.Y / 1000.0))
-                                                 .ToList();
-                    this.velocityLineSeries.Points.Clear();
-                    velocityDataPoints.ForEach(item => this.velocityLineSeries.Points.Add(item));
-                }
+        /// <summary>
+        /// 運動方程式を大きな時間刻みと緩い許容誤差で最後まで解き、軌道の概形をLineSeriesに格納して、各事象の概算値を求める
+        /// （FreefallInitで生成したオブジェクトだけが対象）
+        /// </summary>
+        /// <param name="previewAltitudeLineSeries">軌道の概形の経過時間－高度グラフのプロット用のLineSeries</param>
+        /// <param name="previewVelocityLineSeries">軌道の概形の経過時間－速度グラフのプロット用のLineSeries</param>
+        /// <returns>地面に衝突した際の時間と速度、最高到達高度の際の時間と高度が詰まったSystem.ValueTuple</returns>
+        internal ((Double, Double)? stateofimpact, (Double, Double)? stateofhmax) FreefallSolveEomPreview(LineSeries previewAltitudeLineSeries, LineSeries previewVelocityLineSeries)
+        {
+            Debug.Assert(this.handle == null, "Previewは、FreefallInitで生成したオブジェクトに対してだけ呼び出せる！");
+
+            var (t, h, v, stateofimpact, stateofhmax) = UnsafeNativeMethods.FreefallSolveEomPreview();
+
+            // 概形の点についても、グラフの縦軸の単位を変更するかどうかを判定する
+            for (var i = 0; i < t.Length; i++)
+            {
+                FreefallSolveEom.Graph縦軸単位判定(h[i], v[i]);
             }
-            
+
             // LineSeriesに結果を格納
-            lock (this.altitudeLineSeries)
+            lock (previewAltitudeLineSeries)
             {
-                if (FreefallSolveEom.Is高度単位km)
-                {
-                    h /= 1000.0;
-                }
-            
-                this.altitudeLineSeries.Points.Add(new DataPoint(t, h));
+                previewAltitudeLineSeries.Points.AddRange(t.Zip(h, (ti, hi) => new DataPoint(ti, hi)));
             }
-            
+
             // LineSeriesに結果を格納
-            lock (this.velocityLineSeries)
+            lock (previewVelocityLineSeries)
             {
-                if (FreefallSolveEom.Is速度単位km_s)
-                {
-                    v /= 1000.0;
-                }
-            
-                this.velocityLineSeries.Points.Add(new DataPoint(t, v));
+                previewVelocityLineSeries.Points.AddRange(t.Zip(v, (ti, vi) => new DataPoint(ti, vi)));
             }
-                        
-            // 物体が地面に衝突したときの時間と速度を記録
-            lock (this.velocityLineSeries)
+
+            return (stateofimpact, stateofhmax);
+        }
+
+        /// <summary>
+        /// DLL側に記録した点のうち、時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を取得し、LineSeriesの点を置き換える
+        /// </summary>
+        /// <param name="tmin">範囲の最初の時刻（秒）</param>
+        /// <param name="tmax">範囲の最後の時刻（秒）</param>
+        /// <param name="npixels">横方向のピクセル数</param>
+        /// <param name="isAltitude">経過時間－高度グラフのLineSeriesを置き換えるかどうか（falseの場合は経過時間－速度グラフ）</param>
+        internal void Graph点更新(Double tmin, Double tmax, Int32 npixels, Boolean isAltitude)
+        {
+            var (t, h, v) = UnsafeNativeMethods.FreefallSolveEomQueryTrajectory(this.handle, tmin, tmax, npixels);
+            var lineSeries = isAltitude ? this.altitudeLineSeries : this.velocityLineSeries;
+
+            // LineSeriesの点を置き換える
+            lock (lineSeries)
             {
-                this.地面衝突時間And速度 = this.velocityLineSeries.Points.Last();
+                lineSeries.Points.Clear();
+                lineSeries.Points.AddRange(t.Zip(isAltitude ? h : v, (ti, yi) => new DataPoint(ti, yi)));
             }
+        }
+
+        /// <summary>
+        /// 計算が終了したかどうかを調べる
+        /// </summary>
+        /// <returns>計算が終了したかどうか</returns>
+        internal Boolean IsCalculationFinished()
+        {
+            return (this.handle != null ? UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.IsCalculationFinished(this.handle.Value)) : UnsafeNativeMethods.IsCalculationFinished()) != 0;
+        }
 
-            if (FreefallSolveEom.Is速度単位km_s)
+        /// <summary>
+        /// CSVファイルへの書き出しに失敗したかどうかを調べる（CreateInstanceで生成したオブジェクトはファイルに出力しない）
+        /// </summary>
+        /// <returns>書き出しに失敗したかどうか</returns>
+        internal Boolean IsWriteFailed()
+        {
+            return this.handle == null && UnsafeNativeMethods.IsWriteFailed() != 0;
+        }
+
+        /// <summary>
+        /// グラフに追加する点の高度と速度から、グラフの縦軸の単位をkm、km/sに変更するかどうかを判定する
+        /// </summary>
+        /// <param name="h">高度（m）</param>
+        /// <param name="v">速度（m/s）</param>
+        private static void Graph縦軸単位判定(Double h, Double v)
+        {
+            // 点はSI単位のまま追加し、km、km/sへの変換はグラフの縦軸の表示で行う（既に追加した点には触れない）
+            if (!FreefallSolveEom.高度単位km変更フラグ && h >= FreefallSolveEom.高度kmグラフ閾値)
             {
-                // 速度の単位をm/sに戻す
-                this.地面衝突時間And速度 = new DataPoint(this.地面衝突時間And速度.X, this.地面衝突時間And速度.Y * 1000.0);
+                FreefallSolveEom.Is高度単位km = true;
+                FreefallSolveEom.高度単位km変更フラグ = true;
+            }
+            
+            if (!FreefallSolveEom.速度単位km_s変更フラグ && Math.Abs(v) >= FreefallSolveEom.速度km_sグラフ閾値)
+            {
+                FreefallSolveEom.Is速度単位km_s = true;
+                FreefallSolveEom.速度単位km_s変更フラグ = true;
             }
-
-            return (t, h, v, hmaxstate, vmaxstate, stateofkarmanline, stateofexosphere);
         }
 
         #endregion メソッド
@@ -6,6 +6,7 @@
 namespace Freefall
 {
     using System;
+    using System.Collections.Generic;
     using System.Diagnostics;
     using System.Linq;
     using System.Text.RegularExpressions;
@@ -52,6 +53,11 @@ namespace Freefall
         /// </summary>
         private static readonly String から落とすテキスト = "から落とす";
 
+        /// <summary>
+        /// 「概算：」の固定文字列
+        /// </summary>
+        private static readonly String 概算テキスト = "概算：";
+
         /// <summary>
         /// 「計算所要時間：」の固定文字列
         /// </summary>
@@ -81,6 +87,11 @@ namespace Freefall
         /// タイマーの時間間隔
         /// </summary>
         private static readonly Int32 TimerInterval = 50;
+
+        /// <summary>
+        /// 複数の条件を比較する際の、条件ごとのグラフの色（条件の数が多い場合は繰り返す）
+        /// </summary>
+        private static readonly OxyColor[] 比較グラフの色 = { OxyColors.Red, OxyColors.Blue, OxyColors.Green, OxyColors.Orange, OxyColors.Purple, OxyColors.Brown };
         
         /// <summary>
         /// 時間計測用のストップウォッチオブジェクト
@@ -97,6 +108,42 @@ namespace Freefall
         /// </summary>
         private readonly LineSeries velocityLineSeries = new LineSeries();
 
+        /// <summary>
+        /// 軌道の概形の経過時間－高度グラフのプロット用のLineSeries（精密な計算結果が届いた区間から削除する）
+        /// </summary>
+        private readonly LineSeries previewAltitudeLineSeries = new LineSeries() { Color = OxyColors.Gray, LineStyle = LineStyle.Dash };
+
+        /// <summary>
+        /// 軌道の概形の経過時間－速度グラフのプロット用のLineSeries（精密な計算結果が届いた区間から削除する）
+        /// </summary>
+        private readonly LineSeries previewVelocityLineSeries = new LineSeries() { Color = OxyColors.Gray, LineStyle = LineStyle.Dash };
+
+        /// <summary>
+        /// 複数の条件を比較する際の、条件ごとの経過時間－高度グラフのプロット用のLineSeries
+        /// </summary>
+        private readonly List<LineSeries> comparisonAltitudeLineSeries = new List<LineSeries>();
+
+        /// <summary>
+        /// 複数の条件を比較する際の、条件ごとの経過時間－速度グラフのプロット用のLineSeries
+        /// </summary>
+        private readonly List<LineSeries> comparisonVelocityLineSeries = new List<LineSeries>();
+
+        /// <summary>
+        /// 複数の条件を比較する際の、条件ごとの運動方程式を解くクラスのオブジェクト
+        /// （計算が終わった後もズームやパンに合わせて点を取得し直すので、次の計算を始めるまで破棄しない）
+        /// </summary>
+        private readonly List<FreefallSolveEom> comparisonFfse = new List<FreefallSolveEom>();
+
+        /// <summary>
+        /// ズームまたはパンされていて、リセットされていないグラフの横軸
+        /// </summary>
+        private readonly HashSet<Axis> zoomedAxes = new HashSet<Axis>();
+
+        /// <summary>
+        /// 複数の条件を比較した結果の表
+        /// </summary>
+        private List<ComparisonResult> comparisonResults;
+
         /// <summary>
         /// 処理をキャンセルする場合のトークン
         /// </summary>
@@ -117,11 +164,21 @@ namespace Freefall
         /// </summary>
         private Double h;
 
+        /// <summary>
+        /// 複数の条件を同時に解いて比較しているかどうか
+        /// </summary>
+        private Boolean isComparison;
+
         /// <summary>
         /// 処理が正常終了したかキャンセルで打ち切られたかを示すフラグ
         /// </summary>
         private Boolean isProgressCanceled;
 
+        /// <summary>
+        /// 軌道の概形から求めた各事象の概算値の文字列
+        /// </summary>
+        private String previewResultText = String.Empty;
+
         /// <summary>
         /// 対応するView
         /// </summary>
@@ -293,6 +350,78 @@ namespace Freefall
             return resultstr;
         }
 
+        /// <summary>
+        /// 複数の条件について、空気抵抗のある自由落下系における運動方程式を同時に解く等の処理を開始する
+        /// </summary>
+        /// <param name="conditions">各条件の名前、球の質量（kg）、常微分方程式の数値解法</param>
+        /// <param name="dt">常微分方程式の数値解法の時間刻み（秒）</param>
+        /// <param name="tintervalgraphplot">グラフプロット用の時間間隔（秒）</param>
+        /// <param name="eps">常微分方程式の数値解法の許容誤差</param>
+        /// <param name="r">球の半径（m）</param>
+        /// <param name="h0">初期高度（m）</param>
+        /// <param name="v0">初期速度（m/s）</param>
+        private async Task ComparisonProgressStart(IReadOnlyList<(String name, Double m, Int32 odesolver)> conditions, Double dt, Double tintervalgraphplot, Double eps, Double r, Double h0, Double v0)
+        {
+            var results = new (Double? timpact, Double? thmax, Double? tvmax)[conditions.Count];
+
+            var istoleranceschedule = this.sdm.SaveData.IsToleranceSchedule;
+
+            // 条件ごとにDLL側に別のオブジェクトを生成する（各条件の点はDLL側に記録し、Graph点更新で表示に必要な点だけを取得する）
+            this.comparisonFfse.AddRange(conditions.Select(
+                (condition, i) => new FreefallSolveEom(this.comparisonAltitudeLineSeries[i], this.comparisonVelocityLineSeries[i],
+                    dt, tintervalgraphplot, eps, condition.m, r, h0, v0, condition.odesolver, istoleranceschedule)));
+
+            using (this.cts = new CancellationTokenSource())
+            {
+                // 条件ごとのオブジェクトを、それぞれ別のスレッドで同時に解く
+                // （全体の所要時間は、各条件の所要時間の和ではなく、最も遅い条件の所要時間程度になる）
+                var solvers = this.comparisonFfse.ToArray();
+                var tasks = solvers.Select(
+                    (se, i) => Task.Run(
+                        () =>
+                        {
+                            (Double, Double)? hmaxstate = null;
+                            (Double, Double, Double)? vmaxstate = null;
+                            (Double, Double, Boolean)? exospherestate = null;
+
+                            while (!se.IsCalculationFinished())
+                            {
+                                // キャンセルされた場合例外をスロー
+                                this.cts.Token.ThrowIfCancellationRequested();
+
+                                (_, _, _, hmaxstate, vmaxstate, _, exospherestate) = se.FreefallSolveEomNextStep();
+
+                                this.Graph縦軸単位更新();
+                            }
+
+                            // 第二宇宙速度以上で外気圏を脱出した場合は、地面に衝突しない
+                            var timpact = exospherestate != null && exospherestate.Value.Item3 ? (Double?)null : se.地面衝突時間And速度.X;
+                            results[i] = (timpact, hmaxstate?.Item1, vmaxstate?.Item1);
+                        },
+                        this.cts.Token)).ToArray();
+
+                try
+                {
+                    await Task.WhenAll(tasks);
+                }
+                catch (OperationCanceledException)
+                {
+                    this.isProgressCanceled = true;
+                }
+            }
+
+            // 最初の条件を基準にして、各事象の時間の差の表を作る
+            this.comparisonResults = new List<ComparisonResult>();
+            for (var i = 0; i < conditions.Count; i++)
+            {
+                var (timpact, thmax, tvmax) = results[i];
+                this.comparisonResults.Add(new ComparisonResult(conditions[i].name, timpact, thmax, tvmax, this.comparisonResults.FirstOrDefault()));
+            }
+
+            // 計算処理が終わった後に終了処理を行う
+            this.DoEnd();
+        }
+
         /// <summary>
         /// 計算等の終了処理を行う
         /// それに伴い、UI要素等を変更する
@@ -302,6 +431,14 @@ namespace Freefall
             // タイマー停止
             this.dispatcherTimer.Stop();
 
+            // 軌道の概形は、精密な計算結果で置き換えられなかった部分も含めて消す
+            this.previewAltitudeLineSeries.Points.Clear();
+            this.previewVelocityLineSeries.Points.Clear();
+            this.previewResultText = String.Empty;
+
+            // 最後に届いた点までを含めて、グラフの点を取得し直す
+            this.Graph点更新();
+
             if (this.isProgressCanceled)
             {
                 // 「キャンセル」ボタンを有効にする
@@ -309,6 +446,9 @@ namespace Freefall
 
                 // キャンセルフラグを元に戻す
                 this.isProgressCanceled = false;
+
+                // 軌道の概形を消したグラフをプロット
+                this.GraphPlot(false);
             }
             else
             {
@@ -320,6 +460,12 @@ namespace Freefall
 
                 // 計算結果をUIに表示
                 this.Run計算結果UI表示();
+
+                // CSVファイルへの書き出しに失敗していたら知らせる（計算結果は表示したままにする）
+                if (!this.isComparison && this.ffse != null && this.ffse.IsWriteFailed())
+                {
+                    MyError.CallErrorMessageBox($"CSVファイルへの書き出しに失敗しました。{Environment.NewLine}ディスクの空き容量や書き込み権限を確認して下さい。");
+                }
             }
             
             // ストップウォッチリセット
@@ -355,37 +501,81 @@ namespace Freefall
             return (dt, tintervalgraphplot, eps, (Int32)sd.OdeSolver);
         }
 
+        /// <summary>
+        /// 複数の条件を比較する場合に、比較する各条件を取得する
+        /// </summary>
+        /// <param name="m">画面で指定した球の質量（kg）</param>
+        /// <param name="odesolver">設定で指定した常微分方程式の数値解法</param>
+        /// <returns>各条件の名前、球の質量（kg）、常微分方程式の数値解法のリスト（比較しない場合は空）</returns>
+        private List<(String name, Double m, Int32 odesolver)> Get比較する条件(Double m, Int32 odesolver)
+        {
+            var conditions = new List<(String name, Double m, Int32 odesolver)>();
+
+            switch ((ComparisonKind)this.比較の種類ComboBox.SelectedIndex)
+            {
+                case ComparisonKind.なし:
+                    break;
+
+                case ComparisonKind.数値解法:
+                    // AUTOは系に応じて他のいずれかの数値解法を選ぶだけなので、比較から除く
+                    foreach (DefaultData.OdeSolverType type in Enum.GetValues(typeof(DefaultData.OdeSolverType)))
+                    {
+                        if (type != DefaultData.OdeSolverType.AUTO)
+                        {
+                            conditions.Add((type.ToString(), m, (Int32)type));
+                        }
+                    }
+
+                    break;
+
+                case ComparisonKind.球の質量:
+                    // 解釈できない要素は無視する
+                    foreach (var str in this.比較する質量TextBox.Text.Split(',').Select(str => str.Trim()))
+                    {
+                        var mass = MainWindow.質量単位変換(str);
+                        if (mass != null)
+                        {
+                            conditions.Add((str, mass.Value, odesolver));
+                        }
+                    }
+
+                    break;
+
+                default:
+                    Debug.Assert(false, "ComparisonKindがあり得ない値になっている！");
+                    break;
+            }
+
+            return conditions;
+        }
+
         /// <summary>
         /// 経過時間－高度の関係のグラフと、経過時間－速度の関係のグラフをプロットする
         /// </summary>
         /// <param name="uselock">プロットの際にロックをかけるかどうか</param>
         private void GraphPlot(Boolean uselock)
         {
-            // TvsAltitudePlotModelにLineSeriesを削除
-            this.mwvm.TvsAltitudePlotModel.Series.Remove(this.altitudeLineSeries);
-            
-            // TvsVelocityPlotModelにLineSeriesを削除
-            this.mwvm.TvsVelocityPlotModel.Series.Remove(this.velocityLineSeries);
+            // 軌道の概形は、精密な計算結果の下に描く
+            var altitudeLineSeries = this.isComparison ? this.comparisonAltitudeLineSeries : new List<LineSeries> { this.previewAltitudeLineSeries, this.altitudeLineSeries };
+            var velocityLineSeries = this.isComparison ? this.comparisonVelocityLineSeries : new List<LineSeries> { this.previewVelocityLineSeries, this.velocityLineSeries };
+
+            // TvsAltitudePlotModelとTvsVelocityPlotModelのLineSeriesを削除（前回の計算のものも含む）
+            this.mwvm.TvsAltitudePlotModel.Series.Clear();
+            this.mwvm.TvsVelocityPlotModel.Series.Clear();
 
             // TvsAltitudePlotModelのLineSeriesの設定
-            this.mwvm.TvsAltitudePlotModel.Series.Add(this.altitudeLineSeries);
+            altitudeLineSeries.ForEach(this.mwvm.TvsAltitudePlotModel.Series.Add);
 
             // TvsVelocityPlotModelのLineSeriesの設定
-            this.mwvm.TvsVelocityPlotModel.Series.Add(this.velocityLineSeries);
+            velocityLineSeries.ForEach(this.mwvm.TvsVelocityPlotModel.Series.Add);
 
             if (uselock)
             {
-                lock (this.altitudeLineSeries)
-                {
-                    // 経過時間－高度の関係のグラフをプロット
-                    this.mwvm.TvsAltitudePlotModel.InvalidatePlot(true);
-                }
+                // 経過時間－高度の関係のグラフをプロット
+                MainWindow.InvalidatePlotWithLock(this.mwvm.TvsAltitudePlotModel, altitudeLineSeries, 0);
 
-                lock (this.velocityLineSeries)
-                {
-                    // 経過時間－速度の関係のグラフをプロット
-                    this.mwvm.TvsVelocityPlotModel.InvalidatePlot(true);
-                }
+                // 経過時間－速度の関係のグラフをプロット
+                MainWindow.InvalidatePlotWithLock(this.mwvm.TvsVelocityPlotModel, velocityLineSeries, 0);
             }
             else
             {
@@ -397,6 +587,59 @@ namespace Freefall
             }
         }
 
+        /// <summary>
+        /// 計算結果のLineSeriesの点を、各グラフが表示している時刻の範囲と横方向のピクセル数に必要なものに置き換える
+        /// 点はDLL側に記録されているので、グラフを描く手間は計算した点の数ではなくピクセル数に比例する
+        /// </summary>
+        private void Graph点更新()
+        {
+            // 比較する場合は、条件ごとのオブジェクトから、それぞれのLineSeriesの点を取得し直す
+            var solvers = this.isComparison ? this.comparisonFfse : new List<FreefallSolveEom>();
+            if (!this.isComparison && this.ffse != null)
+            {
+                solvers.Add(this.ffse);
+            }
+
+            var (altitudetmin, altitudetmax) = this.Get表示範囲(this.mwvm.TvsAltitudePlotModel.Axes[0]);
+            var (velocitytmin, velocitytmax) = this.Get表示範囲(this.mwvm.TvsVelocityPlotModel.Axes[0]);
+            foreach (var se in solvers)
+            {
+                se.Graph点更新(altitudetmin, altitudetmax, Math.Max((Int32)this.TvsAltitudePlotView.ActualWidth, 1), true);
+                se.Graph点更新(velocitytmin, velocitytmax, Math.Max((Int32)this.TvsVelocityPlotView.ActualWidth, 1), false);
+            }
+        }
+
+        /// <summary>
+        /// グラフの横軸（経過時間）が表示している時刻の範囲を取得する
+        /// </summary>
+        /// <param name="axis">グラフの横軸</param>
+        /// <returns>範囲の最初と最後の時刻（秒）（ズームやパンをしていない場合は全体）</returns>
+        private (Double tmin, Double tmax) Get表示範囲(Axis axis)
+        {
+            // ズームやパンをしていない場合は、軸の範囲が点に合わせて広がるように全体を取得する
+            return this.zoomedAxes.Contains(axis) ? (axis.ActualMinimum, axis.ActualMaximum) : (Double.MinValue, Double.MaxValue);
+        }
+
+        /// <summary>
+        /// LineSeriesのロックを全てかけてから、グラフをプロットする
+        /// </summary>
+        /// <param name="plotModel">プロットするグラフ</param>
+        /// <param name="lineSeries">グラフのLineSeries</param>
+        /// <param name="index">次にロックをかけるLineSeriesのインデックス</param>
+        private static void InvalidatePlotWithLock(PlotModel plotModel, List<LineSeries> lineSeries, Int32 index)
+        {
+            if (index == lineSeries.Count)
+            {
+                plotModel.InvalidatePlot(true);
+                return;
+            }
+
+            lock (lineSeries[index])
+            {
+                MainWindow.InvalidatePlotWithLock(plotModel, lineSeries, index + 1);
+            }
+        }
+
         /// <summary>
         /// 「MaximumVelocityText」TextBlockのテキストを生成し、表示する
         /// </summary>
@@ -440,6 +683,8 @@ namespace Freefall
         /// <param name="odesolver">常微分方程式の数値解法</param>
         private async Task ProgressStart(Double dt, Double tintervalgraphplot, Double eps, Double m, Double r, Double h0, Double v0, Int32 odesolver)
         {
+            var previewTask = Task.CompletedTask;
+
             using (this.cts = new CancellationTokenSource())
             {
                 // 非同期で計算処理を実行
@@ -451,26 +696,24 @@ namespace Freefall
                             ffse = new FreefallSolveEom(this.sdm.SaveData, this.altitudeLineSeries,
                                 this.velocityLineSeries, dt, tintervalgraphplot, eps, m, r, h0, v0, odesolver);
 
-                            while (UnsafeNativeMethods.IsCalculationFinished() == 0)
+                            // 設定で有効にした場合は、大きな時間刻みと緩い許容誤差で最後まで解いた軌道の概形と各事象の概算値を、精密な計算と並行して求めて表示し、
+                            // 精密な計算結果が届いた区間から順に置き換えていく（概形を求め終わるのを待たずに精密な計算を始める）
+                            previewTask = this.sdm.SaveData.IsProgressivePreview ? Task.Run(
+                                () =>
+                                {
+                                    var (previewimpact, previewhmax) = ffse.FreefallSolveEomPreview(this.previewAltitudeLineSeries, this.previewVelocityLineSeries);
+                                    this.previewResultText = MainWindow.PreviewResultText生成(previewimpact, previewhmax);
+                                    this.Graph縦軸単位更新();
+                                }) : Task.CompletedTask;
+
+                            while (!ffse.IsCalculationFinished())
                             {
                                 // キャンセルされた場合例外をスロー           
                                 this.cts.Token.ThrowIfCancellationRequested();
 
                                 (t, h, v, stateofhmax, stateofvmax, stateofkarmanline, stateofexosphere) = ffse.FreefallSolveEomNextStep();
 
-                                if (!this.経過時間高度縦軸単位km変更フラグ && FreefallSolveEom.高度単位km変更フラグ)
-                                {
-                                    this.経過時間高度Graph縦軸設定();
-                                    this.経過時間高度縦軸単位km変更フラグ = true;
-                                }
-
-                                if (this.経過時間速度縦軸単位km_s変更フラグ || !FreefallSolveEom.速度単位km_s変更フラグ)
-                                {
-                                    continue;
-                                }
-
-                                this.経過時間速度Graph縦軸設定();
-                                this.経過時間速度縦軸単位km_s変更フラグ = true;
+                                this.Graph縦軸単位更新();
                             }
                         }
                         catch (OperationCanceledException)
@@ -481,10 +724,60 @@ namespace Freefall
                     this.cts.Token);
             }
 
+            // 終了処理で概形を消した後に概形が追加されないように、概形を求め終わるのを待つ
+            await previewTask;
+
             // 計算処理が終わった後に終了処理を行う
             this.DoEnd();
         }
 
+        /// <summary>
+        /// 軌道の概形から求めた各事象の概算値の文字列を生成する
+        /// </summary>
+        /// <param name="stateofimpact">地面に衝突した際の時間（秒）と速度（m/s）（衝突しなかった場合はnull）</param>
+        /// <param name="stateofhmax">最高到達高度の際の時間（秒）と高度（m）（発見できなかった場合はnull）</param>
+        /// <returns>各事象の概算値の文字列</returns>
+        private static String PreviewResultText生成((Double, Double)? stateofimpact, (Double, Double)? stateofhmax)
+        {
+            var resultstr = MainWindow.概算テキスト;
+            if (stateofhmax != null)
+            {
+                var (thmax, hmax) = stateofhmax.Value;
+                resultstr += hmax >= MainWindow.高度km閾値 ? $"{thmax:F1}秒後に最高到達高度{hmax / 1000.0:F1}km、" : $"{thmax:F1}秒後に最高到達高度{hmax:F1}m、";
+            }
+
+            if (stateofimpact != null)
+            {
+                var (timpact, vimpact) = stateofimpact.Value;
+                resultstr += $"{timpact:F1}秒後に{Math.Abs(vimpact):F1}m/sで地面に衝突{Environment.NewLine}";
+            }
+            else
+            {
+                resultstr += $"外気圏を脱出{Environment.NewLine}";
+            }
+
+            return resultstr;
+        }
+
+        /// <summary>
+        /// 軌道の概形の点のうち、精密な計算結果が届いた時刻までのものを削除する
+        /// </summary>
+        /// <param name="lineSeries">軌道の概形のLineSeries</param>
+        /// <param name="t">精密な計算結果が届いた時刻（秒）</param>
+        private static void PreviewPoints削除(LineSeries lineSeries, Double t)
+        {
+            lock (lineSeries)
+            {
+                var n = 0;
+                while (n < lineSeries.Points.Count && lineSeries.Points[n].X <= t)
+                {
+                    n++;
+                }
+
+                lineSeries.Points.RemoveRange(0, n);
+            }
+        }
+
         /// <summary>
         /// 計算等の処理を行う
         /// </summary>
@@ -503,28 +796,40 @@ namespace Freefall
             this.TvsAltitudePlotView.IsEnabled = false;
             this.TvsVelocityPlotView.IsEnabled = false;
 
+            // 計算に必要な各種条件を取得する
+            var (m, r, h0, v0) = this.直径to半径and単位変換();
+            var (dt, tintervalgraphplot, eps, odesolver) = this.Get各種条件();
+
+            // 比較する条件を取得する
+            var conditions = this.Get比較する条件(m, odesolver);
+            this.isComparison = conditions.Count > 0;
+
             // 計算結果のUIの初期化
-            this.Run前計算結果UI初期化();
+            this.Run前計算結果UI初期化(conditions);
 
             // ストップウォッチスタート
             this.sw.Start();
 
-            // 計算に必要な各種条件を取得する
-            var (m, r, h0, v0) = this.直径to半径and単位変換();
-            var (dt, tintervalgraphplot, eps, odesolver) = this.Get各種条件();
-
             // タイマースタート
             this.dispatcherTimer.Interval = TimeSpan.FromMilliseconds(MainWindow.TimerInterval);
             this.dispatcherTimer.Start();
             
             // 計算処理開始
-            this.ProgressStart(dt, tintervalgraphplot, eps, m, r, h0, v0, odesolver).ContinueWith(_ => {});
+            if (this.isComparison)
+            {
+                this.ComparisonProgressStart(conditions, dt, tintervalgraphplot, eps, r, h0, v0).ContinueWith(_ => {});
+            }
+            else
+            {
+                this.ProgressStart(dt, tintervalgraphplot, eps, m, r, h0, v0, odesolver).ContinueWith(_ => {});
+            }
         }
 
         /// <summary>
         /// 計算等の処理前にUIを初期化する
         /// </summary>
-        private void Run前計算結果UI初期化()
+        /// <param name="conditions">比較する各条件（比較しない場合は空）</param>
+        private void Run前計算結果UI初期化(IReadOnlyList<(String name, Double m, Int32 odesolver)> conditions)
         {
             this.CalculationRequiredTimeText.Text = MainWindow.計算所要時間テキスト;
 
@@ -540,6 +845,39 @@ namespace Freefall
             // LineSeriesのPointsを空にする
             this.altitudeLineSeries.Points.Clear();
             this.velocityLineSeries.Points.Clear();
+            this.previewAltitudeLineSeries.Points.Clear();
+            this.previewVelocityLineSeries.Points.Clear();
+            this.previewResultText = String.Empty;
+
+            // 前回の計算の経過時間で、軌道の概形を削除しないようにする
+            this.t = 0.0;
+
+            // 前回の計算のオブジェクトで、グラフの点を取得し直さないようにする
+            this.ffse = null;
+            foreach (var se in this.comparisonFfse)
+            {
+                se.Dispose();
+            }
+
+            this.comparisonFfse.Clear();
+
+            // 比較する場合は、条件ごとに色を変えたLineSeriesを用意する
+            this.comparisonAltitudeLineSeries.Clear();
+            this.comparisonVelocityLineSeries.Clear();
+            for (var i = 0; i < conditions.Count; i++)
+            {
+                var color = MainWindow.比較グラフの色[i % MainWindow.比較グラフの色.Length];
+                this.comparisonAltitudeLineSeries.Add(new LineSeries() { Color = color, Title = conditions[i].name });
+                this.comparisonVelocityLineSeries.Add(new LineSeries() { Color = color, Title = conditions[i].name });
+            }
+
+            // 比較する場合は、最高速度等の代わりに比較結果の表を表示する
+            this.comparisonResults = null;
+            this.比較結果DataGrid.ItemsSource = null;
+            this.比較結果DataGrid.Visibility = this.isComparison ? Visibility.Visible : Visibility.Collapsed;
+            this.MaximumVelocityText.Visibility = this.isComparison ? Visibility.Collapsed : Visibility.Visible;
+            this.MaximumReachableAltitudeText.Visibility = this.isComparison ? Visibility.Collapsed : Visibility.Visible;
+            this.CalculateResultText.Visibility = this.isComparison ? Visibility.Collapsed : Visibility.Visible;
 
             // 何も表示されないグラフをプロット
             this.GraphPlot(false);
@@ -553,6 +891,13 @@ namespace Freefall
             // 計算結果をグラフにプロット
             this.GraphPlot(false);
 
+            if (this.isComparison)
+            {
+                // 比較結果の表を表示
+                this.比較結果DataGrid.ItemsSource = this.comparisonResults;
+                return;
+            }
+
             // 「MaximumVelocityText」TextBlockのテキストを生成し、表示
             this.MaximumVelocityText生成();
 
@@ -659,6 +1004,63 @@ namespace Freefall
             return (m, r, h0, v0);
         }
 
+        /// <summary>
+        /// 球の質量の文字列を、基準の単位（kg）の値に変換する
+        /// </summary>
+        /// <param name="str">単位（g、kg、または省略）付きの球の質量の文字列</param>
+        /// <returns>球の質量（kg）（解釈できない場合と、正でない場合はnull）</returns>
+        private static Double? 質量単位変換(String str)
+        {
+            if (!Double.TryParse(Regex.Replace(str, @"[^0-9.]", String.Empty), out Double m) || m <= 0.0)
+            {
+                return null;
+            }
+
+            switch (Regex.Replace(str, @"[^a-z]", String.Empty))
+            {
+                case "g":
+                    return m * 0.001;
+
+                case "kg":
+                case "":
+                    return m;
+
+                default:
+                    return null;
+            }
+        }
+
+        /// <summary>
+        /// 計算中にグラフの縦軸の単位を変更する必要が生じた場合に、縦軸を設定し直す
+        /// （計算を行うワーカースレッドから呼び出された場合は、UIスレッドで設定し直す）
+        /// </summary>
+        private void Graph縦軸単位更新()
+        {
+            if (!this.Dispatcher.CheckAccess())
+            {
+                // OxyPlotの軸とフラグはUIスレッドでだけ変更する（変更が必要な場合だけ、Dispatcherに処理を移す）
+                if ((!this.経過時間高度縦軸単位km変更フラグ && FreefallSolveEom.高度単位km変更フラグ) ||
+                    (!this.経過時間速度縦軸単位km_s変更フラグ && FreefallSolveEom.速度単位km_s変更フラグ))
+                {
+                    this.Dispatcher.InvokeAsync(this.Graph縦軸単位更新);
+                }
+
+                return;
+            }
+
+            if (!this.経過時間高度縦軸単位km変更フラグ && FreefallSolveEom.高度単位km変更フラグ)
+            {
+                this.経過時間高度Graph縦軸設定();
+                this.経過時間高度縦軸単位km変更フラグ = true;
+            }
+
+            if (!this.経過時間速度縦軸単位km_s変更フラグ && FreefallSolveEom.速度単位km_s変更フラグ)
+            {
+                this.経過時間速度Graph縦軸設定();
+                this.経過時間速度縦軸単位km_s変更フラグ = true;
+            }
+        }
+
         /// <summary>
         /// 経過時間－高度の関係のグラフの縦軸と、それに関連するフラグを元に戻す
         /// </summary>
@@ -688,13 +1090,10 @@ namespace Freefall
         /// </summary>
         private void 経過時間高度Graph縦軸設定()
         {
-            // 経過時間－高度の関係のグラフの縦軸を削除
-            this.mwvm.TvsAltitudePlotModel.Axes.RemoveAt(1);
-
-            // 経過時間－高度の関係のグラフの軸を設定
-            this.mwvm.TvsAltitudePlotModel.Axes.Add(FreefallSolveEom.Is高度単位km
-                ? new LinearAxis {Minimum = 0.0, Position = AxisPosition.Left, Title = "高度（km）"}
-                : new LinearAxis {Minimum = 0.0, Position = AxisPosition.Left, Title = "高度（m）"});
+            // 点はm単位のまま、縦軸の表示だけをkmにする
+            var axis = (ScaledLinearAxis)this.mwvm.TvsAltitudePlotModel.Axes[1];
+            axis.DisplayScale = FreefallSolveEom.Is高度単位km ? 1000.0 : 1.0;
+            axis.Title = FreefallSolveEom.Is高度単位km ? "高度（km）" : "高度（m）";
         }
 
         /// <summary>
@@ -702,13 +1101,10 @@ namespace Freefall
         /// </summary>
         private void 経過時間速度Graph縦軸設定()
         {
-            // 経過時間－速度の関係のグラフの縦軸を削除
-            this.mwvm.TvsVelocityPlotModel.Axes.RemoveAt(1);
-
-            // 経過時間－速度の関係のグラフの軸を設定
-            this.mwvm.TvsVelocityPlotModel.Axes.Add(FreefallSolveEom.Is速度単位km_s
-                ? new LinearAxis {Position = AxisPosition.Left, Title = "速度（km/s）"}
-                : new LinearAxis {Position = AxisPosition.Left, Title = "速度（m/s）"});
+            // 点はm/s単位のまま、縦軸の表示だけをkm/sにする
+            var axis = (ScaledLinearAxis)this.mwvm.TvsVelocityPlotModel.Axes[1];
+            axis.DisplayScale = FreefallSolveEom.Is速度単位km_s ? 1000.0 : 1.0;
+            axis.Title = FreefallSolveEom.Is速度単位km_s ? "速度（km/s）" : "速度（m/s）";
         }
 
         #endregion メソッド
@@ -761,6 +1157,14 @@ namespace Freefall
         {
             this.CalculationRequiredTimeText.Text = $"{MainWindow.計算所要時間テキスト}{this.sw.Elapsed.TotalSeconds:F2}秒";
 
+            if (this.isComparison)
+            {
+                // 比較している各条件のこれまでに届いた点から、表示に必要な点を取得し、リアルタイムにグラフプロット
+                this.Graph点更新();
+                this.GraphPlot(true);
+                return;
+            }
+
             this.MaximumVelocityText生成();
 
             if (this.stateofhmax != null)
@@ -772,13 +1176,9 @@ namespace Freefall
             }
 
             var 高度str = "現在高度：";
-            if (FreefallSolveEom.高度単位km変更フラグ && Math.Abs(h) < 10.0)
+            if (FreefallSolveEom.高度単位km変更フラグ && Math.Abs(h) >= 10000.0)
             {
-                高度str += $"{h * 1000.0:F1}m{Environment.NewLine}";
-            }
-            else if (FreefallSolveEom.高度単位km変更フラグ)
-            {
-                高度str += $"{h:F1}km{Environment.NewLine}";
+                高度str += $"{h / 1000.0:F1}km{Environment.NewLine}";
             }
             else
             {
@@ -786,13 +1186,9 @@ namespace Freefall
             }
 
             var 速度str = "現在速度：";
-            if (FreefallSolveEom.速度単位km_s変更フラグ && Math.Abs(v) < 1.0)
-            {
-                速度str += $"{v * 1000.0:F1}m/s（{v * 3600.0:F1}km/h）";
-            }
-            else if (FreefallSolveEom.速度単位km_s変更フラグ)
+            if (FreefallSolveEom.速度単位km_s変更フラグ && Math.Abs(v) >= 1000.0)
             {
-                速度str += $"{v:F1}km/s（{v * 3600.0:F1}km/h）";
+                速度str += $"{v / 1000.0:F1}km/s（{v * 3.6:F1}km/h）";
             }
             else
             {
@@ -800,7 +1196,14 @@ namespace Freefall
             }
 
             // 経過時間、現在高度、現在速度を表示
-            this.CalculateResultText.Text = this.CalculateResultText生成() + $"経過時間：{t:F1}秒{Environment.NewLine}" + 高度str + 速度str;
+            this.CalculateResultText.Text = this.CalculateResultText生成() + this.previewResultText + $"経過時間：{t:F1}秒{Environment.NewLine}" + 高度str + 速度str;
+
+            // 精密な計算結果が届いた区間の軌道の概形を削除
+            MainWindow.PreviewPoints削除(this.previewAltitudeLineSeries, this.t);
+            MainWindow.PreviewPoints削除(this.previewVelocityLineSeries, this.t);
+
+            // これまでに届いた点から、表示に必要な点を取得
+            this.Graph点更新();
 
             // 計算結果をリアルタイムにグラフプロット
             this.GraphPlot(true);
@@ -909,6 +1312,10 @@ namespace Freefall
             // タイマーを作成する
             this.dispatcherTimer = new DispatcherTimer(DispatcherPriority.Normal, this.Dispatcher);
             this.dispatcherTimer.Tick += this.DispatcherTimer_Tick;
+
+            // ズームやパンで表示する範囲が変わったら、その範囲に必要な点を取得し直す
+            this.mwvm.TvsAltitudePlotModel.Axes[0].AxisChanged += this.経過時間軸_AxisChanged;
+            this.mwvm.TvsVelocityPlotModel.Axes[0].AxisChanged += this.経過時間軸_AxisChanged;
         }
 
         /// <summary>
@@ -1089,6 +1496,49 @@ namespace Freefall
             this.textBox自動変更 = false;
         }
 
+        /// <summary>
+        /// 「比較の種類ComboBox」の選択要素が変更されたとき呼ばれるイベントハンドラ
+        /// </summary>
+        /// <param name="sender">The parameter is not used.</param>
+        /// <param name="e">The parameter is not used.</param>
+        private void 比較の種類ComboBox_OnSelectionChanged(object sender, SelectionChangedEventArgs e)
+        {
+            // XAMLの読み込み中（比較する質量TextBoxの生成前）にも呼ばれる
+            if (this.比較する質量TextBox == null)
+            {
+                return;
+            }
+
+            // 比較する質量は、球の質量を変えて比較する場合だけ入力できる
+            this.比較する質量TextBox.IsEnabled = (ComparisonKind)this.比較の種類ComboBox.SelectedIndex == ComparisonKind.球の質量;
+        }
+
+        /// <summary>
+        /// グラフの横軸（経過時間）がズーム、パン、リセットされたときに呼ばれるイベントハンドラ
+        /// </summary>
+        /// <param name="sender">変更されたグラフの横軸</param>
+        /// <param name="e">変更の種類が格納されたAxisChangedEventArgs</param>
+        private void 経過時間軸_AxisChanged(object sender, AxisChangedEventArgs e)
+        {
+            if (e.ChangeType == AxisChangeTypes.Reset)
+            {
+                this.zoomedAxes.Remove((Axis)sender);
+            }
+            else
+            {
+                this.zoomedAxes.Add((Axis)sender);
+            }
+
+            // 計算中はタイマーで点を取得し直すので、計算していない場合だけ取得し直す
+            if (this.os != OperationState.処理開始待機中)
+            {
+                return;
+            }
+
+            this.Graph点更新();
+            this.GraphPlot(false);
+        }
+
         /// <summary>
         /// 「計算開始・キャンセル」ボタンを押したときに呼ばれるイベントハンドラ
         /// </summary>
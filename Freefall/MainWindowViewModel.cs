@@ -329,7 +329,7 @@ namespace Freefall
                 Axes =
                 {
                     new LinearAxis { Minimum = 0.0, Position = AxisPosition.Bottom, Title = "経過時間（秒）" },
-                    new LinearAxis { Minimum = 0.0, Position = AxisPosition.Left, Title = "高度（m）" }
+                    new ScaledLinearAxis { Minimum = 0.0, Position = AxisPosition.Left, Title = "高度（m）" }
                 },
                 Title = "経過時間と高度の関係"
             };
@@ -339,7 +339,7 @@ namespace Freefall
                 Axes =
                 {
                     new LinearAxis { Minimum = 0.0, Position = AxisPosition.Bottom, Title = "経過時間（秒）" },
-                    new LinearAxis { Position = AxisPosition.Left, Title = "速度（m/s）" }
+                    new ScaledLinearAxis { Position = AxisPosition.Left, Title = "速度（m/s）" }
                 },
                 Title = "経過時間と速度の関係"
             };
@@ -27,6 +27,8 @@ module DefaultData =
          | ADAMS_BASHFORTH_MOULTON = 0
          | BULIRSCH_STOER          = 1
          | CONTROLLED_RUNGE_KUTTA  = 2
+         | ROSENBROCK              = 3
+         | AUTO                    = 4
  
     /// <summary>
     /// Freefallのデフォルト値を集めた構造体
@@ -62,6 +64,16 @@ module DefaultData =
             // デフォルトで計算結果をCSVファイルに保存する
             /// </summary>
             static member DefaultIsOutputToCsvFile = false
+
+            /// <summary>
+            /// デフォルトで精密な計算と並行して軌道の概形を表示する
+            /// </summary>
+            static member DefaultIsProgressivePreview = true
+
+            /// <summary>
+            /// デフォルトでは事象から遠い区間で許容誤差を緩めない（緩めると事象の時刻が僅かにずれるため）
+            /// </summary>
+            static member DefaultIsToleranceSchedule = false
             
             /// <summary>
             /// デフォルトの常微分方程式の数値解法
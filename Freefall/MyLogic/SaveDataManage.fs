@@ -3,6 +3,7 @@
 module SaveDataManage =
     open System
     open System.IO
+    open System.Runtime.Serialization
     open System.Runtime.Serialization.Formatters.Binary
     open DefaultData
     open MyError
@@ -65,6 +66,18 @@ module SaveDataManage =
         /// </summary>
         let mutable isOutputToCsvFile = DefaultDataDefinition.DefaultIsOutputToCsvFile
 
+        /// <summary>
+        /// 精密な計算と並行して軌道の概形を表示するかどうか（この項目のない古いdatファイルも読み込めるようにする）
+        /// </summary>
+        [<OptionalField>]
+        let mutable isProgressivePreview = DefaultDataDefinition.DefaultIsProgressivePreview
+
+        /// <summary>
+        /// 事象から遠い区間で許容誤差を緩めるかどうか（この項目のない古いdatファイルも読み込めるようにする）
+        /// </summary>
+        [<OptionalField>]
+        let mutable isToleranceSchedule = DefaultDataDefinition.DefaultIsToleranceSchedule
+
         /// <summary>
         // 球の質量
         /// </summary>
@@ -149,6 +162,20 @@ module SaveDataManage =
             with get() = isOutputToCsvFile
             and set(value) = isOutputToCsvFile <- value
 
+        /// <summary>
+        /// 精密な計算と並行して軌道の概形を表示するかどうか
+        /// </summary>
+        member public this.IsProgressivePreview
+            with get() = isProgressivePreview
+            and set(value) = isProgressivePreview <- value
+
+        /// <summary>
+        /// 事象から遠い区間で許容誤差を緩めるかどうか
+        /// </summary>
+        member public this.IsToleranceSchedule
+            with get() = isToleranceSchedule
+            and set(value) = isToleranceSchedule <- value
+
         /// <summary>
         // 球の質量
         /// </summary>
@@ -165,6 +192,19 @@ module SaveDataManage =
         
         // #endregion プロパティ
 
+        // #region メソッド
+
+        /// <summary>
+        /// 逆シリアル化の前に呼ばれ、古いdatファイルにない項目をデフォルト値にする
+        /// （逆シリアル化ではコンストラクタが呼ばれないので、何もしないとfalseになる）
+        /// </summary>
+        [<OnDeserializing>]
+        member private this.SetDefaultOfOptionalFields(_ : StreamingContext) =
+            isProgressivePreview <- DefaultDataDefinition.DefaultIsProgressivePreview
+            isToleranceSchedule <- DefaultDataDefinition.DefaultIsToleranceSchedule
+
+        // #endregion メソッド
+
     /// <summary>
     /// 設定情報データをインポート・エクスポートするクラス
     /// </summary>
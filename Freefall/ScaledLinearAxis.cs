@@ -0,0 +1,49 @@
+﻿//-----------------------------------------------------------------------
+// <copyright file="ScaledLinearAxis.cs" company="dc1394's software">
+//     Copyright © 2018 @dc1394 All Rights Reserved.
+// </copyright>
+//-----------------------------------------------------------------------
+namespace Freefall
+{
+    using System;
+    using OxyPlot.Axes;
+
+    /// <summary>
+    /// プロットする値はSI単位のまま、目盛りのラベルとトラッカーに表示する値だけを指定した倍率で割る線形の軸
+    /// </summary>
+    internal sealed class ScaledLinearAxis : LinearAxis
+    {
+        #region プロパティ
+
+        /// <summary>
+        /// 表示する値を求めるためにSI単位の値を割る倍率（m→kmの場合は1000）
+        /// </summary>
+        internal Double DisplayScale { get; set; } = 1.0;
+
+        #endregion プロパティ
+
+        #region メソッド
+
+        /// <summary>
+        /// トラッカーに表示する値を返す
+        /// </summary>
+        /// <param name="x">SI単位の値</param>
+        /// <returns>倍率で割った値</returns>
+        public override Object GetValue(Double x)
+        {
+            return x / this.DisplayScale;
+        }
+
+        /// <summary>
+        /// 目盛りのラベルの文字列を返す
+        /// </summary>
+        /// <param name="x">SI単位の値</param>
+        /// <returns>倍率で割った値の文字列</returns>
+        protected override String FormatValueOverride(Double x)
+        {
+            return base.FormatValueOverride(x / this.DisplayScale);
+        }
+
+        #endregion メソッド
+    }
+}
@@ -152,6 +152,10 @@ namespace Freefall
 
             this.IsOutputToCsvFileCheckBox.IsChecked = DefaultData.DefaultDataDefinition.DefaultIsOutputToCsvFile;
 
+            this.IsToleranceScheduleCheckBox.IsChecked = DefaultData.DefaultDataDefinition.DefaultIsToleranceSchedule;
+
+            this.IsProgressivePreviewCheckBox.IsChecked = DefaultData.DefaultDataDefinition.DefaultIsProgressivePreview;
+
             switch (DefaultData.DefaultDataDefinition.DefaultOdeSolverType)
             {
                 case DefaultData.OdeSolverType.ADAMS_BASHFORTH_MOULTON:
@@ -166,6 +170,14 @@ namespace Freefall
                     this.ControlledRungeKuttaRadioButton.IsChecked = true;
                     break;
 
+                case DefaultData.OdeSolverType.ROSENBROCK:
+                    this.RosenbrockRadioButton.IsChecked = true;
+                    break;
+
+                case DefaultData.OdeSolverType.AUTO:
+                    this.AutoRadioButton.IsChecked = true;
+                    break;
+
                 default:
                     Debug.Assert(false, "DefaultData.DefaultDataDefinition.DefaultOdeSolverTypeがあり得ない値になっている！");
                     break;
@@ -249,6 +261,10 @@ namespace Freefall
             this.sd.DeltatOfOdeSolver = this.swvm.DeltatOfOdeSolver;
             
             this.sd.IsOutputToCsvFile = this.IsOutputToCsvFileCheckBox.IsChecked ?? false;
+
+            this.sd.IsToleranceSchedule = this.IsToleranceScheduleCheckBox.IsChecked ?? false;
+
+            this.sd.IsProgressivePreview = this.IsProgressivePreviewCheckBox.IsChecked ?? false;
             
             this.sd.OdeSolver = this.swvm.OdeSolver;
 
@@ -285,6 +301,10 @@ namespace Freefall
 
             this.swvm.EpsOfSolveOde = this.sd.EpsOfSolveOde;
 
+            this.IsToleranceScheduleCheckBox.IsChecked = this.sd.IsToleranceSchedule;
+
+            this.IsProgressivePreviewCheckBox.IsChecked = this.sd.IsProgressivePreview;
+
             this.IsOutputToCsvFileCheckBox.IsChecked = this.sd.IsOutputToCsvFile;
 
             this.IsOutputToCsvFileCheckBox.RaiseEvent(this.sd.IsOutputToCsvFile
@@ -313,6 +333,8 @@ namespace Freefall
 
                 case DefaultData.OdeSolverType.BULIRSCH_STOER:
                 case DefaultData.OdeSolverType.CONTROLLED_RUNGE_KUTTA:
+                case DefaultData.OdeSolverType.ROSENBROCK:
+                case DefaultData.OdeSolverType.AUTO:
                     this.EpsOfSolveOdeTextBox.IsEnabled = true;
 
                     // ヴァリデーション有効
@@ -13,6 +13,15 @@ namespace Freefall
     /// </summary>
     internal static class UnsafeNativeMethods
     {
+        #region フィールド
+
+        /// <summary>
+        /// CreateInstanceで生成したオブジェクトに対する関数が、無効なハンドル（生成していないか、既に破棄したもの）を指定された場合に返す値
+        /// </summary>
+        private static readonly Int32 無効なハンドル = -1;
+
+        #endregion フィールド
+
         #region メソッド
 
         /// <summary>
@@ -25,6 +34,105 @@ namespace Freefall
             Boolean ishmax, isvmax, iskarmanline, isexosphere, issecondescape;
             UnsafeNativeMethods.NextStep(&t, &h, &v, &ishmax, &thmax, &hmax, &isvmax, &tvmax, &hvmax, &vmax, &iskarmanline, &tkarmanline, &vkarmanline, &isexosphere, &texosphere, &vexosphere, &issecondescape);
 
+            return UnsafeNativeMethods.ToState(t, h, v, ishmax, thmax, hmax, isvmax, tvmax, hvmax, vmax, iskarmanline, tkarmanline, vkarmanline, isexosphere, texosphere, vexosphere, issecondescape);
+        }
+
+        /// <summary>
+        /// CreateInstanceで生成したオブジェクトについて、空気抵抗のある自由落下系における運動方程式を与えられた時間だけ解き、状態を求める
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <returns>系の状態が詰まったSystem.ValueTuple</returns>
+        internal static unsafe (Double , Double , Double , (Double, Double)?, (Double, Double, Double)?, (Double, Double)?, (Double, Double, Boolean)?) FreefallSolveEomNextStep(Int32 handle)
+        {
+            Double t, h, v, thmax, hmax, tvmax, hvmax, vmax, tkarmanline, vkarmanline, texosphere, vexosphere;
+            Boolean ishmax, isvmax, iskarmanline, isexosphere, issecondescape;
+            UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.NextStep(handle, &t, &h, &v, &ishmax, &thmax, &hmax, &isvmax, &tvmax, &hvmax, &vmax, &iskarmanline, &tkarmanline, &vkarmanline, &isexosphere, &texosphere, &vexosphere, &issecondescape));
+
+            return UnsafeNativeMethods.ToState(t, h, v, ishmax, thmax, hmax, isvmax, tvmax, hvmax, vmax, iskarmanline, tkarmanline, vkarmanline, isexosphere, texosphere, vexosphere, issecondescape);
+        }
+
+        /// <summary>
+        /// FreefallInitで指定した条件で、運動方程式を大きな時間刻みと緩い許容誤差で最後まで解き、軌道の概形と各事象の概算値を求める
+        /// </summary>
+        /// <returns>軌道の概形の経過時間、高度、速度の配列と、地面に衝突した際の時間と速度、最高到達高度の際の時間と高度が詰まったSystem.ValueTuple</returns>
+        internal static unsafe (Double[] t, Double[] h, Double[] v, (Double, Double)? stateofimpact, (Double, Double)? stateofhmax) FreefallSolveEomPreview()
+        {
+            var value = new Double[10];
+            var isvalid = stackalloc Boolean[10];
+
+            Int32 n;
+            fixed (Double * pvalue = value)
+            {
+                n = UnsafeNativeMethods.Preview(pvalue, isvalid);
+            }
+
+            var t = new Double[n];
+            var h = new Double[n];
+            var v = new Double[n];
+            fixed (Double * pt = t, ph = h, pv = v)
+            {
+                UnsafeNativeMethods.GetPreviewPoints(pt, ph, pv);
+            }
+
+            // 各事象の並びは、地面衝突時、最高到達高度、最高速度、カーマン・ライン突破時、外気圏脱出時の順
+            (Double, Double)? stateofimpact = isvalid[0] ? (value[0], value[1]) : ((Double, Double)?)null;
+            (Double, Double)? stateofhmax = isvalid[2] ? (value[2], value[3]) : ((Double, Double)?)null;
+
+            return (t, h, v, stateofimpact, stateofhmax);
+        }
+
+        /// <summary>
+        /// EnableTrajectoryPyramidの後にNextStepが返した点のうち、時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を取得する
+        /// </summary>
+        /// <param name="handle">CreateInstanceで生成したオブジェクトのハンドル（FreefallInitで生成したオブジェクトの場合はnull）</param>
+        /// <param name="tmin">範囲の最初の時刻（秒）</param>
+        /// <param name="tmax">範囲の最後の時刻（秒）</param>
+        /// <param name="npixels">横方向のピクセル数</param>
+        /// <returns>経過時間、高度、速度の配列が詰まったSystem.ValueTuple</returns>
+        internal static unsafe (Double[] t, Double[] h, Double[] v) FreefallSolveEomQueryTrajectory(Int32? handle, Double tmin, Double tmax, Int32 npixels)
+        {
+            // 取得する点の数は、ピクセル数の4倍に6を足した数を超えない
+            var t = new Double[4 * npixels + 6];
+            var h = new Double[4 * npixels + 6];
+            var v = new Double[4 * npixels + 6];
+
+            Int32 n;
+            fixed (Double * pt = t, ph = h, pv = v)
+            {
+                n = handle != null ?
+                    UnsafeNativeMethods.ハンドル検証(UnsafeNativeMethods.QueryTrajectory(handle.Value, tmin, tmax, npixels, pt, ph, pv)) :
+                    UnsafeNativeMethods.QueryTrajectory(tmin, tmax, npixels, pt, ph, pv);
+            }
+
+            Array.Resize(ref t, n);
+            Array.Resize(ref h, n);
+            Array.Resize(ref v, n);
+
+            return (t, h, v);
+        }
+
+        /// <summary>
+        /// CreateInstanceで生成したオブジェクトに対する関数の戻り値を調べ、ハンドルが無効だった場合は例外をスローする
+        /// （DLL側は無効なハンドルに対しては何もしないので、結果を使わずにここで止める）
+        /// </summary>
+        /// <param name="result">関数の戻り値</param>
+        /// <returns>関数の戻り値</returns>
+        internal static Int32 ハンドル検証(Int32 result)
+        {
+            if (result == UnsafeNativeMethods.無効なハンドル)
+            {
+                throw new ObjectDisposedException(nameof(FreefallSolveEom), "DLL側のオブジェクトのハンドルが無効です（既に破棄されています）");
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// NextStepが返した値（引数はNextStepと同じ）を、系の状態が詰まったSystem.ValueTupleにまとめる
+        /// </summary>
+        /// <returns>系の状態が詰まったSystem.ValueTuple</returns>
+        private static (Double , Double , Double , (Double, Double)?, (Double, Double, Double)?, (Double, Double)?, (Double, Double, Boolean)?) ToState(Double t, Double h, Double v, Boolean ishmax, Double thmax, Double hmax, Boolean isvmax, Double tvmax, Double hvmax, Double vmax, Boolean iskarmanline, Double tkarmanline, Double vkarmanline, Boolean isexosphere, Double texosphere, Double vexosphere, Boolean issecondescape)
+        {
             (Double, Double)? stateofhmax = null;
             if (ishmax)
             {
@@ -52,6 +160,77 @@ namespace Freefall
             return (t, h, v, stateofhmax, stateofvmax, stateofkarmnline, stateofexosphere);
         }
 
+        /// <summary>
+        /// 空気抵抗のある自由落下系に対して運動方程式を解くクラスのオブジェクトを、FreefallInitのものとは別に生成する（CSVファイルに結果を出力しない）
+        /// ハンドルを指定する各メソッドは、ハンドルごとに別のスレッドから同時に呼び出してよい
+        /// </summary>
+        /// <param name="dt">常微分方程式の数値解法の時間刻み（秒）</param>
+        /// <param name="tintervalgraphplot">グラフプロット用の時間間隔（秒）</param>
+        /// <param name="eps">常微分方程式の数値解法の許容誤差</param>
+        /// <param name="m">球の質量（kg）</param>
+        /// <param name="r">球の半径（m）</param>
+        /// <param name="h0">初期高度（m）</param>
+        /// <param name="v0">初期速度（m/s）</param>
+        /// <param name="odeSolverType">常微分方程式の数値解法</param>
+        /// <returns>生成したオブジェクトのハンドル</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "createinstance")]
+        internal static extern Int32 CreateInstance(Double dt, Double tintervalgraphplot, Double eps, Double m, Double r, Double h0, Double v0, Int32 odeSolverType);
+
+        /// <summary>
+        /// CreateInstanceで生成したオブジェクトを破棄する
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        [DllImport("freefallsolveeom", EntryPoint = "destroyinstance")]
+        internal static extern void DestroyInstance(Int32 handle);
+
+        /// <summary>
+        /// 以降のNextStepが、グラフを折れ線で描いた際の誤差が許容誤差を超える点だけを返すようにする（FreefallInitの後、最初のNextStepより前に呼び出す）
+        /// </summary>
+        /// <param name="reltol">高度と速度の、それまでの最大の絶対値に対する許容誤差</param>
+        /// <param name="maxgap">返す点の時刻の最大の間隔（秒）</param>
+        [DllImport("freefallsolveeom", EntryPoint = "enableadaptivesampling")]
+        internal static extern void EnableAdaptiveSampling(Double reltol, Double maxgap);
+
+        /// <summary>
+        /// EnableAdaptiveSamplingの、CreateInstanceで生成したオブジェクトに対する版
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <param name="reltol">高度と速度の、それまでの最大の絶対値に対する許容誤差</param>
+        /// <param name="maxgap">返す点の時刻の最大の間隔（秒）</param>
+        /// <returns>成功した場合は0、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "enableadaptivesamplingof")]
+        internal static extern Int32 EnableAdaptiveSampling(Int32 handle, Double reltol, Double maxgap);
+
+        /// <summary>
+        /// 以降のNextStepが返す点を、解像度の異なる最小値・最大値の階層とともにDLL側に記録するようにする（FreefallInitの後、最初のNextStepより前に呼び出す）
+        /// </summary>
+        [DllImport("freefallsolveeom", EntryPoint = "enabletrajectorypyramid")]
+        internal static extern void EnableTrajectoryPyramid();
+
+        /// <summary>
+        /// EnableTrajectoryPyramidの、CreateInstanceで生成したオブジェクトに対する版
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <returns>成功した場合は0、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "enabletrajectorypyramidof")]
+        internal static extern Int32 EnableTrajectoryPyramid(Int32 handle);
+
+        /// <summary>
+        /// 以降の計算で、どの事象からも遠い区間では許容誤差をepsmaxまで緩めるようにする（FreefallInitの後、最初のNextStepより前に呼び出す）
+        /// </summary>
+        /// <param name="epsmax">最も緩い許容誤差（FreefallInitに渡した許容誤差以上）</param>
+        [DllImport("freefallsolveeom", EntryPoint = "enabletoleranceschedule")]
+        internal static extern void EnableToleranceSchedule(Double epsmax);
+
+        /// <summary>
+        /// EnableToleranceScheduleの、CreateInstanceで生成したオブジェクトに対する版
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <param name="epsmax">最も緩い許容誤差（CreateInstanceに渡した許容誤差以上）</param>
+        /// <returns>成功した場合は0、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "enabletolerancescheduleof")]
+        internal static extern Int32 EnableToleranceSchedule(Int32 handle, Double epsmax);
+
         /// <summary>
         /// 空気抵抗のある自由落下系に対して運動方程式を解くクラスのコンストラクタ（CSVファイルに結果を出力しない）を呼び出す
         /// </summary>
@@ -82,6 +261,15 @@ namespace Freefall
         [DllImport("freefallsolveeom", EntryPoint = "initofcsvoutput", CharSet = CharSet.Ansi)]
         internal static extern void FreefallInit(Double dt, Double tintervalgraphplot, Double tintervaloutputcsv, String csvfilename, Double eps, Double m, Double r, Double h0, Double v0, Int32 odeSolverType);
 
+        /// <summary>
+        /// Previewで求めた軌道の概形の点を取得する
+        /// </summary>
+        /// <param name="t">経過時間（秒）の配列へのポインタ（要素数はPreviewの返り値、返り値として使用）</param>
+        /// <param name="h">高度（m）の配列へのポインタ（要素数はPreviewの返り値、返り値として使用）</param>
+        /// <param name="v">速度（m/s）の配列へのポインタ（要素数はPreviewの返り値、返り値として使用）</param>
+        [DllImport("freefallsolveeom", EntryPoint = "getpreviewpoints")]
+        private static extern unsafe void GetPreviewPoints(Double * t, Double * h, Double * v);
+
         /// <summary>
         /// 計算が終了したかどうかを調べる
         /// </summary>
@@ -89,6 +277,21 @@ namespace Freefall
         [DllImport("freefallsolveeom", EntryPoint = "iscalculationfinished")]
         internal static extern Int32 IsCalculationFinished();
 
+        /// <summary>
+        /// IsCalculationFinishedの、CreateInstanceで生成したオブジェクトに対する版
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <returns>計算が終了していたら1、していなかったら0、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "iscalculationfinishedof")]
+        internal static extern Int32 IsCalculationFinished(Int32 handle);
+
+        /// <summary>
+        /// CSVファイルへの書き出しに失敗したかどうかを調べる
+        /// </summary>
+        /// <returns>書き出しに失敗していたら1、していなかったら0</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "iswritefailed")]
+        internal static extern Int32 IsWriteFailed();
+
         /// <summary>
         /// 空気抵抗のある自由落下系における運動方程式を与えられた時間だけ解き、状態を求める
         /// </summary>
@@ -112,6 +315,50 @@ namespace Freefall
         [DllImport("freefallsolveeom", EntryPoint = "nextstep")]
         private static extern unsafe void NextStep(Double * t, Double * h, Double * v, Boolean * ishmax, Double * thmax, Double * hmax, Boolean * isvmax, Double * tvmax, Double * hvmax, Double * vmax, Boolean * iskarmanline, Double * tkarmanline, Double * vkarmanline, Boolean * isexosphere, Double * texosphere, Double * vexosphere, Boolean * issecondescape);
 
+        /// <summary>
+        /// NextStepの、CreateInstanceで生成したオブジェクトに対する版（引数はhandle以外NextStepと同じ）
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <returns>成功した場合は0、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "nextstepof")]
+        private static extern unsafe Int32 NextStep(Int32 handle, Double * t, Double * h, Double * v, Boolean * ishmax, Double * thmax, Double * hmax, Boolean * isvmax, Double * tvmax, Double * hvmax, Double * vmax, Boolean * iskarmanline, Double * tkarmanline, Double * vkarmanline, Boolean * isexosphere, Double * texosphere, Double * vexosphere, Boolean * issecondescape);
+
+        /// <summary>
+        /// FreefallInitで指定した条件で、運動方程式を大きな時間刻みと緩い許容誤差で最後まで解き、軌道の概形と各事象の概算値を求める
+        /// </summary>
+        /// <param name="value">各事象の概算値（要素数10の配列へのポインタ、返り値として使用）</param>
+        /// <param name="isvalid">各事象が発生したかどうか（要素数10の配列へのポインタ、返り値として使用）</param>
+        /// <returns>軌道の概形の点の数</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "preview")]
+        private static extern unsafe Int32 Preview(Double * value, Boolean * isvalid);
+
+        /// <summary>
+        /// EnableTrajectoryPyramidの後にNextStepが返した点のうち、時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を取得する
+        /// </summary>
+        /// <param name="tmin">範囲の最初の時刻（秒）</param>
+        /// <param name="tmax">範囲の最後の時刻（秒）</param>
+        /// <param name="npixels">横方向のピクセル数</param>
+        /// <param name="t">経過時間（秒）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <param name="h">高度（m）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <param name="v">速度（m/s）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <returns>取得した点の数</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "querytrajectory")]
+        private static extern unsafe Int32 QueryTrajectory(Double tmin, Double tmax, Int32 npixels, Double * t, Double * h, Double * v);
+
+        /// <summary>
+        /// QueryTrajectoryの、CreateInstanceで生成したオブジェクトに対する版
+        /// </summary>
+        /// <param name="handle">オブジェクトのハンドル</param>
+        /// <param name="tmin">範囲の最初の時刻（秒）</param>
+        /// <param name="tmax">範囲の最後の時刻（秒）</param>
+        /// <param name="npixels">横方向のピクセル数</param>
+        /// <param name="t">経過時間（秒）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <param name="h">高度（m）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <param name="v">速度（m/s）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）</param>
+        /// <returns>取得した点の数、ハンドルが無効な場合は-1</returns>
+        [DllImport("freefallsolveeom", EntryPoint = "querytrajectoryof")]
+        private static extern unsafe Int32 QueryTrajectory(Int32 handle, Double tmin, Double tmax, Int32 npixels, Double * t, Double * h, Double * v);
+
         #endregion メソッド
     }
 }
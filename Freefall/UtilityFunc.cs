@@ -69,6 +69,27 @@ namespace Freefall
         硬式野球のボール = 9
     }
 
+    /// <summary>
+    /// 複数の条件を同時に解いて比較する際の、変える条件の列挙型
+    /// </summary>
+    public enum ComparisonKind
+    {
+        /// <summary>
+        /// 比較しない
+        /// </summary>
+        なし = 0,
+
+        /// <summary>
+        /// 常微分方程式の数値解法を変える
+        /// </summary>
+        数値解法 = 1,
+
+        /// <summary>
+        /// 球の質量を変える
+        /// </summary>
+        球の質量 = 2
+    }
+
     #endregion 列挙型
 
     /// <summary>
@@ -0,0 +1,283 @@
+﻿/*! \file freefallserver.cpp
+    \brief 常駐して、クライアントから受け取ったシミュレーションのジョブをワーカースレッドのプールで実行するサーバ
+
+    使い方:
+        freefallserver [--port ポート番号] [--workers ワーカーの数] [--atmosphere 大気モデルのファイル名]
+        ループバックアドレス（127.0.0.1）でだけ待ち受ける（要求と応答の形式はsession.hを参照）
+        大気モデルとワーカースレッドは起動時に一度だけ用意し、全ての要求で共有する
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "jobqueue.h"
+#include "session.h"
+#include "../freefallsolveeom/freefallsolveeom.h"
+#include "../freefallsolveeom/solvesummary.h"
+#include <algorithm>                    // for std::max
+#include <csignal>                      // for SIGINT, SIGTERM
+#include <cstdint>                      // for std::uint16_t, std::uint32_t, std::uint64_t
+#include <cstdlib>                      // for EXIT_FAILURE, EXIT_SUCCESS
+#include <iomanip>                      // for std::setprecision
+#include <iostream>                     // for std::cerr, std::cout
+#include <limits>                       // for std::numeric_limits
+#include <memory>                       // for std::make_shared, std::shared_ptr
+#include <sstream>                      // for std::ostringstream
+#include <string>                       // for std::stoul, std::string
+#include <thread>                       // for std::thread
+#include <tuple>                        // for std::get
+#include <utility>                      // for std::make_pair, std::move
+#include <vector>                       // for std::vector
+#include <boost/asio/io_context.hpp>    // for boost::asio::io_context
+#include <boost/asio/ip/tcp.hpp>        // for boost::asio::ip::tcp
+#include <boost/asio/signal_set.hpp>    // for boost::asio::signal_set
+
+namespace freefallserver {
+    // #region 型エイリアス
+
+    //! A typedef.
+    /*!
+        サーバが用いる、空気抵抗のある自由落下系に対して運動方程式を解くクラスの型
+    */
+    using FreefallSolveEom = freefallsolveeom::FreefallSolveEom<>;
+
+    // #endregion 型エイリアス
+
+    // #region 関数の宣言
+
+    //! A function.
+    /*!
+        非同期に次のクライアントの接続を受け付ける
+        \param acceptor 待ち受けているソケット
+        \param queue ジョブを投入するキュー
+        \param client 次に接続したクライアントに付ける番号
+    */
+    void accept(boost::asio::ip::tcp::acceptor & acceptor, JobQueue & queue, std::uint64_t client);
+
+    //! A function.
+    /*!
+        ジョブを実行し、途中の状態または計算が終了した際の各事象の値をクライアントに送る
+        \param job 実行するジョブ
+        \param atmosphere 全てのジョブで共有する大気モデル
+    */
+    void execute(Job const & job, std::shared_ptr<freefallsolveeom::Atmosphere const> const & atmosphere);
+
+    //! A function.
+    /*!
+        計算が終了した際の各事象の値を、一行の応答にする
+        \param id ジョブの識別子
+        \param summary 計算が終了した際の各事象の値
+        \return 応答
+    */
+    std::string formatsummary(std::string const & id, FreefallSolveEom::summarytype const & summary);
+
+    // #endregion 関数の宣言
+
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        既定の待ち受けるポート番号
+    */
+    static auto constexpr PORT = 50080;
+
+    //! A global variable (constant expression).
+    /*!
+        途中の状態をまとめて送る数（一つずつ送るとio_contextへの投入の負荷が計算に比べて大きくなる）
+    */
+    static auto constexpr STATESPERSEND = 256;
+
+    // #endregion 定数
+}
+
+int main(int argc, char * argv[])
+{
+    using namespace freefallserver;
+    using boost::asio::ip::tcp;
+
+    auto port = static_cast<std::uint16_t>(PORT);
+    auto nworkers = std::max(std::thread::hardware_concurrency(), 1U);
+    auto atmosphere = freefallsolveeom::Atmosphere::getDefault();
+
+    for (auto i = 1; i < argc; i++) {
+        std::string const opt(argv[i]);
+        if (opt == "--port" && i + 1 < argc)
+        {
+            port = static_cast<std::uint16_t>(std::stoul(argv[++i]));
+        }
+        else if (opt == "--workers" && i + 1 < argc)
+        {
+            nworkers = std::max(static_cast<std::uint32_t>(std::stoul(argv[++i])), 1U);
+        }
+        else if (opt == "--atmosphere" && i + 1 < argc)
+        {
+            atmosphere = freefallsolveeom::Atmosphere::load(argv[++i]);
+            if (!atmosphere)
+            {
+                std::cerr << "cannot load " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::cerr << "usage: freefallserver [--port port] [--workers n] [--atmosphere filename]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    boost::asio::io_context io;
+
+    // 他のマシンからは接続できないように、ループバックアドレスでだけ待ち受ける
+    tcp::acceptor acceptor(io);
+    boost::system::error_code ec;
+    acceptor.open(tcp::v4(), ec);
+    if (!ec)
+    {
+        acceptor.set_option(tcp::acceptor::reuse_address(true), ec);
+        acceptor.bind(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port), ec);
+    }
+
+    if (!ec)
+    {
+        acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+    }
+
+    if (ec)
+    {
+        std::cerr << "cannot listen on port " << port << ": " << ec.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // ワーカースレッドは要求ごとに作らず、起動してから終了するまで使い回す
+    JobQueue queue;
+    std::vector<std::thread> workers;
+    for (auto i = 0U; i < nworkers; i++) {
+        workers.emplace_back([&queue, atmosphere] {
+            while (auto const job = queue.pop()) {
+                execute(*job, atmosphere);
+                queue.done(*job);
+            }
+        });
+    }
+
+    accept(acceptor, queue, 0);
+
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](boost::system::error_code const &, int) { io.stop(); });
+
+    std::cout << "listening on 127.0.0.1:" << port << " with " << nworkers << " workers" << std::endl;
+    io.run();
+
+    queue.close();
+    for (auto & worker : workers) {
+        worker.join();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+namespace freefallserver {
+    // #region 関数の定義
+
+    void accept(boost::asio::ip::tcp::acceptor & acceptor, JobQueue & queue, std::uint64_t client)
+    {
+        acceptor.async_accept([&acceptor, &queue, client](boost::system::error_code const & ec, boost::asio::ip::tcp::socket socket) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+
+            if (!ec)
+            {
+                std::make_shared<Session>(std::move(socket), client, queue)->start();
+            }
+
+            accept(acceptor, queue, client + 1);
+        });
+    }
+
+    void execute(Job const & job, std::shared_ptr<freefallsolveeom::Atmosphere const> const & atmosphere)
+    {
+        if (job.cancelled)
+        {
+            job.send("cancelled " + job.id + "\n");
+            return;
+        }
+
+        FreefallSolveEom fse(job.dt, job.tintervalgraphplot, job.eps, job.m, job.r, job.h0, job.v0, static_cast<FreefallSolveEom::Ode_Solver_type>(job.ode_solver_type), atmosphere);
+
+        FreefallSolveEom::summarytype summary;
+        auto isstalled = false;
+        if (job.summary)
+        {
+            // 途中の状態を返さないが、一定のステップ数を進めるごとに取り消されたかどうかを確認する
+            auto const result = fse.summary([&job] { return job.cancelled.load(); });
+            if (!result)
+            {
+                job.send("cancelled " + job.id + "\n");
+                return;
+            }
+
+            summary = *result;
+        }
+        else
+        {
+            std::ostringstream states;
+            states << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+            // 最初の呼び出しは初期状態を返す
+            auto n = 0;
+            do {
+                if (job.cancelled)
+                {
+                    break;
+                }
+
+                auto const [t, h, v, hmax, vmax, karmanline, exosphere] = fse();
+                states << "state " << job.id << ' ' << t << ' ' << h << ' ' << v << '\n';
+                if (++n % STATESPERSEND == 0)
+                {
+                    // クライアントが読み込みを遅らせている間は計算を止め、上限の時間を過ぎても読み込まなければ取り消す
+                    if (!job.waitforroom(job.cancelled))
+                    {
+                        isstalled = true;
+                        break;
+                    }
+
+                    job.send(states.str());
+                    states.str("");
+                }
+
+                // 第二宇宙速度で外気圏を脱出した場合は地面に衝突しない（summary()と同じ）
+                auto const isescaped = exosphere && std::get<2>(*exosphere);
+                summary = {
+                    fse.isCalculationFinished() && !isescaped ? std::make_optional(std::make_pair(t, v)) : std::nullopt,
+                    hmax,
+                    vmax,
+                    karmanline,
+                    exosphere };
+            } while (!fse.isCalculationFinished());
+
+            if (n % STATESPERSEND)
+            {
+                job.send(states.str());
+            }
+        }
+
+        job.send(job.cancelled || isstalled ? "cancelled " + job.id + "\n" : formatsummary(job.id, summary) + "done " + job.id + "\n");
+    }
+
+    std::string formatsummary(std::string const & id, FreefallSolveEom::summarytype const & summary)
+    {
+        std::ostringstream line;
+        line << std::setprecision(std::numeric_limits<double>::max_digits10) << "summary " << id;
+        for (auto const value : freefallsolveeom::tocolumns(summary)) {
+            line << ' ' << value;
+        }
+
+        line << '\n';
+
+        return line.str();
+    }
+
+    // #endregion 関数の定義
+}
@@ -0,0 +1,92 @@
+﻿/*! \file jobqueue.cpp
+    \brief シミュレーションサーバのジョブを、優先度とクライアントの公平さに基づいてワーカーに配るキューのクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "jobqueue.h"
+#include <algorithm>    // for std::find
+#include <iterator>     // for std::next
+
+namespace freefallserver {
+    // #region publicメンバ関数
+
+    void JobQueue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+
+        cv_.notify_all();
+    }
+
+    void JobQueue::done(Job const & job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto const itr = running_.find(job.client);
+        if (itr != running_.end() && !--itr->second)
+        {
+            running_.erase(itr);
+        }
+    }
+
+    std::shared_ptr<Job> JobQueue::pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return closed_ || !waiting_.empty(); });
+
+        if (closed_)
+        {
+            return nullptr;
+        }
+
+        // 待っているジョブの数はクライアントの数程度なので、毎回全て調べる
+        auto const nrunning = [this](std::uint64_t client) {
+            auto const itr = running_.find(client);
+            return itr != running_.end() ? itr->second : 0;
+        };
+
+        auto best = waiting_.begin();
+        for (auto itr = std::next(best); itr != waiting_.end(); ++itr) {
+            if ((*itr)->priority > (*best)->priority ||
+                ((*itr)->priority == (*best)->priority && nrunning((*itr)->client) < nrunning((*best)->client)))
+            {
+                best = itr;
+            }
+        }
+
+        auto const job = *best;
+        waiting_.erase(best);
+        running_[job->client]++;
+
+        return job;
+    }
+
+    void JobQueue::push(std::shared_ptr<Job> const & job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            waiting_.push_back(job);
+        }
+
+        cv_.notify_one();
+    }
+
+    bool JobQueue::remove(std::shared_ptr<Job> const & job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto const itr = std::find(waiting_.begin(), waiting_.end(), job);
+        if (itr == waiting_.end())
+        {
+            return false;
+        }
+
+        waiting_.erase(itr);
+        return true;
+    }
+
+    // #endregion publicメンバ関数
+}
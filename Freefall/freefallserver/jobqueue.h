@@ -0,0 +1,238 @@
+﻿/*! \file jobqueue.h
+    \brief シミュレーションサーバのジョブと、それを優先度とクライアントの公平さに基づいてワーカーに配るキューのクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _JOBQUEUE_H_
+#define _JOBQUEUE_H_
+
+#pragma once
+
+#include <atomic>               // for std::atomic
+#include <condition_variable>   // for std::condition_variable
+#include <cstdint>              // for std::int32_t, std::uint64_t
+#include <functional>           // for std::function
+#include <list>                 // for std::list
+#include <map>                  // for std::map
+#include <memory>               // for std::shared_ptr
+#include <mutex>                // for std::mutex
+#include <string>               // for std::string
+
+namespace freefallserver {
+    //! A struct.
+    /*!
+        一つのシミュレーションのジョブを表す構造体
+    */
+    struct Job {
+        //! A public member variable.
+        /*!
+            クライアントが付けたジョブの識別子
+        */
+        std::string id;
+
+        //! A public member variable.
+        /*!
+            ジョブを投入したクライアントの番号
+        */
+        std::uint64_t client;
+
+        //! A public member variable.
+        /*!
+            優先度（大きいほど先に実行される）
+        */
+        std::int32_t priority;
+
+        //! A public member variable.
+        /*!
+            途中の状態を返さずに、計算が終了した際の各事象の値だけを返すかどうか
+        */
+        bool summary;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法の時間刻み（秒）
+        */
+        double dt;
+
+        //! A public member variable.
+        /*!
+            途中の状態を返す時間間隔（秒）
+        */
+        double tintervalgraphplot;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法の許容誤差
+        */
+        double eps;
+
+        //! A public member variable.
+        /*!
+            球の質量（kg）
+        */
+        double m;
+
+        //! A public member variable.
+        /*!
+            球の半径（m）
+        */
+        double r;
+
+        //! A public member variable.
+        /*!
+            初期高度（m）
+        */
+        double h0;
+
+        //! A public member variable.
+        /*!
+            初期速度（m/s）
+        */
+        double v0;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法（FreefallSolveEom::Ode_Solver_typeの値）
+        */
+        std::int32_t ode_solver_type;
+
+        //! A public member variable.
+        /*!
+            取り消されたかどうか（実行中のジョブは、ワーカーが途中の状態を返すたびに、summaryの場合は一定のステップ数を進めるたびに調べる）
+        */
+        std::atomic<bool> cancelled;
+
+        //! A public member variable.
+        /*!
+            結果の行をクライアントに送る関数（ワーカーのスレッドから呼び出してよい）
+        */
+        std::function<void(std::string &&)> send;
+
+        //! A public member variable.
+        /*!
+            クライアントへの送信待ちの応答が上限を超えている間、呼び出したワーカーのスレッドを止める関数
+            送信待ちが上限以下に減るか、取り消された場合はtrueを、クライアントが読み込まないまま一定の時間が過ぎたか、接続が切れた場合はfalseを返す
+        */
+        std::function<bool(std::atomic<bool> const &)> waitforroom;
+    };
+
+    //! A class.
+    /*!
+        ジョブを優先度の高い順に、同じ優先度の中では実行中のジョブが少ないクライアントから順に、
+        さらに同じ場合は投入された順にワーカーに配るキューのクラス
+    */
+    class JobQueue final {
+    public:
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            デフォルトコンストラクタ
+        */
+        JobQueue() = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~JobQueue() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            キューを閉じ、待機しているワーカーを全て起こす（以降のpop()はnullptrを返す）
+        */
+        void close();
+
+        //! A public member function.
+        /*!
+            ワーカーがジョブの実行を終えたことを記録する
+            \param job 実行を終えたジョブ
+        */
+        void done(Job const & job);
+
+        //! A public member function.
+        /*!
+            次に実行するジョブを取り出す（キューが空の場合は、ジョブが投入されるか、キューが閉じられるまで待つ）
+            \return 次に実行するジョブ（キューが閉じられた場合はnullptr）
+        */
+        std::shared_ptr<Job> pop();
+
+        //! A public member function.
+        /*!
+            ジョブを投入する
+            \param job 投入するジョブ
+        */
+        void push(std::shared_ptr<Job> const & job);
+
+        //! A public member function.
+        /*!
+            まだ実行されていないジョブをキューから取り除く
+            \param job 取り除くジョブ
+            \return キューから取り除いたかどうか（既に実行中か、実行を終えていた場合はfalse）
+        */
+        bool remove(std::shared_ptr<Job> const & job);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            キューが閉じられたかどうか
+        */
+        bool closed_ = false;
+
+        //! A private member variable.
+        /*!
+            ジョブが投入されたか、キューが閉じられたことを通知する条件変数
+        */
+        std::condition_variable cv_;
+
+        //! A private member variable.
+        /*!
+            メンバ変数を保護するミューテックス
+        */
+        std::mutex mutex_;
+
+        //! A private member variable.
+        /*!
+            クライアントごとの、実行中のジョブの数
+        */
+        std::map<std::uint64_t, std::int32_t> running_;
+
+        //! A private member variable.
+        /*!
+            まだ実行されていないジョブ（投入された順）
+        */
+        std::list< std::shared_ptr<Job> > waiting_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        JobQueue(JobQueue const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        JobQueue & operator=(JobQueue const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _JOBQUEUE_H_
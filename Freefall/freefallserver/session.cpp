@@ -0,0 +1,292 @@
+﻿/*! \file session.cpp
+    \brief シミュレーションサーバの一つのクライアントとの接続を扱うクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "session.h"
+#include <chrono>                   // for std::chrono::seconds
+#include <cmath>                    // for std::isfinite
+#include <istream>                  // for std::getline, std::istream
+#include <mutex>                    // for std::lock_guard, std::unique_lock
+#include <utility>                  // for std::move
+#include <boost/asio/post.hpp>      // for boost::asio::post
+#include <boost/asio/read_until.hpp>// for boost::asio::async_read_until
+#include <boost/asio/write.hpp>     // for boost::asio::async_write
+
+namespace freefallserver {
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        省略した場合の、常微分方程式の数値解法の時間刻み（秒）
+    */
+    static auto constexpr DT = 0.01;
+
+    //! A global variable (constant expression).
+    /*!
+        省略した場合の、常微分方程式の数値解法の許容誤差
+    */
+    static auto constexpr EPS = 1.0E-8;
+
+    //! A global variable (constant expression).
+    /*!
+        省略した場合の、常微分方程式の数値解法（コントロールされたRunge-Kutta法）
+    */
+    static auto constexpr ODE_SOLVER_TYPE = 2;
+
+    //! A global variable (constant expression).
+    /*!
+        省略した場合の、途中の状態を返す時間間隔（秒）
+    */
+    static auto constexpr TINTERVAL = 0.1;
+
+    //! A global variable (constant expression).
+    /*!
+        常微分方程式の数値解法の数（FreefallSolveEom::Ode_Solver_typeの要素の数）
+    */
+    static auto constexpr NODESOLVERTYPES = 5;
+
+    //! A global variable (constant expression).
+    /*!
+        一つのクライアントについて、送信待ちにしておく応答の大きさの上限（バイト）
+        これを超えると、途中の状態を返すワーカーはクライアントが読み込むまで待たされる
+    */
+    static auto constexpr MAXPENDINGBYTES = static_cast<std::size_t>(1) << 20;
+
+    //! A global variable (constant expression).
+    /*!
+        送信待ちが上限を超えたまま、ワーカーを待たせる最大の時間（これを過ぎるとジョブを取り消す）
+    */
+    static auto constexpr MAXSTALL = std::chrono::seconds(30);
+
+    // #endregion 定数
+
+    // #region コンストラクタ
+
+    Session::Session(boost::asio::ip::tcp::socket && socket, std::uint64_t client, JobQueue & queue) :
+        client_(client),
+        queue_(queue),
+        socket_(std::move(socket))
+    {
+    }
+
+    // #endregion コンストラクタ
+
+    // #region publicメンバ関数
+
+    void Session::send(std::string && lines)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pendingmutex_);
+            pendingbytes_ += lines.size();
+        }
+
+        // 書き込みは全てio_contextのスレッドで行う
+        boost::asio::post(socket_.get_executor(), [self = shared_from_this(), lines = std::move(lines)]() mutable {
+            self->writing_.push_back(std::move(lines));
+            if (self->writing_.size() == 1)
+            {
+                self->write();
+            }
+        });
+    }
+
+    void Session::start()
+    {
+        read();
+    }
+
+    bool Session::waitforroom(std::atomic<bool> const & cancelled)
+    {
+        std::unique_lock<std::mutex> lock(pendingmutex_);
+        auto const isready = pendingcv_.wait_for(lock, MAXSTALL, [this, &cancelled] {
+            return closed_ || cancelled.load() || pendingbytes_ <= MAXPENDINGBYTES;
+        });
+
+        return isready && !closed_;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    void Session::cancel(std::string const & id)
+    {
+        auto const itr = jobs_.find(id);
+        auto const job = itr != jobs_.end() ? itr->second.lock() : nullptr;
+        if (!job)
+        {
+            send("error " + id + " no such job\n");
+            return;
+        }
+
+        job->cancelled = true;
+        notifywaiting();
+        if (queue_.remove(job))
+        {
+            send("cancelled " + id + "\n");
+        }
+    }
+
+    void Session::cancelall()
+    {
+        for (auto const & [id, weak] : jobs_) {
+            if (auto const job = weak.lock())
+            {
+                job->cancelled = true;
+                queue_.remove(job);
+            }
+        }
+
+        jobs_.clear();
+        notifywaiting();
+    }
+
+    void Session::handle(std::string const & line)
+    {
+        std::istringstream args(line);
+        std::string command;
+        args >> command;
+
+        if (command == "submit")
+        {
+            submit(args);
+        }
+        else if (command == "cancel")
+        {
+            std::string id;
+            args >> id;
+            cancel(id);
+        }
+        else if (!command.empty())
+        {
+            send("error - unknown command " + command + "\n");
+        }
+    }
+
+    void Session::notifywaiting()
+    {
+        // 待っている側が条件を確かめてから待ち始めるまでの間に知らせて、知らせが失われることのないようにロックを取る
+        {
+            std::lock_guard<std::mutex> lock(pendingmutex_);
+        }
+
+        pendingcv_.notify_all();
+    }
+
+    void Session::read()
+    {
+        boost::asio::async_read_until(socket_, buffer_, '\n', [self = shared_from_this()](boost::system::error_code const & ec, std::size_t) {
+            if (ec)
+            {
+                // 接続が切れたので、結果を受け取る相手のいないジョブを取り消す
+                {
+                    std::lock_guard<std::mutex> lock(self->pendingmutex_);
+                    self->closed_ = true;
+                }
+
+                self->cancelall();
+                return;
+            }
+
+            std::istream is(&self->buffer_);
+            std::string line;
+            std::getline(is, line);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+
+            self->handle(line);
+            self->read();
+        });
+    }
+
+    void Session::submit(std::istringstream & args)
+    {
+        auto const job = std::make_shared<Job>();
+        std::string mode;
+        args >> job->id >> job->priority >> mode >> job->m >> job->r >> job->h0 >> job->v0;
+
+        job->dt = DT;
+        job->tintervalgraphplot = TINTERVAL;
+        job->eps = EPS;
+        job->ode_solver_type = ODE_SOLVER_TYPE;
+        if (!args.fail() && !args.eof() && !(args >> std::ws).eof())
+        {
+            args >> job->dt >> job->tintervalgraphplot >> job->eps >> job->ode_solver_type;
+        }
+
+        if (args.fail() || (mode != "summary" && mode != "trajectory") ||
+            job->dt <= 0.0 || job->tintervalgraphplot <= 0.0 || job->eps <= 0.0 ||
+            job->ode_solver_type < 0 || job->ode_solver_type >= NODESOLVERTYPES)
+        {
+            send("error " + (job->id.empty() ? std::string("-") : job->id) + " usage: submit id priority summary|trajectory m r h0 v0 [dt tinterval eps solver]\n");
+            return;
+        }
+
+        // NaNとの比較は常にfalseとなるので、範囲の確認とは別に有限かどうかを確認する
+        auto const isfinite = [](auto... values) { return (std::isfinite(values) && ...); };
+        if (!isfinite(job->m, job->r, job->h0, job->v0, job->dt, job->tintervalgraphplot, job->eps) ||
+            job->m <= 0.0 || job->r <= 0.0 || job->h0 < 0.0)
+        {
+            send("error " + job->id + " m and r must be positive, h0 must not be negative, and all values must be finite\n");
+            return;
+        }
+
+        // 実行を終えたジョブの識別子は再利用してよい
+        for (auto itr = jobs_.begin(); itr != jobs_.end();) {
+            itr = itr->second.expired() ? jobs_.erase(itr) : std::next(itr);
+        }
+
+        if (jobs_.count(job->id))
+        {
+            send("error " + job->id + " duplicate job id\n");
+            return;
+        }
+
+        job->client = client_;
+        job->summary = mode == "summary";
+        job->cancelled = false;
+        job->send = [self = shared_from_this()](std::string && lines) { self->send(std::move(lines)); };
+        job->waitforroom = [self = shared_from_this()](std::atomic<bool> const & cancelled) { return self->waitforroom(cancelled); };
+
+        jobs_.emplace(job->id, job);
+        send("queued " + job->id + "\n");
+        queue_.push(job);
+    }
+
+    void Session::write()
+    {
+        boost::asio::async_write(socket_, boost::asio::buffer(writing_.front()), [self = shared_from_this()](boost::system::error_code const & ec, std::size_t) {
+            if (ec)
+            {
+                // 書き込めなくなったので、送信待ちを捨てて、待っているワーカーを起こす
+                self->writing_.clear();
+                {
+                    std::lock_guard<std::mutex> lock(self->pendingmutex_);
+                    self->closed_ = true;
+                    self->pendingbytes_ = 0;
+                }
+
+                self->pendingcv_.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(self->pendingmutex_);
+                self->pendingbytes_ -= self->writing_.front().size();
+            }
+
+            self->pendingcv_.notify_all();
+            self->writing_.pop_front();
+            if (!self->writing_.empty())
+            {
+                self->write();
+            }
+        });
+    }
+
+    // #endregion privateメンバ関数
+}
@@ -0,0 +1,226 @@
+﻿/*! \file session.h
+    \brief シミュレーションサーバの一つのクライアントとの接続を扱うクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#pragma once
+
+#include "jobqueue.h"
+#include <atomic>                   // for std::atomic
+#include <condition_variable>       // for std::condition_variable
+#include <cstddef>                  // for std::size_t
+#include <cstdint>                  // for std::uint64_t
+#include <deque>                    // for std::deque
+#include <map>                      // for std::map
+#include <memory>                   // for std::enable_shared_from_this, std::weak_ptr
+#include <mutex>                    // for std::mutex
+#include <sstream>                  // for std::istringstream
+#include <string>                   // for std::string
+#include <boost/asio/ip/tcp.hpp>    // for boost::asio::ip::tcp::socket
+#include <boost/asio/streambuf.hpp> // for boost::asio::streambuf
+
+namespace freefallserver {
+    //! A class.
+    /*!
+        シミュレーションサーバの一つのクライアントとの接続を扱うクラス
+        クライアントは一行に一つの要求を送る
+            submit 識別子 優先度 summary|trajectory 球の質量 球の半径 初期高度 初期速度 [時間刻み 時間間隔 許容誤差 数値解法]
+            cancel 識別子
+        サーバは一行に一つの応答を返す
+            queued 識別子 / state 識別子 経過時間 高度 速度 / summary 識別子 各列の値 / done 識別子 / cancelled 識別子 / error 識別子 メッセージ
+        接続が切れた場合は、そのクライアントのジョブを全て取り消す
+        送信待ちの応答の大きさには上限があり、クライアントが読み込みを遅らせると途中の状態を返すワーカーは待たされ、
+        それでも読み込まない場合はそのジョブを取り消す（一つのクライアントがサーバのメモリを使い尽くさないようにする）
+    */
+    class Session final : public std::enable_shared_from_this<Session> {
+    public:
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param socket 接続したソケット
+            \param client クライアントの番号
+            \param queue ジョブを投入するキュー
+        */
+        Session(boost::asio::ip::tcp::socket && socket, std::uint64_t client, JobQueue & queue);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Session() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            クライアントに応答を送る（どのスレッドから呼び出してもよい）
+            \param lines 送る応答（一行以上で、各行は改行で終わる）
+        */
+        void send(std::string && lines);
+
+        //! A public member function.
+        /*!
+            要求の読み込みを開始する
+        */
+        void start();
+
+        //! A public member function.
+        /*!
+            送信待ちの応答の大きさが上限を超えている間、呼び出したスレッドを止める（ワーカーのスレッドから呼び出す）
+            \param cancelled ジョブが取り消されたかどうか
+            \return 送信待ちが上限以下に減るか、取り消された場合はtrue、上限の時間を過ぎても減らないか、接続が切れた場合はfalse
+        */
+        bool waitforroom(std::atomic<bool> const & cancelled);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function.
+        /*!
+            ジョブを取り消す（まだ実行されていない場合はここで、実行中の場合はワーカーが取り消しを応答する）
+            \param id ジョブの識別子
+        */
+        void cancel(std::string const & id);
+
+        //! A private member function.
+        /*!
+            このクライアントのジョブを全て、応答を返さずに取り消す
+        */
+        void cancelall();
+
+        //! A private member function.
+        /*!
+            waitforroomで待っているワーカーのスレッドを起こす
+        */
+        void notifywaiting();
+
+        //! A private member function.
+        /*!
+            一行の要求を処理する
+            \param line 要求
+        */
+        void handle(std::string const & line);
+
+        //! A private member function.
+        /*!
+            次の一行の要求を非同期に読み込む
+        */
+        void read();
+
+        //! A private member function.
+        /*!
+            submit要求の引数を読み込み、ジョブを投入する
+            \param args submit要求の引数
+        */
+        void submit(std::istringstream & args);
+
+        //! A private member function.
+        /*!
+            送信待ちの先頭の応答を非同期に書き込む
+        */
+        void write();
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            読み込んだ要求のバッファ
+        */
+        boost::asio::streambuf buffer_;
+
+        //! A private member variable (constant).
+        /*!
+            クライアントの番号
+        */
+        std::uint64_t const client_;
+
+        //! A private member variable.
+        /*!
+            接続が切れたかどうか
+        */
+        bool closed_ = false;
+
+        //! A private member variable.
+        /*!
+            識別子から、このクライアントが投入したジョブへの弱参照（実行を終えたジョブは期限切れになる）
+        */
+        std::map< std::string, std::weak_ptr<Job> > jobs_;
+
+        //! A private member variable.
+        /*!
+            送信待ちの応答の大きさの合計（バイト）
+        */
+        std::size_t pendingbytes_ = 0;
+
+        //! A private member variable.
+        /*!
+            送信待ちの応答が減ったことを、waitforroomで待っているワーカーに知らせる条件変数
+        */
+        std::condition_variable pendingcv_;
+
+        //! A private member variable.
+        /*!
+            closed_とpendingbytes_を保護するミューテックス
+        */
+        std::mutex pendingmutex_;
+
+        //! A private member variable.
+        /*!
+            ジョブを投入するキュー
+        */
+        JobQueue & queue_;
+
+        //! A private member variable.
+        /*!
+            接続したソケット
+        */
+        boost::asio::ip::tcp::socket socket_;
+
+        //! A private member variable.
+        /*!
+            送信待ちの応答
+        */
+        std::deque<std::string> writing_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Session() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        Session(Session const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        Session & operator=(Session const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SESSION_H_
@@ -0,0 +1,140 @@
+﻿/*! \file adaptivesampler.cpp
+    \brief 折れ線で描いた際の誤差に応じて、グラフに出力する点を間引くクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "adaptivesampler.h"
+#include "utility/referencetype.h"
+#include <algorithm>            // for std::max, std::min
+#include <cmath>                // for std::fabs
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    // #region publicメンバ関数
+
+    template <typename T>
+    void AdaptiveSampler<T>::flush()
+    {
+        if (pending_)
+        {
+            emit(*pending_);
+            pending_ = std::nullopt;
+        }
+    }
+
+    template <typename T>
+    typename AdaptiveSampler<T>::sampletype AdaptiveSampler<T>::pop()
+    {
+        BOOST_ASSERT(ready());
+
+        auto const sample = ready_[readpos_++];
+
+        // 全て取り出したら、確保した領域を残したまま空にする
+        if (readpos_ == ready_.size())
+        {
+            ready_.clear();
+            readpos_ = 0;
+        }
+
+        return sample;
+    }
+
+    template <typename T>
+    void AdaptiveSampler<T>::push(T t, T h, T v)
+    {
+        using std::fabs;
+        using std::max;
+
+        hscale_ = max(hscale_, T(fabs(h)));
+        vscale_ = max(vscale_, T(fabs(v)));
+
+        AdaptiveSampler::sampletype const sample = { t, h, v };
+        if (!last_)
+        {
+            emit(sample);
+            return;
+        }
+
+        BOOST_ASSERT(t > latest()[0]);
+
+        // 直線で結べなくなったか、間隔が空きすぎる場合は、直前の候補を出力して、そこから新たに直線を引き直す
+        if (pending_ && (t - (*last_)[0] > maxgap_ || !iswithintolerance(sample)))
+        {
+            flush();
+        }
+
+        narrow(sample);
+        pending_ = sample;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    void AdaptiveSampler<T>::emit(AdaptiveSampler::sampletype const & sample)
+    {
+        // 確保した領域を超えて再確保しないように、呼び出し側は溜まる点の数をcapacity以下に抑える
+        BOOST_ASSERT(ready_.size() < ready_.capacity());
+
+        last_ = sample;
+        ready_.push_back(sample);
+    }
+
+    template <typename T>
+    bool AdaptiveSampler<T>::iswithintolerance(AdaptiveSampler::sampletype const & sample) const
+    {
+        auto const & [t0, h0, v0] = *last_;
+        auto const & [t1, h1, v1] = sample;
+
+        // 直前に出力した点から候補へ引いた直線の傾きが、保留している全ての候補を許容誤差に収める範囲にあるか
+        auto const hslope = (h1 - h0) / (t1 - t0);
+        auto const vslope = (v1 - v0) / (t1 - t0);
+
+        return hslopemin_ <= hslope && hslope <= hslopemax_ && vslopemin_ <= vslope && vslope <= vslopemax_;
+    }
+
+    template <typename T>
+    void AdaptiveSampler<T>::narrow(AdaptiveSampler::sampletype const & sample)
+    {
+        using std::max;
+        using std::min;
+
+        auto const & [t0, h0, v0] = *last_;
+        auto const & [t1, h1, v1] = sample;
+        auto const htol = reltol_ * hscale_;
+        auto const vtol = reltol_ * vscale_;
+
+        // 直線が時刻t1で候補からtol以内を通る傾きの範囲
+        auto const hmax = (h1 - h0 + htol) / (t1 - t0);
+        auto const hmin = (h1 - h0 - htol) / (t1 - t0);
+        auto const vmax = (v1 - v0 + vtol) / (t1 - t0);
+        auto const vmin = (v1 - v0 - vtol) / (t1 - t0);
+
+        // 保留している候補が無ければ、この候補だけで範囲が決まる
+        if (!pending_)
+        {
+            hslopemax_ = hmax;
+            hslopemin_ = hmin;
+            vslopemax_ = vmax;
+            vslopemin_ = vmin;
+            return;
+        }
+
+        hslopemax_ = min(hslopemax_, hmax);
+        hslopemin_ = max(hslopemin_, hmin);
+        vslopemax_ = min(vslopemax_, vmax);
+        vslopemin_ = max(vslopemin_, vmin);
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class AdaptiveSampler<float>;
+    template class AdaptiveSampler<double>;
+    template class AdaptiveSampler<referencetype>;
+
+    // #endregion templateクラスの実体化
+}
@@ -0,0 +1,215 @@
+﻿/*! \file adaptivesampler.h
+    \brief 折れ線で描いた際の誤差に応じて、グラフに出力する点を間引くクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _ADAPTIVESAMPLER_H_
+#define _ADAPTIVESAMPLER_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <cstddef>      // for std::size_t
+#include <optional>     // for std::optional
+#include <vector>       // for std::vector
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        時刻の順に与えられる時刻、高度、速度の候補から、直前に出力した点との間を直線で結んでも
+        間の候補が許容誤差に収まる限り候補を出力せずに保留し、収まらなくなった時点で直前の候補を出力するクラス
+        高度と速度の許容誤差は、それまでの最大の絶対値に対する相対値とする（グラフの縦軸の範囲に対する相対値に相当する）
+        出力する点は候補の一部なので、候補を細かく与えるほど、曲がりの大きい部分に細かく点を残せる
+        保留している候補を全て許容誤差に収める直線の傾きの範囲だけを持つので、候補を一つ追加する手間は保留している候補の数によらない
+        （各候補の許容誤差は、その候補を追加した時点のものを用いる。最大の絶対値は増える一方なので、後から全ての候補を見直すより厳しい側になる）
+        \tparam T 浮動小数点数の型
+    */
+    template <typename T>
+    class AdaptiveSampler final {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            時刻（秒）、高度（m）、速度（m/s）のstd::arrayの型
+        */
+        using sampletype = std::array<T, 3>;
+
+        // #endregion 型エイリアス
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param reltol 高度と速度の、それまでの最大の絶対値に対する許容誤差
+            \param maxgap 出力する点の時刻の最大の間隔（秒）
+            \param capacity pop()で取り出すまでに溜まる、出力する点の最大の数（候補を追加するたびにヒープの確保を行わないように、あらかじめ確保しておく）
+        */
+        AdaptiveSampler(T reltol, T maxgap, std::size_t capacity) : maxgap_(maxgap), reltol_(reltol)
+        {
+            ready_.reserve(capacity);
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~AdaptiveSampler() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            保留している最後の候補を出力する（計算が終了した際に呼び出す）
+        */
+        void flush();
+
+        //! A public member function (const).
+        /*!
+            最後に与えた候補を返す（push()を一度も呼び出していない場合は呼び出せない）
+            \return 最後に与えた候補
+        */
+        AdaptiveSampler::sampletype const & latest() const
+        {
+            return pending_ ? *pending_ : *last_;
+        }
+
+        //! A public member function.
+        /*!
+            出力する点を一つ取り出す（ready()がtrueの場合に限り呼び出せる）
+            \return 出力する点
+        */
+        AdaptiveSampler::sampletype pop();
+
+        //! A public member function.
+        /*!
+            候補を追加する（最初の候補は必ず出力する。時刻は直前に追加した候補より後でなければならない）
+            \param t 時刻（秒）
+            \param h 高度（m）
+            \param v 速度（m/s）
+        */
+        void push(T t, T h, T v);
+
+        //! A public member function (const).
+        /*!
+            出力する点があるかどうかを返す
+            \return 出力する点があるかどうか
+        */
+        bool ready() const
+        {
+            return readpos_ < ready_.size();
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function.
+        /*!
+            点sampleを出力し、以降はそこから直線を引く
+            \param sample 出力する点
+        */
+        void emit(AdaptiveSampler::sampletype const & sample);
+
+        //! A private member function (const).
+        /*!
+            直前に出力した点と候補sampleを直線で結んだ際に、保留している候補が全て許容誤差に収まるかどうかを返す
+            \param sample 候補
+            \return 保留している候補が全て許容誤差に収まるかどうか
+        */
+        bool iswithintolerance(AdaptiveSampler::sampletype const & sample) const;
+
+        //! A private member function.
+        /*!
+            直前に出力した点から引く直線の傾きの範囲を、候補sampleを許容誤差に収める範囲に狭める
+            \param sample 保留する候補
+        */
+        void narrow(AdaptiveSampler::sampletype const & sample);
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            それまでの高度の最大の絶対値（m）
+        */
+        T hscale_ = T(0);
+
+        //! A private member variable.
+        /*!
+            保留している候補を全て許容誤差に収める、直前に出力した点から引く直線の高度の傾きの最大値（m/s）
+        */
+        T hslopemax_ = T(0);
+
+        //! A private member variable.
+        /*!
+            保留している候補を全て許容誤差に収める、直前に出力した点から引く直線の高度の傾きの最小値（m/s）
+        */
+        T hslopemin_ = T(0);
+
+        //! A private member variable.
+        /*!
+            直前に出力した点（まだ出力していない場合はstd::nullopt）
+        */
+        std::optional<AdaptiveSampler::sampletype> last_ = std::nullopt;
+
+        //! A private member variable (constant).
+        /*!
+            出力する点の時刻の最大の間隔（秒）
+        */
+        T const maxgap_;
+
+        //! A private member variable.
+        /*!
+            保留している最後の候補（保留している候補が無い場合はstd::nullopt）
+        */
+        std::optional<AdaptiveSampler::sampletype> pending_ = std::nullopt;
+
+        //! A private member variable.
+        /*!
+            ready_の中で、次にpop()で取り出す点の位置
+        */
+        std::size_t readpos_ = 0;
+
+        //! A private member variable.
+        /*!
+            出力する点（全て取り出した時点で空にするので、確保した領域を使い回す）
+        */
+        std::vector<AdaptiveSampler::sampletype> ready_;
+
+        //! A private member variable (constant).
+        /*!
+            高度と速度の、それまでの最大の絶対値に対する許容誤差
+        */
+        T const reltol_;
+
+        //! A private member variable.
+        /*!
+            それまでの速度の最大の絶対値（m/s）
+        */
+        T vscale_ = T(0);
+
+        //! A private member variable.
+        /*!
+            保留している候補を全て許容誤差に収める、直前に出力した点から引く直線の速度の傾きの最大値（m/s^2）
+        */
+        T vslopemax_ = T(0);
+
+        //! A private member variable.
+        /*!
+            保留している候補を全て許容誤差に収める、直前に出力した点から引く直線の速度の傾きの最小値（m/s^2）
+        */
+        T vslopemin_ = T(0);
+
+        // #endregion メンバ変数
+    };
+}
+
+#endif  // _ADAPTIVESAMPLER_H_
@@ -0,0 +1,105 @@
+﻿/*! \file atmosphere.cpp
+    \brief 高度80km以上の大気の気圧と温度をスプライン補間で与えるクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "atmosphere.h"
+#include <algorithm>            // for std::adjacent_find, std::all_of, std::min, std::replace
+#include <cctype>               // for std::isspace
+#include <fstream>              // for std::ifstream
+#include <functional>           // for std::greater_equal
+#include <istream>              // for std::ws
+#include <sstream>              // for std::istringstream
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    // #region コンストラクタ・デストラクタ
+
+    Atmosphere::Atmosphere(std::vector<double> const & z_mesh, std::vector<double> const & p_data, std::vector<double> const & t_data) :
+        spline_pressure_(gsl_spline_alloc(gsl_interp_cspline, z_mesh.size()), gsl_spline_deleter),
+        spline_temperature_(gsl_spline_alloc(gsl_interp_cspline, z_mesh.size()), gsl_spline_deleter),
+        top_(z_mesh.back())
+    {
+        BOOST_ASSERT(p_data.size() == z_mesh.size());
+        BOOST_ASSERT(t_data.size() == z_mesh.size());
+
+        // gsl_spline_initはデータをコピーするので、元の配列は保持しない
+        gsl_spline_init(spline_pressure_.get(), z_mesh.data(), p_data.data(), z_mesh.size());
+        gsl_spline_init(spline_temperature_.get(), z_mesh.data(), t_data.data(), z_mesh.size());
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    std::shared_ptr<Atmosphere const> Atmosphere::getDefault()
+    {
+        // 高度80km以上での気圧と温度のデータ
+        // 国立天文台編『理科年表』丸善出版（2012）p.331より引用
+        static auto const atmosphere = std::make_shared<Atmosphere const>(
+            std::vector<double>{ 80000.0,  86000.0,  90000.0,  91000.0,  100000.0, 110000.0,
+                                 120000.0, 130000.0, 140000.0, 160000.0, 180000.0, 200000.0,
+                                 250000.0, 300000.0, 350000.0, 400000.0, 450000.0, 500000.0,
+                                 550000.0, 600000.0, 650000.0, 700000.0, 750000.0, 800000.0,
+                                 850000.0, 900000.0, 1000000.0 },
+            std::vector<double>{ 1.0524,    0.37338,   0.18359,   0.15381,   3.2011E-2, 7.1042E-3,
+                                 2.5382E-3, 1.2505E-3, 7.2028E-4, 3.0395E-4, 1.5271E-4, 8.4736E-5,
+                                 2.4767E-5, 8.7704E-6, 3.4498E-6, 1.4518E-6, 6.4468E-7, 3.0236E-7,
+                                 1.5137E-7, 8.2130E-8, 4.8865E-8, 3.1908E-8, 2.2599E-8, 1.7036E-8,
+                                 1.3415E-8, 1.0873E-8, 7.5138E-9 },
+            std::vector<double>{ 198.639, 186.87, 186.87, 186.87, 195.08, 240.00, 360.00, 469.27,
+                                 559.63,  696.29, 790.07, 854.56, 941.33, 976.01, 990.06, 995.83,
+                                 998.22,  999.24, 999.67, 999.85, 999.93, 999.97, 999.99, 999.99,
+                                 1000.0,  1000.0, 1000.0 });
+
+        return atmosphere;
+    }
+
+    std::shared_ptr<Atmosphere const> Atmosphere::load(std::string const & filename)
+    {
+        std::ifstream ifs(filename);
+        if (!ifs)
+        {
+            return nullptr;
+        }
+
+        std::vector<double> z_mesh, p_data, t_data;
+        for (std::string line; std::getline(ifs, line);) {
+            // #以降はコメント
+            line.erase(std::min(line.find('#'), line.size()));
+            std::replace(line.begin(), line.end(), ',', ' ');
+
+            // 空白だけの行は読み飛ばし、それ以外で数値が3つ揃わない行は壊れた行とみなす
+            if (std::all_of(line.begin(), line.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }))
+            {
+                continue;
+            }
+
+            std::istringstream iss(line);
+            double z, p, t;
+            if (!(iss >> z >> p >> t) || !(iss >> std::ws).eof() || p < 0.0 || t <= 0.0)
+            {
+                return nullptr;
+            }
+
+            z_mesh.push_back(z);
+            p_data.push_back(p);
+            t_data.push_back(t);
+        }
+
+        // 3次スプライン補間には3点以上が必要で、高度は狭義単調増加でなければならない
+        // 大気の上端より上はケプラー軌道として解くので、カーマン・ラインの突破を検出するには上端がカーマン・ライン以上でなければならない
+        if (z_mesh.size() < 3 ||
+            z_mesh.front() > Atmosphere::LOWERLIMIT ||
+            z_mesh.back() < Atmosphere::UPPERLIMIT ||
+            std::adjacent_find(z_mesh.begin(), z_mesh.end(), std::greater_equal<double>()) != z_mesh.end())
+        {
+            return nullptr;
+        }
+
+        return std::make_shared<Atmosphere const>(z_mesh, p_data, t_data);
+    }
+
+    // #endregion publicメンバ関数
+}
@@ -0,0 +1,194 @@
+﻿/*! \file atmosphere.h
+    \brief 高度80km以上の大気の気圧と温度をスプライン補間で与えるクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _ATMOSPHERE_H_
+#define _ATMOSPHERE_H_
+
+#pragma once
+
+#include "utility/deleter.h"
+#include "utility/dual.h"
+#include <cstddef>                  // for std::size_t
+#include <memory>                   // for std::shared_ptr, std::unique_ptr
+#include <string>                   // for std::string
+#include <vector>                   // for std::vector
+
+namespace freefallsolveeom {
+    //! A class.
+    /*!
+        高度80km以上の大気の気圧と温度をスプライン補間で与える、構築後は変更されないクラス
+        補間の際にgsl_interp_accelを用いないため、複数のスレッドから同時に参照してもよい
+    */
+    class Atmosphere final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            高度のメッシュとその高度での気圧と温度からスプライン補間を構築するコンストラクタ
+            \param z_mesh 高度（m）のメッシュ（狭義単調増加）
+            \param p_data 各高度での気圧（Pa）
+            \param t_data 各高度での温度（K）
+        */
+        Atmosphere(std::vector<double> const & z_mesh, std::vector<double> const & p_data, std::vector<double> const & t_data);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Atmosphere() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public static member function.
+        /*!
+            国立天文台編『理科年表』のデータによる既定の大気モデルを返す（プロセス内で一度だけ構築される）
+            \return 既定の大気モデルへのstd::shared_ptr
+        */
+        static std::shared_ptr<Atmosphere const> getDefault();
+
+        //! A public static member function.
+        /*!
+            ファイルから大気モデルを読み込む
+            ファイルは一行に「高度（m） 気圧（Pa） 温度（K）」を空白またはカンマ区切りで記述し、#以降はコメントとする
+            高度はLOWERLIMIT以下からUPPERLIMIT以上までを覆っていなければならず、空白だけの行以外で数値が3つ揃わない行があれば失敗とする
+            \param filename 読み込むファイル名
+            \return 読み込んだ大気モデルへのstd::shared_ptr（読み込みに失敗した場合はnullptr）
+        */
+        static std::shared_ptr<Atmosphere const> load(std::string const & filename);
+
+        template <typename T>
+        //! A public member function (const).
+        /*!
+            高度zでの気圧（Pa）を返す
+            \param z 高度（m）
+            \return 気圧（Pa）
+        */
+        T pressure(T const & z) const
+        {
+            return evalspline(spline_pressure_.get(), z);
+        }
+
+        template <typename T>
+        //! A public member function (const).
+        /*!
+            高度zでの温度（K）を返す
+            \param z 高度（m）
+            \return 温度（K）
+        */
+        T temperature(T const & z) const
+        {
+            return evalspline(spline_temperature_.get(), z);
+        }
+
+        //! A public member function (const).
+        /*!
+            大気の上端の高度を返す（これより上は真空とみなす）
+            \return 大気の上端の高度（m）
+        */
+        double top() const
+        {
+            return top_;
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region private staticメンバ関数
+
+        template <typename T>
+        //! A private static member function.
+        /*!
+            スプライン補間の値を返す（補間はdoubleで行う）
+            \param spline gsl_splineへのポインタ
+            \param z 高度（m）
+            \return スプライン補間の値
+        */
+        static T evalspline(gsl_spline const * spline, T const & z)
+        {
+            return static_cast<T>(gsl_spline_eval(spline, static_cast<double>(z), nullptr));
+        }
+
+        template <typename T, std::size_t N>
+        //! A private static member function.
+        /*!
+            スプライン補間の値とその導関数を二重数として返す（補間はdoubleで行う）
+            \param spline gsl_splineへのポインタ
+            \param z 高度（m）
+            \return スプライン補間の値とその導関数が格納された二重数
+        */
+        static Dual<T, N> evalspline(gsl_spline const * spline, Dual<T, N> const & z)
+        {
+            auto const zval = static_cast<double>(z.value());
+            return z.chain(static_cast<T>(gsl_spline_eval(spline, zval, nullptr)), static_cast<T>(gsl_spline_eval_deriv(spline, zval, nullptr)));
+        }
+
+        // #endregion private staticメンバ関数
+
+        // #region メンバ変数
+
+        //! A private static member variable (constant expression).
+        /*!
+            読み込むファイルの大気モデルが覆っていなければならない最低の高度（m）（これより下は標準大気の式で求める）
+        */
+        static auto constexpr LOWERLIMIT = 86000.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            読み込むファイルの大気モデルが覆っていなければならない最高の高度（m）（カーマン・ライン）
+        */
+        static auto constexpr UPPERLIMIT = 100000.0;
+
+        //! A private member variable (constant).
+        /*!
+            気圧のgsl_splineへのスマートポインタ
+        */
+        std::unique_ptr<gsl_spline, decltype(gsl_spline_deleter)> const spline_pressure_;
+
+        //! A private member variable (constant).
+        /*!
+            温度のgsl_splineへのスマートポインタ
+        */
+        std::unique_ptr<gsl_spline, decltype(gsl_spline_deleter)> const spline_temperature_;
+
+        //! A private member variable (constant).
+        /*!
+            大気の上端の高度（m）
+        */
+        double const top_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Atmosphere() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        Atmosphere(Atmosphere const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        Atmosphere & operator=(Atmosphere const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _ATMOSPHERE_H_
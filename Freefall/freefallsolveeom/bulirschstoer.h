@@ -0,0 +1,527 @@
+﻿/*! \file bulirschstoer.h
+    \brief ステップごとにヒープの確保を行わない、Bulirsch-Stoer法のステッパークラスの宣言と実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _BULIRSCHSTOER_H_
+#define _BULIRSCHSTOER_H_
+
+#pragma once
+
+#include <algorithm>                    // for std::max, std::min
+#include <array>                        // for std::array
+#include <cmath>                        // for std::pow
+#include <cstddef>                      // for std::size_t
+#include <boost/numeric/odeint.hpp>     // for boost::numeric::odeint
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        Boost.Odeintのbulirsch_stoerと同じアルゴリズムで、ステップ幅と次数を制御するBulirsch-Stoer法のステッパークラス
+        bulirsch_stoerはtry_step()を呼び出すごとに、最適なステップ幅と仕事量の表をstd::vectorとして確保するので、
+        それらの表と外挿の表をオブジェクト自身が持つstd::arrayとすることで、ステップごとのヒープの確保をなくす
+        \tparam State 状態の型（大きさが固定で、サイズ変更を要しない型でなければならない）
+        \tparam Value 浮動小数点数の型
+    */
+    template <typename State, typename Value>
+    class BulirschStoer final {
+        static_assert(!boost::numeric::odeint::is_resizeable<State>::value, "Stateは大きさが固定の型でなければならない");
+
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            状態の型
+        */
+        using state_type = State;
+
+        //! A typedef.
+        /*!
+            浮動小数点数の型
+        */
+        using value_type = Value;
+
+        //! A typedef.
+        /*!
+            状態の微分の型
+        */
+        using deriv_type = State;
+
+        //! A typedef.
+        /*!
+            時間の型
+        */
+        using time_type = Value;
+
+        //! A typedef.
+        /*!
+            状態に対する演算を表す代数の型
+        */
+        using algebra_type = typename boost::numeric::odeint::algebra_dispatcher<State>::algebra_type;
+
+        //! A typedef.
+        /*!
+            状態に対する演算の型
+        */
+        using operations_type = typename boost::numeric::odeint::operations_dispatcher<State>::operations_type;
+
+        //! A typedef.
+        /*!
+            Boost.Odeintのintegrate関数に、ステップ幅を制御するステッパーであることを伝えるタグ
+        */
+        using stepper_category = boost::numeric::odeint::controlled_stepper_tag;
+
+        // #endregion 型エイリアス
+
+    private:
+        // #region staticメンバ変数
+
+        //! A private static member variable (constant expression).
+        /*!
+            外挿に用いる最大の段数
+        */
+        static std::size_t constexpr KMAX = 8;
+
+        //! A private static member variable (constant expression).
+        /*!
+            最適なステップ幅を求める際の定数（bulirsch_stoerと同じ値）
+        */
+        static auto constexpr STEPFAC1 = 0.65;
+
+        //! A private static member variable (constant expression).
+        /*!
+            最適なステップ幅を求める際の定数（bulirsch_stoerと同じ値）
+        */
+        static auto constexpr STEPFAC2 = 0.94;
+
+        //! A private static member variable (constant expression).
+        /*!
+            最適なステップ幅を求める際の定数（bulirsch_stoerと同じ値）
+        */
+        static auto constexpr STEPFAC3 = 0.02;
+
+        //! A private static member variable (constant expression).
+        /*!
+            最適なステップ幅を求める際の定数（bulirsch_stoerと同じ値）
+        */
+        static auto constexpr STEPFAC4 = 4.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            次数を変える際の仕事量の比の閾値（bulirsch_stoerと同じ値）
+        */
+        static auto constexpr KFAC2 = 0.9;
+
+        // #endregion staticメンバ変数
+
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param epsabs 絶対許容誤差
+            \param epsrel 相対許容誤差
+        */
+        BulirschStoer(Value epsabs, Value epsrel) : errorchecker_(epsabs, epsrel)
+        {
+            using std::pow;
+
+            // 各段の分割数と仕事量、外挿の係数を求める
+            for (std::size_t i = 0; i <= BulirschStoer::KMAX; i++) {
+                intervalsequence_[i] = 2 * (i + 1);
+                cost_[i] = i == 0 ? intervalsequence_[i] : cost_[i - 1] + intervalsequence_[i];
+                facmintable_[i] = pow(Value(BulirschStoer::STEPFAC3), Value(1) / static_cast<Value>(2 * i + 1));
+                for (std::size_t k = 0; k < i; k++) {
+                    auto const r = static_cast<Value>(intervalsequence_[i]) / static_cast<Value>(intervalsequence_[k]);
+                    coeff_[i][k] = Value(1) / (r * r - Value(1));
+                }
+            }
+
+            reset();
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~BulirschStoer() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            状態xから時間刻みdtで一ステップ進めることを試みる
+            \param system 常微分方程式の右辺（またはその参照のラッパー）
+            \param x 状態（成功した場合は進めた状態に更新する）
+            \param t 時刻（成功した場合はdtだけ進める）
+            \param dt 時間刻み（次に試みるべき時間刻みに更新する）
+            \return 成功したかどうか
+        */
+        template <typename System>
+        boost::numeric::odeint::controlled_step_result try_step(System system, State & x, Value & t, Value & dt);
+
+        //! A public member function.
+        /*!
+            ステップ幅と次数の制御の状態を、最初のステップの前の状態に戻す
+        */
+        void reset()
+        {
+            currentkopt_ = 4;
+            isfirst_ = true;
+            islaststeprejected_ = false;
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function (const).
+        /*!
+            与えられた誤差と段数から、最適なステップ幅を求める
+            \param h 現在のステップ幅
+            \param error 誤差
+            \param k 段数
+            \return 最適なステップ幅
+        */
+        Value calchopt(Value h, Value error, std::size_t k) const;
+
+        //! A private member function.
+        /*!
+            外挿の表から、ステップ幅を0に近づけた極限の状態を多項式で外挿する
+            \param k 段数
+            \param xest 最後の段の状態（外挿した状態に更新する）
+        */
+        void extrapolate(std::size_t k, State & xest);
+
+        //! A private member function (const).
+        /*!
+            段数kの誤差から、これ以上段数を増やしても収束しない（ステップを棄却すべき）かどうかを判定する
+            \param error 誤差
+            \param k 段数
+            \return ステップを棄却すべきかどうか
+        */
+        bool shouldreject(Value error, std::size_t k) const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            状態に対する演算を表す代数
+        */
+        algebra_type algebra_;
+
+        //! A private member variable.
+        /*!
+            外挿の係数
+        */
+        std::array<std::array<Value, BulirschStoer::KMAX + 1>, BulirschStoer::KMAX + 1> coeff_ = {};
+
+        //! A private member variable.
+        /*!
+            各段の仕事量（右辺の評価の回数の累計）
+        */
+        std::array<std::size_t, BulirschStoer::KMAX + 1> cost_ = {};
+
+        //! A private member variable.
+        /*!
+            現在の最適な段数
+        */
+        std::size_t currentkopt_ = 4;
+
+        //! A private member variable.
+        /*!
+            直前に試みた時間刻み（外から変えられた場合は、制御の状態を戻す）
+        */
+        Value dtlast_ = Value(0);
+
+        //! A private member variable.
+        /*!
+            ステップの開始時の状態の微分
+        */
+        State dxdt_;
+
+        //! A private member variable.
+        /*!
+            外挿した状態と、最初の段の状態との差
+        */
+        State err_;
+
+        //! A private member variable.
+        /*!
+            誤差を求めるオブジェクト
+        */
+        boost::numeric::odeint::default_error_checker<Value, algebra_type, operations_type> errorchecker_;
+
+        //! A private member variable.
+        /*!
+            各段の、ステップ幅の縮小率の下限
+        */
+        std::array<Value, BulirschStoer::KMAX + 1> facmintable_ = {};
+
+        //! A private member variable.
+        /*!
+            各段の最適なステップ幅（try_step()の呼び出しごとに上書きする）
+        */
+        std::array<Value, BulirschStoer::KMAX + 1> hopt_ = {};
+
+        //! A private member variable.
+        /*!
+            各段の分割数
+        */
+        std::array<std::size_t, BulirschStoer::KMAX + 1> intervalsequence_ = {};
+
+        //! A private member variable.
+        /*!
+            最初のステップかどうか
+        */
+        bool isfirst_ = true;
+
+        //! A private member variable.
+        /*!
+            直前のステップが棄却されたかどうか
+        */
+        bool islaststeprejected_ = false;
+
+        //! A private member variable.
+        /*!
+            各段の状態を求める修正中点法のステッパー
+        */
+        boost::numeric::odeint::modified_midpoint<State, Value, State, Value, algebra_type, operations_type> midpoint_;
+
+        //! A private member variable.
+        /*!
+            外挿の表
+        */
+        std::array<State, BulirschStoer::KMAX> table_;
+
+        //! A private member variable.
+        /*!
+            各段の、単位時間あたりの仕事量（try_step()の呼び出しごとに上書きする）
+        */
+        std::array<Value, BulirschStoer::KMAX + 1> work_ = {};
+
+        //! A private member variable.
+        /*!
+            外挿した状態
+        */
+        State xnew_;
+
+        // #endregion メンバ変数
+    };
+
+    // #region publicメンバ関数
+
+    template <typename State, typename Value>
+    template <typename System>
+    boost::numeric::odeint::controlled_step_result BulirschStoer<State, Value>::try_step(System system, State & x, Value & t, Value & dt)
+    {
+        using boost::numeric::odeint::fail;
+        using boost::numeric::odeint::success;
+
+        typename boost::numeric::odeint::unwrap_reference<System>::type & sys = system;
+        sys(x, dxdt_, t);
+
+        // 時間刻みが外から変えられた場合は、制御の状態を戻す
+        if (dt != dtlast_)
+        {
+            reset();
+        }
+
+        auto isrejected = true;
+        auto newh = dt;
+
+        // 最適な段数の前後で、収束したかどうかを判定する
+        for (std::size_t k = 0; k <= currentkopt_ + 1; k++) {
+            midpoint_.set_steps(static_cast<unsigned short>(intervalsequence_[k]));
+            if (k == 0)
+            {
+                midpoint_.do_step(system, x, dxdt_, t, xnew_, dt);
+                continue;
+            }
+
+            midpoint_.do_step(system, x, dxdt_, t, table_[k - 1], dt);
+            extrapolate(k, xnew_);
+
+            // 誤差を見積もる
+            algebra_.for_each3(err_, xnew_, table_[0], typename operations_type::template scale_sum2<Value, Value>(Value(1), Value(-1)));
+            auto const error = errorchecker_.error(algebra_, x, dxdt_, err_, dt);
+            hopt_[k] = calchopt(dt, error, k);
+            work_[k] = static_cast<Value>(cost_[k]) / hopt_[k];
+
+            if (k == currentkopt_ - 1 || isfirst_)
+            {
+                // 最適な段数より前で収束したか
+                if (error < 1.0)
+                {
+                    isrejected = false;
+                    if (work_[k] < BulirschStoer::KFAC2 * work_[k - 1] || currentkopt_ <= 2)
+                    {
+                        currentkopt_ = std::min(BulirschStoer::KMAX - 1, std::max(std::size_t(2), k + 1));
+                        newh = hopt_[k] * static_cast<Value>(cost_[k + 1]) / static_cast<Value>(cost_[k]);
+                    }
+                    else
+                    {
+                        currentkopt_ = std::min(BulirschStoer::KMAX - 1, std::max(std::size_t(2), k));
+                        newh = hopt_[k];
+                    }
+
+                    break;
+                }
+                else if (shouldreject(error, k) && !isfirst_)
+                {
+                    isrejected = true;
+                    newh = hopt_[k];
+                    break;
+                }
+            }
+
+            if (k == currentkopt_)
+            {
+                // 最適な段数で収束したか
+                if (error < 1.0)
+                {
+                    isrejected = false;
+                    if (work_[k - 1] < BulirschStoer::KFAC2 * work_[k])
+                    {
+                        currentkopt_ = std::max(std::size_t(2), currentkopt_ - 1);
+                        newh = hopt_[currentkopt_];
+                    }
+                    else if (work_[k] < BulirschStoer::KFAC2 * work_[k - 1] && !islaststeprejected_)
+                    {
+                        currentkopt_ = std::min(BulirschStoer::KMAX - 1, currentkopt_ + 1);
+                        newh = hopt_[k] * static_cast<Value>(cost_[currentkopt_]) / static_cast<Value>(cost_[k]);
+                    }
+                    else
+                    {
+                        newh = hopt_[currentkopt_];
+                    }
+
+                    break;
+                }
+                else if (shouldreject(error, k))
+                {
+                    isrejected = true;
+                    newh = hopt_[currentkopt_];
+                    break;
+                }
+            }
+
+            if (k == currentkopt_ + 1)
+            {
+                // 最適な段数の次で収束したか
+                if (error < 1.0)
+                {
+                    isrejected = false;
+                    if (work_[k - 2] < BulirschStoer::KFAC2 * work_[k - 1])
+                    {
+                        currentkopt_ = std::max(std::size_t(2), currentkopt_ - 1);
+                    }
+
+                    if (work_[k] < BulirschStoer::KFAC2 * work_[currentkopt_] && !islaststeprejected_)
+                    {
+                        currentkopt_ = std::min(BulirschStoer::KMAX - 1, k);
+                    }
+                }
+                else
+                {
+                    isrejected = true;
+                }
+
+                newh = hopt_[currentkopt_];
+                break;
+            }
+        }
+
+        if (!isrejected)
+        {
+            t += dt;
+            x = xnew_;
+        }
+
+        if (!islaststeprejected_ || boost::numeric::odeint::detail::less_with_sign(newh, dt, dt))
+        {
+            dtlast_ = newh;
+            dt = newh;
+        }
+
+        islaststeprejected_ = isrejected;
+        isfirst_ = false;
+
+        return isrejected ? fail : success;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename State, typename Value>
+    Value BulirschStoer<State, Value>::calchopt(Value h, Value error, std::size_t k) const
+    {
+        using std::max;
+        using std::min;
+        using std::pow;
+
+        auto const facmin = facmintable_[k];
+        if (error == 0.0)
+        {
+            return h / facmin;
+        }
+
+        auto const fac = BulirschStoer::STEPFAC2 / pow(error / BulirschStoer::STEPFAC1, Value(1) / static_cast<Value>(2 * k + 1));
+
+        return h * max(Value(facmin / BulirschStoer::STEPFAC4), min(Value(1 / facmin), Value(fac)));
+    }
+
+    template <typename State, typename Value>
+    void BulirschStoer<State, Value>::extrapolate(std::size_t k, State & xest)
+    {
+        // 多項式による外挿（Numerical Recipes 3rd ed., 17.3節）
+        for (auto j = k - 1; j > 0; j--) {
+            algebra_.for_each3(
+                table_[j - 1],
+                table_[j],
+                table_[j - 1],
+                typename operations_type::template scale_sum2<Value, Value>(Value(1) + coeff_[k][j], -coeff_[k][j]));
+        }
+
+        algebra_.for_each3(
+            xest,
+            table_[0],
+            xest,
+            typename operations_type::template scale_sum2<Value, Value>(Value(1) + coeff_[k][0], -coeff_[k][0]));
+    }
+
+    template <typename State, typename Value>
+    bool BulirschStoer<State, Value>::shouldreject(Value error, std::size_t k) const
+    {
+        if (k == currentkopt_ - 1)
+        {
+            // Numerical Recipes 3rd ed.の式(17.3.17)
+            auto const d = static_cast<Value>(intervalsequence_[currentkopt_] * intervalsequence_[currentkopt_ + 1]) /
+                static_cast<Value>(intervalsequence_[0] * intervalsequence_[0]);
+            return error > d * d;
+        }
+        else if (k == currentkopt_)
+        {
+            auto const d = static_cast<Value>(intervalsequence_[currentkopt_]) / static_cast<Value>(intervalsequence_[0]);
+            return error > d * d;
+        }
+        else
+        {
+            return error > 1.0;
+        }
+    }
+
+    // #endregion privateメンバ関数
+}
+
+#endif  // _BULIRSCHSTOER_H_
@@ -0,0 +1,122 @@
+﻿/*! \file denseoutput.cpp
+    \brief 計算した軌道を区分的な3次エルミート補間で保持し、任意の時刻の状態を求めるクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "denseoutput.h"
+#include "utility/referencetype.h"
+#include <algorithm>            // for std::upper_bound
+#include <cstddef>              // for std::ptrdiff_t
+#include <iterator>             // for std::distance
+#include <utility>              // for std::make_pair
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    // #region publicメンバ関数
+
+    template <typename T>
+    typename DenseOutput<T>::statetype DenseOutput<T>::operator()(T t) const
+    {
+        BOOST_ASSERT(!nodes_.empty());
+
+        if (nodes_.size() == 1 || t <= nodes_.front().t)
+        {
+            return std::make_pair(nodes_.front().h, nodes_.front().v);
+        }
+
+        if (t >= nodes_.back().t)
+        {
+            return std::make_pair(nodes_.back().h, nodes_.back().v);
+        }
+
+        return interpolate(segment(0, t), t);
+    }
+
+    template <typename T>
+    void DenseOutput<T>::operator()(T const * t, std::size_t n, T * h, T * v) const
+    {
+        BOOST_ASSERT(!nodes_.empty());
+
+        std::size_t i = 0;
+        for (std::size_t k = 0; k < n; k++) {
+            if (nodes_.size() == 1 || t[k] <= nodes_.front().t || t[k] >= nodes_.back().t)
+            {
+                auto const & node = t[k] <= nodes_.front().t ? nodes_.front() : nodes_.back();
+                h[k] = node.h;
+                v[k] = node.v;
+                continue;
+            }
+
+            // 時刻が昇順に並んでいれば、直前の区間より前を探索する必要はない
+            i = segment(k && t[k] >= t[k - 1] ? i : 0, t[k]);
+
+            auto const state = interpolate(i, t[k]);
+            h[k] = state.first;
+            v[k] = state.second;
+        }
+    }
+
+    template <typename T>
+    void DenseOutput<T>::push(T t, T h, T v, T a)
+    {
+        BOOST_ASSERT(nodes_.empty() || t >= nodes_.back().t);
+
+        if (!nodes_.empty() && t == nodes_.back().t)
+        {
+            nodes_.back() = { t, h, v, a };
+            return;
+        }
+
+        nodes_.push_back({ t, h, v, a });
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    typename DenseOutput<T>::statetype DenseOutput<T>::interpolate(std::size_t i, T t) const
+    {
+        auto const & n0 = nodes_[i];
+        auto const & n1 = nodes_[i + 1];
+
+        auto const dt = n1.t - n0.t;
+        auto const s = (t - n0.t) / dt;
+        auto const s2 = s * s;
+        auto const s3 = s2 * s;
+
+        // 3次エルミート基底関数
+        auto const h00 = 2 * s3 - 3 * s2 + 1;
+        auto const h10 = s3 - 2 * s2 + s;
+        auto const h01 = -2 * s3 + 3 * s2;
+        auto const h11 = s3 - s2;
+
+        return std::make_pair(
+            h00 * n0.h + h10 * dt * n0.v + h01 * n1.h + h11 * dt * n1.v,
+            h00 * n0.v + h10 * dt * n0.a + h01 * n1.v + h11 * dt * n1.a);
+    }
+
+    template <typename T>
+    std::size_t DenseOutput<T>::segment(std::size_t first, T t) const
+    {
+        // t < nodes_[i + 1].t となる最初の区間i
+        auto const itr = std::upper_bound(
+            nodes_.begin() + static_cast<std::ptrdiff_t>(first) + 1,
+            nodes_.end() - 1,
+            t,
+            [](T const & lhs, DenseOutput::nodetype const & rhs) { return lhs < rhs.t; });
+
+        return static_cast<std::size_t>(std::distance(nodes_.begin(), itr)) - 1;
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class DenseOutput<float>;
+    template class DenseOutput<double>;
+    template class DenseOutput<referencetype>;
+
+    // #endregion templateクラスの実体化
+}
@@ -0,0 +1,194 @@
+﻿/*! \file denseoutput.h
+    \brief 計算した軌道を区分的な3次エルミート補間で保持し、任意の時刻の状態を求めるクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _DENSEOUTPUT_H_
+#define _DENSEOUTPUT_H_
+
+#pragma once
+
+#include <cstddef>      // for std::size_t
+#include <utility>      // for std::pair
+#include <vector>       // for std::vector
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        各時間刻みの終わりの時刻、高度、速度、加速度を節点として保持し、隣り合う節点の間を3次エルミート補間するクラス
+        高度の補間には速度を、速度の補間には加速度を導関数として用いるため、誤差は時間刻みの4乗に比例する
+        \tparam T 浮動小数点数の型
+    */
+    template <typename T>
+    class DenseOutput final {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            高度（m）と速度（m/s）のstd::pairの型
+        */
+        using statetype = std::pair<T, T>;
+
+        // #endregion 型エイリアス
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            デフォルトコンストラクタ
+        */
+        DenseOutput() = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~DenseOutput() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function (const).
+        /*!
+            節点が一つも無いかどうかを返す
+            \return 節点が一つも無いかどうか
+        */
+        bool empty() const
+        {
+            return nodes_.empty();
+        }
+
+        //! A public member function (const).
+        /*!
+            時刻tの状態を求める（O(log n)、保持している範囲の外の時刻は範囲の端に丸める）
+            \param t 時刻（秒）
+            \return 高度（m）と速度（m/s）
+        */
+        DenseOutput::statetype operator()(T t) const;
+
+        //! A public member function (const).
+        /*!
+            複数の時刻の状態をまとめて求める（時刻が昇順に並んでいる場合は、直前の区間から探索を始める）
+            \param t 時刻（秒）の配列へのポインタ
+            \param n 時刻の数
+            \param h 高度（m）の配列へのポインタ（返り値として使用）
+            \param v 速度（m/s）の配列へのポインタ（返り値として使用）
+        */
+        void operator()(T const * t, std::size_t n, T * h, T * v) const;
+
+        //! A public member function.
+        /*!
+            節点を追加する（時刻は直前の節点の時刻以上でなければならず、同じ時刻の場合は置き換える）
+            \param t 時刻（秒）
+            \param h 高度（m）
+            \param v 速度（m/s）
+            \param a 加速度（m/s²）
+        */
+        void push(T t, T h, T v, T a);
+
+        //! A public member function (const).
+        /*!
+            節点の数を返す
+            \return 節点の数
+        */
+        std::size_t size() const
+        {
+            return nodes_.size();
+        }
+
+        //! A public member function (const).
+        /*!
+            最初の節点の時刻を返す
+            \return 最初の節点の時刻（秒）
+        */
+        T tbegin() const
+        {
+            return nodes_.front().t;
+        }
+
+        //! A public member function (const).
+        /*!
+            最後の節点の時刻を返す
+            \return 最後の節点の時刻（秒）
+        */
+        T tend() const
+        {
+            return nodes_.back().t;
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region 構造体
+
+        //! A struct.
+        /*!
+            補間の節点
+        */
+        struct nodetype {
+            //! A public member variable.
+            /*!
+                時刻（秒）
+            */
+            T t;
+
+            //! A public member variable.
+            /*!
+                高度（m）
+            */
+            T h;
+
+            //! A public member variable.
+            /*!
+                速度（m/s）
+            */
+            T v;
+
+            //! A public member variable.
+            /*!
+                加速度（m/s²）
+            */
+            T a;
+        };
+
+        // #endregion 構造体
+
+        // #region privateメンバ関数
+
+        //! A private member function (const).
+        /*!
+            i番目とi + 1番目の節点の間で、時刻tの状態を補間する
+            \param i 区間の番号
+            \param t 時刻（秒）
+            \return 高度（m）と速度（m/s）
+        */
+        DenseOutput::statetype interpolate(std::size_t i, T t) const;
+
+        //! A private member function (const).
+        /*!
+            [first, nodes_.size() - 1)の範囲で、時刻tを含む区間の番号を二分探索する
+            \param first 探索を始める区間の番号
+            \param t 時刻（秒）
+            \return 区間の番号
+        */
+        std::size_t segment(std::size_t first, T t) const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            時刻の昇順に並んだ節点
+        */
+        std::vector<DenseOutput::nodetype> nodes_;
+
+        // #endregion メンバ変数
+    };
+}
+
+#endif  // _DENSEOUTPUT_H_
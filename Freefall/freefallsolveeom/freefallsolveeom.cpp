@@ -5,13 +5,15 @@
     This software is released under the BSD 2-Clause License.
 */
 #include "freefallsolveeom.h"
-#include <cmath>                                // for std::cos, std::floor, std::log10
-#include <cstdio>                               // for std::fclose, std::fflush, std::fopen, std::fwrite
+#include "keplerorbit.h"
+#include <algorithm>                            // for std::count_if, std::max, std::min
+#include <cmath>                                // for std::ceil, std::cos, std::fabs, std::floor, std::isfinite, std::llround, std::log10
+#include <limits>                               // for std::numeric_limits
+#include <memory>                               // for std::make_unique
 #include <optional>                             // for std::make_optional
-#include <queue>                                // for std::queue
-#include <string>                               // for std::to_string
 #include <tuple>                                // for std::get, std::make_tuple
-#include <utility>                              // for std::make_pair  
+#include <type_traits>                          // for std::is_same_v
+#include <utility>                              // for std::make_pair, std::move
 #include <boost/assert.hpp>                     // for BOOST_ASSERT
 #include <boost/math/constants/constants.hpp>   // for boost::math::constants::pi
 #include <boost/math/tools/minima.hpp>          // for boost::math::tools::brent_find_minima
@@ -20,162 +22,289 @@
 namespace freefallsolveeom {
     // #region コンストラクタ・デストラクタ
 
-    FreefallSolveEom::FreefallSolveEom(double dt, double tintervalgraphplot, double eps, double m, double r, double h0, double v0, Ode_Solver_type ode_solver_type) :
-        acc_(gsl_interp_accel_alloc(), gsl_interp_accel_deleter),
+    template <typename Real, bool Diagnostics>
+    FreefallSolveEom<Real, Diagnostics>::FreefallSolveEom(Real dt, Real tintervalgraphplot, Real eps, Real m, Real r, Real h0, Real v0, Ode_Solver_type ode_solver_type, std::shared_ptr<Atmosphere const> atmosphere) :
+        atmosphere_(std::move(atmosphere)),
+        atmospheretop_(atmosphere_->top()),
         dt_(dt),
         eps_(eps),
-        fp_(nullptr, std::fclose),
         h0_(h0),
         imax_(static_cast<std::int32_t>(tintervalgraphplot / dt)),
-        l2divm2northlatitude45_(sqr(sqr(FreefallSolveEom::R0 + h0) * 2.0 * pi<double>() / (24.0 * 60.0 * 60.0)) * std::cos(pi<double>() * 0.25)),
+        l2divm2northlatitude45_(getl2divm2northlatitude45(h0)),
         m_(m),
         ode_solver_type_(ode_solver_type),
         r_(r),
-        spherevolume_(4.0 / 3.0 * boost::math::constants::pi<double>() * r * r * r),
-        spline_pressure_(nullptr, gsl_spline_deleter),
-        spline_temperature_(nullptr, gsl_spline_deleter),
+        spherevolume_(getspherevolume(r)),
         tintervalgraphplot_(tintervalgraphplot),
         tintervaloutputcsv_(std::nullopt),
         islargertintervaloutputcsv_(std::nullopt),
         v0_(v0),
-		x_({ R0 + h0, v0 })
+        x_({ h0, v0 })
     {
-        initialize();
     }
 
-    FreefallSolveEom::FreefallSolveEom(double dt, double tintervalgraphplot, double tintervaloutputcsv, std::string const & csvfilename, double eps, double m, double r, double h0, double v0, Ode_Solver_type ode_solver_type) :
-        acc_(gsl_interp_accel_alloc(), gsl_interp_accel_deleter),
+    template <typename Real, bool Diagnostics>
+    FreefallSolveEom<Real, Diagnostics>::FreefallSolveEom(Real dt, Real tintervalgraphplot, Real tintervaloutputcsv, std::string const & csvfilename, TrajectoryWriter::Format format, TrajectoryWriter::Compression compression, Real eps, Real m, Real r, Real h0, Real v0, Ode_Solver_type ode_solver_type, std::shared_ptr<Atmosphere const> atmosphere) :
+        atmosphere_(std::move(atmosphere)),
+        atmospheretop_(atmosphere_->top()),
         dt_(dt),
         eps_(eps),
-        fp_(std::unique_ptr< FILE, decltype(&std::fclose) >(std::fopen(csvfilename.c_str(), "w"), std::fclose)),
         h0_(h0),
         imax_(static_cast<std::int32_t>(tintervalgraphplot / dt)),
-        l2divm2northlatitude45_(sqr(sqr(FreefallSolveEom::R0 + h0) * 2.0 * pi<double>() / (24.0 * 60.0 * 60.0)) * std::cos(pi<double>() * 0.25)),
+        l2divm2northlatitude45_(getl2divm2northlatitude45(h0)),
         m_(m),
         ode_solver_type_(ode_solver_type),
-        outputtocsvdigits_(std::to_string(tintervaloutputcsv > 0.1 ? 1 : static_cast<std::int32_t>(std::ceil(-std::log10(tintervaloutputcsv))))),
         r_(r),
-        spherevolume_(4.0 / 3.0 * boost::math::constants::pi<double>() * r * r * r),
-        spline_pressure_(nullptr, gsl_spline_deleter),
-        spline_temperature_(nullptr, gsl_spline_deleter),
+        spherevolume_(getspherevolume(r)),
         tintervalgraphplot_(tintervalgraphplot),
         tintervaloutputcsv_(std::make_optional(tintervaloutputcsv)),
         islargertintervaloutputcsv_(std::make_optional(tintervalgraphplot <= tintervaloutputcsv)),
         v0_(v0),
-        x_({ R0 + h0, v0 })
+        x_({ h0, v0 }),
+        writer_(std::make_unique<TrajectoryWriter>(
+            csvfilename,
+            format,
+            compression,
+            tintervaloutputcsv > 0.1 ? 1 : static_cast<std::int32_t>(std::ceil(-std::log10(static_cast<double>(tintervaloutputcsv)))),
+            Diagnostics ? FreefallSolveEom::NDIAGNOSTICS : 0))
     {
-        initialize();
+        // ファイルを開けなかった場合も書き出しの失敗とする
+        if (!writer_->isopen())
+        {
+            iswritefailed_ = true;
+            writer_.reset();
+        }
     }
 
     // #endregion コンストラクタ・デストラクタ
 
     // #region publicメンバ関数
 
-    std::tuple< double, double, double, FreefallSolveEom::hmaxtype, FreefallSolveEom::vmaxtype, FreefallSolveEom::tandvtype, FreefallSolveEom::tandvandbooltype > FreefallSolveEom::operator()()
+    template <typename Real, bool Diagnostics>
+    void FreefallSolveEom<Real, Diagnostics>::enabletoleranceschedule(Real epsmax)
     {
-        FreefallSolveEom::state_type result{};
+        BOOST_ASSERT(isfirststep_);
+        BOOST_ASSERT(epsmax >= eps_);
+
+        istoleranceschedule_ = true;
+
+        // 許容誤差をTOLERANCERATIO倍ずつ緩めた段階のステッパーを、epsmaxを超えない範囲で用意する（丸め誤差の分だけ余裕を持たせて比較する）
+        for (Real eps = eps_ * FreefallSolveEom::TOLERANCERATIO; eps <= epsmax * (1.0 + 1.0E-9); eps *= FreefallSolveEom::TOLERANCERATIO) {
+            stepperbs_.prototypes.push_back(FreefallSolveEom::bs_stepper_type(eps, eps));
+            steppercontrolled_.prototypes.push_back(make_controlled(eps, eps, error_stepper_type()));
+            stepperstiff_.prototypes.push_back(makestiffstepper(eps));
+        }
+    }
+
+    template <typename Real, bool Diagnostics>
+    std::tuple< Real, Real, Real, typename FreefallSolveEom<Real, Diagnostics>::hmaxtype, typename FreefallSolveEom<Real, Diagnostics>::vmaxtype, typename FreefallSolveEom<Real, Diagnostics>::tandvtype, typename FreefallSolveEom<Real, Diagnostics>::tandvandbooltype > FreefallSolveEom<Real, Diagnostics>::operator()()
+    {
+        auto const sample = nextsample();
+        auto const & [t, h, v] = sample;
+
+        // 最高速度の際の状態は、返す点ではなく、最後に積分した状態から求める
+        auto const & [tlatest, hlatest, vlatest] = adaptivesampler_ ? adaptivesampler_->latest() : sample;
+
+        return std::make_tuple(t, h, v, getstateofhmax(), getstateofvmax(tlatest, hlatest, vlatest), stateescapeofkarmanline_, stateescapeofexosphere_);
+    }
+
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::pararealtype FreefallSolveEom<Real, Diagnostics>::parareal(Real tmax, std::size_t nslices, std::uint32_t nthreads) const
+    {
+        BOOST_ASSERT(isfirststep_);
+
         switch (ode_solver_type_) {
         case Ode_Solver_type::ADAMS_BASHFORTH_MOULTON:
-            result = solveeom_run(adams_bashforth_moulton< 2, FreefallSolveEom::state_type >());
-            break;
+            return parareal_run(adams_bashforth_moulton< 2, FreefallSolveEom::state_type, Real >(), tmax, nslices, nthreads);
 
         case Ode_Solver_type::BULIRSCH_STOER:
-            result = solveeom_run(bulirsch_stoer< FreefallSolveEom::state_type >(eps_, eps_));
-            break;
+            return parareal_run(FreefallSolveEom::bs_stepper_type(eps_, eps_), tmax, nslices, nthreads);
 
         case Ode_Solver_type::CONTROLLED_RUNGE_KUTTA:
-            result = solveeom_run(make_controlled(eps_, eps_, error_stepper_type()));
-            break;
+        // 硬さの判定は直前の状態に依存するため、スライスごとに独立に切り替えられない
+        case Ode_Solver_type::AUTO:
+            return parareal_run(make_controlled(eps_, eps_, error_stepper_type()), tmax, nslices, nthreads);
+
+        case Ode_Solver_type::ROSENBROCK:
+            return parareal_run(FreefallSolveEom::stiff_stepper_type(eps_, eps_), tmax, nslices, nthreads);
 
         default:
             BOOST_ASSERT(!"Ode_Solver_typeがあり得ない値になっている！");
-            break;
+            return FreefallSolveEom::pararealtype();
         }
+    }
 
-        auto const t = iscalculationfinished_ ? tend_ : t_;
-        auto const h = result[0] - FreefallSolveEom::R0;
-        auto const v = result[1];
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::previewtype FreefallSolveEom<Real, Diagnostics>::preview() const
+    {
+        // 時間刻みを大きくすると硬くなりやすいので、数値解法は自動で切り替える
+        auto const dt = std::max(dt_, static_cast<Real>(FreefallSolveEom::PREVIEWDT));
+        FreefallSolveEom coarse(
+            dt,
+            std::max(tintervalgraphplot_, dt),
+            std::max(eps_, static_cast<Real>(FreefallSolveEom::PREVIEWEPS)),
+            m_,
+            r_,
+            h0_,
+            v0_,
+            Ode_Solver_type::AUTO,
+            atmosphere_);
 
-        FreefallSolveEom::hmaxtype stateofhmax = std::nullopt;
-        if (hmaxoftandh_)
-        {
-            stateofhmax = hmaxoftandh_;
-        }
-        else if (v0_ <= 0.0)
-        {
-            stateofhmax = std::make_optional(std::make_pair(0.0, h0_));
+        FreefallSolveEom::previewtype res;
+        while (!coarse.isCalculationFinished()) {
+            auto const [t, h, v, stateofhmax, stateofvmax, stateofkarmanline, stateofexosphere] = coarse();
+            res.trajectory.push_back({ t, h, v });
+            res.events.hmax = stateofhmax;
+            res.events.vmax = stateofvmax;
+            res.events.karmanline = stateofkarmanline;
+            res.events.exosphere = stateofexosphere;
         }
-        
-        FreefallSolveEom::vmaxtype stateofvmax = std::nullopt;
-        if (vmaxoftandhandv_ && std::fabs(std::get<2>(*vmaxoftandhandv_)) >= std::fabs(v0_))
-        {
-            stateofvmax = vmaxoftandhandv_;
-        }
-        else if (vmaxoftandhandv_ || (iscalculationfinished_ && std::fabs(v) < std::fabs(v0_)))
+
+        // 第二宇宙速度で外気圏を脱出した場合は地面に衝突しない
+        if (!res.events.exosphere || !std::get<2>(*res.events.exosphere))
         {
-            stateofvmax = std::make_optional(std::make_tuple(0.0, h0_, v0_));    
+            auto const & last = res.trajectory.back();
+            res.events.impact = std::make_optional(std::make_pair(last[0], last[2]));
         }
-        else if (iscalculationfinished_ && std::fabs(v) >= std::fabs(v0_))
-        {
-            stateofvmax = std::make_optional(std::make_tuple(t, h, v));
+
+        return res;
+    }
+
+    template <typename Real, bool Diagnostics>
+    SampleRange<Real> FreefallSolveEom<Real, Diagnostics>::samples(FreefallSolveEom::eventhandlertype handler)
+    {
+        return SampleRange<Real>([this, handler = std::move(handler), notified = std::uint32_t(0)](FreefallSolveEom::sampletype & sample) mutable {
+            if (isCalculationFinished())
+            {
+                return false;
+            }
+
+            sample = nextsample();
+            if (handler)
+            {
+                notifyevents(handler, adaptivesampler_ ? adaptivesampler_->latest() : sample, notified);
+            }
+
+            return true;
+        });
+    }
+
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::sensitivitytype FreefallSolveEom<Real, Diagnostics>::sensitivity() const
+    {
+        switch (ode_solver_type_) {
+        case Ode_Solver_type::ADAMS_BASHFORTH_MOULTON:
+            return sensitivity_run(adams_bashforth_moulton< 2, FreefallSolveEom::sensitivity_state_type, Real >());
+
+        case Ode_Solver_type::BULIRSCH_STOER:
+            return sensitivity_run(bulirsch_stoer< FreefallSolveEom::sensitivity_state_type, Real >(eps_, eps_));
+
+        case Ode_Solver_type::CONTROLLED_RUNGE_KUTTA:
+        // 変分方程式のヤコビアンには加速度の2階偏微分が必要になるため、Rosenbrock法の場合もRunge-Kutta法で解く
+        case Ode_Solver_type::ROSENBROCK:
+        case Ode_Solver_type::AUTO:
+            return sensitivity_run(make_controlled(eps_, eps_, sensitivity_error_stepper_type()));
+
+        default:
+            BOOST_ASSERT(!"Ode_Solver_typeがあり得ない値になっている！");
+            return FreefallSolveEom::sensitivitytype();
         }
+    }
 
-        return std::make_tuple(t, h, v, stateofhmax, stateofvmax, stateescapeofkarmanline_, stateescapeofexosphere_);
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::summarytype FreefallSolveEom<Real, Diagnostics>::summary()
+    {
+        return *summary([] { return false; });
+    }
+
+    template <typename Real, bool Diagnostics>
+    std::optional<typename FreefallSolveEom<Real, Diagnostics>::summarytype> FreefallSolveEom<Real, Diagnostics>::summary(std::function<bool()> const & iscancelled)
+    {
+        // 途中の状態は返さず、計算が終了するか取り消されるまで進める
+        auto result = x_;
+        do {
+            if (iscancelled())
+            {
+                return std::nullopt;
+            }
+
+            result = solveeom<true>();
+        } while (!iscalculationfinished_);
+
+        auto const h = result[0];
+        auto const v = result[1];
+
+        // 第二宇宙速度で外気圏を脱出した場合は地面に衝突しない
+        auto const isescaped = stateescapeofexosphere_ && std::get<2>(*stateescapeofexosphere_);
+
+        return FreefallSolveEom::summarytype{
+            isescaped ? std::nullopt : std::make_optional(std::make_pair(tend_, v)),
+            getstateofhmax(),
+            getstateofvmax(tend_, h, v),
+            stateescapeofkarmanline_,
+            stateescapeofexosphere_ };
     }
 
     // #endregion publicメンバ関数
 
     // #region privateメンバ関数
 
-    double FreefallSolveEom::get_P(double r) const
+    template <typename Real, bool Diagnostics>
+    template <typename T>
+    T FreefallSolveEom<Real, Diagnostics>::get_P(T const & h) const
     {
+        using std::exp;
+        using std::pow;
+
         // ジオポテンシャル高度を取得
-        auto const H = getGeopotentialFromAltitude(r);
+        auto const H = getGeopotentialFromAltitude(h);
 
         // 「標準大気 ー 各高度における空気の温度・圧力・密度・音速・粘性係数・動粘性係数の計算式」
         // https://pigeon-poppo.com/standard-atmosphere/ より
         if (H <= 11000.0)
         {
-            return 101325.0 * std::pow(288.15 / FreefallSolveEom::get_T(r), -5.256);
+            return 101325.0 * pow(288.15 / FreefallSolveEom::get_T(h), -5.256);
         }
         else if (H <= 20000.0)
         {
-            return 22632.064 * std::exp(-0.1577 * (FreefallSolveEom::MTOKM * H - 11.0));
+            return 22632.064 * exp(-0.1577 * (FreefallSolveEom::MTOKM * H - 11.0));
         }
         else if (H <= 32000.0)
         {
-            return 5474.889 * std::pow(216.65 / FreefallSolveEom::get_T(r), 34.163);
+            return 5474.889 * pow(216.65 / FreefallSolveEom::get_T(h), 34.163);
         }
         else if (H <= 47000.0)
         {
-            return 868.019 * std::pow(228.65 / FreefallSolveEom::get_T(r), 12.201);
+            return 868.019 * pow(228.65 / FreefallSolveEom::get_T(h), 12.201);
         }
         else if (H <= 51000.0)
         {
-            return 110.906 * std::exp(-0.1262 * (FreefallSolveEom::MTOKM * H - 47.0));
+            return 110.906 * exp(-0.1262 * (FreefallSolveEom::MTOKM * H - 47.0));
         }
         else if (H <= 71000.0)
         {
-            return 66.939 * std::pow(270.65 / FreefallSolveEom::get_T(r), -12.201);
+            return 66.939 * pow(270.65 / FreefallSolveEom::get_T(h), -12.201);
         }
         else if (H <= 84852.0)
         {
-            return 3.956 * std::pow(214.65 / FreefallSolveEom::get_T(r), -17.082);
+            return 3.956 * pow(214.65 / FreefallSolveEom::get_T(h), -17.082);
         }
-        else if (r - FreefallSolveEom::R0 <= 1000000.0)
+        else if (h <= atmospheretop_)
         {   
-            return gsl_spline_eval(spline_pressure_.get(), r - FreefallSolveEom::R0, acc_.get());
+            return atmosphere_->pressure(h);
         }
         else
         {
-            return 0.0;
+            return T(0.0);
         }
     }
 
-    double FreefallSolveEom::get_T(double r) const
+    template <typename Real, bool Diagnostics>
+    template <typename T>
+    T FreefallSolveEom<Real, Diagnostics>::get_T(T const & h) const
     {
         // ジオポテンシャル高度を取得
-        auto const H = getGeopotentialFromAltitude(r);
+        auto const H = getGeopotentialFromAltitude(h);
         
         // 「標準大気 ー 各高度における空気の温度・圧力・密度・音速・粘性係数・動粘性係数の計算式」
         // https://pigeon-poppo.com/standard-atmosphere/ より
@@ -207,63 +336,369 @@ namespace freefallsolveeom {
         {
             return FreefallSolveEom::CELSIUSTOABSOLUTETEMPERATURE + 83.5 - 2.0 * FreefallSolveEom::MTOKM * H;
         }
-        else if (r - FreefallSolveEom::R0 <= 1000000.0)
+        else if (h <= atmospheretop_)
         {
-            return gsl_spline_eval(spline_temperature_.get(), r - FreefallSolveEom::R0, acc_.get());
+            return atmosphere_->temperature(h);
         }
         else
         {
-            return 1000.0;
+            return T(1000.0);
         }
     }
 
-    void FreefallSolveEom::initialize()
+    template <typename Real, bool Diagnostics>
+    void FreefallSolveEom<Real, Diagnostics>::integrate_eom(FreefallSolveEom::stiff_stepper_type const & stepper, Real t, FreefallSolveEom::state_type & x) const
     {
-        // 高度80km以上での気圧と温度のデータ
-        // 国立天文台編『理科年表』丸善出版（2012）p.331より引用
-        p_data_ = { 1.0524,    0.37338,   0.18359,   0.15381,   3.2011E-2, 7.1042E-3,
-                    2.5382E-3, 1.2505E-3, 7.2028E-4, 3.0395E-4, 1.5271E-4, 8.4736E-5,
-                    2.4767E-5, 8.7704E-6, 3.4498E-6, 1.4518E-6, 6.4468E-7, 3.0236E-7,
-                    1.5137E-7, 8.2130E-8, 4.8865E-8, 3.1908E-8, 2.2599E-8, 1.7036E-8,
-                    1.3415E-8, 1.0873E-8, 7.5138E-9 };
-
-        t_data_ = { 198.639, 186.87, 186.87, 186.87, 195.08, 240.00, 360.00, 469.27,
-                    559.63,  696.29, 790.07, 854.56, 941.33, 976.01, 990.06, 995.83,
-                    998.22,  999.24, 999.67, 999.85, 999.93, 999.97, 999.99, 999.99,
-                    1000.0,  1000.0, 1000.0 };
-
-        z_mesh_ = { 80000.0,  86000.0,  90000.0,  91000.0,  100000.0, 110000.0,
-                    120000.0, 130000.0, 140000.0, 160000.0, 180000.0, 200000.0,
-                    250000.0, 300000.0, 350000.0, 400000.0, 450000.0, 500000.0,
-                    550000.0, 600000.0, 650000.0, 700000.0, 750000.0, 800000.0,
-                    850000.0, 900000.0, 1000000.0 };
-
-        BOOST_ASSERT(p_data_.size() == z_mesh_.size());
-        BOOST_ASSERT(t_data_.size() == z_mesh_.size());
-
-        spline_pressure_.reset(gsl_spline_alloc(gsl_interp_cspline, z_mesh_.size()));
-        spline_temperature_.reset(gsl_spline_alloc(gsl_interp_cspline, z_mesh_.size()));
-
-        gsl_spline_init(spline_pressure_.get(), z_mesh_.data(), p_data_.data(), z_mesh_.size());
-        gsl_spline_init(spline_temperature_.get(), z_mesh_.data(), t_data_.data(), z_mesh_.size());
+        // 複数のスレッドから同時に呼び出されるので、状態の作業領域はその都度確保する
+        boost::numeric::ublas::vector<Real> xtmp(2);
+        integrate_stiff(stepper, t, x, xtmp);
     }
-    
+
+    template <typename Real, bool Diagnostics>
     template <typename Stepper>
-    FreefallSolveEom::state_type FreefallSolveEom::solveeom_run(Stepper const & stepper)
+    void FreefallSolveEom<Real, Diagnostics>::integrate_stiff(Stepper const & stepper, Real t, FreefallSolveEom::state_type & x, boost::numeric::ublas::vector<Real> & xtmp) const
+    {
+        using vector_type = boost::numeric::ublas::vector<Real>;
+        using matrix_type = boost::numeric::ublas::matrix<Real>;
+
+        BOOST_ASSERT(xtmp.size() == 2);
+
+        xtmp[0] = x[0];
+        xtmp[1] = x[1];
+
+        integrate_adaptive(
+            stepper,
+            std::make_pair(
+                [this](vector_type const & x, vector_type & dxdt, Real const)
+                {
+                    // dx/dt = v
+                    dxdt[0] = x[1];
+
+                    // dv/dt = a
+                    dxdt[1] = acceleration(x[0], x[1], m_, r_, spherevolume_, l2divm2northlatitude45_);
+                },
+                [this](vector_type const & x, matrix_type & jacobi, Real const, vector_type & dfdt)
+                {
+                    // 加速度と、そのh、vについての偏微分
+                    auto const a = accelerationwithjacobian(FreefallSolveEom::state_type{ x[0], x[1] });
+
+                    jacobi(0, 0) = 0.0;
+                    jacobi(0, 1) = 1.0;
+                    jacobi(1, 0) = a.grad(0);
+                    jacobi(1, 1) = a.grad(1);
+
+                    // 方程式は時間に陽に依存しない
+                    dfdt[0] = 0.0;
+                    dfdt[1] = 0.0;
+                }),
+            xtmp,
+            Real(0),
+            t,
+            dt_);
+
+        x[0] = xtmp[0];
+        x[1] = xtmp[1];
+    }
+
+    template <typename Real, bool Diagnostics>
+    bool FreefallSolveEom<Real, Diagnostics>::isstiff()
+    {
+        // 陽解法では、安定性のために時間刻みを 1/(スペクトル半径) 程度まで小さくする必要がある
+        // 切り替えが頻繁に起こらないように、閾値に幅を持たせる
+        auto const stiffness = spectralradius(x_) * dt_;
+        if (isstiff_ && stiffness < FreefallSolveEom::NONSTIFFTHRESHOLD)
+        {
+            isstiff_ = false;
+        }
+        else if (!isstiff_ && stiffness > FreefallSolveEom::STIFFTHRESHOLD)
+        {
+            isstiff_ = true;
+        }
+
+        return isstiff_;
+    }
+
+    template <typename Real, bool Diagnostics>
+    Real FreefallSolveEom<Real, Diagnostics>::spectralradius(FreefallSolveEom::state_type const & x) const
+    {
+        using std::fabs;
+        using std::sqrt;
+
+        // 加速度と、そのh、vについての偏微分
+        auto const a = accelerationwithjacobian(x);
+
+        // ヤコビアン ((0, 1), (∂a/∂h, ∂a/∂v)) の固有値の絶対値の最大値
+        auto const disc = sqr(a.grad(1)) + 4.0 * a.grad(0);
+
+        return disc >= 0.0 ?
+            0.5 * (fabs(a.grad(1)) + sqrt(disc)) :
+            sqrt(-a.grad(0));
+    }
+
+    template <typename Real, bool Diagnostics>
+    Real FreefallSolveEom<Real, Diagnostics>::specificenergy(FreefallSolveEom::state_type const & x) const
+    {
+        // 地球中心からの距離
+        auto const distance = FreefallSolveEom::R0 + x[0];
+
+        return 0.5 * sqr(x[1]) -
+            // 重力のポテンシャル
+            FreefallSolveEom::G * FreefallSolveEom::M / distance +
+            // 遠心力のポテンシャル
+            l2divm2northlatitude45_ / (2.0 * sqr(distance));
+    }
+
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::StiffStepper FreefallSolveEom<Real, Diagnostics>::makestiffstepper(Real eps)
+    {
+        FreefallSolveEom::StiffStepper stepper(FreefallSolveEom::stiff_stepper_type(eps, eps));
+
+        // 最初のステップで確保されるバッファを、あらかじめ確保しておく
+        boost::numeric::ublas::vector<Real> const x(2);
+        stepper.adjust_size(x);
+        stepper.stepper().adjust_size(x);
+
+        return stepper;
+    }
+
+    template <typename Real, bool Diagnostics>
+    Real FreefallSolveEom<Real, Diagnostics>::gettimetoevent() const
+    {
+        // 加速度と、そのh、vについての偏微分
+        auto const a = accelerationwithjacobian(x_);
+
+        // 事象の判定に用いる量gが0に近づいている場合、線形に外挿して0に達するまでの時間 -g / (dg/dt) を見積もる
+        auto tau = std::numeric_limits<Real>::infinity();
+        auto const approach = [&tau](Real g, Real dgdt)
+        {
+            if (g * dgdt < 0.0)
+            {
+                tau = std::min(tau, Real(-g / dgdt));
+            }
+        };
+
+        if (!stateescapeofkarmanline_)
+        {
+            approach(x_[0] - FreefallSolveEom::KARMANLINE, x_[1]);
+        }
+
+        if (!stateescapeofexosphere_)
+        {
+            approach(x_[0] - FreefallSolveEom::ALTITUDEOFEXOSPHERE, x_[1]);
+        }
+
+        // 地面と最高到達高度
+        approach(x_[0], x_[1]);
+        approach(x_[1], a.value());
+
+        // 最高速度（落下中に加速度が0になる点）
+        if (!vmaxoftandhandv_ && x_[1] < 0.0)
+        {
+            approach(a.value(), a.grad(0) * x_[1] + a.grad(1) * a.value());
+        }
+
+        return tau;
+    }
+
+    template <typename Real, bool Diagnostics>
+    bool FreefallSolveEom<Real, Diagnostics>::iseventbracketed(FreefallSolveEom::state_type const & before, FreefallSolveEom::state_type const & after) const
+    {
+        // 最高速度は、区間の途中で速度が最小となった後に増加に転じた場合も含める
+        return (!stateescapeofkarmanline_ && after[0] >= FreefallSolveEom::KARMANLINE) ||
+               (!stateescapeofexosphere_ && after[0] >= FreefallSolveEom::ALTITUDEOFEXOSPHERE) ||
+               after[0] < 0.0 ||
+               before[1] * after[1] <= 0.0 ||
+               (!vmaxoftandhandv_ && after[1] < 0.0 &&
+                (after[1] > before[1] || acceleration(after[0], after[1], m_, r_, spherevolume_, l2divm2northlatitude45_) > 0.0));
+    }
+
+    template <typename Real, bool Diagnostics>
+    void FreefallSolveEom<Real, Diagnostics>::pushstep(Real t, FreefallSolveEom::state_type const & x)
+    {
+        if (denseoutput_)
+        {
+            denseoutput_->push(t, x[0], x[1], acceleration(x[0], x[1], m_, r_, spherevolume_, l2divm2northlatitude45_));
+        }
+
+        if (adaptivesampler_)
+        {
+            adaptivesampler_->push(t, x[0], x[1]);
+        }
+    }
+    
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::hmaxtype FreefallSolveEom<Real, Diagnostics>::getstateofhmax() const
+    {
+        if (hmaxoftandh_)
+        {
+            return hmaxoftandh_;
+        }
+        else if (v0_ <= 0.0)
+        {
+            return std::make_optional(std::make_pair(Real(0), h0_));
+        }
+
+        return std::nullopt;
+    }
+
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::vmaxtype FreefallSolveEom<Real, Diagnostics>::getstateofvmax(Real t, Real h, Real v) const
+    {
+        using std::fabs;
+
+        if (vmaxoftandhandv_ && fabs(std::get<2>(*vmaxoftandhandv_)) >= fabs(v0_))
+        {
+            return vmaxoftandhandv_;
+        }
+        else if (vmaxoftandhandv_ || (iscalculationfinished_ && fabs(v) < fabs(v0_)))
+        {
+            return std::make_optional(std::make_tuple(Real(0), h0_, v0_));
+        }
+        else if (iscalculationfinished_ && fabs(v) >= fabs(v0_))
+        {
+            return std::make_optional(std::make_tuple(t, h, v));
+        }
+
+        return std::nullopt;
+    }
+
+    template <typename Real, bool Diagnostics>
+    typename FreefallSolveEom<Real, Diagnostics>::sampletype FreefallSolveEom<Real, Diagnostics>::nextsample()
+    {
+        if (!adaptivesampler_)
+        {
+            auto const result = solveeom<false>();
+
+            return { iscalculationfinished_ ? tend_ : t_, result[0], result[1] };
+        }
+
+        // 次に返す点が決まるまで、tintervalgraphplot秒ずつ積分する（時間刻みごとの状態は、pushstep()が候補として与える）
+        while (!adaptivesampler_->ready() && !iscalculationfinished_) {
+            solveeom<false>();
+
+            if (iscalculationfinished_)
+            {
+                adaptivesampler_->flush();
+            }
+        }
+
+        return adaptivesampler_->pop();
+    }
+
+    template <typename Real, bool Diagnostics>
+    void FreefallSolveEom<Real, Diagnostics>::notifyevents(FreefallSolveEom::eventhandlertype const & handler, FreefallSolveEom::sampletype const & latest, std::uint32_t & notified) const
+    {
+        auto const isnotified = [&notified](FreefallSolveEom::Event event) {
+            return (notified & (std::uint32_t(1) << static_cast<std::int32_t>(event))) != 0;
+        };
+
+        auto const notify = [&handler, &notified](FreefallSolveEom::Event event, Real t, Real h, Real v) {
+            notified |= std::uint32_t(1) << static_cast<std::int32_t>(event);
+            handler(event, t, h, v);
+        };
+
+        // 通知済みの事象は、値を求め直さずに読み飛ばす
+        if (!isnotified(FreefallSolveEom::Event::KARMANLINE) && stateescapeofkarmanline_)
+        {
+            auto const [t, v] = *stateescapeofkarmanline_;
+            notify(FreefallSolveEom::Event::KARMANLINE, t, Real(FreefallSolveEom::KARMANLINE), v);
+        }
+
+        if (!isnotified(FreefallSolveEom::Event::EXOSPHERE) && stateescapeofexosphere_)
+        {
+            notify(FreefallSolveEom::Event::EXOSPHERE, std::get<0>(*stateescapeofexosphere_), Real(FreefallSolveEom::ALTITUDEOFEXOSPHERE), std::get<1>(*stateescapeofexosphere_));
+        }
+
+        if (!isnotified(FreefallSolveEom::Event::HMAX))
+        {
+            if (auto const hmax = getstateofhmax())
+            {
+                // 最高到達高度に達する前に落ち始めた場合は、初期状態が最高到達高度となる
+                notify(FreefallSolveEom::Event::HMAX, hmax->first, hmax->second, hmaxoftandh_ ? Real(0) : v0_);
+            }
+        }
+
+        if (!isnotified(FreefallSolveEom::Event::VMAX))
+        {
+            if (auto const vmax = getstateofvmax(latest[0], latest[1], latest[2]))
+            {
+                auto const [t, h, v] = *vmax;
+                notify(FreefallSolveEom::Event::VMAX, t, h, v);
+            }
+        }
+
+        // 第二宇宙速度で外気圏を脱出した場合は地面に衝突しない
+        auto const isescaped = stateescapeofexosphere_ && std::get<2>(*stateescapeofexosphere_);
+        if (!isnotified(FreefallSolveEom::Event::IMPACT) && iscalculationfinished_ && !isescaped)
+        {
+            notify(FreefallSolveEom::Event::IMPACT, latest[0], latest[1], latest[2]);
+        }
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <bool Summary>
+    typename FreefallSolveEom<Real, Diagnostics>::state_type FreefallSolveEom<Real, Diagnostics>::solveeom()
+    {
+        FreefallSolveEom::state_type result{};
+        switch (ode_solver_type_) {
+        case Ode_Solver_type::ADAMS_BASHFORTH_MOULTON:
+            result = solveeom_run<Summary>(stepperabm_);
+            break;
+
+        case Ode_Solver_type::BULIRSCH_STOER:
+            result = solveeom_run<Summary>(stepperbs_);
+            break;
+
+        case Ode_Solver_type::CONTROLLED_RUNGE_KUTTA:
+            result = solveeom_run<Summary>(steppercontrolled_);
+            break;
+
+        case Ode_Solver_type::ROSENBROCK:
+            result = solveeom_run<Summary>(stepperstiff_);
+            break;
+
+        case Ode_Solver_type::AUTO:
+            // グラフプロット用の時間間隔ごとに、方程式の硬さに応じて解法を切り替える
+            if (isstiff())
+            {
+                result = solveeom_run<Summary>(stepperstiff_);
+            }
+            else
+            {
+                result = solveeom_run<Summary>(steppercontrolled_);
+            }
+            break;
+
+        default:
+            BOOST_ASSERT(!"Ode_Solver_typeがあり得ない値になっている！");
+            break;
+        }
+
+        return result;
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <bool Summary, typename Stepper>
+    typename FreefallSolveEom<Real, Diagnostics>::state_type FreefallSolveEom<Real, Diagnostics>::solveeom_run(FreefallSolveEom::StepperWorkspace<Stepper> & workspace)
     {
         using namespace boost::math::tools;
 
         if (isfirststep_)
         {
-            if (fp_)
+            if constexpr (!Summary)
             {
-                outputresulttocsv(0.0, x_);
+                if (writer_)
+                {
+                    outputresulttocsv(0.0, x_);
+                }
+
+                pushstep(0.0, x_);
             }
 
             // 0秒目ですでにカーマン・ラインを突破しているかどうか
             if (x_[0] >= FreefallSolveEom::KARMANLINE)
             {
-                stateescapeofkarmanline_ = std::make_optional(std::make_pair(0.0, v0_));
+                stateescapeofkarmanline_ = std::make_optional(std::make_pair(Real(0), v0_));
             }
 
             // 0秒目ですでに外気圏を脱出しているかどうか
@@ -272,7 +707,7 @@ namespace freefallsolveeom {
                 // 外気圏を脱出した際に速度が第二宇宙速度以上だったかどうか
                 if (x_[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE)
                 {
-                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(0.0, v0_, true));
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(Real(0), v0_, true));
 
                     // 計算打ち切り
                     iscalculationfinished_ = true;
@@ -280,7 +715,7 @@ namespace freefallsolveeom {
                 }
                 else
                 {
-                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(0.0, v0_, false));
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(Real(0), v0_, false));
                 }
             }
 
@@ -288,22 +723,66 @@ namespace freefallsolveeom {
             return x_;
         }
 
-        std::queue<FreefallSolveEom::state_type> history{};
+        // 直近の二つの状態（固定長のリングバッファなので、ヒープの確保を行わない）
+        FreefallSolveEom::historytype history;
 
-        for (auto i = 1; i <= imax_; i++) {
-            auto const ttmp = static_cast<double>(i) * dt_;
+        // 要約のみを求める場合は、途中の状態を返す必要が無いので一度に多くのステップを進める
+        // （自動切り替えの場合は、硬さの判定の間隔を変えないようにグラフプロット用の時間間隔ごとに止める）
+        auto const imax = Summary && ode_solver_type_ != Ode_Solver_type::AUTO ? FreefallSolveEom::SUMMARYIMAX : imax_;
 
-            if (history.size() < 2)
+        for (auto i = 1; i <= imax; i++) {
+            if (history.full())
             {
-                history.push(x_);
+                history.pop();
             }
-            else
+
+            history.push(x_);
+
+            // 大気の無い領域では解析的に解く
+            if (x_[0] > atmospheretop_)
             {
-                history.pop();
-                history.push(x_);
+                if (auto const nstep = solveeom_kepler<Summary>(i, imax, history); nstep > 0)
+                {
+                    if (iscalculationfinished_)
+                    {
+                        return x_;
+                    }
+
+                    i += nstep - 1;
+
+                    if constexpr (!Summary)
+                    {
+                        if (tintervaloutputcsv_ && !(*islargertintervaloutputcsv_) && isoutputtimeofcsv(static_cast<Real>(i) * dt_))
+                        {
+                            outputresulttocsv(t_ + static_cast<Real>(i) * dt_, x_);
+                        }
+                    }
+
+                    continue;
+                }
             }
 
-            integrate_eom(stepper, dt_, x_);
+            // 事象から遠い区間では、許容誤差を緩めて複数のステップを一度に積分する
+            // （時間刻みごとの状態を出力する場合は行わない）
+            if (Summary || (!writer_ && !denseoutput_))
+            {
+                if (auto const nstep = solveeom_relaxed(workspace, i, imax, history); nstep > 0)
+                {
+                    i += nstep - 1;
+
+                    // 点を間引く場合は、まとめて積分した区間の終わりの状態だけを候補とする
+                    if constexpr (!Summary)
+                    {
+                        pushstep(t_ + static_cast<Real>(i) * dt_, x_);
+                    }
+
+                    continue;
+                }
+            }
+
+            auto const ttmp = static_cast<Real>(i) * dt_;
+
+            integrate_eom(workspace, dt_, x_);
 
             if (vmaxoftandhandv_ && x_[1] < 0.0)
             {
@@ -317,22 +796,22 @@ namespace freefallsolveeom {
             {
                 auto maxit = MAXITER;
                 auto res = bisect(
-                    [&stepper, &statebefore, this](double t)
+                    [&workspace, &statebefore, this](Real t)
                 {
                     auto x = statebefore;
-                    integrate_eom(stepper, t, x);
+                    integrate_eom(workspace, t, x);
                     return x[0] - FreefallSolveEom::KARMANLINE;
                 },
-                    0.0,
+                    Real(0),
                     dt_,
-                    eps_tolerance<double>(FreefallSolveEom::DIGITS),
+                    eps_tolerance<Real>(FreefallSolveEom::DIGITS),
                     maxit);
 
                 auto const tescapeofkarmanline = (res.first + res.second) * 0.5;
                 auto xtmp(statebefore);
-                integrate_eom(stepper, tescapeofkarmanline, xtmp);
+                integrate_eom(workspace, tescapeofkarmanline, xtmp);
 
-                stateescapeofkarmanline_ = std::make_optional(std::make_pair(t_ + static_cast<double>(i - 1) * dt_ + tescapeofkarmanline, xtmp[1]));
+                stateescapeofkarmanline_ = std::make_optional(std::make_pair(t_ + static_cast<Real>(i - 1) * dt_ + tescapeofkarmanline, xtmp[1]));
             }
 
             // 外気圏を脱出した際の時間を探索
@@ -340,65 +819,77 @@ namespace freefallsolveeom {
             {
                 auto maxit = MAXITER;
                 auto res = bisect(
-                    [&stepper, &statebefore, this](double t)
+                    [&workspace, &statebefore, this](Real t)
                 {
                     auto x = statebefore;
-                    integrate_eom(stepper, t, x);
+                    integrate_eom(workspace, t, x);
                     return x[0] - FreefallSolveEom::ALTITUDEOFEXOSPHERE;
                 },
-                    0.0,
+                    Real(0),
                     dt_,
-                    eps_tolerance<double>(FreefallSolveEom::DIGITS),
+                    eps_tolerance<Real>(FreefallSolveEom::DIGITS),
                     maxit);
 
                 auto const tescapeofexosphere = (res.first + res.second) * 0.5;
                 auto xtmp(statebefore);
-                integrate_eom(stepper, tescapeofexosphere, xtmp);
+                integrate_eom(workspace, tescapeofexosphere, xtmp);
 
                 // 外気圏を脱出した際に速度が第二宇宙速度以上だったかどうか
                 if (xtmp[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE)
                 {
-                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(t_ + static_cast<double>(i - 1) * dt_ + tescapeofexosphere, xtmp[1], true));
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(t_ + static_cast<Real>(i - 1) * dt_ + tescapeofexosphere, xtmp[1], true));
 
                     // 計算打ち切り
                     iscalculationfinished_ = true;
-                    tend_ = t_ + static_cast<double>(i - 1) * dt_ + tescapeofexosphere;
+                    tend_ = t_ + static_cast<Real>(i - 1) * dt_ + tescapeofexosphere;
+
+                    if constexpr (!Summary)
+                    {
+                        pushstep(tend_, xtmp);
+                    }
 
                     return xtmp;
                 }
                 else
                 {
-                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(t_ + static_cast<double>(i - 1) * dt_ + tescapeofexosphere, xtmp[1], false));
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(t_ + static_cast<Real>(i - 1) * dt_ + tescapeofexosphere, xtmp[1], false));
                 }
             }
             
             // 地面に衝突する時の速度とその際の時間を探索
-            if (x_[0] < FreefallSolveEom::R0)
+            if (x_[0] < 0.0)
             {
                 auto maxit = MAXITER;
                 auto res = bisect(
-                    [&stepper, &statebefore, this](double t)
+                    [&workspace, &statebefore, this](Real t)
                 {
                     auto x = statebefore;
-                    integrate_eom(stepper, t, x);
-                    return x[0] - FreefallSolveEom::R0;
+                    integrate_eom(workspace, t, x);
+                    return x[0];
                 },
-                    0.0,
+                    Real(0),
                     dt_,
-                    eps_tolerance<double>(FreefallSolveEom::DIGITS),
+                    eps_tolerance<Real>(FreefallSolveEom::DIGITS),
                     maxit);
 
                 auto const tendtmp = (res.first + res.second) * 0.5;
                 auto xtmp(statebefore);
-                integrate_eom(stepper, tendtmp, xtmp);
+                integrate_eom(workspace, tendtmp, xtmp);
 
-                tend_ = t_ + static_cast<double>(i - 1) * dt_ + tendtmp;
-                                
-                if (fp_)
+                tend_ = t_ + static_cast<Real>(i - 1) * dt_ + tendtmp;
+
+                if constexpr (!Summary)
                 {
-                    outputresulttocsv(tend_, xtmp);
-                    std::fflush(fp_.get());
-                    fp_.reset();
+                    pushstep(tend_, xtmp);
+
+                    if (writer_)
+                    {
+                        // 残りのブロックを書き出してファイルを閉じる
+                        outputresulttocsv(tend_, xtmp);
+                        writer_->close();
+                        iswritefailed_ = writer_->isfailed();
+                        writer_.reset();
+                    }
                 }
                 
                 iscalculationfinished_ = true;
@@ -411,22 +902,22 @@ namespace freefallsolveeom {
             {
                 auto maxit = MAXITER;
                 auto const res = bisect(
-                    [&stepper, &statebefore, this](double t)
+                    [&workspace, &statebefore, this](Real t)
                 {
                     auto x = statebefore;
-                    integrate_eom(stepper, t, x);
+                    integrate_eom(workspace, t, x);
                     return x[1];
                 },
-                    0.0,
+                    Real(0),
                     dt_,
-                    eps_tolerance<double>(FreefallSolveEom::DIGITS),
+                    eps_tolerance<Real>(FreefallSolveEom::DIGITS),
                     maxit);
 
                 auto const thmaxtmp = (res.first + res.second) * 0.5;
                 auto xtmp(statebefore);
-                integrate_eom(stepper, thmaxtmp, xtmp);
+                integrate_eom(workspace, thmaxtmp, xtmp);
 
-                hmaxoftandh_ = std::make_optional(std::make_pair(t_ + static_cast<double>(i - 1) * dt_ + thmaxtmp, xtmp[0] - FreefallSolveEom::R0));
+                hmaxoftandh_ = std::make_optional(std::make_pair(t_ + static_cast<Real>(i - 1) * dt_ + thmaxtmp, xtmp[0]));
             }
 
             // 最高速度とその際の時間と高度の探索
@@ -435,61 +926,725 @@ namespace freefallsolveeom {
                 auto maxit = MAXITER;
                 auto state2before = history.front();
                 auto const res = brent_find_minima(
-                    [&stepper, &state2before, this](double t)
+                    [&workspace, &state2before, this](Real t)
                 {
                     auto x = state2before;
-                    integrate_eom(stepper, t, x);
+                    integrate_eom(workspace, t, x);
                     return x[1];
                 },
-                    0.0,
-                    2.0 * dt_,
+                    Real(0),
+                    2 * dt_,
                     FreefallSolveEom::DIGITS,
                     maxit);
 
                 auto xtmp(state2before);
-                integrate_eom(stepper, res.first, xtmp);
+                integrate_eom(workspace, res.first, xtmp);
 
                 BOOST_ASSERT(xtmp[1] < state2before[1]);
                 BOOST_ASSERT(xtmp[1] < statebefore[1]);
                 BOOST_ASSERT(xtmp[1] < x_[1]);
 
-                vmaxoftandhandv_ = std::make_optional(std::make_tuple(t_ + static_cast<double>(i - 2) * dt_ + res.first, xtmp[0] - FreefallSolveEom::R0, xtmp[1]));
+                vmaxoftandhandv_ = std::make_optional(std::make_tuple(t_ + static_cast<Real>(i - 2) * dt_ + res.first, xtmp[0], xtmp[1]));
             }
 
-            if (tintervaloutputcsv_ &&
-                !(*islargertintervaloutputcsv_) &&
-                (std::fabs(ttmp / *tintervaloutputcsv_ - std::floor(ttmp / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV || std::fabs(ttmp / *tintervaloutputcsv_ - std::ceil(ttmp / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV))
+            if constexpr (!Summary)
             {
-                outputresulttocsv(t_ + ttmp, x_);
+                pushstep(t_ + ttmp, x_);
+
+                if (tintervaloutputcsv_ && !(*islargertintervaloutputcsv_) && isoutputtimeofcsv(ttmp))
+                {
+                    outputresulttocsv(t_ + ttmp, x_);
+                }
             }
         }
 
-        cnt_++;
-        t_ = static_cast<double>(cnt_) * tintervalgraphplot_;
-
-        if (tintervaloutputcsv_ &&
-            *islargertintervaloutputcsv_ &&
-            (std::fabs(t_ / *tintervaloutputcsv_ - std::floor(t_ / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV || std::fabs(t_ / *tintervaloutputcsv_ - std::ceil(t_ / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV))
+        if constexpr (Summary)
         {
-            outputresulttocsv(t_, x_);
+            t_ += static_cast<Real>(imax) * dt_;
+        }
+        else
+        {
+            cnt_++;
+            t_ = static_cast<Real>(cnt_) * tintervalgraphplot_;
+
+            if (tintervaloutputcsv_ && *islargertintervaloutputcsv_ && isoutputtimeofcsv(t_))
+            {
+                outputresulttocsv(t_, x_);
+            }
+
+            // 書き出し用のスレッドで圧縮か書き込みに失敗していたら、以降のファイルへの出力を打ち切る
+            if (writer_ && writer_->isfailed())
+            {
+                iswritefailed_ = true;
+                writer_.reset();
+            }
         }
                 
         return x_;
     }
 
+    template <typename Real, bool Diagnostics>
+    template <bool Summary>
+    std::int32_t FreefallSolveEom<Real, Diagnostics>::solveeom_kepler(std::int32_t i, std::int32_t imax, FreefallSolveEom::historytype & history)
+    {
+        using std::floor;
+        using std::llround;
+
+        KeplerOrbit<Real> const orbit(FreefallSolveEom::G * FreefallSolveEom::M, l2divm2northlatitude45_, FreefallSolveEom::R0 + x_[0], x_[1]);
+        if (!orbit.isValid())
+        {
+            return 0;
+        }
+
+        // 解析解の地球中心からの距離を、高度に直した状態を返す
+        auto const stateat = [&orbit](Real t)
+        {
+            auto x = orbit(t);
+            x[0] -= FreefallSolveEom::R0;
+
+            return x;
+        };
+
+        // グラフプロット用の時間間隔の終わりまで進める
+        auto nstep = imax - i + 1;
+
+        // CSVファイルに出力する時刻があれば、そこまでとする
+        if constexpr (!Summary)
+        {
+            if (tintervaloutputcsv_ && !(*islargertintervaloutputcsv_))
+            {
+                auto const csvstep = std::max(static_cast<std::int32_t>(llround(*tintervaloutputcsv_ / dt_)), 1);
+                nstep = std::min(nstep, (i + csvstep - 1) / csvstep * csvstep - i + 1);
+            }
+        }
+
+        // 大気圏に再突入する場合は、その直前のステップまでとする
+        if (auto const treentry = orbit.timetoradius(FreefallSolveEom::R0 + atmospheretop_, false))
+        {
+            nstep = std::min(nstep, static_cast<std::int32_t>(floor(*treentry / dt_)));
+        }
+
+        if (nstep <= 0)
+        {
+            return 0;
+        }
+
+        auto const tbefore = t_ + static_cast<Real>(i - 1) * dt_;
+        auto const tspan = static_cast<Real>(nstep) * dt_;
+
+        // 外気圏を脱出した際の時間を解析的に求める
+        if (!stateescapeofexosphere_)
+        {
+            if (auto const texosphere = orbit.timetoradius(FreefallSolveEom::R0 + FreefallSolveEom::ALTITUDEOFEXOSPHERE, true); texosphere && *texosphere <= tspan)
+            {
+                auto const xtmp = stateat(*texosphere);
+
+                // 外気圏を脱出した際に速度が第二宇宙速度以上だったかどうか
+                if (xtmp[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE)
+                {
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(tbefore + *texosphere, xtmp[1], true));
+
+                    // 計算打ち切り
+                    iscalculationfinished_ = true;
+                    tend_ = tbefore + *texosphere;
+                    x_ = xtmp;
+
+                    if (!Summary && (denseoutput_ || adaptivesampler_))
+                    {
+                        for (auto k = 1; static_cast<Real>(k) * dt_ < *texosphere; k++) {
+                            pushstep(tbefore + static_cast<Real>(k) * dt_, stateat(static_cast<Real>(k) * dt_));
+                        }
+
+                        pushstep(tend_, x_);
+                    }
+
+                    return nstep;
+                }
+                else
+                {
+                    stateescapeofexosphere_ = std::make_optional(std::make_tuple(tbefore + *texosphere, xtmp[1], false));
+                }
+            }
+        }
+
+        // 最高到達高度とその際の時間を解析的に求める
+        if (auto const tapoapsis = orbit.timetoapoapsis(); tapoapsis && *tapoapsis <= tspan)
+        {
+            hmaxoftandh_ = std::make_optional(std::make_pair(tbefore + *tapoapsis, *orbit.apoapsis() - FreefallSolveEom::R0));
+        }
+
+        // 次のステップで参照する、直前の状態を更新
+        history.pop();
+        history.push(stateat(tspan - dt_));
+
+        // 解析解から、時間刻みごとの補間の節点とグラフに出力する点の候補を記録する
+        if (!Summary && (denseoutput_ || adaptivesampler_))
+        {
+            for (auto k = 1; k < nstep; k++) {
+                pushstep(tbefore + static_cast<Real>(k) * dt_, stateat(static_cast<Real>(k) * dt_));
+            }
+        }
+
+        x_ = stateat(tspan);
+
+        if constexpr (!Summary)
+        {
+            pushstep(tbefore + tspan, x_);
+        }
+
+        return nstep;
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <typename Stepper>
+    std::int32_t FreefallSolveEom<Real, Diagnostics>::solveeom_relaxed(FreefallSolveEom::StepperWorkspace<Stepper> & workspace, std::int32_t i, std::int32_t imax, FreefallSolveEom::historytype & history)
+    {
+        using std::floor;
+
+        // Adams-Bashforth-Moulton法は時間刻みが固定なので、まとめて積分してもステップ数は減らない
+        if (!istoleranceschedule_ || std::is_same_v<Stepper, FreefallSolveEom::abm_stepper_type>)
+        {
+            return 0;
+        }
+
+        // 直前にまとめて進めようとした区間で事象が起きた可能性がある場合は、しばらく時間刻みごとに積分する
+        if (tightsteps_ > 0)
+        {
+            tightsteps_--;
+            return 0;
+        }
+
+        // 最も近い事象までの時間の1/TOLERANCEGUARDSTEPSだけ進める（事象に近づくにつれて、一度に進める時間は等比級数的に短くなる）
+        auto const tau = gettimetoevent();
+        auto const nstep = static_cast<std::int32_t>(std::min(Real(floor(tau / (FreefallSolveEom::TOLERANCEGUARDSTEPS * dt_))), Real(imax - i + 1)));
+        if (nstep < 2)
+        {
+            return 0;
+        }
+
+        // 最も近い事象まで遠いほど、許容誤差を緩めた段階を用いる
+        auto const maxlevel = workspace.prototypes.size() - 1;
+        std::size_t level = 0;
+        for (Real threshold = FreefallSolveEom::TOLERANCEGUARDSTEPS * dt_; level < maxlevel && tau >= threshold; threshold *= FreefallSolveEom::TOLERANCERATIO) {
+            level++;
+        }
+
+        auto const statebefore = x_;
+        integrate_eom(workspace, static_cast<Real>(nstep - 1) * dt_, x_, level);
+        auto const statelast = x_;
+        integrate_eom(workspace, dt_, x_, level);
+
+        // 事象が起きた可能性がある場合は、時間刻みごとに元の許容誤差で積分し直す
+        if (iseventbracketed(statebefore, x_))
+        {
+            x_ = statebefore;
+            tightsteps_ = static_cast<std::int32_t>(FreefallSolveEom::TOLERANCEGUARDSTEPS);
+            return 0;
+        }
+
+        // 次のステップで参照する、直前の状態を更新
+        history.pop();
+        history.push(statelast);
+
+        return nstep;
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <typename Stepper>
+    typename FreefallSolveEom<Real, Diagnostics>::pararealtype FreefallSolveEom<Real, Diagnostics>::parareal_run(Stepper const & stepper, Real tmax, std::size_t nslices, std::uint32_t nthreads) const
+    {
+        using std::ceil;
+        using std::fabs;
+        using std::floor;
+        using std::isfinite;
+
+        using namespace boost::math::tools;
+
+        // 地面に衝突したか、第二宇宙速度で外気圏を脱出したかどうか
+        auto const isfinished = [](FreefallSolveEom::state_type const & x)
+        {
+            return x[0] < 0.0 ||
+                (x[0] >= FreefallSolveEom::ALTITUDEOFEXOSPHERE && x[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE);
+        };
+
+        // 粗い伝播が発散していない（成分が有限で、空気抵抗で散逸するはずのエネルギーが増えていない）かどうか
+        auto const energy0 = specificenergy({ h0_, v0_ });
+        auto const energymax = energy0 + FreefallSolveEom::COARSEENERGYMARGIN * fabs(energy0);
+        auto const isvalid = [energymax, this](FreefallSolveEom::state_type const & x)
+        {
+            return isfinite(x[0]) && isfinite(x[1]) && specificenergy(x) <= energymax;
+        };
+
+        // 粗い伝播（計算が終了した状態はそれ以上進めない）
+        // 修正量G(新しい状態) - G(古い状態)が滑らかになるように、時間刻みは誤差では制御せず、COARSEDTと安定性の上限の小さい方とする
+        // 安定性の上限は、現在の状態と、それをEuler法で進めた状態でのスペクトル半径から求める
+        // （静止から落下し始める場合など、空気抵抗が速度とともに急に強くなる場合も、一ステップ目から安定に進める）
+        auto const propagatecoarse = [&isfinished, this](Real span, FreefallSolveEom::state_type & x)
+        {
+            auto const rhs = [this](FreefallSolveEom::state_type const & x, FreefallSolveEom::state_type & dxdt, Real const)
+            {
+                // dx/dt = v
+                dxdt[0] = x[1];
+
+                // dv/dt = a
+                dxdt[1] = acceleration(x[0], x[1], m_, r_, spherevolume_, l2divm2northlatitude45_);
+            };
+
+            runge_kutta4< FreefallSolveEom::state_type, Real > stepper;
+            for (auto t = Real(0); t < span && !isfinished(x);) {
+                // 時間刻みがdt_を下回るほど硬い場合は、dt_で進める（発散した場合はisvalidで検出して逐次的に積分する）
+                auto h = std::min(Real(FreefallSolveEom::COARSEDT), span - t);
+                if (auto const rho = spectralradius(x); rho * h > FreefallSolveEom::COARSESTABILITY)
+                {
+                    h = std::max(Real(FreefallSolveEom::COARSESTABILITY / rho), std::min(dt_, span - t));
+                }
+
+                FreefallSolveEom::state_type dxdt;
+                rhs(x, dxdt, Real(0));
+                if (auto const rho = spectralradius({ x[0] + h * dxdt[0], x[1] + h * dxdt[1] }); rho * h > FreefallSolveEom::COARSESTABILITY)
+                {
+                    h = std::max(Real(FreefallSolveEom::COARSESTABILITY / rho), std::min(dt_, span - t));
+                }
+
+                stepper.do_step(rhs, x, Real(0), h);
+                t += h;
+            }
+        };
+
+        FreefallSolveEom::pararealtype result{ { { Real(0), h0_, v0_ } }, std::nullopt, 0 };
+        FreefallSolveEom::state_type x = { h0_, v0_ };
+        auto const nmax = static_cast<std::int64_t>(floor(tmax / tintervalgraphplot_));
+        auto const ncoarsespan = std::max(static_cast<std::int64_t>(ceil(FreefallSolveEom::COARSESPAN / tintervalgraphplot_)), std::int64_t(1));
+        std::int64_t n = 0;
+
+        while (n < nmax && !isfinished(x)) {
+            // 計算が終了するまでの残りの時間を粗い伝播で見積もり、それを覆うだけの区間を一度に積分する
+            // （粗い伝播が発散した場合は、そこまでの区間だけを積分する）
+            auto xcoarse = x;
+            auto nwindow = std::int64_t(0);
+            do {
+                nwindow = std::min(nwindow + ncoarsespan, nmax - n);
+                propagatecoarse(static_cast<Real>(ncoarsespan) * tintervalgraphplot_, xcoarse);
+            } while (n + nwindow < nmax && !isfinished(xcoarse) && isvalid(xcoarse));
+
+            // スライスの長さは、tintervalgraphplot秒の整数倍に揃える
+            auto const nperslice = (nwindow + static_cast<std::int64_t>(nslices) - 1) / static_cast<std::int64_t>(nslices);
+            auto const nslicewindow = static_cast<std::size_t>((nwindow + nperslice - 1) / nperslice);
+
+            // 精密な伝播（operator()と同じく時間刻みごとに積分し、tintervalgraphplot秒ごとの状態を記録する）
+            std::vector< std::vector<FreefallSolveEom::state_type> > samples(nslicewindow);
+            auto const propagatefine = [&isfinished, nperslice, &samples, &stepper, this](std::size_t k, FreefallSolveEom::state_type & x)
+            {
+                samples[k].clear();
+                for (std::int64_t j = 0; j < nperslice; j++) {
+                    for (auto i = 0; i < imax_ && !isfinished(x); i++) {
+                        integrate_eom(stepper, dt_, x);
+                    }
+
+                    samples[k].push_back(x);
+                }
+            };
+
+            Parareal<Real> parareal(
+                [&propagatecoarse, nperslice, this](std::size_t, FreefallSolveEom::state_type & x)
+            {
+                propagatecoarse(static_cast<Real>(nperslice) * tintervalgraphplot_, x);
+            },
+                propagatefine,
+                isvalid,
+                eps_,
+                nthreads);
+
+            auto const isdiverged = parareal(x, nslicewindow).empty();
+            result.iterations += parareal.iterations();
+            if (isdiverged)
+            {
+                // 粗い伝播が発散した場合は、この区間を精密な伝播で逐次的に積分し直す
+                auto xserial = x;
+                for (std::size_t k = 0; k < nslicewindow; k++) {
+                    propagatefine(k, xserial);
+                }
+
+                result.iterations++;
+            }
+
+            for (auto const & slice : samples) {
+                for (auto const & sample : slice) {
+                    if (n >= nmax)
+                    {
+                        return result;
+                    }
+
+                    if (sample[0] < 0.0)
+                    {
+                        // 直前の記録から時間刻みごとに積分し直し、地面に衝突した時刻を探索する
+                        auto tbefore = static_cast<Real>(n) * tintervalgraphplot_;
+                        auto statebefore = x;
+                        auto xtmp = x;
+                        while (true) {
+                            integrate_eom(stepper, dt_, xtmp);
+                            if (xtmp[0] < 0.0)
+                            {
+                                break;
+                            }
+
+                            tbefore += dt_;
+                            statebefore = xtmp;
+                        }
+
+                        auto maxit = MAXITER;
+                        auto const res = bisect(
+                            [&stepper, &statebefore, this](Real t)
+                        {
+                            auto x = statebefore;
+                            integrate_eom(stepper, t, x);
+                            return x[0];
+                        },
+                            Real(0),
+                            dt_,
+                            eps_tolerance<Real>(FreefallSolveEom::DIGITS),
+                            maxit);
+
+                        auto const tendtmp = static_cast<Real>((res.first + res.second) * 0.5);
+                        xtmp = statebefore;
+                        integrate_eom(stepper, tendtmp, xtmp);
+
+                        result.trajectory.push_back({ tbefore + tendtmp, xtmp[0], xtmp[1] });
+                        result.impact = std::make_optional(std::make_pair(tbefore + tendtmp, xtmp[1]));
+
+                        return result;
+                    }
+
+                    n++;
+                    x = sample;
+                    result.trajectory.push_back({ static_cast<Real>(n) * tintervalgraphplot_, x[0], x[1] });
+
+                    // 第二宇宙速度で外気圏を脱出した場合は、そこで打ち切る
+                    if (isfinished(x))
+                    {
+                        return result;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <typename Stepper>
+    typename FreefallSolveEom<Real, Diagnostics>::sensitivitytype FreefallSolveEom<Real, Diagnostics>::sensitivity_run(Stepper const & stepper) const
+    {
+        using std::fabs;
+
+        using namespace boost::math::tools;
+
+        // 状態から、m、r、h0、v0についてのhの偏微分を取り出す
+        auto const gradofh = [](FreefallSolveEom::sensitivity_state_type const & x)
+        {
+            return FreefallSolveEom::gradtype{ x[2], x[4], x[6], x[8] };
+        };
+
+        // 状態から、m、r、h0、v0についてのvの偏微分を取り出す
+        auto const gradofv = [](FreefallSolveEom::sensitivity_state_type const & x)
+        {
+            return FreefallSolveEom::gradtype{ x[3], x[5], x[7], x[9] };
+        };
+
+        // 高度が閾値を横切る時刻の偏微分（dt/dp = -(∂h/∂p) / v）
+        auto const gradoftofcrossing = [&gradofh](FreefallSolveEom::sensitivity_state_type const & x)
+        {
+            auto res = gradofh(x);
+            for (auto & g : res) {
+                g = -g / x[1];
+            }
+
+            return res;
+        };
+
+        // 時刻が変化する事象における速度の偏微分（dv/dp = ∂v/∂p + a dt/dp）
+        auto const gradofvattime = [&gradofv, this](FreefallSolveEom::sensitivity_state_type const & x, FreefallSolveEom::gradtype const & gradoft)
+        {
+            auto const a = accelerationwithjacobian(x).value();
+            auto res = gradofv(x);
+            for (auto k = 0U; k < res.size(); k++) {
+                res[k] += a * gradoft[k];
+            }
+
+            return res;
+        };
+
+        // 区間[0, span]の中で、funcが0になる時刻と、その時刻の状態を求める
+        auto const findroot = [&stepper, this](FreefallSolveEom::sensitivity_state_type const & statebefore, Real span, auto const & func)
+        {
+            auto maxit = MAXITER;
+            auto const res = bisect(
+                [&stepper, &statebefore, &func, this](Real t)
+            {
+                auto x = statebefore;
+                integrate_sensitivity(stepper, t, x);
+                return func(x);
+            },
+                Real(0),
+                span,
+                eps_tolerance<Real>(FreefallSolveEom::DIGITS),
+                maxit);
+
+            auto const troot = (res.first + res.second) * 0.5;
+            auto xtmp(statebefore);
+            integrate_sensitivity(stepper, troot, xtmp);
+
+            return std::make_pair(troot, xtmp);
+        };
+
+        FreefallSolveEom::sensitivitytype result;
+        FreefallSolveEom::gradtype const zerograd{};
+        FreefallSolveEom::gradtype const gradofv0{ 0.0, 0.0, 0.0, 1.0 };
+
+        // 計算終了時の状態から、最高速度が見つかっていない場合の最高速度を決める
+        auto const finish = [&result, &zerograd, &gradofv0, this](Real tend, FreefallSolveEom::gradtype const & gradoftend, Real vend, FreefallSolveEom::gradtype const & gradofvend)
+        {
+            if (result.vmax && fabs(result.vmax->first) >= fabs(v0_))
+            {
+                return;
+            }
+            else if (result.vmax || fabs(vend) < fabs(v0_))
+            {
+                result.tvmax = std::make_optional(std::make_pair(Real(0), zerograd));
+                result.vmax = std::make_optional(std::make_pair(v0_, gradofv0));
+            }
+            else
+            {
+                result.tvmax = std::make_optional(std::make_pair(tend, gradoftend));
+                result.vmax = std::make_optional(std::make_pair(vend, gradofvend));
+            }
+        };
+
+        // 初期状態（∂h/∂h0 = 1、∂v/∂v0 = 1）
+        FreefallSolveEom::sensitivity_state_type x = { h0_, v0_, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.0 };
+
+        if (v0_ <= 0.0)
+        {
+            result.thmax = std::make_optional(std::make_pair(Real(0), zerograd));
+            result.hmax = std::make_optional(std::make_pair(h0_, FreefallSolveEom::gradtype{ 0.0, 0.0, 1.0, 0.0 }));
+        }
+
+        // 0秒目ですでにカーマン・ラインを突破しているかどうか
+        if (x[0] >= FreefallSolveEom::KARMANLINE)
+        {
+            result.tkarmanline = std::make_optional(std::make_pair(Real(0), zerograd));
+            result.vkarmanline = std::make_optional(std::make_pair(v0_, gradofv0));
+        }
+
+        // 0秒目ですでに外気圏を脱出しているかどうか
+        if (x[0] >= FreefallSolveEom::ALTITUDEOFEXOSPHERE)
+        {
+            result.texosphere = std::make_optional(std::make_pair(Real(0), zerograd));
+            result.vexosphere = std::make_optional(std::make_pair(v0_, gradofv0));
+
+            // 外気圏を脱出した際に速度が第二宇宙速度以上だったら計算打ち切り
+            if (x[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE)
+            {
+                finish(Real(0), zerograd, v0_, gradofv0);
+                return result;
+            }
+        }
+
+        // 抗力係数の式が切り替わるレイノルズ数（accelerationの場合分けと同じ値）
+        static std::array<double, 4> constexpr REBOUNDARIES = { FreefallSolveEom::ZERODECISION, FreefallSolveEom::RETHRESHOLD, 2.0E+5, 1.0E+6 };
+
+        // 状態から、抗力の式の場合分けの番号を求める
+        // （跳びを求めるaccelerationwithjacobianと同じ二重数の演算でレイノルズ数を求め、境界の近くでも判定を一致させる）
+        auto const dragregime = [this](FreefallSolveEom::sensitivity_state_type const & x)
+        {
+            auto const Re = reynoldswithjacobian(x).value();
+            return std::count_if(REBOUNDARIES.begin(), REBOUNDARIES.end(), [Re](double b) { return Re >= b; });
+        };
+
+        // 区間[0, span]の中の事象を探索する（計算が打ち切られた場合はtrueを返す）
+        auto const findevents = [&](FreefallSolveEom::sensitivity_state_type const & statebefore, FreefallSolveEom::sensitivity_state_type const & x, Real span, Real tbefore)
+        {
+            // カーマン・ラインを突破した際の時間を探索
+            if (!result.tkarmanline && x[0] >= FreefallSolveEom::KARMANLINE)
+            {
+                auto const [troot, xtmp] = findroot(statebefore, span, [](FreefallSolveEom::sensitivity_state_type const & x) { return x[0] - FreefallSolveEom::KARMANLINE; });
+                auto const gradoft = gradoftofcrossing(xtmp);
+
+                result.tkarmanline = std::make_optional(std::make_pair(tbefore + troot, gradoft));
+                result.vkarmanline = std::make_optional(std::make_pair(xtmp[1], gradofvattime(xtmp, gradoft)));
+            }
+
+            // 外気圏を脱出した際の時間を探索
+            if (!result.texosphere && x[0] >= FreefallSolveEom::ALTITUDEOFEXOSPHERE)
+            {
+                auto const [troot, xtmp] = findroot(statebefore, span, [](FreefallSolveEom::sensitivity_state_type const & x) { return x[0] - FreefallSolveEom::ALTITUDEOFEXOSPHERE; });
+                auto const gradoft = gradoftofcrossing(xtmp);
+                auto const gradofvtmp = gradofvattime(xtmp, gradoft);
+
+                result.texosphere = std::make_optional(std::make_pair(tbefore + troot, gradoft));
+                result.vexosphere = std::make_optional(std::make_pair(xtmp[1], gradofvtmp));
+
+                // 外気圏を脱出した際に速度が第二宇宙速度以上だったら計算打ち切り
+                if (xtmp[1] >= FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE)
+                {
+                    finish(tbefore + troot, gradoft, xtmp[1], gradofvtmp);
+                    return true;
+                }
+            }
+
+            // 地面に衝突する時の速度とその際の時間を探索
+            if (x[0] < 0.0)
+            {
+                auto const [troot, xtmp] = findroot(statebefore, span, [](FreefallSolveEom::sensitivity_state_type const & x) { return x[0]; });
+                auto const gradoft = gradoftofcrossing(xtmp);
+                auto const gradofvtmp = gradofvattime(xtmp, gradoft);
+
+                result.timpact = std::make_optional(std::make_pair(tbefore + troot, gradoft));
+                result.vimpact = std::make_optional(std::make_pair(xtmp[1], gradofvtmp));
+
+                finish(tbefore + troot, gradoft, xtmp[1], gradofvtmp);
+                return true;
+            }
+
+            // 最高到達高度とその際の時間の探索
+            if (statebefore[1] * x[1] <= 0.0)
+            {
+                auto const [troot, xtmp] = findroot(statebefore, span, [](FreefallSolveEom::sensitivity_state_type const & x) { return x[1]; });
+
+                // v = 0となる時刻の偏微分（dt/dp = -(∂v/∂p) / a）、その時刻ではdh/dp = ∂h/∂p
+                auto const a = accelerationwithjacobian(xtmp).value();
+                auto gradoft = gradofv(xtmp);
+                for (auto & g : gradoft) {
+                    g = -g / a;
+                }
+
+                result.thmax = std::make_optional(std::make_pair(tbefore + troot, gradoft));
+                result.hmax = std::make_optional(std::make_pair(xtmp[0], gradofh(xtmp)));
+            }
+
+            return false;
+        };
+
+        auto statebefore = x;
+        for (auto i = 1; ; i++) {
+            auto const state2before = statebefore;
+            statebefore = x;
+
+            // 抗力係数の式が切り替わる時刻でステップを分割し、変分方程式の解に跳びを加える
+            auto segstart = statebefore;
+            auto tbefore = static_cast<Real>(i - 1) * dt_;
+            auto span = dt_;
+            while (true) {
+                x = segstart;
+                integrate_sensitivity(stepper, span, x);
+
+                auto const regimebefore = dragregime(segstart);
+                auto const regimeafter = dragregime(x);
+                if (regimebefore == regimeafter)
+                {
+                    break;
+                }
+
+                // 最初に横切る境界のレイノルズ数
+                auto const Rec = regimeafter > regimebefore ? REBOUNDARIES[regimebefore] : REBOUNDARIES[regimebefore - 1];
+
+                // dragregimeと同じレイノルズ数でRe >= Recを境界の上側とし、0を返さない関数で二分法を行う
+                // （境界上の点で0を返すと、区間の幅が0のまま進まなくなることがある）
+                auto maxit = MAXITER;
+                auto const res = bisect(
+                    [&stepper, &segstart, Rec, this](Real t)
+                {
+                    auto x = segstart;
+                    integrate_sensitivity(stepper, t, x);
+                    return reynoldswithjacobian(x).value() >= Rec ? Real(1) : Real(-1);
+                },
+                    Real(0),
+                    span,
+                    eps_tolerance<Real>(FreefallSolveEom::DIGITS),
+                    maxit);
+
+                auto xminus(segstart);
+                integrate_sensitivity(stepper, res.first, xminus);
+                auto xplus(segstart);
+                integrate_sensitivity(stepper, res.second, xplus);
+
+                // 切り替わる前の区間の事象を探索
+                if (findevents(segstart, xminus, res.first, tbefore))
+                {
+                    return result;
+                }
+
+                // 切り替わる時刻の偏微分（dts/dp = -(dRe/dp) / (dRe/dt)）
+                auto const aminus = accelerationwithjacobian(xminus).value();
+                auto const aplus = accelerationwithjacobian(xplus).value();
+                auto const Re = reynoldswithjacobian(xminus);
+                auto const dRedt = Re.grad(0) * xminus[1] + Re.grad(1) * aminus;
+                for (auto k = 0; k < 4; k++) {
+                    auto const dRedp = Re.grad(0) * xminus[2 + 2 * k] + Re.grad(1) * xminus[3 + 2 * k] + (k == 1 ? Re.grad(3) : 0.0);
+
+                    // ∂v/∂pの跳び（Δ(∂v/∂p) = (a⁻ - a⁺) dts/dp）
+                    xplus[3 + 2 * k] += (aminus - aplus) * (-dRedp / dRedt);
+                }
+
+                segstart = xplus;
+                tbefore += res.second;
+                span -= res.second;
+            }
+
+            if (findevents(segstart, x, span, tbefore))
+            {
+                return result;
+            }
+
+            // 最高速度とその際の時間の探索
+            if (!result.vmax && x[1] < 0.0 && x[1] > statebefore[1])
+            {
+                auto maxit = MAXITER;
+                auto const res = brent_find_minima(
+                    [&stepper, &state2before, this](Real t)
+                {
+                    auto x = state2before;
+                    integrate_sensitivity(stepper, t, x);
+                    return x[1];
+                },
+                    Real(0),
+                    2 * dt_,
+                    FreefallSolveEom::DIGITS,
+                    maxit);
+
+                auto xtmp(state2before);
+                integrate_sensitivity(stepper, res.first, xtmp);
+
+                // a = 0となる時刻の偏微分（dt/dp = -(da/dp) / (da/dt)）
+                auto const a = accelerationwithjacobian(xtmp);
+                auto const dadt = a.grad(0) * xtmp[1] + a.grad(1) * a.value();
+                FreefallSolveEom::gradtype gradoft;
+                for (auto k = 0; k < 4; k++) {
+                    auto const dadp = a.grad(0) * xtmp[2 + 2 * k] + a.grad(1) * xtmp[3 + 2 * k] + (k < 3 ? a.grad(2 + k) : 0.0);
+                    gradoft[k] = -dadp / dadt;
+                }
+
+                result.tvmax = std::make_optional(std::make_pair(static_cast<Real>(i - 2) * dt_ + res.first, gradoft));
+                result.vmax = std::make_optional(std::make_pair(xtmp[1], gradofvattime(xtmp, gradoft)));
+            }
+        }
+    }
+
     // #endregion privateメンバ関数
 
-    // #region templateメンバ関数の実体化
+    // #region templateクラスの実体化
 
-    template FreefallSolveEom::state_type FreefallSolveEom::solveeom_run<adams_bashforth_moulton< 2, FreefallSolveEom::state_type > >(adams_bashforth_moulton< 2, state_type > const & stepper);
-    template FreefallSolveEom::state_type FreefallSolveEom::solveeom_run<bulirsch_stoer < FreefallSolveEom::state_type > >(bulirsch_stoer < state_type > const & stepper);
-    template FreefallSolveEom::state_type FreefallSolveEom::solveeom_run<FreefallSolveEom::error_stepper_type>(error_stepper_type const & stepper);
+    template class FreefallSolveEom<float>;
+    template class FreefallSolveEom<double>;
+    template class FreefallSolveEom<referencetype>;
+    template class FreefallSolveEom<double, true>;
 
-    // #endregion templateメンバ関数の実体化
+    // #endregion templateクラスの実体化
 
     // #region staticメンバ変数
 
-    const double FreefallSolveEom::SECONDESCAPEVELOCITYOFEXOSPHERE = std::sqrt(2.0 * FreefallSolveEom::G * FreefallSolveEom::M / FreefallSolveEom::ALTITUDEOFEXOSPHERE);
+    template <typename Real, bool Diagnostics>
+    const double FreefallSolveEom<Real, Diagnostics>::SECONDESCAPEVELOCITYOFEXOSPHERE = std::sqrt(2.0 * FreefallSolveEom::G * FreefallSolveEom::M / (FreefallSolveEom::R0 + FreefallSolveEom::ALTITUDEOFEXOSPHERE));
 
     // #endregion staticメンバ変数
 }
@@ -10,15 +10,29 @@
 
 #pragma once
 
-#include "utility/deleter.h"
+#include "adaptivesampler.h"
+#include "atmosphere.h"
+#include "bulirschstoer.h"
+#include "denseoutput.h"
+#include "parareal.h"
+#include "rosenbrock4.h"
+#include "samplerange.h"
+#include "trajectorywriter.h"
+#include "utility/dual.h"
+#include "utility/referencetype.h"
+#include "utility/ringbuffer.h"
+#include <algorithm>                    // for std::max, std::min
 #include <array>                        // for std::array
-#include <cstdint>                      // for std::int32_t
-#include <cstdio>                       // for std::fclose
+#include <cmath>                        // for std::ceil, std::fabs, std::floor
+#include <cstddef>                      // for std::size_t
+#include <cstdint>                      // for std::int32_t, std::uint32_t
 #include <functional>                   // for std::function
-#include <memory>                       // for std::unique_ptr
+#include <memory>                       // for std::shared_ptr, std::unique_ptr
 #include <optional>                     // for std::optional
 #include <tuple>                        // for std::tuple
 #include <utility>                      // for std::pair
+#include <vector>                       // for std::vector
+#include <boost/assert.hpp>             // for BOOST_ASSERT
 #include <boost/cstdint.hpp>            // for boost::uintmax_t
 #include <boost/numeric/odeint.hpp>     // for boost::numeric::odeint
 
@@ -26,10 +40,13 @@ namespace freefallsolveeom {
     using namespace boost::math::constants;
     using namespace boost::numeric::odeint;
 
-    //! A class.
+    //! A template class.
     /*!
         空気抵抗のある自由落下系に対して運動方程式を解くクラスの宣言
+        \tparam Real 浮動小数点数の型（float、double、または参照解用のreferencetype）
+        \tparam Diagnostics ファイルに出力する各行に、診断用の物理量の列を追加するかどうか（falseの場合、積分の内側のループには一切影響しない）
     */
+    template <typename Real = double, bool Diagnostics = false>
     class FreefallSolveEom final {
     public:
         // #region 列挙型
@@ -44,50 +61,424 @@ namespace freefallsolveeom {
             // Bulirsch-Stoer法
             BULIRSCH_STOER,
             // コントロールされたRunge-Kutta法
-            CONTROLLED_RUNGE_KUTTA
+            CONTROLLED_RUNGE_KUTTA,
+            // Rosenbrock法（硬い方程式向け）
+            ROSENBROCK,
+            // 硬さに応じてRosenbrock法とコントロールされたRunge-Kutta法を自動で切り替える
+            AUTO
+        };
+
+        //!  A enumerated type
+        /*!
+            samples()の走査中に通知する事象の種類を表す列挙型（同じ点で確定した事象は、この順に通知する）
+        */
+        enum class Event : std::int32_t {
+            // カーマン・ラインを突破した
+            KARMANLINE,
+            // 外気圏を脱出した
+            EXOSPHERE,
+            // 最高到達高度に達した
+            HMAX,
+            // 最高速度に達した
+            VMAX,
+            // 地面に衝突した（第二宇宙速度で外気圏を脱出した場合は通知しない）
+            IMPACT
         };
 
         // #endregion 列挙型
 
         // #region 型エイリアス
 
+        //! A typedef.
+        /*!
+            球の質量m、球の半径r、初期高度h0、初期速度v0についての偏微分が格納されたstd::arrayの型
+        */
+        using gradtype = std::array<Real, 4>;
+
         //! A typedef.
         /*!
             最高到達高度の際の時間と高度のstd::pairのstd::optionalの型
         */
-        using hmaxtype = std::optional< std::pair<double, double> >;
+        using hmaxtype = std::optional< std::pair<Real, Real> >;
 
         //! A typedef.
         /*!
             カーマン・ラインを突破した際の時間と速度のstd::pairのstd::optionalの型
         */
-        using tandvtype = std::optional< std::pair<double, double> >;
+        using tandvtype = std::optional< std::pair<Real, Real> >;
 
         //! A typedef.
         /*!
             外気圏を脱出した際の時間と速度とその時に第二宇宙速度を超えていたかどうかのstd::tupleのstd::optionalの型
         */
-        using tandvandbooltype = std::optional< std::tuple<double, double, bool> >;
+        using tandvandbooltype = std::optional< std::tuple<Real, Real, bool> >;
 
         //! A typedef.
         /*!
             最高速度の際の時間と速度と高度のstd::tupleのstd::optionalの型
         */
-        using vmaxtype = std::optional< std::tuple<double, double, double> >;
+        using vmaxtype = std::optional< std::tuple<Real, Real, Real> >;
+
+        //! A typedef.
+        /*!
+            値と、そのm、r、h0、v0についての偏微分のstd::pairのstd::optionalの型
+        */
+        using valueandgradtype = std::optional< std::pair<Real, FreefallSolveEom::gradtype> >;
+
+        //! A typedef.
+        /*!
+            samples()が返す、時間（秒）、高度（m）、速度（m/s）のstd::arrayの型
+        */
+        using sampletype = typename SampleRange<Real>::sampletype;
+
+        //! A typedef.
+        /*!
+            事象の種類と、その際の時間（秒）、高度（m）、速度（m/s）を受け取る関数の型
+        */
+        using eventhandlertype = std::function<void(FreefallSolveEom::Event, Real, Real, Real)>;
+
+        //! A struct.
+        /*!
+            各事象の値と、その球の質量m、球の半径r、初期高度h0、初期速度v0についての感度が格納された構造体
+        */
+        struct sensitivitytype {
+            //! A public member variable.
+            /*!
+                地面に衝突した際の時間（秒）とその感度
+            */
+            FreefallSolveEom::valueandgradtype timpact;
+
+            //! A public member variable.
+            /*!
+                地面に衝突した際の速度（m/s）とその感度
+            */
+            FreefallSolveEom::valueandgradtype vimpact;
+
+            //! A public member variable.
+            /*!
+                最高到達高度の際の時間（秒）とその感度
+            */
+            FreefallSolveEom::valueandgradtype thmax;
+
+            //! A public member variable.
+            /*!
+                最高到達高度（m）とその感度
+            */
+            FreefallSolveEom::valueandgradtype hmax;
+
+            //! A public member variable.
+            /*!
+                最高速度の際の時間（秒）とその感度
+            */
+            FreefallSolveEom::valueandgradtype tvmax;
+
+            //! A public member variable.
+            /*!
+                最高速度（m/s）とその感度
+            */
+            FreefallSolveEom::valueandgradtype vmax;
+
+            //! A public member variable.
+            /*!
+                カーマン・ラインを突破した際の時間（秒）とその感度
+            */
+            FreefallSolveEom::valueandgradtype tkarmanline;
+
+            //! A public member variable.
+            /*!
+                カーマン・ラインを突破した際の速度（m/s）とその感度
+            */
+            FreefallSolveEom::valueandgradtype vkarmanline;
+
+            //! A public member variable.
+            /*!
+                外気圏を脱出した際の時間（秒）とその感度
+            */
+            FreefallSolveEom::valueandgradtype texosphere;
+
+            //! A public member variable.
+            /*!
+                外気圏を脱出した際の速度（m/s）とその感度
+            */
+            FreefallSolveEom::valueandgradtype vexosphere;
+        };
+
+        //! A struct.
+        /*!
+            計算が終了した際の各事象の値が格納された構造体
+        */
+        struct summarytype {
+            //! A public member variable.
+            /*!
+                地面に衝突した際の時間（秒）と速度（m/s）（第二宇宙速度で外気圏を脱出した場合はstd::nullopt）
+            */
+            FreefallSolveEom::tandvtype impact;
+
+            //! A public member variable.
+            /*!
+                最高到達高度の際の時間（秒）と最高到達高度（m）
+            */
+            FreefallSolveEom::hmaxtype hmax;
+
+            //! A public member variable.
+            /*!
+                最高速度の際の時間（秒）と高度（m）と最高速度（m/s）
+            */
+            FreefallSolveEom::vmaxtype vmax;
+
+            //! A public member variable.
+            /*!
+                カーマン・ラインを突破した際の時間（秒）と速度（m/s）
+            */
+            FreefallSolveEom::tandvtype karmanline;
+
+            //! A public member variable.
+            /*!
+                外気圏を脱出した際の時間（秒）と速度（m/s）とその時に第二宇宙速度以上だったかどうか
+            */
+            FreefallSolveEom::tandvandbooltype exosphere;
+        };
+
+        //! A struct.
+        /*!
+            parareal()で求めた軌道と、地面に衝突した際の状態が格納された構造体
+        */
+        struct pararealtype {
+            //! A public member variable.
+            /*!
+                tintervalgraphplot秒ごとの時間（秒）、高度（m）、速度（m/s）（最初の要素は初期状態、最後の要素は計算が終了した際の状態）
+            */
+            std::vector< std::array<Real, 3> > trajectory;
+
+            //! A public member variable.
+            /*!
+                地面に衝突した際の時間（秒）と速度（m/s）（tmax秒までに衝突しなかった場合はstd::nullopt）
+            */
+            FreefallSolveEom::tandvtype impact;
+
+            //! A public member variable.
+            /*!
+                精密な伝播を全てのスライスで並列に行った回数の合計
+            */
+            std::int32_t iterations;
+        };
+
+        //! A struct.
+        /*!
+            preview()で求めた軌道の概形と、各事象の概算値が格納された構造体
+        */
+        struct previewtype {
+            //! A public member variable.
+            /*!
+                時間（秒）、高度（m）、速度（m/s）（最初の要素は初期状態、最後の要素は計算が終了した際の状態）
+            */
+            std::vector< std::array<Real, 3> > trajectory;
+
+            //! A public member variable.
+            /*!
+                各事象の概算値
+            */
+            FreefallSolveEom::summarytype events;
+        };
+
+        //! A struct.
+        /*!
+            ファイルに出力する時刻における、加速度の計算の途中で現れる物理量が格納された構造体
+            ファイルには、この構造体のメンバの順に時間、高度、速度の後の列として出力される
+        */
+        struct diagnosticstype {
+            //! A public member variable.
+            /*!
+                空気の密度（kg/m³）
+            */
+            Real rho;
+
+            //! A public member variable.
+            /*!
+                空気の粘性係数（Pa·s）
+            */
+            Real myu;
+
+            //! A public member variable.
+            /*!
+                レイノルズ数
+            */
+            Real Re;
+
+            //! A public member variable.
+            /*!
+                抵抗係数（慣性抵抗が働かない場合は0）
+            */
+            Real CD;
+
+            //! A public member variable.
+            /*!
+                球に働く浮力の項（m/s²）
+            */
+            Real buoyancy;
+
+            //! A public member variable.
+            /*!
+                粘性抵抗（N）（粘性抵抗が働かない場合は0）
+            */
+            Real F;
+
+            //! A public member variable.
+            /*!
+                慣性抵抗÷m（m/s²）（慣性抵抗が働かない場合は0）
+            */
+            Real f2;
+        };
 
     private:
         //! A typedef.
         /*!
-            2階常微分方程式の状態の型
+            加速度のヤコビアンを求めるための二重数の型（h、v、m、球の半径、h0についての偏微分を持つ）
         */
-        using state_type = std::array<double, 2>;
+        using dualtype = Dual<Real, 5>;
+
+        //! A typedef.
+        /*!
+            2階常微分方程式の状態の型（高度と速度）
+            float型でも時間刻みごとの小さな変位が丸めで失われないように、地球中心からの距離ではなく高度を持つ
+        */
+        using state_type = std::array<Real, 2>;
+
+        //! A typedef.
+        /*!
+            変分方程式を含めた常微分方程式の状態の型（h、v、およびm、球の半径、h0、v0それぞれについてのh、vの偏微分）
+        */
+        using sensitivity_state_type = std::array<Real, 10>;
 
         //! A typedef.
         /*!
             Runge-Kutta法の誤差のコントロールの型
         */
-        using error_stepper_type = runge_kutta_dopri5< state_type >;
-        
+        using error_stepper_type = runge_kutta_dopri5< state_type, Real >;
+
+        //! A typedef.
+        /*!
+            変分方程式を含めた場合のRunge-Kutta法の誤差のコントロールの型
+        */
+        using sensitivity_error_stepper_type = runge_kutta_dopri5< sensitivity_state_type, Real >;
+
+        //! A typedef.
+        /*!
+            Rosenbrock法の誤差のコントロールの型
+        */
+        using stiff_stepper_type = rosenbrock4_controller< Rosenbrock4<Real> >;
+
+        //! A typedef.
+        /*!
+            Adams Bashforth Moulton法のステッパーの型
+        */
+        using abm_stepper_type = adams_bashforth_moulton< 2, state_type, Real >;
+
+        //! A typedef.
+        /*!
+            Bulirsch-Stoer法のステッパーの型
+        */
+        using bs_stepper_type = BulirschStoer< state_type, Real >;
+
+        //! A typedef.
+        /*!
+            コントロールされたRunge-Kutta法のステッパーの型
+        */
+        using controlled_stepper_type = typename result_of::make_controlled<error_stepper_type>::type;
+
+        //! A typedef.
+        /*!
+            直近の二つの状態を保持するリングバッファの型
+        */
+        using historytype = RingBuffer<state_type, 2>;
+
+        //! A class.
+        /*!
+            作業領域で用いるRosenbrock法のステッパーのクラス
+            rosenbrock4はRosenbrock法の係数をconstなメンバ変数として持つため代入できない
+            ステップ間で引き継がれる状態はステップ幅の制御の状態だけであり、内部のバッファは毎ステップ上書きされるので、
+            代入では制御の状態だけをコピーする（バッファを確保し直さない）
+        */
+        class StiffStepper final : public FreefallSolveEom::stiff_stepper_type {
+        public:
+            //! A constructor.
+            /*!
+                Rosenbrock法のステッパーから構築するコンストラクタ
+                \param stepper Rosenbrock法のステッパー
+            */
+            explicit StiffStepper(FreefallSolveEom::stiff_stepper_type const & stepper) : FreefallSolveEom::stiff_stepper_type(stepper)
+            {
+            }
+
+            //! A copy constructor.
+            /*!
+                デフォルトコピーコンストラクタ
+            */
+            StiffStepper(StiffStepper const &) = default;
+
+            //! A public member function.
+            /*!
+                ステップ幅の制御の状態をコピーする代入演算子
+                \param rhs コピー元のオブジェクト
+                \return コピー先のオブジェクト
+            */
+            StiffStepper & operator=(StiffStepper const & rhs)
+            {
+                this->m_atol = rhs.m_atol;
+                this->m_rtol = rhs.m_rtol;
+                this->m_max_dt = rhs.m_max_dt;
+                this->m_first_step = rhs.m_first_step;
+                this->m_err_old = rhs.m_err_old;
+                this->m_dt_old = rhs.m_dt_old;
+                this->m_last_rejected = rhs.m_last_rejected;
+
+                return *this;
+            }
+        };
+
+        template <typename Stepper>
+        //! A template struct.
+        /*!
+            ステッパーの作業領域を表す構造体
+            作業用のステッパーに初期状態のステッパーを代入し直すことで、毎回新しいステッパーを構築するのと同じ結果を、
+            内部のバッファを確保し直さずに得る（同じ大きさのバッファ同士の代入はヒープの確保を行わない）
+            \tparam Stepper ステッパーの型
+        */
+        struct StepperWorkspace {
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ
+                \param stepper 最も厳しい許容誤差の、初期状態のステッパー（内部のバッファは確保済みでなければならない）
+            */
+            explicit StepperWorkspace(Stepper const & stepper) : prototypes({ stepper }), work(stepper)
+            {
+            }
+
+            //! A public member function.
+            /*!
+                作業用のステッパーを、指定された許容誤差の段階の初期状態に戻して返す
+                \param level 許容誤差の段階（用意された段階より大きい場合は、最も緩い段階とする）
+                \return 作業用のステッパー
+            */
+            Stepper & renew(std::size_t level)
+            {
+                work = prototypes[std::min(level, prototypes.size() - 1)];
+                return work;
+            }
+
+            //! A public member variable.
+            /*!
+                許容誤差の段階ごとの、初期状態のステッパー（0番目が最も厳しく、enabletoleranceschedule()で緩い段階を追加する）
+            */
+            std::vector<Stepper> prototypes;
+
+            //! A public member variable.
+            /*!
+                作業用のステッパー
+            */
+            Stepper work;
+        };
+
         // #endregion 型エイリアス
 
         // #region コンストラクタ・デストラクタ
@@ -104,24 +495,28 @@ namespace freefallsolveeom {
             \param h0 初期高度（m）
             \param v0 初期速度（m/s）
             \param ode_solver_type 常微分方程式の数値解法
+            \param atmosphere 高度80km以上の大気モデル
         */
-        FreefallSolveEom(double dt, double tintervalgraphplot, double eps, double m, double r, double h0, double v0, FreefallSolveEom::Ode_Solver_type ode_solver_type);
+        FreefallSolveEom(Real dt, Real tintervalgraphplot, Real eps, Real m, Real r, Real h0, Real v0, FreefallSolveEom::Ode_Solver_type ode_solver_type, std::shared_ptr<Atmosphere const> atmosphere = Atmosphere::getDefault());
 
         //! A constructor.
         /*!
-            CSVファイルに計算結果を出力する場合のコンストラクタ
+            ファイルに計算結果を出力する場合のコンストラクタ
             \param dt 常微分方程式の数値解法の時間刻み（秒）
             \param tintervalgraphplot グラフプロット用の時間間隔（秒）
-            \param tintervaloutputcsv CSVファイル出力用の時間間隔（秒）
-            \param csvfilename 出力するCSVファイルのファイル名
+            \param tintervaloutputcsv ファイル出力用の時間間隔（秒）
+            \param csvfilename 出力するファイルのファイル名
+            \param format 出力する形式
+            \param compression 圧縮の方法
             \param eps 常微分方程式の数値解法の許容誤差
             \param m 球の質量（kg）
             \param r 球の半径（m）
             \param h0 初期高度（m）
             \param v0 初期速度（m/s）
             \param ode_solver_type 常微分方程式の数値解法
+            \param atmosphere 高度80km以上の大気モデル
         */
-        FreefallSolveEom(double dt, double tintervalgraphplot, double tintervaloutputcsv, std::string const & csvfilename, double eps, double m, double r, double h0, double v0, FreefallSolveEom::Ode_Solver_type ode_solver_type);
+        FreefallSolveEom(Real dt, Real tintervalgraphplot, Real tintervaloutputcsv, std::string const & csvfilename, TrajectoryWriter::Format format, TrajectoryWriter::Compression compression, Real eps, Real m, Real r, Real h0, Real v0, FreefallSolveEom::Ode_Solver_type ode_solver_type, std::shared_ptr<Atmosphere const> atmosphere = Atmosphere::getDefault());
 
         //! A destructor.
         /*!
@@ -133,6 +528,60 @@ namespace freefallsolveeom {
 
         // #region publicメンバ関数
 
+        //! A public member function (const).
+        /*!
+            記録した軌道の補間を返す（enabledenseoutput()を呼び出していない場合はstd::nullopt）
+            計算の後に、任意の時刻の高度と速度を積分し直さずにO(log n)で求められる
+            \return 記録した軌道の補間
+        */
+        std::optional< DenseOutput<Real> > const & denseoutput() const
+        {
+            return denseoutput_;
+        }
+
+        //! A public member function.
+        /*!
+            以降のoperator()が、時間刻みごとの状態を候補として、グラフを折れ線で描いた際の誤差が
+            許容誤差を超える点だけを返すようにする（最初のoperator()の呼び出しより前に呼び出す）
+            終端速度に近い区間のように直線に近い部分では点を間引き、最高到達高度の付近や大気が濃くなる部分では
+            tintervalgraphplot秒より細かく、時間刻みの間隔まで点を返す
+            enabletoleranceschedule()で複数のステップを一度に積分する区間では、その区間の終わりの状態だけを候補とする
+            （区間はtintervalgraphplot秒を超えず、最高到達高度や最高速度などの事象の近くでは時間刻みごとの積分に戻る）
+            \param reltol 高度と速度の、それまでの最大の絶対値に対する許容誤差
+            \param maxgap 返す点の時刻の最大の間隔（秒）
+        */
+        void enableadaptivesampling(Real reltol, Real maxgap)
+        {
+            BOOST_ASSERT(isfirststep_);
+
+            // 一度のtintervalgraphplot秒の積分で与える候補はimax_個以下なので、溜まる点は最後のflush()を含めてもこれを超えない
+            adaptivesampler_.emplace(reltol, maxgap, static_cast<std::size_t>(std::max(imax_, 1)) + 1);
+        }
+
+        //! A public member function.
+        /*!
+            以降の計算で、時間刻みごとの状態を補間の節点として記録するようにする（最初のoperator()の呼び出しより前に呼び出す）
+        */
+        void enabledenseoutput()
+        {
+            BOOST_ASSERT(isfirststep_);
+
+            denseoutput_.emplace();
+        }
+
+        //! A public member function.
+        /*!
+            以降の計算で、どの事象（カーマン・ライン、外気圏、最高到達高度、最高速度、地面）からも遠い区間では
+            複数のステップを一度に積分し、遠さに応じて許容誤差をepsmaxまで緩めるようにする（最初のoperator()の呼び出しより前に呼び出す）
+            事象に近づくにつれて一度に進める時間と許容誤差は元に戻り、事象の近くのステップと事象の時刻の探索は常に元の許容誤差で行う
+            時間刻みごとの状態が必要なCSVファイルへの出力と補間の節点の記録を行う場合は、summary()でのみ有効となる
+            （Adams-Bashforth-Moulton法では何もしない）
+            事象の時刻のずれに保証された上界はない（epsmaxが元の許容誤差と等しくても、ステップの区切りが変わるので時刻は一致しない）
+            ずれの大きさは、freefalltestのtesttoleranceschedule()で代表的な条件について経験的に確かめているだけである
+            \param epsmax 最も緩い許容誤差（元の許容誤差と等しい場合は、許容誤差を緩めずに複数のステップを一度に積分する）
+        */
+        void enabletoleranceschedule(Real epsmax);
+
         //! A public member function (const).
         /*!
             計算が終了したかどうかを返す
@@ -140,46 +589,215 @@ namespace freefallsolveeom {
         */
         bool isCalculationFinished() const
         {
-            return iscalculationfinished_;
+            // 点を間引く場合は、計算が終了した後も、まだ返していない点が残っていれば終了していないとみなす
+            return iscalculationfinished_ && (!adaptivesampler_ || !adaptivesampler_->ready());
+        }
+
+        //! A public member function (const).
+        /*!
+            ファイルを開けなかったか、書き出しに失敗したかどうかを返す（失敗した時点でファイルへの出力は打ち切り、計算は続ける）
+            \return ファイルへの書き出しに失敗したかどうか
+        */
+        bool isWriteFailed() const
+        {
+            return iswritefailed_;
         }
 
         //! A public member function.
         /*!
-            運動方程式を、tintervalgraphplot秒ぶん積分する
+            運動方程式を、tintervalgraphplot秒ぶん積分する（enableadaptivesampling()を呼び出した場合は、次に返す点が決まるまで積分する）
+            最初の数回の呼び出しの後は、どの数値解法でもヒープの確保を行わない（freefalltestで確かめる）
             \return 経過時間、高度、速度、最高到達高度の時の状態、最高速度の際の状態、カーマンラインを脱出した際の状態、外気圏を脱出した際の状態
         */
-        std::tuple< double, double, double, FreefallSolveEom::hmaxtype, FreefallSolveEom::vmaxtype, FreefallSolveEom::tandvtype, FreefallSolveEom::tandvandbooltype > operator()();
+        std::tuple< Real, Real, Real, FreefallSolveEom::hmaxtype, FreefallSolveEom::vmaxtype, FreefallSolveEom::tandvtype, FreefallSolveEom::tandvandbooltype > operator()();
+
+        //! A public member function (const).
+        /*!
+            運動方程式を、パラレアル法で時間方向に並列に初期状態から最後まで積分し、tintervalgraphplot秒ごとの状態を求める
+            区間をnslices個のスライスに分割し、大きな時間刻みの4次のRunge-Kutta法による粗い伝播の予測を、
+            operator()と同じ数値解法と時間刻みによる精密な伝播で並列に修正することを、修正量がepsに収まるまで繰り返す
+            粗い伝播の時間刻みはヤコビアンのスペクトル半径で抑え、それでも粗い伝播が発散した区間は並列化せずに逐次的に積分する
+            大気の無い領域も解析的に解かずに積分し、事象は地面への衝突と第二宇宙速度での外気圏の脱出だけを扱う
+            \param tmax 積分する最大の時間（秒）
+            \param nslices 一度に並列に積分するスライスの数
+            \param nthreads 精密な伝播を行うスレッドの数
+            \return 軌道と、地面に衝突した際の状態
+        */
+        FreefallSolveEom::pararealtype parareal(Real tmax, std::size_t nslices, std::uint32_t nthreads) const;
+
+        //! A public member function (const).
+        /*!
+            運動方程式を、大きな時間刻み（PREVIEWDT秒以上）と緩い許容誤差（PREVIEWEPS以上）で初期状態から最後まで解き、
+            軌道の概形と各事象の概算値を求める（このオブジェクトの状態は変えないので、operator()による計算の前後いずれに呼び出してもよい）
+            operator()による精密な計算の結果が揃うまでの間、軌道全体の見通しをすぐに表示するために用いる
+            \return 軌道の概形と、各事象の概算値
+        */
+        FreefallSolveEom::previewtype preview() const;
+
+        //! A public member function.
+        /*!
+            operator()と同じ点（時間、高度、速度）を、範囲を走査して要素が必要になった時点で一つずつ求める範囲を返す
+            各点について事象の状態のstd::tupleは作らず、各事象は値が確定した時点でhandlerに一度ずつ通知する
+            （点を間引く場合は、事象の時刻は直前に返した点の時刻より後とは限らない）
+            走査を途中でやめれば、それ以降の積分は行わない（このオブジェクトは範囲を走査し終えるまで破棄してはならない）
+            \param handler 事象を受け取る関数（事象が不要な場合はnullptr）
+            \return 計算が終了するまでの点を返す範囲
+        */
+        SampleRange<Real> samples(FreefallSolveEom::eventhandlertype handler = nullptr);
+
+        //! A public member function (const).
+        /*!
+            変分方程式を運動方程式と同時に初期状態から最後まで積分し、各事象の値とその感度を求める
+            \return 各事象の値と、その球の質量m、球の半径r、初期高度h0、初期速度v0についての感度
+        */
+        FreefallSolveEom::sensitivitytype sensitivity() const;
+
+        //! A public member function.
+        /*!
+            運動方程式を、途中の状態を返さずに最後まで一度に解き、各事象の値だけを求める
+            ファイルへの出力と補間の節点の記録は行わない（バッチ計算やパラメータスイープ向け）
+            \return 計算が終了した際の各事象の値
+        */
+        FreefallSolveEom::summarytype summary();
+
+        //! A public member function.
+        /*!
+            summary()と同じく各事象の値だけを求めるが、solveeom_runを一回呼び出すごとにiscancelledを呼び出し、trueが返れば計算をやめる
+            \param iscancelled 計算を取り消すかどうかを返す関数
+            \return 計算が終了した際の各事象の値（取り消した場合はstd::nullopt）
+        */
+        std::optional<FreefallSolveEom::summarytype> summary(std::function<bool()> const & iscancelled);
 
         // #endregion publicメンバ関数
 
     private:
         // #region private staticメンバ関数
 
+        template <typename T>
         //! A static private member function.
         /*!
-            地球中心からの距離r（m）からジオポテンシャル高度H（m）を取得する
-            \param r 地球中心からの距離（m）
+            高度h（m）からジオポテンシャル高度H（m）を取得する
+            \param h 高度（m）
             \return ジオポテンシャル高度（m）
         */
-        static double getGeopotentialFromAltitude(double r)
+        static T getGeopotentialFromAltitude(T const & h)
         {
             // 「標準大気 ー 各高度における空気の温度・圧力・密度・音速・粘性係数・動粘性係数の計算式」
             // https://pigeon-poppo.com/standard-atmosphere/ より
-            return FreefallSolveEom::R0 * (r - FreefallSolveEom::R0) / r;
+            return FreefallSolveEom::R0 * h / (FreefallSolveEom::R0 + h);
         }
 
-        // #region private staticメンバ関数
+        template <typename T>
+        //! A static private member function.
+        /*!
+            初期高度h0（m）から、物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）を取得する
+            \param h0 初期高度（m）
+            \return 物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）
+        */
+        static T getl2divm2northlatitude45(T const & h0);
+
+        template <typename T>
+        //! A static private member function.
+        /*!
+            球の半径r（m）から球の体積（m³）を取得する
+            \param r 球の半径（m）
+            \return 球の体積（m³）
+        */
+        static T getspherevolume(T const & r)
+        {
+            return 4.0 / 3.0 * pi<Real>() * r * r * r;
+        }
+
+        //! A static private member function.
+        /*!
+            内部のバッファを状態の大きさに合わせて確保済みの、Rosenbrock法のステッパーを生成する
+            \param eps 許容誤差
+            \return Rosenbrock法のステッパー
+        */
+        static FreefallSolveEom::StiffStepper makestiffstepper(Real eps);
+
+        // #endregion private staticメンバ関数
 
         // #region privateメンバ関数
 
+        template <typename T, bool Diagnose = false>
+        //! A private member function (const).
+        /*!
+            球の加速度（m/s²）を返す
+            \param x 高度（m）
+            \param v 速度（m/s）
+            \param m 球の質量（kg）
+            \param r 球の半径（m）
+            \param spherevolume 球の体積（m³）
+            \param l2divm2 物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）
+            \param diagnostics 途中で現れる物理量を格納する構造体へのポインタ（Diagnoseがtrueの場合のみ使用）
+            \return 球の加速度（m/s²）
+        */
+        T acceleration(T const & x, T const & v, T const & m, T const & r, T const & spherevolume, T const & l2divm2, FreefallSolveEom::diagnosticstype * diagnostics = nullptr) const;
+
+        //! A private member function (const).
+        /*!
+            球の加速度とそのh、vについての偏微分を返す
+            \param x 位置と速度が格納されたstd::array
+            \return 球の加速度とその偏微分が格納された二重数
+        */
+        FreefallSolveEom::dualtype accelerationwithjacobian(FreefallSolveEom::state_type const & x) const
+        {
+            return acceleration(dualtype(x[0], 0), dualtype(x[1], 1), dualtype(m_), dualtype(r_), dualtype(spherevolume_), dualtype(l2divm2northlatitude45_));
+        }
+
+        //! A private member function (const).
+        /*!
+            変分方程式を含めた状態における、球の加速度とそのh、v、m、球の半径、h0についての偏微分を返す
+            \param x 変分方程式を含めた常微分方程式の状態
+            \return 球の加速度とその偏微分が格納された二重数
+        */
+        FreefallSolveEom::dualtype accelerationwithjacobian(FreefallSolveEom::sensitivity_state_type const & x) const
+        {
+            dualtype const r(r_, 3);
+            dualtype const h0(h0_, 4);
+
+            return acceleration(dualtype(x[0], 0), dualtype(x[1], 1), dualtype(m_, 2), r, getspherevolume(r), getl2divm2northlatitude45(h0));
+        }
+
+        template <typename T>
+        //! A private member function (const).
+        /*!
+            レイノルズ数を返す
+            \param x 高度（m）
+            \param v 速度（m/s）
+            \param r 球の半径（m）
+            \return レイノルズ数
+        */
+        T reynolds(T const & x, T const & v, T const & r) const
+        {
+            using std::fabs;
+
+            return 2.0 * r * get_rho(x) * fabs(v) / get_myu(x);
+        }
+
+        //! A private member function (const).
+        /*!
+            変分方程式を含めた状態における、レイノルズ数とそのh、v、m、球の半径、h0についての偏微分を返す
+            \param x 変分方程式を含めた常微分方程式の状態
+            \return レイノルズ数とその偏微分が格納された二重数
+        */
+        FreefallSolveEom::dualtype reynoldswithjacobian(FreefallSolveEom::sensitivity_state_type const & x) const
+        {
+            return reynolds(dualtype(x[0], 0), dualtype(x[1], 1), dualtype(r_, 3));
+        }
+
+        template <typename T>
         //! A private member function (const).
         /*!
             空気の粘性係数（N･s/m²)を返す
-            \param r 地球中心からの距離r（m）
+            \param h 高度（m）
             \return 空気の粘性係数（N･s/m²)
         */
-        double get_myu(double r) const
+        T get_myu(T const & h) const
         {
+            using std::pow;
+
             // 「標準大気 ー 各高度における空気の温度・圧力・密度・音速・粘性係数・動粘性係数の計算式」
             // https://pigeon-poppo.com/standard-atmosphere/ より
 
@@ -187,44 +805,82 @@ namespace freefallsolveeom {
             auto constexpr S = 110.4;
 
             // 空気の絶対温度（K)
-            auto const T = get_T(r);
-            return 1.458E-6 * std::pow(T, 1.5) / (T + S);
+            auto const temp = get_T(h);
+            return 1.458E-6 * pow(temp, 1.5) / (temp + S);
         }
 
+        template <typename T>
         //! A private member function (const).
         /*!
             空気の圧力（Pa)を返す
-            \param r 地球中心からの距離r（m）
+            \param h 高度（m）
             \return 空気の圧力（Pa）
         */
-        double get_P(double r) const;
+        T get_P(T const & h) const;
 
+        template <typename T>
         //! A private member function (const).
         /*!
             空気の密度（kg/m³)を返す
-            \param r 地球中心からの距離r（m）
+            \param h 高度（m）
             \return 空気の密度（kg/m³)
         */
-        double get_rho(double r) const
+        T get_rho(T const & h) const
         {
             // 「標準大気 ー 各高度における空気の温度・圧力・密度・音速・粘性係数・動粘性係数の計算式」
             // https://pigeon-poppo.com/standard-atmosphere/ より
-            return 0.00348368 * get_P(r) / get_T(r);
+            return 0.00348368 * get_P(h) / get_T(h);
         }
 
+        template <typename T>
         //! A private member function (const).
         /*!
             空気の絶対温度（K)を返す
-            \param r 地球中心からの距離r（m）
+            \param h 高度（m）
             \return 空気の絶対温度（K）
         */
-        double get_T(double r) const;
+        T get_T(T const & h) const;
 
         //! A private member function.
         /*!
-            メンバ変数を初期化する（コンストラクタの中身）
+            現在の状態での方程式の硬さを見積もり、Rosenbrock法を用いるべきかどうかを判定する
+            \return Rosenbrock法を用いるべきかどうか
+        */
+        bool isstiff();
+
+        //! A private member function (const).
+        /*!
+            状態xでの、ヤコビアン ((0, 1), (∂a/∂h, ∂a/∂v)) の固有値の絶対値の最大値（スペクトル半径）を返す
+            陽解法で安定に積分できる時間刻みは、この逆数程度で抑えられる
+            \param x 状態
+            \return ヤコビアンのスペクトル半径（1/s）
+        */
+        Real spectralradius(FreefallSolveEom::state_type const & x) const;
+
+        //! A private member function (const).
+        /*!
+            状態xでの、単位質量あたりの力学的エネルギー（運動エネルギーと、重力と遠心力のポテンシャルの和）を返す
+            空気抵抗はエネルギーを散逸させるので、真の軌道ではほとんど増えない
+            \param x 状態
+            \return 単位質量あたりの力学的エネルギー（J/kg）
+        */
+        Real specificenergy(FreefallSolveEom::state_type const & x) const;
+
+        //! A private member function (const).
+        /*!
+            時刻tがCSVファイルに出力する時刻かどうかを返す
+            \param t 時刻（秒）
+            \return CSVファイルに出力する時刻かどうか
         */
-        void initialize();
+        bool isoutputtimeofcsv(Real t) const
+        {
+            using std::ceil;
+            using std::fabs;
+            using std::floor;
+
+            return fabs(t / *tintervaloutputcsv_ - floor(t / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV ||
+                   fabs(t / *tintervaloutputcsv_ - ceil(t / *tintervaloutputcsv_)) <= FreefallSolveEom::ZERODECISIONTOCSV;
+        }
 
         template <typename Stepper>
         //! A private member function.
@@ -234,27 +890,220 @@ namespace freefallsolveeom {
             \param t 時刻
             \param x 位置と速度が格納されたstd::array
         */
-        void integrate_eom(Stepper const & stepper, double t, state_type & x);
+        void integrate_eom(Stepper const & stepper, Real t, state_type & x) const;
 
+        //! A private member function (const).
+        /*!
+            運動方程式を、解析的なヤコビアンを用いたRosenbrock法で時刻tまで積分する
+            \param stepper 数値積分のステッパー
+            \param t 時刻
+            \param x 位置と速度が格納されたstd::array
+        */
+        void integrate_eom(FreefallSolveEom::stiff_stepper_type const & stepper, Real t, state_type & x) const;
+
+        template <typename Stepper>
         //! A private member function.
         /*!
-            計算結果をcsvファイルに出力する
-            \param t 経過時間（秒）
-            \param x 常微分方程式の状態（現在の地球中心からの距離と速度）
+            作業領域のステッパーを初期状態に戻してから、運動方程式を時刻tまで積分する
+            （ステッパーを戻す際にも、積分する際にもヒープの確保を行わない）
+            \param workspace 数値積分のステッパーの作業領域
+            \param t 時刻
+            \param x 位置と速度が格納されたstd::array
+            \param level 許容誤差の段階（0が最も厳しい）
         */
-        void outputresulttocsv(double t, state_type const & x) const
+        void integrate_eom(StepperWorkspace<Stepper> & workspace, Real t, state_type & x, std::size_t level = 0)
         {
-            std::fprintf(fp_.get(), ("%." + outputtocsvdigits_ + "f, %.2f, %.2f\n").c_str(), t, x[0] - FreefallSolveEom::R0, x[1]);
+            integrate_eom(boost::ref(workspace.renew(level)), t, x);
         }
 
+        //! A private member function.
+        /*!
+            作業領域のステッパーを初期状態に戻してから、運動方程式を解析的なヤコビアンを用いたRosenbrock法で時刻tまで積分する
+            （状態の変換にはメンバ変数の作業領域を用い、Rosenbrock4はステップごとにヒープの確保を行わない）
+            \param workspace 数値積分のステッパーの作業領域
+            \param t 時刻
+            \param x 位置と速度が格納されたstd::array
+            \param level 許容誤差の段階（0が最も厳しい）
+        */
+        void integrate_eom(StepperWorkspace<FreefallSolveEom::StiffStepper> & workspace, Real t, state_type & x, std::size_t level = 0)
+        {
+            integrate_stiff(boost::ref(workspace.renew(level)), t, x, stiffstate_);
+        }
+
+        template <typename Stepper>
+        //! A private member function (const).
+        /*!
+            運動方程式を、解析的なヤコビアンを用いたRosenbrock法で時刻tまで積分する
+            \param stepper 数値積分のステッパー（またはその参照のラッパー）
+            \param t 時刻
+            \param x 位置と速度が格納されたstd::array
+            \param xtmp Rosenbrock法の状態の作業領域（要素数は2でなければならない）
+        */
+        void integrate_stiff(Stepper const & stepper, Real t, state_type & x, boost::numeric::ublas::vector<Real> & xtmp) const;
+
         template <typename Stepper>
+        //! A private member function (const).
+        /*!
+            変分方程式を運動方程式と同時に時刻tまで積分する
+            \param stepper 数値積分のステッパー
+            \param t 時刻
+            \param x 変分方程式を含めた常微分方程式の状態
+        */
+        void integrate_sensitivity(Stepper const & stepper, Real t, sensitivity_state_type & x) const;
+
+        //! A private member function.
+        /*!
+            時間刻みごとの状態を、補間の節点とグラフに出力する点の候補として記録する
+            （enabledenseoutput()とenableadaptivesampling()のどちらも呼び出していない場合は何もしない）
+            \param t 経過時間（秒）
+            \param x 常微分方程式の状態（現在の高度と速度）
+        */
+        void pushstep(Real t, state_type const & x);
+
+        //! A private member function.
+        /*!
+            計算結果をファイルに出力する（圧縮と書き込みは別のスレッドで行われる）
+            Diagnosticsがtrueの場合は、この時刻の状態から加速度を計算し直して診断用の物理量の列を追加する
+            \param t 経過時間（秒）
+            \param x 常微分方程式の状態（現在の高度と速度）
+        */
+        void outputresulttocsv(Real t, state_type const & x) const
+        {
+            if (!writer_)
+            {
+                return;
+            }
+
+            if constexpr (Diagnostics)
+            {
+                FreefallSolveEom::diagnosticstype d;
+                acceleration<Real, true>(x[0], x[1], m_, r_, spherevolume_, l2divm2northlatitude45_, &d);
+
+                std::array<double, FreefallSolveEom::NDIAGNOSTICS> const columns = {
+                    static_cast<double>(d.rho), static_cast<double>(d.myu), static_cast<double>(d.Re), static_cast<double>(d.CD),
+                    static_cast<double>(d.buoyancy), static_cast<double>(d.F), static_cast<double>(d.f2) };
+                writer_->write(static_cast<double>(t), static_cast<double>(x[0]), static_cast<double>(x[1]), columns.data());
+            }
+            else
+            {
+                writer_->write(static_cast<double>(t), static_cast<double>(x[0]), static_cast<double>(x[1]), nullptr);
+            }
+        }
+
+        //! A private member function (const).
+        /*!
+            現在の状態から、まだ起きていない各事象（カーマン・ライン、外気圏、地面、最高到達高度、最高速度）に達するまでの時間を、
+            事象の判定に用いる量を線形に外挿して見積もり、その最小値を返す
+            \return 最も近い事象に達するまでの時間の見積もり（どの事象にも近づいていない場合は無限大）
+        */
+        Real gettimetoevent() const;
+
+        //! A private member function (const).
+        /*!
+            状態beforeから状態afterまでの区間で、いずれかの事象が起きた可能性があるかどうかを返す
+            \param before 区間の最初の状態
+            \param after 区間の最後の状態
+            \return いずれかの事象が起きた可能性があるかどうか
+        */
+        bool iseventbracketed(state_type const & before, state_type const & after) const;
+
+        //! A private member function (const).
+        /*!
+            operator()が返す、最高到達高度の際の状態を求める
+            \return 最高到達高度の際の時間と高度のstd::pairのstd::optional
+        */
+        FreefallSolveEom::hmaxtype getstateofhmax() const;
+
+        //! A private member function (const).
+        /*!
+            operator()が返す、最高速度の際の状態を求める
+            \param t 経過時間（秒）
+            \param h 現在の高度（m）
+            \param v 現在の速度（m/s）
+            \return 最高速度の際の時間と高度と速度のstd::tupleのstd::optional
+        */
+        FreefallSolveEom::vmaxtype getstateofvmax(Real t, Real h, Real v) const;
+
+        //! A private member function.
+        /*!
+            operator()とsamples()が返す次の点を求める（enableadaptivesampling()を呼び出した場合は、次に返す点が決まるまで積分する）
+            \return 経過時間、高度、速度
+        */
+        FreefallSolveEom::sampletype nextsample();
+
+        //! A private member function (const).
+        /*!
+            まだ通知していない事象のうち、値が確定したものをhandlerに通知する
+            \param handler 事象を受け取る関数
+            \param latest 最後に積分した状態の経過時間、高度、速度
+            \param notified 通知した事象のビットの集合（返り値としても使用）
+        */
+        void notifyevents(FreefallSolveEom::eventhandlertype const & handler, FreefallSolveEom::sampletype const & latest, std::uint32_t & notified) const;
+
+        template <bool Summary>
+        //! A private member function.
+        /*!
+            指定された数値解法で運動方程式を解く
+            \tparam Summary trueの場合は、ファイル出力と補間の節点の記録を行わず、最大でSUMMARYIMAXステップを一度に進める
+            \return 位置と速度が格納されたstate_type
+        */
+        FreefallSolveEom::state_type solveeom();
+
+        template <bool Summary, typename Stepper>
         //! A private member function.
         /*!
             空気抵抗のある自由落下系における運動方程式をdtgraphplot秒ぶんだけ解く
-            \param stepper 数値積分のステッパー
+            \tparam Summary trueの場合は、ファイル出力と補間の節点の記録を行わず、最大でSUMMARYIMAXステップを一度に進める
+            \param workspace 数値積分のステッパーの作業領域
             \return 位置と速度が格納されたstate_type
         */
-        FreefallSolveEom::state_type solveeom_run(Stepper const & stepper);
+        FreefallSolveEom::state_type solveeom_run(StepperWorkspace<Stepper> & workspace);
+
+        template <bool Summary>
+        //! A private member function.
+        /*!
+            大気の無い領域で、運動方程式をケプラー方程式を用いて解析的に解き、可能な限り多くのステップを一度に進める
+            \tparam Summary trueの場合は、ファイル出力の時刻で止めず、補間の節点も記録しない
+            \param i 現在のステップの番号
+            \param imax 今回の呼び出しで進めるステップの番号の最大値
+            \param history 直近の二つの状態が格納されたリングバッファ
+            \return 進めたステップ数（解析的に解けない場合は0）
+        */
+        std::int32_t solveeom_kepler(std::int32_t i, std::int32_t imax, FreefallSolveEom::historytype & history);
+
+        template <typename Stepper>
+        //! A private member function.
+        /*!
+            どの事象からも遠い場合に、最も近い事象までの時間の1/TOLERANCEGUARDSTEPSのステップ数を、
+            遠さに応じて緩めた許容誤差で一度に積分する（事象が起きた可能性がある場合は、状態を元に戻して0を返す）
+            \param workspace 数値積分のステッパーの作業領域
+            \param i 現在のステップの番号
+            \param imax 今回の呼び出しで進めるステップの番号の最大値
+            \param history 直近の二つの状態が格納されたリングバッファ
+            \return 進めたステップ数（まとめて進めない場合は0）
+        */
+        std::int32_t solveeom_relaxed(StepperWorkspace<Stepper> & workspace, std::int32_t i, std::int32_t imax, FreefallSolveEom::historytype & history);
+
+        template <typename Stepper>
+        //! A private member function (const).
+        /*!
+            指定された数値解法を精密な伝播として、運動方程式をパラレアル法で積分する
+            \param stepper 精密な伝播に用いる数値積分のステッパー
+            \param tmax 積分する最大の時間（秒）
+            \param nslices 一度に並列に積分するスライスの数
+            \param nthreads 精密な伝播を行うスレッドの数
+            \return 軌道と、地面に衝突した際の状態
+        */
+        FreefallSolveEom::pararealtype parareal_run(Stepper const & stepper, Real tmax, std::size_t nslices, std::uint32_t nthreads) const;
+
+        template <typename Stepper>
+        //! A private member function (const).
+        /*!
+            変分方程式を運動方程式と同時に初期状態から最後まで積分し、各事象の値とその感度を求める
+            \param stepper 数値積分のステッパー
+            \return 各事象の値とその感度
+        */
+        FreefallSolveEom::sensitivitytype sensitivity_run(Stepper const & stepper) const;
 
         // #endregion privateメンバ関数
 
@@ -270,7 +1119,7 @@ namespace freefallsolveeom {
         /*!
             方程式の根や最小値を見つけるときの精度のビット
         */
-        static auto constexpr DIGITS = std::numeric_limits<double>::digits;
+        static auto constexpr DIGITS = std::numeric_limits<Real>::digits;
 
         //! A private static member variable (constant expression).
         /*!
@@ -286,15 +1135,15 @@ namespace freefallsolveeom {
 
         //! A private static member variable (constant expression).
         /*!
-            外気圏の高さ（高度10000km）の、地球中心からの距離
+            外気圏の高さ（高度10000km）（m）
         */
-        static auto constexpr ALTITUDEOFEXOSPHERE = 10000000.0 + FreefallSolveEom::R0;
+        static auto constexpr ALTITUDEOFEXOSPHERE = 10000000.0;
 
         //! A private static member variable (constant expression).
         /*!
-            カーマン・ライン（高度100km）の、地球中心からの距離
+            カーマン・ライン（高度100km）（m）
         */
-        static auto constexpr KARMANLINE = 100000.0 + FreefallSolveEom::R0;
+        static auto constexpr KARMANLINE = 100000.0;
 
         //! A private static member variable (constant expression).
         /*!
@@ -302,18 +1151,93 @@ namespace freefallsolveeom {
         */
         static auto constexpr RETHRESHOLD = 2.0E-3;
 
+        //! A private static member variable (constant expression).
+        /*!
+            ヤコビアンのスペクトル半径と時間刻みの積がこの値を上回ったら、Rosenbrock法に切り替える
+        */
+        static auto constexpr STIFFTHRESHOLD = 10.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            ヤコビアンのスペクトル半径と時間刻みの積がこの値を下回ったら、コントロールされたRunge-Kutta法に戻す
+        */
+        static auto constexpr NONSTIFFTHRESHOLD = 2.0;
+
         //! A private static member variable (constant expression).
         /*!
             地球の質量（kg）
         */
         static auto constexpr M = 5.97243E+24;
 
+        //! A private static member variable (constant expression).
+        /*!
+            parareal()の粗い伝播に用いる、4次のRunge-Kutta法の最大の時間刻み（秒）
+        */
+        static auto constexpr COARSEDT = 1.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            parareal()の粗い伝播で、ヤコビアンのスペクトル半径と時間刻みの積をこの値以下に抑える
+            （4次のRunge-Kutta法の実軸上の安定限界は約2.79だが、減衰を正しく再現するように余裕を持たせる）
+        */
+        static auto constexpr COARSESTABILITY = 1.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            parareal()で、粗い伝播の状態の単位質量あたりの力学的エネルギーが、初期状態のものを初期状態の絶対値のこの倍数より多く上回ったら、
+            粗い伝播が発散したとみなし、その区間を逐次的に積分する
+        */
+        static auto constexpr COARSEENERGYMARGIN = 1.0E-2;
+
+        //! A private static member variable (constant expression).
+        /*!
+            parareal()で、粗い伝播で残りの時間を見積もる際に一度に進める時間（秒）
+        */
+        static auto constexpr COARSESPAN = 10.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            preview()に用いる最小の時間刻み（秒）
+        */
+        static auto constexpr PREVIEWDT = 0.1;
+
+        //! A private static member variable (constant expression).
+        /*!
+            preview()に用いる最小の許容誤差
+        */
+        static auto constexpr PREVIEWEPS = 1.0E-6;
+
         //! A private static member variable (constant expression).
         /*!
             方程式の根や最小値を見つけるときの繰り返しの最高値
         */
         static boost::uintmax_t constexpr MAXITER = 1000;
 
+        //! A private static member variable (constant expression).
+        /*!
+            summary()で、solveeom_runの一回の呼び出しで進める最大のステップ数（取り消しを確認する間隔でもある）
+        */
+        static std::int32_t constexpr SUMMARYIMAX = 1 << 20;
+
+        //! A private static member variable (constant expression).
+        /*!
+            最も近い事象までの時間が、時間刻みのこの倍数より短い場合は、最も厳しい許容誤差で時間刻みごとに積分する
+            （それより遠い場合は、最も近い事象までの時間のこの逆数倍だけまとめて積分する）
+        */
+        static auto constexpr TOLERANCEGUARDSTEPS = 10.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            許容誤差の隣り合う段階の比（最も近い事象までの時間がこの倍数だけ遠くなるごとに、許容誤差を一段階緩める）
+        */
+        static auto constexpr TOLERANCERATIO = 10.0;
+
+        //! A private static member variable (constant expression).
+        /*!
+            診断用の物理量の列の数（diagnosticstypeのメンバの数）
+        */
+        static std::size_t constexpr NDIAGNOSTICS = 7;
+
         //! A private static member variable (constant expression).
         /*!
             メートルをキロメートルに変換するときの定数
@@ -344,39 +1268,51 @@ namespace freefallsolveeom {
 
         //! A private member variable.
         /*!
-            gsl_interp_accelへのスマートポインタ
+            グラフに出力する点を間引くオブジェクト（enableadaptivesampling()を呼び出していない場合はstd::nullopt）
+        */
+        std::optional< AdaptiveSampler<Real> > adaptivesampler_ = std::nullopt;
+
+        //! A private member variable (constant).
+        /*!
+            高度80km以上の大気モデル（全てのインスタンスで共有される）
         */
-        std::unique_ptr<gsl_interp_accel, decltype(gsl_interp_accel_deleter)> const acc_;
+        std::shared_ptr<Atmosphere const> const atmosphere_;
+
+        //! A private member variable (constant).
+        /*!
+            大気の上端の高度（m）（これより上は真空とみなす）
+        */
+        double const atmospheretop_;
 
         //! A private member variable.
         /*!
             時間のカウント
         */
-        double cnt_ = 0;
+        Real cnt_ = 0;
 
-        //! A private member variable (constant).
+        //! A private member variable.
         /*!
-            常微分方程式の数値解法の時間刻み（秒）
+            記録した軌道の補間（enabledenseoutput()を呼び出していない場合はstd::nullopt）
         */
-        double const dt_;
+        std::optional< DenseOutput<Real> > denseoutput_ = std::nullopt;
 
         //! A private member variable (constant).
         /*!
-            常微分方程式の数値解法の許容誤差
+            常微分方程式の数値解法の時間刻み（秒）
         */
-        double const eps_;
+        Real const dt_;
 
-        //! A private member variable.
+        //! A private member variable (constant).
         /*!
-            CSVファイル出力用のファイルポインタのスマートポインタ
+            常微分方程式の数値解法の許容誤差
         */
-        std::unique_ptr< FILE, decltype(&std::fclose) > fp_;
+        Real const eps_;
 
         //! A private member variable (constant).
         /*!
             初期高度（m）
         */
-        double const h0_;
+        Real const h0_;
 
         //! A private member variable.
         /*!
@@ -401,18 +1337,36 @@ namespace freefallsolveeom {
             最初のステップかどうか
         */
         bool isfirststep_ = true;
+
+        //! A private member variable.
+        /*!
+            自動切り替えの際に、現在Rosenbrock法を用いているかどうか
+        */
+        bool isstiff_ = false;
+
+        //! A private member variable.
+        /*!
+            enabletoleranceschedule()を呼び出したかどうか
+        */
+        bool istoleranceschedule_ = false;
+
+        //! A private member variable.
+        /*!
+            ファイルへの書き出しに失敗したかどうか
+        */
+        bool iswritefailed_ = false;
         
         //! A private member variable (constant).
         /*!
             物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）
         */
-        double const l2divm2northlatitude45_;
+        Real const l2divm2northlatitude45_;
         
         //! A private member variable (constant).
         /*!
             球の質量（kg）
         */
-        double const m_;
+        Real const m_;
         
         //! A private member variable (constant).
         /*!
@@ -422,81 +1376,83 @@ namespace freefallsolveeom {
 
         //! A private member variable (constant).
         /*!
-            CSVファイルに記録するときの、小数点以下の桁数
+			投げる球の半径（m）
         */
-        std::string outputtocsvdigits_;
+        Real const r_;
 
-        //! A private member variable.
+        //! A private member variable (constant).
         /*!
-            圧力Pのデータが格納された可変長配列
+            球の体積（m³）
         */
-        std::vector<double> p_data_;
+        Real const spherevolume_;
 
-        //! A private member variable (constant).
+        //! A private member variable.
         /*!
-			投げる球の半径（m）
+            外気圏を脱出した際の時間（秒）と速度（m/s）とその時に第二宇宙速度を超えていたかどうかのstd::tupleのstd::optional
         */
-        double const r_;
+        FreefallSolveEom::tandvandbooltype stateescapeofexosphere_ = std::nullopt;
 
-        //! A private member variable (constant).
+        //! A private member variable.
         /*!
-            球の体積（m³）
+            カーマン・ラインを突破した際の時間（秒）と速度（m/s）のstd::pairのstd::optional
         */
-        double const spherevolume_;
+        FreefallSolveEom::tandvtype stateescapeofkarmanline_ = std::nullopt;
+
+        // 以下のステッパーの作業領域はeps_を用いて初期化するため、eps_より後に宣言しなければならない
 
         //! A private member variable.
         /*!
-            gsl_interp_typeへのスマートポインタ
+            Adams Bashforth Moulton法のステッパーの作業領域
         */
-        std::unique_ptr<gsl_spline, decltype(gsl_spline_deleter)> spline_pressure_;
+        StepperWorkspace<FreefallSolveEom::abm_stepper_type> stepperabm_{ FreefallSolveEom::abm_stepper_type() };
 
         //! A private member variable.
         /*!
-            gsl_interp_typeへのスマートポインタ
+            Bulirsch-Stoer法のステッパーの作業領域
         */
-        std::unique_ptr<gsl_spline, decltype(gsl_spline_deleter)> spline_temperature_;
+        StepperWorkspace<FreefallSolveEom::bs_stepper_type> stepperbs_{ FreefallSolveEom::bs_stepper_type(eps_, eps_) };
 
         //! A private member variable.
         /*!
-            外気圏を脱出した際の時間（秒）と速度（m/s）とその時に第二宇宙速度を超えていたかどうかのstd::tupleのstd::optional
+            コントロールされたRunge-Kutta法のステッパーの作業領域
         */
-        FreefallSolveEom::tandvandbooltype stateescapeofexosphere_ = std::nullopt;
+        StepperWorkspace<FreefallSolveEom::controlled_stepper_type> steppercontrolled_{ make_controlled(eps_, eps_, error_stepper_type()) };
 
         //! A private member variable.
         /*!
-            カーマン・ラインを突破した際の時間（秒）と速度（m/s）のstd::pairのstd::optional
+            Rosenbrock法のステッパーの作業領域
         */
-        FreefallSolveEom::tandvtype stateescapeofkarmanline_ = std::nullopt;
+        StepperWorkspace<FreefallSolveEom::StiffStepper> stepperstiff_{ makestiffstepper(eps_) };
 
         //! A private member variable.
         /*!
-            経過時間（秒）
+            Rosenbrock法で積分する際の、状態の作業領域
         */
-        double t_ = 0.0;
+        boost::numeric::ublas::vector<Real> stiffstate_ = boost::numeric::ublas::vector<Real>(2);
 
         //! A private member variable.
         /*!
-            温度Tのデータが格納された可変長配列
+            経過時間（秒）
         */
-        std::vector<double> t_data_;
-                
+        Real t_ = 0.0;
+
         //! A private member variable.
         /*!
             地上落下時の時間（秒）
         */
-        double tend_ = 0.0;
+        Real tend_ = 0.0;
                
         //! A private member variable (constant).
         /*!
             グラフプロット用の時間間隔（秒）
         */
-        double const tintervalgraphplot_;
+        Real const tintervalgraphplot_;
 
         //! A private member variable (constant).
         /*!
             CSVファイル出力用の時間間隔（秒）
         */
-        std::optional<double> const tintervaloutputcsv_;
+        std::optional<Real> const tintervaloutputcsv_;
 
         //! A private member variable.
         /*!
@@ -504,11 +1460,17 @@ namespace freefallsolveeom {
         */
         std::optional<bool> const islargertintervaloutputcsv_;
 
+        //! A private member variable.
+        /*!
+            許容誤差を緩めずに、時間刻みごとに積分する残りのステップ数
+        */
+        std::int32_t tightsteps_ = 0;
+
         //! A private member variable (constant).
         /*!
             初期速度（m/s）
         */
-        double const v0_;
+        Real const v0_;
 
         //! A private member variable.
         /*!
@@ -524,9 +1486,9 @@ namespace freefallsolveeom {
 
         //! A private member variable.
         /*!
-            高度zのメッシュが格納された可変長配列
+            ファイル出力用のオブジェクトへのスマートポインタ（ファイルに出力しない場合はnullptr）
         */
-        std::vector<double> z_mesh_;
+        std::unique_ptr<TrajectoryWriter> writer_;
 
         // #endregion メンバ変数
 
@@ -569,106 +1531,203 @@ namespace freefallsolveeom {
         return x * x;
     }
 
-    template <typename Stepper>
-    //! A private member function.
+    template <typename Real, bool Diagnostics>
+    template <typename T>
+    //! A static private member function.
     /*!
-        運動方程式を時刻tまで積分する
-        \param stepper 数値積分のステッパー
-        \param t 時刻
-        \param x 位置と速度が格納されたstd::array
+        初期高度h0（m）から、物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）を取得する
+        \param h0 初期高度（m）
+        \return 物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）
     */
-    void FreefallSolveEom::integrate_eom(Stepper const & stepper, double t, FreefallSolveEom::state_type & x)
+    T FreefallSolveEom<Real, Diagnostics>::getl2divm2northlatitude45(T const & h0)
     {
-        integrate_adaptive(
-            stepper,
-            [this](FreefallSolveEom::state_type const & x, FreefallSolveEom::state_type & dxdt, double const)
-            {
-                // dx/dt = v
-                dxdt[0] = x[1];
+        using std::cos;
 
-                // 球に働く引力
-                auto const g =
-                    // 球に働く重力
-                    FreefallSolveEom::G * FreefallSolveEom::M / sqr(x[0]) -
-                    // 球に働く遠心力
-                    l2divm2northlatitude45_ / (x_[0] * x_[0] * x_[0]);
+        return sqr(sqr(FreefallSolveEom::R0 + h0) * 2.0 * pi<Real>() / (24.0 * 60.0 * 60.0)) * cos(pi<Real>() / 4);
+    }
 
-                // 空気の密度
-                auto const rho = get_rho(x[0]);
+    template <typename Real, bool Diagnostics>
+    template <typename T, bool Diagnose>
+    //! A private member function (const).
+    /*!
+        球の加速度（m/s²）を返す
+        \param x 高度（m）
+        \param v 速度（m/s）
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param spherevolume 球の体積（m³）
+        \param l2divm2 物体の角運動量Lの2乗を質量mの2乗で割り、北緯45度地点に修正した定数（m⁴s¯²）
+        \param diagnostics 途中で現れる物理量を格納する構造体へのポインタ（Diagnoseがtrueの場合のみ使用）
+        \return 球の加速度（m/s²）
+    */
+    T FreefallSolveEom<Real, Diagnostics>::acceleration(T const & x, T const & v, T const & m, T const & r, T const & spherevolume, T const & l2divm2, FreefallSolveEom::diagnosticstype * diagnostics) const
+    {
+        using std::exp;
+        using std::fabs;
+        using std::pow;
 
-                // 球に働く力
-                auto const f1 = -g +
-                    // 球に働く浮力
-                    rho * spherevolume_ * g;
+        // 地球中心からの距離
+        T const distance = FreefallSolveEom::R0 + x;
 
-                // 空気の粘性係数
-                auto const myu = get_myu(x[0]);
+        // 球に働く引力
+        auto const g =
+            // 球に働く重力
+            FreefallSolveEom::G * FreefallSolveEom::M / sqr(distance) -
+            // 球に働く遠心力
+            l2divm2 / (distance * distance * distance);
 
-                // レイノルズ数
-                auto const Re = 2.0 * r_ * rho * std::fabs(x[1]) / myu;
+        // 空気の密度
+        auto const rho = get_rho(x);
 
-                // 粘性抵抗
-                auto const F = 6.0 * pi<double>() * myu * r_ * x[1];
+        // 球に働く力
+        auto const f1 = -g +
+            // 球に働く浮力
+            rho * spherevolume * g;
 
-                // 重力と遠心力のみが働く
-                if (Re < FreefallSolveEom::ZERODECISION)
-                {
-                    dxdt[1] = -g;
+        // 空気の粘性係数
+        auto const myu = get_myu(x);
 
-                    return;
-                }
+        // レイノルズ数
+        auto const Re = 2.0 * r * rho * fabs(v) / myu;
 
-                // 粘性抵抗のみが働く
-                if (Re < FreefallSolveEom::RETHRESHOLD) {
-                    dxdt[1] = f1 - F / m_;
+        // 粘性抵抗
+        auto const F = 6.0 * pi<Real>() * myu * r * v;
 
-                    return;
-                }
+        if constexpr (Diagnose)
+        {
+            *diagnostics = { rho, myu, Re, T(0), rho * spherevolume * g, T(0), T(0) };
+        }
 
-                auto const FD = 0.5 * rho * pi<double>() * sqr(r_) * std::fabs(x[1]) * x[1];
+        // 重力と遠心力のみが働く
+        if (Re < FreefallSolveEom::ZERODECISION)
+        {
+            return -g;
+        }
 
-                // Drag coefficient
-                double CD;
+        if constexpr (Diagnose)
+        {
+            diagnostics->F = F;
+        }
 
-                // N.-S. Cheng, Comparison of formulas for drag coefficient and settling velocity of
-                // spherical particles, Powder Technology 189 (2009) 395–398.
-                // 2.0*10^-3 < Re < 2.0*10^5
-                if (Re < 2.0E+5)
-                {
-                    CD = 24.0 / Re * std::pow(1.0 + 0.27 * Re, 0.43) + 0.47 * (1.0 - std::exp(-0.04 * std::pow(Re, 0.38)));
-                }
-                // 2.0*10^5 <= Re < 10^6
-                else if (Re < 1.0E+6)
-                {
-                    // Almedeij J. Drag coefficient of flow around a sphere: Matching asymptotically the wide
-                    // trend. std::powder Technology. (2008);doi:10.1016/j.std::powtec.2007.12.006.
-                    auto const phi1 = std::pow(24.0 / Re, 10) + std::pow(21.0 * std::pow(Re, -0.67), 10) +
-                        std::pow(4.0 * std::pow(Re, -0.33), 10) + std::pow(0.4, 10);
-                    auto const phi2 = 1.0 / (1.0 / std::pow(0.148 * std::pow(Re, 0.11), 10) + 1.0 / std::pow(0.5, 10));
-                    auto const phi3 = std::pow((1.57E+8) * std::pow(Re, -1.625), 10);
-                    auto const phi4 = 1.0 / (1.0 / std::pow((6.0E-17) * std::pow(Re, 2.63), 10) + 1.0 / std::pow(0.2, 10));
-
-                    CD = std::pow((1.0 / (1.0 / (phi1 + phi2) + 1.0 / phi3) + phi4), 0.1);
-                }
-                // 10^6 <= Re
-                else
-                {
-                    // Clift R, Grace JR, Weber ME. Bubbles, drops, and particles. New York: Academic; 1978
-                    CD = 0.19 - 8.0E+4 / Re;
-                }
+        // 粘性抵抗のみが働く
+        if (Re < FreefallSolveEom::RETHRESHOLD) {
+            return f1 - F / m;
+        }
+
+        auto const FD = 0.5 * rho * pi<Real>() * sqr(r) * fabs(v) * v;
+
+        // Drag coefficient
+        T CD;
+
+        // N.-S. Cheng, Comparison of formulas for drag coefficient and settling velocity of
+        // spherical particles, Powder Technology 189 (2009) 395–398.
+        // 2.0*10^-3 < Re < 2.0*10^5
+        if (Re < 2.0E+5)
+        {
+            CD = 24.0 / Re * pow(1.0 + 0.27 * Re, 0.43) + 0.47 * (1.0 - exp(-0.04 * pow(Re, 0.38)));
+        }
+        // 2.0*10^5 <= Re < 10^6
+        else if (Re < 1.0E+6)
+        {
+            // Almedeij J. Drag coefficient of flow around a sphere: Matching asymptotically the wide
+            // trend. std::powder Technology. (2008);doi:10.1016/j.std::powtec.2007.12.006.
+            auto const phi1 = pow(24.0 / Re, 10) + pow(21.0 * pow(Re, -0.67), 10) +
+                pow(4.0 * pow(Re, -0.33), 10) + std::pow(0.4, 10);
+            auto const phi2 = 1.0 / (1.0 / pow(0.148 * pow(Re, 0.11), 10) + 1.0 / std::pow(0.5, 10));
+            auto const phi3 = pow((1.57E+8) * pow(Re, -1.625), 10);
+            auto const phi4 = 1.0 / (1.0 / pow((6.0E-17) * pow(Re, 2.63), 10) + 1.0 / std::pow(0.2, 10));
+
+            CD = pow((1.0 / (1.0 / (phi1 + phi2) + 1.0 / phi3) + phi4), 0.1);
+        }
+        // 10^6 <= Re
+        else
+        {
+            // Clift R, Grace JR, Weber ME. Bubbles, drops, and particles. New York: Academic; 1978
+            CD = 0.19 - 8.0E+4 / Re;
+        }
+
+        // 慣性抵抗÷(m)
+        auto const f2 = FD * CD / m;
+
+        if constexpr (Diagnose)
+        {
+            diagnostics->CD = CD;
+            diagnostics->f2 = f2;
+        }
+
+        return f1 - F / m - f2;
+    }
+
+    template <typename Real, bool Diagnostics>
+    template <typename Stepper>
+    //! A private member function (const).
+    /*!
+        運動方程式を時刻tまで積分する
+        \param stepper 数値積分のステッパー
+        \param t 時刻
+        \param x 位置と速度が格納されたstd::array
+    */
+    void FreefallSolveEom<Real, Diagnostics>::integrate_eom(Stepper const & stepper, Real t, FreefallSolveEom::state_type & x) const
+    {
+        integrate_adaptive(
+            stepper,
+            [this](FreefallSolveEom::state_type const & x, FreefallSolveEom::state_type & dxdt, Real const)
+            {
+                // dx/dt = v
+                dxdt[0] = x[1];
+
+                // dv/dt = a
+                dxdt[1] = acceleration(x[0], x[1], m_, r_, spherevolume_, l2divm2northlatitude45_);
+            },
+            x,
+            Real(0),
+            t,
+            dt_);
+    }
 
-                // 慣性抵抗÷(m)
-                auto const f2 = FD * CD / m_;
+    template <typename Real, bool Diagnostics>
+    template <typename Stepper>
+    //! A private member function (const).
+    /*!
+        変分方程式を運動方程式と同時に時刻tまで積分する
+        \param stepper 数値積分のステッパー
+        \param t 時刻
+        \param x 変分方程式を含めた常微分方程式の状態
+    */
+    void FreefallSolveEom<Real, Diagnostics>::integrate_sensitivity(Stepper const & stepper, Real t, FreefallSolveEom::sensitivity_state_type & x) const
+    {
+        integrate_adaptive(
+            stepper,
+            [this](FreefallSolveEom::sensitivity_state_type const & x, FreefallSolveEom::sensitivity_state_type & dxdt, Real const)
+            {
+                // 加速度と、そのh、v、m、球の半径、h0についての偏微分
+                auto const a = accelerationwithjacobian(x);
+
+                dxdt[0] = x[1];
+                dxdt[1] = a.value();
 
-                dxdt[1] = f1 - F / m_ - f2;
+                // 変分方程式 d/dt (∂h/∂p) = ∂v/∂p, d/dt (∂v/∂p) = ∂a/∂h ∂h/∂p + ∂a/∂v ∂v/∂p + ∂a/∂p
+                for (auto k = 0; k < 4; k++) {
+                    dxdt[2 + 2 * k] = x[3 + 2 * k];
+                    dxdt[3 + 2 * k] = a.grad(0) * x[2 + 2 * k] + a.grad(1) * x[3 + 2 * k] + (k < 3 ? a.grad(2 + k) : 0.0);
+                }
             },
             x,
-            0.0,
+            Real(0),
             t,
             dt_);
     }
 
     // #endregion template関数の実装
+
+    // #region templateクラスの実体化の宣言
+
+    extern template class FreefallSolveEom<float>;
+    extern template class FreefallSolveEom<double>;
+    extern template class FreefallSolveEom<referencetype>;
+    extern template class FreefallSolveEom<double, true>;
+
+    // #endregion templateクラスの実体化の宣言
 }
 
 #endif  // _FREEFALLSOLVEEOM_H_
@@ -5,27 +5,349 @@
     This software is released under the BSD 2-Clause License.
 */
 #include "freefallsolveeommain.h"
+#include <algorithm>                // for std::copy
+#include <array>                    // for std::array
+#include <initializer_list>         // for std::initializer_list
+#include <memory>                   // for std::atomic_load, std::atomic_store, std::make_shared, std::shared_ptr
+#include <mutex>                    // for std::lock_guard
 #include <tuple>                    // for std::get
+#include <utility>                  // for std::move
 
 extern "C" {
+    std::int32_t __stdcall createinstance(double dt, double tintervalgraphplot, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type)
+    {
+        auto se = std::make_shared<freefallsolveeom::FreefallSolveEomType>(dt, tintervalgraphplot, eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEomType::Ode_Solver_type>(ode_solver_type), std::atomic_load(&patmosphere));
+
+        std::lock_guard<std::mutex> lock(instancesmutex);
+        auto const handle = nexthandle++;
+        instances.emplace(handle, std::move(se));
+
+        return handle;
+    }
+
+    void __stdcall destroyinstance(std::int32_t handle)
+    {
+        std::shared_ptr<freefallsolveeom::FreefallSolveEomType> se;
+        {
+            std::lock_guard<std::mutex> lock(instancesmutex);
+            auto const itr = instances.find(handle);
+            if (itr == instances.end())
+            {
+                return;
+            }
+
+            se = std::move(itr->second);
+            instances.erase(itr);
+            instancetrajectorypyramids.erase(handle);
+        }
+
+        // ロックを解放してから手放す（他のハンドルの取得を待たせない）
+        // このハンドルを指定した関数が実行中の場合は、その関数が終わった時点で破棄される
+    }
+
+    void __stdcall enableadaptivesampling(double reltol, double maxgap)
+    {
+        pse->enableadaptivesampling(reltol, maxgap);
+    }
+
+    std::int32_t __stdcall enableadaptivesamplingof(std::int32_t handle, double reltol, double maxgap)
+    {
+        auto const se = freefallsolveeom::getinstance(handle);
+        if (!se)
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        se->enableadaptivesampling(reltol, maxgap);
+
+        return 0;
+    }
+
+    void __stdcall enabledenseoutput()
+    {
+        pse->enabledenseoutput();
+    }
+
+    void __stdcall enabletrajectorypyramid()
+    {
+        trajectorypyramid.emplace();
+    }
+
+    std::int32_t __stdcall enabletrajectorypyramidof(std::int32_t handle)
+    {
+        std::lock_guard<std::mutex> lock(instancesmutex);
+        if (!instances.count(handle))
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        instancetrajectorypyramids.emplace(handle, std::make_shared< freefallsolveeom::TrajectoryPyramid<double> >());
+
+        return 0;
+    }
+
+    void __stdcall enabletoleranceschedule(double epsmax)
+    {
+        pse->enabletoleranceschedule(epsmax);
+    }
+
+    std::int32_t __stdcall enabletolerancescheduleof(std::int32_t handle, double epsmax)
+    {
+        auto const se = freefallsolveeom::getinstance(handle);
+        if (!se)
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        se->enabletoleranceschedule(epsmax);
+
+        return 0;
+    }
+
+    void __stdcall getsensitivity(double * value, double * grad, bool * isvalid)
+    {
+        using FreefallSolveEom = freefallsolveeom::FreefallSolveEomType;
+
+        auto const res = pse->sensitivity();
+        auto const items = {
+            &FreefallSolveEom::sensitivitytype::timpact,
+            &FreefallSolveEom::sensitivitytype::vimpact,
+            &FreefallSolveEom::sensitivitytype::thmax,
+            &FreefallSolveEom::sensitivitytype::hmax,
+            &FreefallSolveEom::sensitivitytype::tvmax,
+            &FreefallSolveEom::sensitivitytype::vmax,
+            &FreefallSolveEom::sensitivitytype::tkarmanline,
+            &FreefallSolveEom::sensitivitytype::vkarmanline,
+            &FreefallSolveEom::sensitivitytype::texosphere,
+            &FreefallSolveEom::sensitivitytype::vexosphere };
+
+        auto i = 0;
+        for (auto const item : items) {
+            auto const & state = res.*item;
+            if (state)
+            {
+                isvalid[i] = true;
+                value[i] = state->first;
+                std::copy(state->second.begin(), state->second.end(), grad + 4 * i);
+            }
+            else
+            {
+                isvalid[i] = false;
+            }
+
+            i++;
+        }
+    }
+
+    void __stdcall getpreviewpoints(double * t, double * h, double * v)
+    {
+        for (auto const & [tp, hp, vp] : previewtrajectory) {
+            *t++ = tp;
+            *h++ = hp;
+            *v++ = vp;
+        }
+    }
+
+    bool __stdcall getstatesat(double const * t, std::int32_t n, double * h, double * v)
+    {
+        auto const & denseoutput = pse->denseoutput();
+        if (!denseoutput || denseoutput->empty())
+        {
+            return false;
+        }
+
+        (*denseoutput)(t, static_cast<std::size_t>(n), h, v);
+
+        return true;
+    }
+
     void __stdcall init(double dt, double tintervalgraphplot, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type)
     {
-        pse.emplace(dt, tintervalgraphplot, eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEom::Ode_Solver_type>(ode_solver_type));
+        trajectorypyramid.reset();
+        pse.emplace(dt, tintervalgraphplot, eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEomType::Ode_Solver_type>(ode_solver_type), std::atomic_load(&patmosphere));
     }
 
     void __stdcall initofcsvoutput(double dt, double tintervalgraphplot, double tintervaloutputcsv, char const * csvfilename, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type)
     {
-        pse.emplace(dt, tintervalgraphplot, tintervaloutputcsv, csvfilename, eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEom::Ode_Solver_type>(ode_solver_type));
+        using freefallsolveeom::TrajectoryWriter;
+
+        trajectorypyramid.reset();
+        pse.emplace(dt, tintervalgraphplot, tintervaloutputcsv, csvfilename, TrajectoryWriter::Format::CSV, TrajectoryWriter::Compression::NONE, eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEomType::Ode_Solver_type>(ode_solver_type), std::atomic_load(&patmosphere));
+    }
+
+    void __stdcall initofstreamoutput(double dt, double tintervalgraphplot, double tintervaloutputcsv, char const * filename, std::int32_t format, std::int32_t compression, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type)
+    {
+        using freefallsolveeom::TrajectoryWriter;
+
+        trajectorypyramid.reset();
+        pse.emplace(dt, tintervalgraphplot, tintervaloutputcsv, filename, static_cast<TrajectoryWriter::Format>(format), static_cast<TrajectoryWriter::Compression>(compression), eps, m, r, h0, v0, static_cast<freefallsolveeom::FreefallSolveEomType::Ode_Solver_type>(ode_solver_type), std::atomic_load(&patmosphere));
     }
     
     std::int32_t __stdcall iscalculationfinished()
     {
         return pse->isCalculationFinished() ? 1 : 0;
     }
+
+    std::int32_t __stdcall iscalculationfinishedof(std::int32_t handle)
+    {
+        auto const se = freefallsolveeom::getinstance(handle);
+        if (!se)
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        return se->isCalculationFinished() ? 1 : 0;
+    }
+
+    std::int32_t __stdcall iswritefailed()
+    {
+        return pse->isWriteFailed() ? 1 : 0;
+    }
+
+    bool __stdcall loadatmosphere(char const * filename)
+    {
+        if (!filename)
+        {
+            std::atomic_store(&patmosphere, freefallsolveeom::Atmosphere::getDefault());
+            return true;
+        }
+
+        auto atmosphere = freefallsolveeom::Atmosphere::load(filename);
+        if (!atmosphere)
+        {
+            return false;
+        }
+
+        std::atomic_store(&patmosphere, std::move(atmosphere));
+        return true;
+    }
+
+    bool __stdcall loadsurrogate(char const * filename)
+    {
+        if (!filename)
+        {
+            std::atomic_store(&psurrogate, std::shared_ptr<freefallsolveeom::Surrogate const>());
+            return true;
+        }
+
+        auto surrogate = freefallsolveeom::Surrogate::load(filename);
+        if (!surrogate)
+        {
+            return false;
+        }
+
+        std::atomic_store(&psurrogate, std::shared_ptr<freefallsolveeom::Surrogate const>(std::move(surrogate)));
+        return true;
+    }
     
     void __stdcall nextstep(double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape)
     {
-        auto const [tres, hres, vres, stateofhmax, stateofvmax, stateofkamanline, stateofexosphere] = (*pse)();
+        freefallsolveeom::nextstepimpl(*pse, t, h, v, ishmax, thmax, hmax, isvmax, tvmax, hvmax, vmax, iskarmanline, tkarmanline, vkarmanline, isexosphere, texosphere, vexosphere, issecondescape);
+
+        if (trajectorypyramid)
+        {
+            trajectorypyramid->push(*t, *h, *v);
+        }
+    }
+
+    std::int32_t __stdcall nextstepof(std::int32_t handle, double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape)
+    {
+        auto const se = freefallsolveeom::getinstance(handle);
+        if (!se)
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        freefallsolveeom::nextstepimpl(*se, t, h, v, ishmax, thmax, hmax, isvmax, tvmax, hvmax, vmax, iskarmanline, tkarmanline, vkarmanline, isexosphere, texosphere, vexosphere, issecondescape);
+
+        if (auto const trajectorypyramid = freefallsolveeom::gettrajectorypyramid(handle))
+        {
+            trajectorypyramid->push(*t, *h, *v);
+        }
+
+        return 0;
+    }
+
+    std::int32_t __stdcall preview(double * value, bool * isvalid)
+    {
+        auto res = pse->preview();
+
+        auto const & events = res.events;
+        std::array< std::optional< std::pair<double, double> >, 5 > const states = {
+            events.impact,
+            events.hmax,
+            events.vmax ? std::make_optional(std::make_pair(std::get<0>(*events.vmax), std::get<2>(*events.vmax))) : std::nullopt,
+            events.karmanline,
+            events.exosphere ? std::make_optional(std::make_pair(std::get<0>(*events.exosphere), std::get<1>(*events.exosphere))) : std::nullopt };
+
+        for (auto i = 0U; i < states.size(); i++) {
+            isvalid[2 * i] = isvalid[2 * i + 1] = static_cast<bool>(states[i]);
+            if (states[i])
+            {
+                value[2 * i] = states[i]->first;
+                value[2 * i + 1] = states[i]->second;
+            }
+        }
+
+        previewtrajectory = std::move(res.trajectory);
+
+        return static_cast<std::int32_t>(previewtrajectory.size());
+    }
+
+    std::int32_t __stdcall querysurrogate(double m, double r, double h0, double v0, double maxrelerr, double * value, double * error)
+    {
+        auto const surrogate = std::atomic_load(&psurrogate);
+        if (!surrogate)
+        {
+            return -1;
+        }
+
+        auto const res = (*surrogate)({ m, r, h0, v0 }, maxrelerr);
+        std::copy(res.value.begin(), res.value.end(), value);
+        std::copy(res.error.begin(), res.error.end(), error);
+
+        return res.issurrogate ? 1 : 0;
+    }
+
+    std::int32_t __stdcall querytrajectory(double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v)
+    {
+        return trajectorypyramid ? freefallsolveeom::querytrajectoryimpl(*trajectorypyramid, tmin, tmax, npixels, t, h, v) : 0;
+    }
+
+    std::int32_t __stdcall querytrajectoryof(std::int32_t handle, double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v)
+    {
+        if (!freefallsolveeom::getinstance(handle))
+        {
+            return freefallsolveeom::INVALIDHANDLE;
+        }
+
+        auto const trajectorypyramid = freefallsolveeom::gettrajectorypyramid(handle);
+
+        return trajectorypyramid ? freefallsolveeom::querytrajectoryimpl(*trajectorypyramid, tmin, tmax, npixels, t, h, v) : 0;
+    }
+}
+
+namespace freefallsolveeom {
+    std::shared_ptr<FreefallSolveEomType> getinstance(std::int32_t handle)
+    {
+        // shared_ptrを複製して返すので、ロックを解放した後にdestroyinstanceでmapから取り除かれても、呼び出し側が使い終わるまで破棄されない
+        std::lock_guard<std::mutex> lock(instancesmutex);
+        auto const itr = instances.find(handle);
+
+        return itr != instances.end() ? itr->second : nullptr;
+    }
+
+    std::shared_ptr< TrajectoryPyramid<double> > gettrajectorypyramid(std::int32_t handle)
+    {
+        std::lock_guard<std::mutex> lock(instancesmutex);
+        auto const itr = instancetrajectorypyramids.find(handle);
+
+        return itr != instancetrajectorypyramids.end() ? itr->second : nullptr;
+    }
+
+    void nextstepimpl(FreefallSolveEomType & se, double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape)
+    {
+        auto const [tres, hres, vres, stateofhmax, stateofvmax, stateofkamanline, stateofexosphere] = se();
 
         *t = tres;
         *h = hres;
@@ -78,4 +400,16 @@ extern "C" {
             *issecondescape = false;
         }
     }
+
+    std::int32_t querytrajectoryimpl(TrajectoryPyramid<double> const & trajectorypyramid, double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v)
+    {
+        auto const points = trajectorypyramid.query(tmin, tmax, static_cast<std::size_t>(npixels));
+        for (auto const & [tp, hp, vp] : points) {
+            *t++ = tp;
+            *h++ = hp;
+            *v++ = vp;
+        }
+
+        return static_cast<std::int32_t>(points.size());
+    }
 }
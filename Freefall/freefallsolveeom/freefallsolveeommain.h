@@ -16,15 +16,169 @@
 #endif
 
 #include "freefallsolveeom.h"
+#include "surrogate.h"
+#include "trajectorypyramid.h"
 #include <cstdint>              // for std::int32_t    
+#include <memory>               // for std::shared_ptr
+#include <mutex>                // for std::mutex
 #include <optional>		        // for std::optional
+#include <unordered_map>        // for std::unordered_map
+#include <vector>               // for std::vector
+
+namespace freefallsolveeom {
+    //! A typedef.
+    /*!
+        DLLが用いる、空気抵抗のある自由落下系に対して運動方程式を解くクラスの型
+        FREEFALLSOLVEEOM_DIAGNOSTICSを定義してビルドした場合は、ファイルに出力する各行に診断用の物理量の列が追加される
+    */
+#ifdef FREEFALLSOLVEEOM_DIAGNOSTICS
+    using FreefallSolveEomType = FreefallSolveEom<double, true>;
+#else
+    using FreefallSolveEomType = FreefallSolveEom<double>;
+#endif
+}
 
 extern "C" {
+    //! A global variable.
+    /*!
+        以降に生成するSolveEoMクラスのオブジェクトが用いる大気モデルへのポインタ
+        loadatmosphereと、createinstanceやinitが別のスレッドから同時に呼ばれてもよいように、必ずstd::atomic_load・std::atomic_storeを通して読み書きする
+    */
+    static std::shared_ptr<freefallsolveeom::Atmosphere const> patmosphere = freefallsolveeom::Atmosphere::getDefault();
+
     //! A global variable.
     /*!
         SolveEoMクラスのオブジェクトへのポインタ
     */
-    static std::optional<freefallsolveeom::FreefallSolveEom> pse;
+    static std::optional<freefallsolveeom::FreefallSolveEomType> pse;
+
+    //! A global variable.
+    /*!
+        createinstanceで生成した、ハンドルで区別されるSolveEoMクラスのオブジェクト（複数の条件を同時に解くために用いる）
+        ハンドルを指定する関数は呼び出しの間shared_ptrを保持するので、その間にdestroyinstanceを呼び出しても、破棄は呼び出しが終わるまで遅れる
+    */
+    static std::unordered_map<std::int32_t, std::shared_ptr<freefallsolveeom::FreefallSolveEomType>> instances;
+
+    //! A global variable.
+    /*!
+        enabletrajectorypyramidofを呼び出したハンドルごとの、nextstepofが返した点を記録する、解像度の異なる最小値・最大値の階層を持つオブジェクト
+        ハンドルを指定する関数は呼び出しの間shared_ptrを保持するので、その間にdestroyinstanceを呼び出しても、破棄は呼び出しが終わるまで遅れる
+    */
+    static std::unordered_map<std::int32_t, std::shared_ptr< freefallsolveeom::TrajectoryPyramid<double> > > instancetrajectorypyramids;
+
+    //! A global variable.
+    /*!
+        instances、instancetrajectorypyramidsとnexthandleを保護するミューテックス
+    */
+    static std::mutex instancesmutex;
+
+    //! A global variable.
+    /*!
+        次にcreateinstanceが返すハンドル
+    */
+    static std::int32_t nexthandle = 1;
+
+    //! A global variable.
+    /*!
+        previewで求めた軌道の概形（getpreviewpointsで取得する）
+    */
+    static std::vector< std::array<double, 3> > previewtrajectory;
+
+    //! A global variable.
+    /*!
+        nextstepが返した点を記録する、解像度の異なる最小値・最大値の階層を持つオブジェクト（enabletrajectorypyramidを呼び出していない場合はstd::nullopt）
+    */
+    static std::optional< freefallsolveeom::TrajectoryPyramid<double> > trajectorypyramid;
+
+    //! A global variable.
+    /*!
+        querysurrogateが用いる、パラメータスイープの結果ファイルを補間するクラスのオブジェクトへのポインタ
+        loadsurrogateとquerysurrogateが別のスレッドから同時に呼ばれてもよいように、必ずstd::atomic_load・std::atomic_storeを通して読み書きする
+        （querysurrogateは複製したポインタを通して補間するので、その間に読み込み直されても補間が終わるまで破棄されない）
+    */
+    static std::shared_ptr<freefallsolveeom::Surrogate const> psurrogate;
+
+    //! A global function.
+    /*!
+        空気抵抗のある自由落下系に対して運動方程式を解くクラスのオブジェクトを、pseとは別に生成する（CSVファイルに結果を出力しない）
+        返したハンドルを指定するnextstepof等は、ハンドルごとに別のスレッドから同時に呼び出してよい
+        ハンドルを指定する関数は、無効なハンドル（生成していないか、既に破棄したもの）を指定された場合は何もせずに-1を返す
+        \param dt 常微分方程式の数値解法の時間刻み（秒）
+        \param tintervalgraphplot グラフプロット用の時間間隔（秒）
+        \param eps 常微分方程式の数値解法の許容誤差
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param ode_solver_type 常微分方程式の数値解法
+        \return 生成したオブジェクトのハンドル
+    */
+    DLLEXPORT std::int32_t __stdcall createinstance(double dt, double tintervalgraphplot, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type);
+
+    //! A global function.
+    /*!
+        createinstanceで生成したオブジェクトを破棄する
+        \param handle オブジェクトのハンドル
+    */
+    DLLEXPORT void __stdcall destroyinstance(std::int32_t handle);
+
+    //! A global function.
+    /*!
+        以降のnextstepが、グラフを折れ線で描いた際の誤差が許容誤差を超える点だけを返すようにする（init系の関数の後、最初のnextstepより前に呼び出す）
+        直線に近い部分では点を間引き、曲がりの大きい部分ではtintervalgraphplot秒より細かく、時間刻みの間隔まで点を返す
+        \param reltol 高度と速度の、それまでの最大の絶対値に対する許容誤差
+        \param maxgap 返す点の時刻の最大の間隔（秒）
+    */
+    DLLEXPORT void __stdcall enableadaptivesampling(double reltol, double maxgap);
+
+    //! A global function.
+    /*!
+        enableadaptivesamplingの、createinstanceで生成したオブジェクトに対する版
+        \param handle オブジェクトのハンドル
+        \param reltol 高度と速度の、それまでの最大の絶対値に対する許容誤差
+        \param maxgap 返す点の時刻の最大の間隔（秒）
+        \return 成功した場合は0、ハンドルが無効な場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall enableadaptivesamplingof(std::int32_t handle, double reltol, double maxgap);
+
+    //! A global function.
+    /*!
+        以降の計算で、時間刻みごとの状態を補間の節点として記録するようにする（init系の関数の後、最初のnextstepより前に呼び出す）
+    */
+    DLLEXPORT void __stdcall enabledenseoutput();
+
+    //! A global function.
+    /*!
+        以降のnextstepが返す点を、解像度の異なる最小値・最大値の階層とともに記録するようにする（init系の関数の後、最初のnextstepより前に呼び出す）
+        記録した点はquerytrajectoryで取得する（古い点は一時ファイルに書き出すため、メモリの使用量は点の数によらず一定に収まる）
+    */
+    DLLEXPORT void __stdcall enabletrajectorypyramid();
+
+    //! A global function.
+    /*!
+        enabletrajectorypyramidの、createinstanceで生成したオブジェクトに対する版（以降のnextstepofが返す点を記録する）
+        記録した点はquerytrajectoryofで取得する
+        \param handle オブジェクトのハンドル
+        \return 成功した場合は0、ハンドルが無効な場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall enabletrajectorypyramidof(std::int32_t handle);
+
+    //! A global function.
+    /*!
+        以降の計算で、どの事象からも遠い区間では許容誤差をepsmaxまで緩めるようにする（init系の関数の後、最初のnextstepより前に呼び出す）
+        事象に近づくにつれて許容誤差は元に戻り、事象の時刻は元の許容誤差で求められる
+        \param epsmax 最も緩い許容誤差（init系の関数に渡した許容誤差以上）
+    */
+    DLLEXPORT void __stdcall enabletoleranceschedule(double epsmax);
+
+    //! A global function.
+    /*!
+        enabletolerancescheduleの、createinstanceで生成したオブジェクトに対する版
+        \param handle オブジェクトのハンドル
+        \param epsmax 最も緩い許容誤差（createinstanceに渡した許容誤差以上）
+        \return 成功した場合は0、ハンドルが無効な場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall enabletolerancescheduleof(std::int32_t handle, double epsmax);
 
     //! A global function.
     /*!
@@ -36,6 +190,28 @@ extern "C" {
     */
     DLLEXPORT void __stdcall getresult(double * thmax, double * hmax, double * tvmax, double * vmax);
 
+    //! A global function.
+    /*!
+        変分方程式を運動方程式と同時に初期状態から最後まで積分し、各事象の値とその感度を取得する
+        各配列の並びは、地面衝突時の時間、地面衝突時の速度、最高到達高度の際の時間、最高到達高度、最高速度の際の時間、
+        最高速度、カーマン・ライン突破時の時間、カーマン・ライン突破時の速度、外気圏脱出時の時間、外気圏脱出時の速度の順
+        \param value 各事象の値（要素数10の配列へのポインタ、返り値として使用）
+        \param grad 各事象の値の、球の質量m、球の半径r、初期高度h0、初期速度v0についての偏微分（要素数40の配列へのポインタ、返り値として使用）
+        \param isvalid 各事象が発生したかどうか（要素数10の配列へのポインタ、返り値として使用）
+    */
+    DLLEXPORT void __stdcall getsensitivity(double * value, double * grad, bool * isvalid);
+
+    //! A global function.
+    /*!
+        記録した軌道の補間から、複数の時刻の高度と速度を求める（時刻を昇順に並べると速い）
+        \param t 経過時間（秒）の配列へのポインタ
+        \param n 時刻の数
+        \param h 高度（m）の配列へのポインタ（返り値として使用）
+        \param v 速度（m/s）の配列へのポインタ（返り値として使用）
+        \return 補間が記録されていたかどうか（enabledenseoutputを呼び出していないか、まだ計算していない場合はfalse）
+    */
+    DLLEXPORT bool __stdcall getstatesat(double const * t, std::int32_t n, double * h, double * v);
+
     //! A global function.
     /*!
         空気抵抗のある自由落下系に対して運動方程式を解くクラスのコンストラクタ（CSVファイルに結果を出力しない）を呼び出す
@@ -66,6 +242,24 @@ extern "C" {
     */
     DLLEXPORT void __stdcall initofcsvoutput(double dt, double tintervalgraphplot, double tintervaloutputcsv, char const * csvfilename, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type);
 
+    //! A global function.
+    /*!
+        空気抵抗のある自由落下系に対して運動方程式を解くクラスのコンストラクタ（形式と圧縮の方法を指定してファイルに結果を出力する）を呼び出す
+        \param dt 常微分方程式の数値解法の時間刻み（秒）
+        \param tintervalgraphplot グラフプロット用の時間間隔（秒）
+        \param tintervaloutputcsv ファイル出力用の時間間隔（秒）
+        \param filename 出力するファイルのファイル名
+        \param format 出力する形式（0: CSV、1: バイナリ）
+        \param compression 圧縮の方法（0: 圧縮しない、1: gzip）
+        \param eps 常微分方程式の数値解法の許容誤差
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param ode_solver_type 常微分方程式の数値解法
+    */
+    DLLEXPORT void __stdcall initofstreamoutput(double dt, double tintervalgraphplot, double tintervaloutputcsv, char const * filename, std::int32_t format, std::int32_t compression, double eps, double m, double r, double h0, double v0, std::int32_t ode_solver_type);
+
     //! A global function.
     /*!
         計算が終了したかどうかを調べる
@@ -73,6 +267,40 @@ extern "C" {
     */
     DLLEXPORT std::int32_t __stdcall iscalculationfinished();
 
+    //! A global function.
+    /*!
+        iscalculationfinishedの、createinstanceで生成したオブジェクトに対する版
+        \param handle オブジェクトのハンドル
+        \return 計算が終了していれば1、していなければ0、ハンドルが無効な場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall iscalculationfinishedof(std::int32_t handle);
+
+    //! A global function.
+    /*!
+        initofcsvoutputまたはinitofstreamoutputで指定したファイルを開けなかったか、書き出しに失敗したかどうかを調べる
+        （失敗した時点で以降の書き出しは打ち切られ、計算はそのまま続けられる）
+        \return 書き出しに失敗したかどうか
+    */
+    DLLEXPORT std::int32_t __stdcall iswritefailed();
+
+    //! A global function.
+    /*!
+        以降に生成するSolveEoMクラスのオブジェクトが用いる高度80km以上の大気モデルをファイルから読み込む
+        ファイルは一行に「高度（m） 気圧（Pa） 温度（K）」を空白またはカンマ区切りで記述する
+        高度は86km以下から100km（カーマン・ライン）以上までを覆っていなければならない
+        \param filename 読み込むファイル名（nullptrの場合は既定の大気モデルに戻す）
+        \return 読み込みに成功したかどうか
+    */
+    DLLEXPORT bool __stdcall loadatmosphere(char const * filename);
+
+    //! A global function.
+    /*!
+        querysurrogateが補間に用いる、パラメータスイープの結果ファイル（freefallsweepが出力したもの）を読み込む
+        \param filename 読み込むファイル名（nullptrの場合は読み込んだ結果ファイルを閉じる）
+        \return 読み込みに成功したかどうか
+    */
+    DLLEXPORT bool __stdcall loadsurrogate(char const * filename);
+
     //! A global function.
     /*!
         空気抵抗のある自由落下系における運動方程式を与えられた時間だけ解き、状態を求める
@@ -95,6 +323,119 @@ extern "C" {
         \param issecondescape 外気圏を脱出した際に速度が第二宇宙速度以上だったかどうかへのポインタ（返り値として使用）
     */
     DLLEXPORT void __stdcall nextstep(double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape);
+
+    //! A global function.
+    /*!
+        nextstepの、createinstanceで生成したオブジェクトに対する版（引数はhandle以外nextstepと同じ）
+        \param handle オブジェクトのハンドル
+        \return 成功した場合は0、ハンドルが無効な場合は-1（引数の指す先には何も書き込まない）
+    */
+    DLLEXPORT std::int32_t __stdcall nextstepof(std::int32_t handle, double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape);
+
+    //! A global function.
+    /*!
+        init系の関数で指定した条件で、運動方程式を大きな時間刻みと緩い許容誤差で最後まで解き、軌道の概形と各事象の概算値を求める
+        nextstepによる精密な計算の結果が揃うまでの間の表示に用いる（nextstepの前後いずれに呼び出してもよい）
+        各配列の並びは、getsensitivityと同じ
+        \param value 各事象の概算値（要素数10の配列へのポインタ、返り値として使用）
+        \param isvalid 各事象が発生したかどうか（要素数10の配列へのポインタ、返り値として使用）
+        \return 軌道の概形の点の数（点はgetpreviewpointsで取得する）
+    */
+    DLLEXPORT std::int32_t __stdcall preview(double * value, bool * isvalid);
+
+    //! A global function.
+    /*!
+        previewで求めた軌道の概形の点を取得する
+        \param t 経過時間（秒）の配列へのポインタ（要素数はpreviewの返り値、返り値として使用）
+        \param h 高度（m）の配列へのポインタ（要素数はpreviewの返り値、返り値として使用）
+        \param v 速度（m/s）の配列へのポインタ（要素数はpreviewの返り値、返り値として使用）
+    */
+    DLLEXPORT void __stdcall getpreviewpoints(double * t, double * h, double * v);
+
+    //! A global function.
+    /*!
+        loadsurrogateで読み込んだ結果ファイルを補間して、運動方程式を解かずに各事象の近似値と誤差の見積もりを求める
+        格子の外の場合や、地面衝突時の時間と速度、最高到達高度、最高速度のいずれかの相対誤差の見積もりがmaxrelerrを超える場合は、
+        結果ファイルと同じ設定で運動方程式を解く
+        各配列の並びは、地面衝突時の時間、地面衝突時の速度、最高到達高度の際の時間、最高到達高度、最高速度の際の時間、最高速度、
+        カーマン・ライン突破時の時間、カーマン・ライン突破時の速度、外気圏脱出時の時間、外気圏脱出時の速度、第二宇宙速度以上だったかどうかの順
+        （事象が発生しなかった値はNaN）
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param maxrelerr 許容する相対誤差
+        \param value 各事象の値（要素数11の配列へのポインタ、返り値として使用）
+        \param error 各事象の値の誤差の見積もり（要素数11の配列へのポインタ、返り値として使用）
+        \return 補間で求めた場合は1、運動方程式を解いた場合は0、結果ファイルを読み込んでいない場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall querysurrogate(double m, double r, double h0, double v0, double maxrelerr, double * value, double * error);
+
+    //! A global function.
+    /*!
+        enabletrajectorypyramidの後にnextstepが返した点のうち、時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を取得する
+        範囲内の点が多い場合は、ピクセル数に見合う区間ごとの最初、最小、最大、最後の値に置き換えるため、点の数は記録した点の数によらない
+        nextstepと別のスレッドから同時に呼び出してよい（init系の関数やenabletrajectorypyramidと同時に呼び出してはならない）
+        \param tmin 範囲の最初の時刻（秒）
+        \param tmax 範囲の最後の時刻（秒）
+        \param npixels 横方向のピクセル数
+        \param t 経過時間（秒）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）
+        \param h 高度（m）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）
+        \param v 速度（m/s）の配列へのポインタ（要素数4 * npixels + 6、返り値として使用）
+        \return 取得した点の数（enabletrajectorypyramidを呼び出していない場合は0）
+    */
+    DLLEXPORT std::int32_t __stdcall querytrajectory(double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v);
+
+    //! A global function.
+    /*!
+        querytrajectoryの、createinstanceで生成したオブジェクトに対する版（引数はhandle以外querytrajectoryと同じ）
+        nextstepofと別のスレッドから同時に呼び出してよい
+        \param handle オブジェクトのハンドル
+        \return 取得した点の数（enabletrajectorypyramidofを呼び出していない場合は0）、ハンドルが無効な場合は-1
+    */
+    DLLEXPORT std::int32_t __stdcall querytrajectoryof(std::int32_t handle, double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v);
+}
+
+namespace freefallsolveeom {
+    //! A global variable (constant expression).
+    /*!
+        ハンドルを指定する関数が、無効なハンドルを指定された場合に返す値
+    */
+    static std::int32_t constexpr INVALIDHANDLE = -1;
+
+    //! A function.
+    /*!
+        createinstanceで生成したオブジェクトを、ハンドルから取得する
+        返したshared_ptrを保持している間は、destroyinstanceを呼び出されてもオブジェクトは破棄されない
+        \param handle オブジェクトのハンドル
+        \return オブジェクトへのポインタ（ハンドルが無効な場合はnullptr）
+    */
+    std::shared_ptr<FreefallSolveEomType> getinstance(std::int32_t handle);
+
+    //! A function.
+    /*!
+        enabletrajectorypyramidofで生成した、ハンドルごとの点を記録するオブジェクトを取得する
+        \param handle オブジェクトのハンドル
+        \return 点を記録するオブジェクトへのポインタ（ハンドルが無効か、enabletrajectorypyramidofを呼び出していない場合はnullptr）
+    */
+    std::shared_ptr< TrajectoryPyramid<double> > gettrajectorypyramid(std::int32_t handle);
+
+    //! A function.
+    /*!
+        オブジェクトの運動方程式を与えられた時間だけ解き、状態をnextstepの引数の形で返す
+        \param se 空気抵抗のある自由落下系に対して運動方程式を解くクラスのオブジェクト
+        \param t 以降の引数はnextstepと同じ
+    */
+    void nextstepimpl(FreefallSolveEomType & se, double * t, double * h, double * v, bool * ishmax, double * thmax, double * hmax, bool * isvmax, double * tvmax, double * hvmax, double * vmax, bool * iskarmanline, double * tkarmanline, double * vkarmanline, bool * isexosphere, double * texosphere, double * vexosphere, bool * issecondescape);
+
+    //! A function.
+    /*!
+        点を記録したオブジェクトから、時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を取得し、querytrajectoryの引数の形で返す
+        \param trajectorypyramid 点を記録したオブジェクト
+        \param tmin 以降の引数はquerytrajectoryと同じ
+        \return 取得した点の数
+    */
+    std::int32_t querytrajectoryimpl(TrajectoryPyramid<double> const & trajectorypyramid, double tmin, double tmax, std::int32_t npixels, double * t, double * h, double * v);
 }
 
 #endif  // _FREEFALLSOLVEEOMMAIN_H_
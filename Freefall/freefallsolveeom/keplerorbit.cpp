@@ -0,0 +1,215 @@
+﻿/*! \file keplerorbit.cpp
+    \brief 大気の無い領域での動径方向の二体問題の運動を解析的に解くクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "keplerorbit.h"
+#include "utility/referencetype.h"
+#include <cmath>                                // for std::acos, std::acosh, std::asinh, std::atan2, std::cos, std::cosh, std::fabs, std::floor, std::fmod, std::sin, std::sinh, std::sqrt
+#include <limits>                               // for std::numeric_limits
+#include <utility>                              // for std::make_pair
+#include <boost/math/constants/constants.hpp>   // for boost::math::constants::pi
+#include <boost/math/tools/roots.hpp>           // for boost::math::tools::newton_raphson_iterate
+
+namespace freefallsolveeom {
+    // #region コンストラクタ・デストラクタ
+
+    template <typename T>
+    KeplerOrbit<T>::KeplerOrbit(T mu, T l2, T r, T v) :
+        mu_(mu)
+    {
+        using std::asinh;
+        using std::atan2;
+        using std::fabs;
+        using std::sqrt;
+
+        // 比力学的エネルギー
+        auto const energy = 0.5 * v * v + 0.5 * l2 / (r * r) - mu / r;
+
+        // 放物線軌道に極めて近い場合は解析的に扱わない
+        if (fabs(energy) * r / mu < 1.0E-10)
+        {
+            return;
+        }
+
+        ishyperbolic_ = energy > 0.0;
+        a_ = 0.5 * mu / fabs(energy);
+        e_ = sqrt(1.0 + 2.0 * energy * l2 / (mu * mu));
+        n_ = sqrt(mu / (a_ * a_ * a_));
+
+        // 円軌道に極めて近い場合は解析的に扱わない
+        if (e_ < 1.0E-6)
+        {
+            return;
+        }
+
+        auto const sinE = r * v / (e_ * sqrt(mu * a_));
+        if (ishyperbolic_)
+        {
+            M0_ = meananomaly(asinh(sinE));
+        }
+        else
+        {
+            auto const cosE = (1.0 - r / a_) / e_;
+            M0_ = meananomaly(atan2(sinE, cosE));
+        }
+
+        isvalid_ = true;
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    template <typename T>
+    std::optional<T> KeplerOrbit<T>::apoapsis() const
+    {
+        return ishyperbolic_ ? std::nullopt : std::make_optional(a_ * (1.0 + e_));
+    }
+
+    template <typename T>
+    std::array<T, 2> KeplerOrbit<T>::operator()(T t) const
+    {
+        using std::cos;
+        using std::cosh;
+        using std::sin;
+        using std::sinh;
+        using std::sqrt;
+
+        auto const E = solvekeplerequation(M0_ + n_ * t);
+
+        if (ishyperbolic_)
+        {
+            auto const r = a_ * (e_ * cosh(E) - 1);
+            return { r, sqrt(mu_ * a_) * e_ * sinh(E) / r };
+        }
+        else
+        {
+            auto const r = a_ * (1 - e_ * cos(E));
+            return { r, sqrt(mu_ * a_) * e_ * sin(E) / r };
+        }
+    }
+
+    template <typename T>
+    std::optional<T> KeplerOrbit<T>::timetoapoapsis() const
+    {
+        using std::fmod;
+
+        if (ishyperbolic_)
+        {
+            return std::nullopt;
+        }
+
+        auto const twopi = boost::math::constants::two_pi<T>();
+        auto const dM = fmod(boost::math::constants::pi<T>() - M0_, twopi);
+        return std::make_optional((dM < 0.0 ? dM + twopi : dM) / n_);
+    }
+
+    template <typename T>
+    std::optional<T> KeplerOrbit<T>::timetoradius(T r, bool ascending) const
+    {
+        using std::acos;
+        using std::acosh;
+        using std::fmod;
+
+        if (ishyperbolic_)
+        {
+            auto const coshH = (r / a_ + 1.0) / e_;
+            if (coshH < 1.0)
+            {
+                return std::nullopt;
+            }
+
+            auto const H = ascending ? acosh(coshH) : -acosh(coshH);
+            auto const dt = (meananomaly(H) - M0_) / n_;
+
+            return dt >= 0.0 ? std::make_optional(dt) : std::nullopt;
+        }
+
+        auto const cosE = (1.0 - r / a_) / e_;
+        if (cosE < -1.0 || cosE > 1.0)
+        {
+            return std::nullopt;
+        }
+
+        auto const E = ascending ? acos(cosE) : -acos(cosE);
+        auto const twopi = boost::math::constants::two_pi<T>();
+        auto const dM = fmod(meananomaly(E) - M0_, twopi);
+
+        return std::make_optional((dM < 0.0 ? dM + twopi : dM) / n_);
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    T KeplerOrbit<T>::meananomaly(T E) const
+    {
+        using std::sin;
+        using std::sinh;
+
+        return ishyperbolic_ ? e_ * sinh(E) - E : E - e_ * sin(E);
+    }
+
+    template <typename T>
+    T KeplerOrbit<T>::solvekeplerequation(T M) const
+    {
+        using std::asinh;
+        using std::cos;
+        using std::cosh;
+        using std::fabs;
+        using std::floor;
+        using std::sin;
+        using std::sinh;
+
+        using namespace boost::math::tools;
+
+        auto constexpr DIGITS = std::numeric_limits<T>::digits;
+
+        if (ishyperbolic_)
+        {
+            // e sinh H - H = M の解は asinh(M/e) ≦ |H| ≦ asinh(M/(e - 1)) の範囲にある
+            auto const lower = asinh(fabs(M) / e_);
+            auto const upper = asinh(fabs(M) / (e_ - 1));
+            auto const H = newton_raphson_iterate(
+                [this, M](T H)
+            {
+                return std::make_pair(e_ * sinh(H) - H - fabs(M), e_ * cosh(H) - 1.0);
+            },
+                (lower + upper) / 2,
+                lower,
+                upper,
+                DIGITS);
+
+            return M < 0.0 ? -H : H;
+        }
+
+        // E - e sin E = M の解は |E - M| ≦ e の範囲にある
+        auto const twopi = boost::math::constants::two_pi<T>();
+        auto const turns = floor(M / twopi);
+        auto const Mnorm = M - turns * twopi;
+        auto const E = newton_raphson_iterate(
+            [this, Mnorm](T E)
+        {
+            return std::make_pair(E - e_ * sin(E) - Mnorm, 1.0 - e_ * cos(E));
+        },
+            Mnorm < boost::math::constants::pi<T>() ? Mnorm + e_ / 2 : Mnorm - e_ / 2,
+            Mnorm - e_,
+            Mnorm + e_,
+            DIGITS);
+
+        return E + turns * twopi;
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class KeplerOrbit<float>;
+    template class KeplerOrbit<double>;
+    template class KeplerOrbit<referencetype>;
+
+    // #endregion templateクラスの実体化
+}
@@ -0,0 +1,177 @@
+﻿/*! \file keplerorbit.h
+    \brief 大気の無い領域での動径方向の二体問題の運動を解析的に解くクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _KEPLERORBIT_H_
+#define _KEPLERORBIT_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <optional>     // for std::optional
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        動径方向の運動方程式 d²r/dt² = -μ/r² + L²/r³ を、ケプラー方程式を用いて解析的に解くクラス
+        \tparam T 浮動小数点数の型
+    */
+    template <typename T>
+    class KeplerOrbit final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            初期状態から軌道要素を求めるコンストラクタ
+            \param mu 地心重力定数GM（m³s¯²）
+            \param l2 角運動量Lの2乗を質量mの2乗で割った定数（m⁴s¯²）
+            \param r 地球中心からの距離（m）
+            \param v 動径方向の速度（m/s）
+        */
+        KeplerOrbit(T mu, T l2, T r, T v);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~KeplerOrbit() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function (const).
+        /*!
+            軌道が解析的に扱えるかどうか（放物線軌道や円軌道に極めて近い場合はfalse）
+            \return 軌道が解析的に扱えるかどうか
+        */
+        bool isValid() const
+        {
+            return isvalid_;
+        }
+
+        //! A public member function (const).
+        /*!
+            遠点（最高到達点）の地球中心からの距離を返す（双曲線軌道の場合はstd::nullopt）
+            \return 遠点の地球中心からの距離（m）
+        */
+        std::optional<T> apoapsis() const;
+
+        //! A public member function (const).
+        /*!
+            初期状態からt秒後の状態を返す
+            \param t 初期状態からの経過時間（秒）
+            \return 地球中心からの距離（m）と速度（m/s）が格納されたstd::array
+        */
+        std::array<T, 2> operator()(T t) const;
+
+        //! A public member function (const).
+        /*!
+            初期状態から、次に遠点に達するまでの時間を返す（双曲線軌道の場合はstd::nullopt）
+            \return 遠点に達するまでの時間（秒）
+        */
+        std::optional<T> timetoapoapsis() const;
+
+        //! A public member function (const).
+        /*!
+            初期状態から、次に地球中心からの距離がrになるまでの時間を返す（到達しない場合はstd::nullopt）
+            \param r 地球中心からの距離（m）
+            \param ascending 上昇中に通過する時刻を求めるならtrue、下降中ならfalse
+            \return 地球中心からの距離がrになるまでの時間（秒）
+        */
+        std::optional<T> timetoradius(T r, bool ascending) const;
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function (const).
+        /*!
+            平均近点角Mから離心近点角E（双曲線軌道の場合はH）を求める
+            \param M 平均近点角
+            \return 離心近点角
+        */
+        T solvekeplerequation(T M) const;
+
+        //! A private member function (const).
+        /*!
+            離心近点角E（双曲線軌道の場合はH）から平均近点角Mを求める
+            \param E 離心近点角
+            \return 平均近点角
+        */
+        T meananomaly(T E) const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            軌道長半径（m、双曲線軌道の場合は正の値で保持する）
+        */
+        T a_ = 0.0;
+
+        //! A private member variable.
+        /*!
+            離心率
+        */
+        T e_ = 0.0;
+
+        //! A private member variable.
+        /*!
+            双曲線軌道かどうか
+        */
+        bool ishyperbolic_ = false;
+
+        //! A private member variable.
+        /*!
+            軌道が解析的に扱えるかどうか
+        */
+        bool isvalid_ = false;
+
+        //! A private member variable.
+        /*!
+            初期状態での平均近点角
+        */
+        T M0_ = 0.0;
+
+        //! A private member variable (constant).
+        /*!
+            地心重力定数GM（m³s¯²）
+        */
+        T const mu_;
+
+        //! A private member variable.
+        /*!
+            平均運動（rad/s）
+        */
+        T n_ = 0.0;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        KeplerOrbit() = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        KeplerOrbit & operator=(KeplerOrbit const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _KEPLERORBIT_H_
@@ -0,0 +1,132 @@
+﻿/*! \file parareal.cpp
+    \brief パラレアル法で、自律系の常微分方程式の初期値問題を時間方向に並列に解くクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "parareal.h"
+#include "utility/referencetype.h"
+#include <algorithm>            // for std::max, std::min
+#include <atomic>               // for std::atomic
+#include <cmath>                // for std::fabs, std::isfinite
+#include <thread>               // for std::thread
+
+namespace freefallsolveeom {
+    // #region publicメンバ関数
+
+    template <typename T>
+    std::vector<typename Parareal<T>::statetype> Parareal<T>::operator()(Parareal::statetype const & x0, std::size_t nslices)
+    {
+        using std::fabs;
+        using std::isfinite;
+        using std::max;
+
+        // 成分が全て有限で、精密な伝播を始めてよい状態かどうか
+        auto const isvalid = [this](Parareal::statetype const & x)
+        {
+            for (auto const & xi : x) {
+                if (!isfinite(xi))
+                {
+                    return false;
+                }
+            }
+
+            return isvalid_(x);
+        };
+
+        // 粗い伝播による最初の予測（coarse[k]は、u[k]を粗い伝播で進めた状態）
+        std::vector<Parareal::statetype> u(nslices + 1), coarse(nslices);
+        u[0] = x0;
+        for (std::size_t k = 0; k < nslices; k++) {
+            coarse[k] = u[k];
+            coarse_(k, coarse[k]);
+            u[k + 1] = coarse[k];
+        }
+
+        iterations_ = 0;
+        for (std::size_t first = 0; first < nslices; first++) {
+            // 粗い伝播が発散した始点からは、精密な伝播を始めない
+            for (auto k = first; k < nslices; k++) {
+                if (!isvalid(u[k]))
+                {
+                    return std::vector<Parareal::statetype>();
+                }
+            }
+
+            // 始点が確定していないスライスを、精密な伝播で並列に進める
+            std::vector<Parareal::statetype> fine(nslices + 1);
+            propagatefine(first, nslices, u, fine);
+            iterations_++;
+
+            // 修正を先頭から順に伝える（u[k + 1] = G(u[k]) + F(u[k]の古い値) - G(u[k]の古い値)）
+            // 最初のスライスの始点は確定しているので、その精密な伝播の結果がそのまま終点になる
+            T err = 0;
+            for (auto k = first; k < nslices; k++) {
+                auto g = u[k];
+                if (k == first)
+                {
+                    g = coarse[k];
+                }
+                else
+                {
+                    coarse_(k, g);
+                }
+
+                for (auto i = 0U; i < g.size(); i++) {
+                    auto const next = g[i] + fine[k + 1][i] - coarse[k][i];
+                    err = max(err, T(fabs(next - u[k + 1][i]) / (eps_ * (1 + fabs(next)))));
+                    u[k + 1][i] = next;
+                }
+
+                coarse[k] = g;
+            }
+
+            if (err <= 1)
+            {
+                break;
+            }
+        }
+
+        return u;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    void Parareal<T>::propagatefine(std::size_t first, std::size_t last, std::vector<Parareal::statetype> const & x, std::vector<Parareal::statetype> & fine) const
+    {
+        // 各スレッドは、まだ誰も取っていないスライスを一つずつ取って進める
+        std::atomic<std::size_t> next(first);
+        auto const work = [&fine, &next, last, &x, this]()
+        {
+            for (auto k = next++; k < last; k = next++) {
+                fine[k + 1] = x[k];
+                fine_(k, fine[k + 1]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        auto const nthreads = std::min(static_cast<std::size_t>(std::max(nthreads_, 1U)), last - first);
+        for (std::size_t i = 1; i < nthreads; i++) {
+            threads.emplace_back(work);
+        }
+
+        work();
+
+        for (auto & th : threads) {
+            th.join();
+        }
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class Parareal<float>;
+    template class Parareal<double>;
+    template class Parareal<referencetype>;
+
+    // #endregion templateクラスの実体化
+}
@@ -0,0 +1,187 @@
+﻿/*! \file parareal.h
+    \brief パラレアル法で、自律系の常微分方程式の初期値問題を時間方向に並列に解くクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _PARAREAL_H_
+#define _PARAREAL_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <cstddef>      // for std::size_t
+#include <cstdint>      // for std::int32_t, std::uint32_t
+#include <functional>   // for std::function
+#include <utility>      // for std::move
+#include <vector>       // for std::vector
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        区間を同じ長さのスライスに分割し、安価な粗い伝播で各スライスの始点の状態を予測した後、
+        精密な伝播を全てのスライスで並列に行って予測を修正することを、修正量が許容誤差に収まるまで繰り返すクラス
+        k回目の修正で最初のk個のスライスは精密な解に一致するので、反復はスライスの数以下で必ず終わる
+        \tparam T 浮動小数点数の型
+    */
+    template <typename T>
+    class Parareal final {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            位置と速度のstd::arrayの型
+        */
+        using statetype = std::array<T, 2>;
+
+        //! A typedef.
+        /*!
+            k番目のスライスの始点の状態を、そのスライスの終点まで進める関数の型（複数のスレッドから同時に呼び出される）
+        */
+        using propagatortype = std::function<void(std::size_t, statetype &)>;
+
+        //! A typedef.
+        /*!
+            状態が、精密な伝播を始めてよい（粗い伝播が発散していない）ものかどうかを返す関数の型
+        */
+        using validatortype = std::function<bool(statetype const &)>;
+
+        // #endregion 型エイリアス
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param coarse 粗い伝播
+            \param fine 精密な伝播
+            \param isvalid 状態が精密な伝播を始めてよいものかどうかを返す関数（成分が有限でない状態は、この関数によらず始めてはならないとみなす）
+            \param eps 収束の判定に用いる許容誤差（各成分の修正量がeps * (1 + |成分|)以下になれば収束とみなす）
+            \param nthreads 精密な伝播を行うスレッドの数
+        */
+        Parareal(Parareal::propagatortype coarse, Parareal::propagatortype fine, Parareal::validatortype isvalid, T eps, std::uint32_t nthreads) :
+            coarse_(std::move(coarse)),
+            eps_(eps),
+            fine_(std::move(fine)),
+            isvalid_(std::move(isvalid)),
+            nthreads_(nthreads)
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Parareal() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function (const).
+        /*!
+            直前のoperator()の呼び出しで、精密な伝播を行った回数を返す
+            \return 反復の回数
+        */
+        std::int32_t iterations() const
+        {
+            return iterations_;
+        }
+
+        //! A public member function.
+        /*!
+            初期状態から、nslices個のスライスの終点の状態を求める
+            精密な伝播を始める前に、まだ確定していないスライスの始点の状態のいずれかが精密な伝播を始めてはならないものであれば、
+            そこで打ち切って空のstd::vectorを返す（呼び出し側は、その区間を逐次的に積分し直す）
+            \param x0 初期状態
+            \param nslices スライスの数
+            \return 各スライスの始点と最後のスライスの終点の状態（要素数nslices + 1）（打ち切った場合は空）
+        */
+        std::vector<Parareal::statetype> operator()(Parareal::statetype const & x0, std::size_t nslices);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function (const).
+        /*!
+            [first, last)の番号のスライスの始点の状態を、精密な伝播で並列に進める
+            \param first 最初のスライスの番号
+            \param last 最後のスライスの次の番号
+            \param x 各スライスの始点の状態
+            \param fine 各スライスの終点の状態（k番目のスライスの終点をk + 1番目の要素に格納する）（返り値として使用）
+        */
+        void propagatefine(std::size_t first, std::size_t last, std::vector<Parareal::statetype> const & x, std::vector<Parareal::statetype> & fine) const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable (constant).
+        /*!
+            粗い伝播
+        */
+        Parareal::propagatortype const coarse_;
+
+        //! A private member variable (constant).
+        /*!
+            収束の判定に用いる許容誤差
+        */
+        T const eps_;
+
+        //! A private member variable (constant).
+        /*!
+            精密な伝播
+        */
+        Parareal::propagatortype const fine_;
+
+        //! A private member variable (constant).
+        /*!
+            状態が精密な伝播を始めてよいものかどうかを返す関数
+        */
+        Parareal::validatortype const isvalid_;
+
+        //! A private member variable.
+        /*!
+            直前のoperator()の呼び出しで、精密な伝播を行った回数
+        */
+        std::int32_t iterations_ = 0;
+
+        //! A private member variable (constant).
+        /*!
+            精密な伝播を行うスレッドの数
+        */
+        std::uint32_t const nthreads_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Parareal() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        Parareal(Parareal const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        Parareal & operator=(Parareal const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _PARAREAL_H_
@@ -0,0 +1,277 @@
+﻿/*! \file rosenbrock4.h
+    \brief ステップごとにヒープの確保を行わない、4次のRosenbrock法のステッパークラスの宣言と実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _ROSENBROCK4_H_
+#define _ROSENBROCK4_H_
+
+#pragma once
+
+#include <cstddef>                                  // for std::size_t
+#include <boost/numeric/odeint.hpp>                 // for boost::numeric::odeint
+#include <boost/numeric/ublas/lu.hpp>               // for boost::numeric::ublas::lu_factorize, boost::numeric::ublas::lu_substitute
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        Boost.Odeintのrosenbrock4と同じ係数で一ステップ進める、4次のRosenbrock法のステッパークラス
+        rosenbrock4::do_step()は、行列 I / (γ dt) - J をublasの式テンプレートの加算で作るため、ステップごとに一時的な行列を確保するので、
+        その行列を作業領域の上で要素ごとに作ることで、ステップごとのヒープの確保をなくす
+        （rosenbrock4_controllerは、ステッパーの型を通してdo_step()を呼び出すので、そのまま誤差の制御に用いることができる）
+        （NDEBUGを定義しない場合は、ublasのLU分解が型の検査のために行列を複製するので、この限りではない）
+        \tparam Value 浮動小数点数の型
+    */
+    template <typename Value>
+    class Rosenbrock4 final : public boost::numeric::odeint::rosenbrock4<Value> {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            基底クラスの型
+        */
+        using base_type = boost::numeric::odeint::rosenbrock4<Value>;
+
+        //! A typedef.
+        /*!
+            状態の型
+        */
+        using state_type = typename base_type::state_type;
+
+        //! A typedef.
+        /*!
+            ヤコビアンの型
+        */
+        using matrix_type = typename base_type::matrix_type;
+
+        //! A typedef.
+        /*!
+            LU分解の置換行列の型
+        */
+        using pmatrix_type = typename base_type::pmatrix_type;
+
+        // #endregion 型エイリアス
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            デフォルトコンストラクタ（作業領域はadjust_size()か最初のステップで確保する）
+        */
+        Rosenbrock4() = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Rosenbrock4() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            作業領域を、状態xと同じ大きさに確保する
+            \param x 状態
+        */
+        void adjust_size(state_type const & x);
+
+        //! A public member function.
+        /*!
+            状態xから時間刻みdtで一ステップ進め、進めた状態と誤差の見積もりを求める
+            \param system 常微分方程式の右辺とヤコビアンを求める関数のstd::pair（またはその参照のラッパー）
+            \param x 状態
+            \param t 時刻
+            \param xout 進めた状態（返り値として使用）
+            \param dt 時間刻み
+            \param xerr 誤差の見積もり（返り値として使用）
+        */
+        template <typename System>
+        void do_step(System system, state_type const & x, Value t, state_type & xout, Value dt, state_type & xerr);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable (constant).
+        /*!
+            Rosenbrock法の係数
+        */
+        typename base_type::rosenbrock_coefficients const coef_;
+
+        //! A private member variable.
+        /*!
+            時間についての偏微分
+        */
+        state_type dfdt_;
+
+        //! A private member variable.
+        /*!
+            ステップの開始時の状態の微分
+        */
+        state_type dxdt_;
+
+        //! A private member variable.
+        /*!
+            途中の段の状態の微分
+        */
+        state_type dxdtnew_;
+
+        //! A private member variable.
+        /*!
+            各段の増分
+        */
+        state_type g1_, g2_, g3_, g4_, g5_;
+
+        //! A private member variable.
+        /*!
+            ヤコビアンと、それから作った行列 I / (γ dt) - J のLU分解
+        */
+        matrix_type jac_;
+
+        //! A private member variable.
+        /*!
+            LU分解の置換行列
+        */
+        pmatrix_type pm_ = pmatrix_type(0);
+
+        //! A private member variable.
+        /*!
+            途中の段の状態
+        */
+        state_type xtmp_;
+
+        // #endregion メンバ変数
+    };
+
+    // #region publicメンバ関数
+
+    template <typename Value>
+    void Rosenbrock4<Value>::adjust_size(state_type const & x)
+    {
+        base_type::adjust_size(x);
+
+        auto const n = x.size();
+        if (jac_.size1() == n)
+        {
+            return;
+        }
+
+        for (auto p : { &dfdt_, &dxdt_, &dxdtnew_, &g1_, &g2_, &g3_, &g4_, &g5_, &xtmp_ }) {
+            p->resize(n, false);
+        }
+
+        jac_.resize(n, n, false);
+        pm_ = pmatrix_type(n);
+    }
+
+    template <typename Value>
+    template <typename System>
+    void Rosenbrock4<Value>::do_step(System system, state_type const & x, Value t, state_type & xout, Value dt, state_type & xerr)
+    {
+        using namespace boost::numeric::ublas;
+
+        typename boost::numeric::odeint::unwrap_reference<System>::type & sys = system;
+        auto & derivfunc = sys.first;
+        auto & jacobifunc = sys.second;
+
+        auto const n = x.size();
+        if (jac_.size1() != n)
+        {
+            adjust_size(x);
+        }
+
+        for (std::size_t i = 0; i < n; i++) {
+            pm_(i) = i;
+        }
+
+        derivfunc(x, dxdt_, t);
+        jacobifunc(x, jac_, t, dfdt_);
+
+        // I / (γ dt) - J を、一時的な行列を作らずに要素ごとに作る
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = 0; j < n; j++) {
+                jac_(i, j) = -jac_(i, j);
+            }
+
+            jac_(i, i) += 1.0 / coef_.gamma / dt;
+        }
+
+        lu_factorize(jac_, pm_);
+
+        // 以下は、rosenbrock4::do_step()と同じ
+        for (std::size_t i = 0; i < n; i++) {
+            g1_[i] = dxdt_[i] + dt * coef_.d1 * dfdt_[i];
+        }
+
+        lu_substitute(jac_, pm_, g1_);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xtmp_[i] = x[i] + coef_.a21 * g1_[i];
+        }
+
+        derivfunc(xtmp_, dxdtnew_, t + coef_.c2 * dt);
+        for (std::size_t i = 0; i < n; i++) {
+            g2_[i] = dxdtnew_[i] + dt * coef_.d2 * dfdt_[i] + coef_.c21 * g1_[i] / dt;
+        }
+
+        lu_substitute(jac_, pm_, g2_);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xtmp_[i] = x[i] + coef_.a31 * g1_[i] + coef_.a32 * g2_[i];
+        }
+
+        derivfunc(xtmp_, dxdtnew_, t + coef_.c3 * dt);
+        for (std::size_t i = 0; i < n; i++) {
+            g3_[i] = dxdtnew_[i] + dt * coef_.d3 * dfdt_[i] + (coef_.c31 * g1_[i] + coef_.c32 * g2_[i]) / dt;
+        }
+
+        lu_substitute(jac_, pm_, g3_);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xtmp_[i] = x[i] + coef_.a41 * g1_[i] + coef_.a42 * g2_[i] + coef_.a43 * g3_[i];
+        }
+
+        derivfunc(xtmp_, dxdtnew_, t + coef_.c4 * dt);
+        for (std::size_t i = 0; i < n; i++) {
+            g4_[i] = dxdtnew_[i] + dt * coef_.d4 * dfdt_[i] + (coef_.c41 * g1_[i] + coef_.c42 * g2_[i] + coef_.c43 * g3_[i]) / dt;
+        }
+
+        lu_substitute(jac_, pm_, g4_);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xtmp_[i] = x[i] + coef_.a51 * g1_[i] + coef_.a52 * g2_[i] + coef_.a53 * g3_[i] + coef_.a54 * g4_[i];
+        }
+
+        derivfunc(xtmp_, dxdtnew_, t + dt);
+        for (std::size_t i = 0; i < n; i++) {
+            g5_[i] = dxdtnew_[i] + (coef_.c51 * g1_[i] + coef_.c52 * g2_[i] + coef_.c53 * g3_[i] + coef_.c54 * g4_[i]) / dt;
+        }
+
+        lu_substitute(jac_, pm_, g5_);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xtmp_[i] += g5_[i];
+        }
+
+        derivfunc(xtmp_, dxdtnew_, t + dt);
+        for (std::size_t i = 0; i < n; i++) {
+            xerr[i] = dxdtnew_[i] + (coef_.c61 * g1_[i] + coef_.c62 * g2_[i] + coef_.c63 * g3_[i] + coef_.c64 * g4_[i] + coef_.c65 * g5_[i]) / dt;
+        }
+
+        lu_substitute(jac_, pm_, xerr);
+
+        for (std::size_t i = 0; i < n; i++) {
+            xout[i] = xtmp_[i] + xerr[i];
+        }
+    }
+
+    // #endregion publicメンバ関数
+}
+
+#endif  // _ROSENBROCK4_H_
@@ -0,0 +1,70 @@
+﻿/*! \file samplerange.cpp
+    \brief 時刻、高度、速度を一つずつ必要になった時点で求める、一度だけ走査できる範囲のクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "samplerange.h"
+#include "utility/referencetype.h"
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    // #region publicメンバ関数
+
+    template <typename T>
+    typename SampleRange<T>::iterator SampleRange<T>::begin()
+    {
+        return next() ? SampleRange::iterator(this) : SampleRange::iterator();
+    }
+
+    template <typename T>
+    SampleRange<T> SampleRange<T>::stride(std::size_t n) &&
+    {
+        BOOST_ASSERT(n > 0);
+
+        return SampleRange([generator = std::move(generator_), n, skip = std::size_t(0)](SampleRange::sampletype & sample) mutable {
+            // 直前に返した要素の後のn - 1個を、次の要素が必要になった時点で読み飛ばす
+            for (; skip > 0; skip--) {
+                if (!generator(sample))
+                {
+                    return false;
+                }
+            }
+
+            skip = n - 1;
+
+            return generator(sample);
+        });
+    }
+
+    template <typename T>
+    SampleRange<T> SampleRange<T>::takewhile(SampleRange::predicatetype pred) &&
+    {
+        return SampleRange([generator = std::move(generator_), pred = std::move(pred)](SampleRange::sampletype & sample) mutable {
+            return generator(sample) && pred(sample);
+        });
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    bool SampleRange<T>::next()
+    {
+        // 一度要素が無くなった後は、元の関数を呼び出さない
+        finished_ = finished_ || !generator_(current_);
+
+        return !finished_;
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class SampleRange<float>;
+    template class SampleRange<double>;
+    template class SampleRange<referencetype>;
+
+    // #endregion templateクラスの実体化
+}
@@ -0,0 +1,343 @@
+﻿/*! \file samplerange.h
+    \brief 時刻、高度、速度を一つずつ必要になった時点で求める、一度だけ走査できる範囲のクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SAMPLERANGE_H_
+#define _SAMPLERANGE_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <cstddef>      // for std::ptrdiff_t, std::size_t
+#include <functional>   // for std::function
+#include <iterator>     // for std::input_iterator_tag
+#include <utility>      // for std::move
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        次の要素を求める関数を、イテレータを進めた時点で初めて呼び出す、一度だけ走査できる範囲のクラス
+        範囲for文やstd::find_ifなどのアルゴリズムで走査でき、途中でループを抜ければ以降の要素は求めない
+        stride()とtakewhile()は、元の範囲を消費して、同じく必要になった時点で要素を求める新たな範囲を返す
+        \tparam T 浮動小数点数の型
+    */
+    template <typename T>
+    class SampleRange final {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            時刻（秒）、高度（m）、速度（m/s）のstd::arrayの型
+        */
+        using sampletype = std::array<T, 3>;
+
+        //! A typedef.
+        /*!
+            次の要素を引数に格納し、要素があったかどうかを返す関数の型（falseを返した後は呼び出されない）
+        */
+        using generatortype = std::function<bool(sampletype &)>;
+
+        //! A typedef.
+        /*!
+            takewhile()に与える、要素を受け取り、走査を続けるかどうかを返す関数の型
+        */
+        using predicatetype = std::function<bool(sampletype const &)>;
+
+        // #endregion 型エイリアス
+
+        //! A class.
+        /*!
+            SampleRangeの入力イテレータ（終端のイテレータは範囲を指さない）
+        */
+        class iterator final {
+            // #region 型エイリアス
+
+        public:
+            //! A typedef.
+            /*!
+                イテレータの種類
+            */
+            using iterator_category = std::input_iterator_tag;
+
+            //! A typedef.
+            /*!
+                要素の型
+            */
+            using value_type = sampletype;
+
+            //! A typedef.
+            /*!
+                イテレータの差の型
+            */
+            using difference_type = std::ptrdiff_t;
+
+            //! A typedef.
+            /*!
+                要素へのポインタの型
+            */
+            using pointer = sampletype const *;
+
+            //! A typedef.
+            /*!
+                要素への参照の型
+            */
+            using reference = sampletype const &;
+
+            // #endregion 型エイリアス
+
+            //! A struct.
+            /*!
+                後置インクリメントが返す、進める前の要素を保持する構造体（*it++で進める前の要素を得るために用いる）
+            */
+            struct postincrementtype {
+                //! A public member function (const).
+                /*!
+                    進める前の要素を返す
+                    \return 進める前の要素
+                */
+                sampletype const & operator*() const
+                {
+                    return sample;
+                }
+
+                //! A public member variable.
+                /*!
+                    進める前の要素
+                */
+                sampletype sample;
+            };
+
+            // #region コンストラクタ
+
+            //! A constructor.
+            /*!
+                終端のイテレータを構築するコンストラクタ
+            */
+            iterator() = default;
+
+            //! A constructor.
+            /*!
+                範囲の現在の要素を指すイテレータを構築するコンストラクタ
+                \param range 範囲
+            */
+            explicit iterator(SampleRange * range) : range_(range)
+            {
+            }
+
+            // #endregion コンストラクタ
+
+            // #region 演算子
+
+            //! A public member function (const).
+            /*!
+                現在の要素を返す（次にイテレータを進めるまで有効）
+                \return 現在の要素
+            */
+            reference operator*() const
+            {
+                return range_->current_;
+            }
+
+            //! A public member function (const).
+            /*!
+                現在の要素へのポインタを返す（次にイテレータを進めるまで有効）
+                \return 現在の要素へのポインタ
+            */
+            pointer operator->() const
+            {
+                return &range_->current_;
+            }
+
+            //! A public member function.
+            /*!
+                次の要素を求める（要素が無くなった場合は終端のイテレータになる）
+                \return このイテレータ
+            */
+            iterator & operator++()
+            {
+                if (!range_->next())
+                {
+                    range_ = nullptr;
+                }
+
+                return *this;
+            }
+
+            //! A public member function.
+            /*!
+                次の要素を求め、進める前の要素を返す
+                \return 進める前の要素を保持するオブジェクト
+            */
+            postincrementtype operator++(int)
+            {
+                postincrementtype const before = { range_->current_ };
+                ++*this;
+
+                return before;
+            }
+
+            //! A public member function (const).
+            /*!
+                二つのイテレータが等しいかどうかを返す（どちらも終端か、どちらも同じ範囲を指す場合に等しい）
+                \param other もう一方のイテレータ
+                \return 二つのイテレータが等しいかどうか
+            */
+            bool operator==(iterator const & other) const
+            {
+                return range_ == other.range_;
+            }
+
+            //! A public member function (const).
+            /*!
+                二つのイテレータが等しくないかどうかを返す
+                \param other もう一方のイテレータ
+                \return 二つのイテレータが等しくないかどうか
+            */
+            bool operator!=(iterator const & other) const
+            {
+                return range_ != other.range_;
+            }
+
+            // #endregion 演算子
+
+        private:
+            // #region メンバ変数
+
+            //! A private member variable.
+            /*!
+                イテレータが指す範囲（終端のイテレータの場合はnullptr）
+            */
+            SampleRange * range_ = nullptr;
+
+            // #endregion メンバ変数
+        };
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param generator 次の要素を求める関数
+        */
+        explicit SampleRange(SampleRange::generatortype generator) : generator_(std::move(generator))
+        {
+        }
+
+        //! A move constructor.
+        /*!
+            デフォルトムーブコンストラクタ（走査を始めた後にムーブしてはならない）
+        */
+        SampleRange(SampleRange &&) = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~SampleRange() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            最初の要素を求め、それを指すイテレータを返す（一度だけ呼び出せる）
+            \return 最初の要素を指すイテレータ（要素が無い場合は終端のイテレータ）
+        */
+        SampleRange::iterator begin();
+
+        //! A public member function (const).
+        /*!
+            終端のイテレータを返す
+            \return 終端のイテレータ
+        */
+        SampleRange::iterator end() const
+        {
+            return SampleRange::iterator();
+        }
+
+        //! A public member function.
+        /*!
+            この範囲を消費して、最初の要素から数えてn個おきの要素（0番目、n番目、2n番目、…）だけを返す範囲を返す
+            読み飛ばす要素は、次の要素が必要になった時点で求める
+            \param n 要素の間隔（1以上）
+            \return n個おきの要素を返す範囲
+        */
+        SampleRange stride(std::size_t n) &&;
+
+        //! A public member function.
+        /*!
+            この範囲を消費して、predがtrueを返す間だけ要素を返す範囲を返す
+            predが初めてfalseを返した要素は返さず、それ以降の要素も求めない
+            \param pred 要素を受け取り、走査を続けるかどうかを返す関数
+            \return predがtrueを返す間だけ要素を返す範囲
+        */
+        SampleRange takewhile(SampleRange::predicatetype pred) &&;
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function.
+        /*!
+            次の要素を求めてcurrent_に格納する
+            \return 要素があったかどうか
+        */
+        bool next();
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            現在の要素
+        */
+        SampleRange::sampletype current_;
+
+        //! A private member variable.
+        /*!
+            要素が無くなったかどうか
+        */
+        bool finished_ = false;
+
+        //! A private member variable.
+        /*!
+            次の要素を求める関数
+        */
+        SampleRange::generatortype generator_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        SampleRange() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        SampleRange(SampleRange const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        SampleRange & operator=(SampleRange const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SAMPLERANGE_H_
@@ -0,0 +1,54 @@
+﻿/*! \file solvesummary.cpp
+    \brief 格子の設定を用いて一つの条件の運動方程式を解き、結果ファイルの列の値を求める関数の実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "solvesummary.h"
+#include <limits>       // for std::numeric_limits
+#include <tuple>        // for std::get
+
+namespace freefallsolveeom {
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        グラフプロット用の時間間隔（秒）（途中の状態を返さないsummary()を用いるので、数値解法の自動切り替えの間隔だけを決める）
+    */
+    static auto constexpr TINTERVAL = 10.0;
+
+    // #endregion 定数
+
+    // #region 関数の定義
+
+    std::array<double, SweepResultFile::NCOLUMNS> solvesummary(SweepGrid const & grid, std::array<double, 4> const & params)
+    {
+        using FreefallSolveEom = FreefallSolveEom<>;
+
+        auto const [m, r, h0, v0] = params;
+        FreefallSolveEom fse(grid.dt, TINTERVAL, grid.eps, m, r, h0, v0, static_cast<FreefallSolveEom::Ode_Solver_type>(grid.ode_solver_type));
+
+        return tocolumns(fse.summary());
+    }
+
+    std::array<double, SweepResultFile::NCOLUMNS> tocolumns(FreefallSolveEom<>::summarytype const & summary)
+    {
+        auto const & [impact, hmax, vmax, karmanline, exosphere] = summary;
+        auto constexpr NaN = std::numeric_limits<double>::quiet_NaN();
+
+        return {
+            impact ? impact->first : NaN,
+            impact ? impact->second : NaN,
+            hmax ? hmax->first : NaN,
+            hmax ? hmax->second : NaN,
+            vmax ? std::get<0>(*vmax) : NaN,
+            vmax ? std::get<2>(*vmax) : NaN,
+            karmanline ? karmanline->first : NaN,
+            karmanline ? karmanline->second : NaN,
+            exosphere ? std::get<0>(*exosphere) : NaN,
+            exosphere ? std::get<1>(*exosphere) : NaN,
+            exosphere ? (std::get<2>(*exosphere) ? 1.0 : 0.0) : NaN };
+    }
+
+    // #endregion 関数の定義
+}
@@ -0,0 +1,38 @@
+﻿/*! \file solvesummary.h
+    \brief 格子の設定を用いて一つの条件の運動方程式を解き、結果ファイルの列の値を求める関数の宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SOLVESUMMARY_H_
+#define _SOLVESUMMARY_H_
+
+#pragma once
+
+#include "freefallsolveeom.h"
+#include "sweepresultfile.h"
+#include <array>        // for std::array
+
+namespace freefallsolveeom {
+    //! A function.
+    /*!
+        格子に共通する設定（時間刻み、許容誤差、数値解法）を用いて運動方程式を最後まで解き、結果ファイルに書き込む各列の値を返す
+        事象が発生しなかった値はNaNとなる
+        \param grid パラメータスイープの格子
+        \param params 球の質量m、球の半径r、初期高度h0、初期速度v0
+        \return 各列の値
+    */
+    std::array<double, SweepResultFile::NCOLUMNS> solvesummary(SweepGrid const & grid, std::array<double, 4> const & params);
+
+    //! A function.
+    /*!
+        計算が終了した際の各事象の値を、結果ファイルに書き込む各列の値に並べ替える
+        事象が発生しなかった値はNaNとなる
+        \param summary 計算が終了した際の各事象の値
+        \return 各列の値
+    */
+    std::array<double, SweepResultFile::NCOLUMNS> tocolumns(FreefallSolveEom<>::summarytype const & summary);
+}
+
+#endif  // _SOLVESUMMARY_H_
@@ -0,0 +1,272 @@
+﻿/*! \file surrogate.cpp
+    \brief パラメータスイープの結果ファイルを補間して、運動方程式を解かずに近似的な結果を返すクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "surrogate.h"
+#include "solvesummary.h"
+#include <algorithm>    // for std::all_of, std::clamp, std::max, std::min
+#include <cmath>        // for std::fabs, std::isnan
+#include <cstdint>      // for std::uint64_t
+#include <limits>       // for std::numeric_limits
+
+namespace freefallsolveeom {
+    //! A struct.
+    /*!
+        一つの軸上での問い合わせの位置を表す構造体
+    */
+    struct AxisPosition {
+        //! A public member variable.
+        /*!
+            問い合わせの位置の左側の点の番号
+        */
+        std::uint64_t lo;
+
+        //! A public member variable.
+        /*!
+            左側の点から右側の点までのうち、問い合わせの位置までの割合（0～1）
+        */
+        double s;
+    };
+
+    // #region 関数の宣言
+
+    //! A function.
+    /*!
+        軸上での問い合わせの位置を求める
+        \param axis パラメータの軸
+        \param x 問い合わせの値
+        \return 問い合わせの位置（軸の範囲外の場合はstd::nullopt）
+    */
+    std::optional<AxisPosition> locate(SweepAxis const & axis, double x);
+
+    // #endregion 関数の宣言
+
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        格子の点と同じ値とみなす相対的な幅（格子の点での問い合わせの丸め誤差を吸収する）
+    */
+    static auto constexpr SNAP = 1.0E-12;
+
+    //! A global variable (constant expression).
+    /*!
+        許容する相対誤差を調べる列（地面衝突時の時間と速度、最高到達高度、最高速度）
+    */
+    static std::array<SweepResultFile::Column, 4> constexpr KEYCOLUMNS = {
+        SweepResultFile::Column::TIMPACT,
+        SweepResultFile::Column::VIMPACT,
+        SweepResultFile::Column::HMAX,
+        SweepResultFile::Column::VMAX };
+
+    // #endregion 定数
+
+    // #region コンストラクタ
+
+    Surrogate::Surrogate(std::unique_ptr<SweepResultFile const> && result) :
+        result_(std::move(result))
+    {
+    }
+
+    // #endregion コンストラクタ
+
+    // #region publicメンバ関数
+
+    std::unique_ptr<Surrogate> Surrogate::load(std::string const & filename)
+    {
+        auto result = SweepResultFile::open(filename, true);
+        if (!result)
+        {
+            return nullptr;
+        }
+
+        return std::make_unique<Surrogate>(std::move(result));
+    }
+
+    std::optional< std::pair<Surrogate::valuetype, Surrogate::valuetype> > Surrogate::interpolate(std::array<double, 4> const & params) const
+    {
+        auto const & grid = result_->grid();
+        std::array<SweepAxis const *, 4> const axes = { &grid.m, &grid.r, &grid.h0, &grid.v0 };
+
+        std::array<AxisPosition, 4> pos;
+        for (auto k = 0U; k < 4; k++) {
+            auto const p = locate(*axes[k], params[k]);
+            if (!p)
+            {
+                return std::nullopt;
+            }
+
+            pos[k] = *p;
+        }
+
+        // 周囲の16点の値を多重線形補間する（重みが0の点は読まないので、点が一つしかない軸や格子の点上の問い合わせでは読む点が減る）
+        valuetype value{}, error{};
+        std::array<std::uint32_t, SweepResultFile::NCOLUMNS> nnan{};
+        auto ncorners = 0U;
+        for (auto corner = 0U; corner < 16; corner++) {
+            auto w = 1.0;
+            std::array<std::uint64_t, 4> idx;
+            for (auto k = 0U; k < 4; k++) {
+                auto const upper = (corner >> k) & 1U;
+                w *= upper ? pos[k].s : 1.0 - pos[k].s;
+                idx[k] = pos[k].lo + upper;
+            }
+
+            if (w == 0.0)
+            {
+                continue;
+            }
+
+            auto const i = grid.index(idx[0], idx[1], idx[2], idx[3]);
+            if (!result_->isdone(i))
+            {
+                return std::nullopt;
+            }
+
+            ncorners++;
+            for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+                auto const y = result_->column(static_cast<SweepResultFile::Column>(j))[i];
+                if (std::isnan(y))
+                {
+                    nnan[j]++;
+                }
+                else
+                {
+                    value[j] += w * y;
+                }
+            }
+        }
+
+        // 各軸について、補間に用いた各点を通る軸方向の二階差分fi-1 - 2fi + fi+1（区間の両端で取る）の最大値から、
+        // 線形補間の誤差 s(1 - s) / 2 × |f''|h^2 を見積もる（最大値を取るのは、事象が切り替わる折れ目を見逃さないため）
+        auto constexpr INF = std::numeric_limits<double>::infinity();
+        for (auto k = 0U; k < 4; k++) {
+            auto const s = pos[k].s;
+            if (s == 0.0 || s == 1.0)
+            {
+                continue;
+            }
+
+            // 二階差分を取れない軸では誤差を見積もれない
+            if (axes[k]->n < 3)
+            {
+                error.fill(INF);
+                break;
+            }
+
+            valuetype d2max{};
+            for (auto corner = 0U; corner < 16; corner++) {
+                std::array<std::uint64_t, 4> idx;
+                auto skip = false;
+                for (auto l = 0U; l < 4; l++) {
+                    auto const upper = (corner >> l) & 1U;
+                    skip = skip || (upper ? pos[l].s : 1.0 - pos[l].s) == 0.0;
+                    idx[l] = pos[l].lo + upper;
+                }
+
+                if (skip)
+                {
+                    continue;
+                }
+
+                idx[k] = std::clamp(idx[k], static_cast<std::uint64_t>(1), axes[k]->n - 2);
+
+                std::array<std::uint64_t, 3> i;
+                for (auto d = 0U; d < 3; d++) {
+                    auto neighbor = idx;
+                    neighbor[k] = idx[k] + d - 1;
+                    i[d] = grid.index(neighbor[0], neighbor[1], neighbor[2], neighbor[3]);
+                }
+
+                if (!result_->isdone(i[0]) || !result_->isdone(i[1]) || !result_->isdone(i[2]))
+                {
+                    d2max.fill(INF);
+                    break;
+                }
+
+                for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+                    auto const y = result_->column(static_cast<SweepResultFile::Column>(j));
+                    auto const d2 = std::fabs(y[i[0]] - 2.0 * y[i[1]] + y[i[2]]);
+                    d2max[j] = std::isnan(d2) ? INF : std::max(d2max[j], d2);
+                }
+            }
+
+            for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+                error[j] += 0.5 * s * (1.0 - s) * d2max[j];
+            }
+        }
+
+        // 周囲の全ての点で事象が発生しなかった場合は、確かに発生しないとみなす
+        // 一部の点でだけ発生しなかった場合は、事象が発生するかどうかの境界をまたいでいるので、値は分からない
+        for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+            if (nnan[j])
+            {
+                value[j] = std::numeric_limits<double>::quiet_NaN();
+                error[j] = nnan[j] == ncorners ? 0.0 : INF;
+            }
+        }
+
+        return std::make_optional(std::make_pair(value, error));
+    }
+
+    Surrogate::resulttype Surrogate::operator()(std::array<double, 4> const & params, double maxrelerr) const
+    {
+        if (auto const interpolated = interpolate(params))
+        {
+            auto const & [value, error] = *interpolated;
+            auto const accurate = std::all_of(KEYCOLUMNS.begin(), KEYCOLUMNS.end(), [&value = value, &error = error, maxrelerr](auto column) {
+                auto const j = static_cast<std::size_t>(column);
+                return std::isnan(value[j]) ? error[j] == 0.0 : error[j] <= maxrelerr * std::fabs(value[j]);
+            });
+
+            if (accurate)
+            {
+                return { value, error, true };
+            }
+        }
+
+        return { solvesummary(result_->grid(), params), valuetype{}, false };
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region 関数の定義
+
+    std::optional<AxisPosition> locate(SweepAxis const & axis, double x)
+    {
+        auto const tolerance = SNAP * std::max(std::max(std::fabs(axis.first), std::fabs(axis.last)), 1.0);
+
+        if (axis.n == 1 || axis.first == axis.last)
+        {
+            return std::fabs(x - axis.first) <= tolerance ? std::make_optional(AxisPosition{ 0, 0.0 }) : std::nullopt;
+        }
+
+        // NaNの問い合わせも範囲外とする
+        auto const lower = std::min(axis.first, axis.last), upper = std::max(axis.first, axis.last);
+        if (!(x >= lower - tolerance && x <= upper + tolerance))
+        {
+            return std::nullopt;
+        }
+
+        auto const umax = static_cast<double>(axis.n - 1);
+        auto const u = std::clamp((x - axis.first) / (axis.last - axis.first) * umax, 0.0, umax);
+        auto const lo = std::min(static_cast<std::uint64_t>(u), axis.n - 2);
+        auto s = u - static_cast<double>(lo);
+
+        // 格子の点上の問い合わせでは誤差を0とするため、丸め誤差の分だけずれた位置を格子の点に揃える
+        if (s < SNAP * umax)
+        {
+            s = 0.0;
+        }
+        else if (s > 1.0 - SNAP * umax)
+        {
+            s = 1.0;
+        }
+
+        return std::make_optional(AxisPosition{ lo, s });
+    }
+
+    // #endregion 関数の定義
+}
@@ -0,0 +1,162 @@
+﻿/*! \file surrogate.h
+    \brief パラメータスイープの結果ファイルを補間して、運動方程式を解かずに近似的な結果を返すクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SURROGATE_H_
+#define _SURROGATE_H_
+
+#pragma once
+
+#include "sweepresultfile.h"
+#include <array>        // for std::array
+#include <memory>       // for std::unique_ptr
+#include <optional>     // for std::optional
+#include <string>       // for std::string
+#include <utility>      // for std::pair
+
+namespace freefallsolveeom {
+    //! A class.
+    /*!
+        パラメータスイープの結果ファイルを、球の質量m、球の半径r、初期高度h0、初期速度v0について多重線形補間して、
+        運動方程式を解かずに近似的な結果とその誤差の見積もりを返すクラス
+        誤差は、各軸について最も近い格子点での二階差分から見積もった線形補間の誤差の和とする
+        格子の外の問い合わせや、見積もった誤差が閾値を超える問い合わせは、格子と同じ設定で運動方程式を解いて答える
+    */
+    class Surrogate final {
+    public:
+        // #region 型エイリアス
+
+        //! A typedef.
+        /*!
+            結果ファイルの各列の値の型
+        */
+        using valuetype = std::array<double, SweepResultFile::NCOLUMNS>;
+
+        // #endregion 型エイリアス
+
+        // #region 構造体
+
+        //! A struct.
+        /*!
+            問い合わせの結果を表す構造体
+        */
+        struct resulttype {
+            //! A public member variable.
+            /*!
+                各列の値（事象が発生しなかった値はNaN）
+            */
+            valuetype value;
+
+            //! A public member variable.
+            /*!
+                各列の値の誤差の見積もり（運動方程式を解いた場合は0）
+            */
+            valuetype error;
+
+            //! A public member variable.
+            /*!
+                補間で答えたかどうか（falseの場合は運動方程式を解いた）
+            */
+            bool issurrogate;
+        };
+
+        // #endregion 構造体
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param result 補間に用いる結果ファイル
+        */
+        explicit Surrogate(std::unique_ptr<SweepResultFile const> && result);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Surrogate() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public static member function.
+        /*!
+            結果ファイルを読み込み専用で開き、補間に用いる
+            \param filename 結果ファイルのファイル名
+            \return このクラスのオブジェクトへのstd::unique_ptr（ファイルが存在しないか、結果ファイルでない場合はnullptr）
+        */
+        static std::unique_ptr<Surrogate> load(std::string const & filename);
+
+        //! A public member function (const).
+        /*!
+            格子の点の値を多重線形補間し、各列の値とその誤差の見積もりを返す
+            \param params 球の質量m、球の半径r、初期高度h0、初期速度v0
+            \return 各列の値と誤差の見積もり（格子の外であるか、補間に用いる実行が未完了の場合はstd::nullopt）
+        */
+        std::optional< std::pair<valuetype, valuetype> > interpolate(std::array<double, 4> const & params) const;
+
+        //! A public member function (const).
+        /*!
+            補間に用いる結果ファイルの格子を返す
+            \return パラメータスイープの格子
+        */
+        SweepGrid const & grid() const
+        {
+            return result_->grid();
+        }
+
+        //! A public member function (const).
+        /*!
+            補間で問い合わせに答え、地面衝突時の時間と速度、最高到達高度、最高速度のいずれかの相対誤差の見積もりが
+            maxrelerrを超える場合や、格子の外の場合は、格子と同じ設定で運動方程式を解いて答える
+            \param params 球の質量m、球の半径r、初期高度h0、初期速度v0
+            \param maxrelerr 許容する相対誤差
+            \return 問い合わせの結果
+        */
+        resulttype operator()(std::array<double, 4> const & params, double maxrelerr) const;
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable (constant).
+        /*!
+            補間に用いる結果ファイル
+        */
+        std::unique_ptr<SweepResultFile const> const result_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        Surrogate() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        Surrogate(Surrogate const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        Surrogate & operator=(Surrogate const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SURROGATE_H_
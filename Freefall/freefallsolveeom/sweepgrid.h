@@ -0,0 +1,144 @@
+﻿/*! \file sweepgrid.h
+    \brief パラメータスイープの格子を表す構造体の宣言と定義
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SWEEPGRID_H_
+#define _SWEEPGRID_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <cstdint>      // for std::int32_t, std::uint64_t
+
+namespace freefallsolveeom {
+    //! A struct.
+    /*!
+        パラメータの一つの軸（firstからlastまでをn等分した点の列）を表す構造体
+    */
+    struct SweepAxis {
+        //! A public member variable.
+        /*!
+            最初の値
+        */
+        double first;
+
+        //! A public member variable.
+        /*!
+            最後の値
+        */
+        double last;
+
+        //! A public member variable.
+        /*!
+            点の数
+        */
+        std::uint64_t n;
+
+        //! A public member function (const).
+        /*!
+            i番目の点の値を返す
+            \param i 点の番号
+            \return i番目の点の値
+        */
+        double operator[](std::uint64_t i) const
+        {
+            return n > 1 ? first + (last - first) * static_cast<double>(i) / static_cast<double>(n - 1) : first;
+        }
+    };
+
+    //! A struct.
+    /*!
+        球の質量m、球の半径r、初期高度h0、初期速度v0の格子と、全ての実行に共通する設定を表す構造体
+        結果ファイルのヘッダにそのまま書き込まれるため、トリビアルにコピー可能でなければならない
+    */
+    struct SweepGrid {
+        //! A public member variable.
+        /*!
+            球の質量（kg）の軸
+        */
+        SweepAxis m;
+
+        //! A public member variable.
+        /*!
+            球の半径（m）の軸
+        */
+        SweepAxis r;
+
+        //! A public member variable.
+        /*!
+            初期高度（m）の軸
+        */
+        SweepAxis h0;
+
+        //! A public member variable.
+        /*!
+            初期速度（m/s）の軸
+        */
+        SweepAxis v0;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法の時間刻み（秒）
+        */
+        double dt;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法の許容誤差
+        */
+        double eps;
+
+        //! A public member variable.
+        /*!
+            常微分方程式の数値解法（FreefallSolveEom::Ode_Solver_typeの値）
+        */
+        std::int32_t ode_solver_type;
+
+        //! A public member function (const).
+        /*!
+            各軸の点の番号から、実行の番号を返す（operator[]の逆）
+            \param im 球の質量の軸の点の番号
+            \param ir 球の半径の軸の点の番号
+            \param ih0 初期高度の軸の点の番号
+            \param iv0 初期速度の軸の点の番号
+            \return 実行の番号
+        */
+        std::uint64_t index(std::uint64_t im, std::uint64_t ir, std::uint64_t ih0, std::uint64_t iv0) const
+        {
+            return ((im * r.n + ir) * h0.n + ih0) * v0.n + iv0;
+        }
+
+        //! A public member function (const).
+        /*!
+            格子の点の総数（実行の総数）を返す
+            \return 格子の点の総数
+        */
+        std::uint64_t size() const
+        {
+            return m.n * r.n * h0.n * v0.n;
+        }
+
+        //! A public member function (const).
+        /*!
+            i番目の実行のパラメータを返す（v0が最も速く変化する順に並ぶ）
+            \param i 実行の番号
+            \return m、r、h0、v0が格納されたstd::array
+        */
+        std::array<double, 4> operator[](std::uint64_t i) const
+        {
+            auto const iv0 = i % v0.n;
+            i /= v0.n;
+            auto const ih0 = i % h0.n;
+            i /= h0.n;
+            auto const ir = i % r.n;
+            i /= r.n;
+
+            return { m[i], r[ir], h0[ih0], v0[iv0] };
+        }
+    };
+}
+
+#endif  // _SWEEPGRID_H_
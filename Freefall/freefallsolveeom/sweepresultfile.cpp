@@ -0,0 +1,127 @@
+﻿/*! \file sweepresultfile.cpp
+    \brief パラメータスイープの結果を格納する、メモリマップされた列指向のファイルのクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "sweepresultfile.h"
+#include <algorithm>            // for std::equal
+#include <atomic>               // for std::atomic_thread_fence
+#include <cstring>              // for std::memcpy
+#include <fstream>              // for std::ifstream, std::ofstream
+#include <type_traits>          // for std::is_trivially_copyable_v
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    static_assert(std::is_trivially_copyable_v<SweepGrid>, "SweepGridはトリビアルにコピー可能でなければならない");
+
+    // #region コンストラクタ・デストラクタ
+
+    SweepResultFile::SweepResultFile(std::string const & filename, bool readonly) :
+        file_(filename.c_str(), readonly ? boost::interprocess::read_only : boost::interprocess::read_write),
+        readonly_(readonly),
+        region_(file_, readonly ? boost::interprocess::read_only : boost::interprocess::read_write)
+    {
+        auto const base = static_cast<char *>(region_.get_address());
+
+        grid_ = reinterpret_cast<SweepGrid const *>(base + sizeof(SweepResultFile::MAGIC));
+        nruns_ = grid_->size();
+        columns_ = reinterpret_cast<double *>(base + SweepResultFile::HEADERSIZE);
+        status_ = reinterpret_cast<std::uint8_t *>(columns_ + SweepResultFile::NCOLUMNS * nruns_);
+
+        BOOST_ASSERT(region_.get_size() == SweepResultFile::filesize(nruns_));
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    bool SweepResultFile::create(std::string const & filename, SweepGrid const & grid)
+    {
+        static_assert(sizeof(SweepResultFile::MAGIC) + sizeof(SweepGrid) <= SweepResultFile::HEADERSIZE, "ヘッダの中身がHEADERSIZEを超えている");
+
+        std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+        if (!ofs || !grid.size())
+        {
+            return false;
+        }
+
+        std::array<char, SweepResultFile::HEADERSIZE> header{};
+        std::memcpy(header.data(), SweepResultFile::MAGIC.data(), sizeof(SweepResultFile::MAGIC));
+        std::memcpy(header.data() + sizeof(SweepResultFile::MAGIC), &grid, sizeof(SweepGrid));
+        ofs.write(header.data(), header.size());
+
+        // 最後の1バイトを書き込んで領域を確保する（間の領域と、全ての実行の完了フラグは0になる）
+        ofs.seekp(static_cast<std::streamoff>(SweepResultFile::filesize(grid.size()) - 1));
+        ofs.put('\0');
+
+        return static_cast<bool>(ofs);
+    }
+
+    std::unique_ptr<SweepResultFile> SweepResultFile::open(std::string const & filename, bool readonly)
+    {
+        std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+        if (!ifs)
+        {
+            return nullptr;
+        }
+
+        auto const size = static_cast<std::uint64_t>(ifs.tellg());
+        if (size < SweepResultFile::HEADERSIZE)
+        {
+            return nullptr;
+        }
+
+        ifs.seekg(0);
+        std::array<char, sizeof(SweepResultFile::MAGIC)> magic;
+        SweepGrid grid;
+        ifs.read(magic.data(), magic.size());
+        ifs.read(reinterpret_cast<char *>(&grid), sizeof(SweepGrid));
+
+        if (!ifs ||
+            !std::equal(magic.begin(), magic.end(), SweepResultFile::MAGIC.begin()) ||
+            size != SweepResultFile::filesize(grid.size()))
+        {
+            return nullptr;
+        }
+
+        return std::make_unique<SweepResultFile>(filename, readonly);
+    }
+
+    bool SweepResultFile::isdone(std::uint64_t i) const
+    {
+        BOOST_ASSERT(i < nruns_);
+
+        auto const done = status_[i] != 0;
+
+        // 完了フラグを読んだ後に値を読む
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return done;
+    }
+
+    void SweepResultFile::store(std::uint64_t i, std::array<double, SweepResultFile::NCOLUMNS> const & values)
+    {
+        BOOST_ASSERT(i < nruns_);
+        BOOST_ASSERT(!readonly_);
+
+        for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+            columns_[j * nruns_ + i] = values[j];
+        }
+
+        // 値を書き込んだ後に完了フラグを立てる（途中でプロセスが落ちた場合、その実行は未完了のまま残る）
+        std::atomic_thread_fence(std::memory_order_release);
+        status_[i] = 1;
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    std::uint64_t SweepResultFile::filesize(std::uint64_t nruns)
+    {
+        return SweepResultFile::HEADERSIZE + (sizeof(double) * SweepResultFile::NCOLUMNS + sizeof(std::uint8_t)) * nruns;
+    }
+
+    // #endregion privateメンバ関数
+}
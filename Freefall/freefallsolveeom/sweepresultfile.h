@@ -0,0 +1,268 @@
+﻿/*! \file sweepresultfile.h
+    \brief パラメータスイープの結果を格納する、メモリマップされた列指向のファイルのクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _SWEEPRESULTFILE_H_
+#define _SWEEPRESULTFILE_H_
+
+#pragma once
+
+#include "sweepgrid.h"
+#include <array>                                    // for std::array
+#include <cstddef>                                  // for std::size_t
+#include <cstdint>                                  // for std::int32_t, std::uint8_t, std::uint64_t
+#include <memory>                                   // for std::unique_ptr
+#include <string>                                   // for std::string
+#include <boost/interprocess/file_mapping.hpp>      // for boost::interprocess::file_mapping
+#include <boost/interprocess/mapped_region.hpp>     // for boost::interprocess::mapped_region
+
+namespace freefallsolveeom {
+    //! A class.
+    /*!
+        パラメータスイープの結果を格納する、メモリマップされた列指向のファイルのクラス
+        ファイルは、ヘッダ（HEADERSIZEバイト）、各列（実行の総数個のdouble）、各実行が完了したかどうか（実行の総数個のバイト）の順に並ぶ
+        各実行の結果は固定の位置に書き込まれるため、複数のプロセスが同じファイルの異なる実行に同時に書き込んでもよく、
+        マージのためのコピーは必要ない（事象が発生しなかった値はNaNとなる）
+    */
+    class SweepResultFile final {
+    public:
+        // #region 列挙型
+
+        //! A enumerated type
+        /*!
+            結果の列
+        */
+        enum class Column : std::int32_t {
+            // 地面に衝突した際の時間（秒）
+            TIMPACT = 0,
+            // 地面に衝突した際の速度（m/s）
+            VIMPACT = 1,
+            // 最高到達高度の際の時間（秒）
+            THMAX = 2,
+            // 最高到達高度（m）
+            HMAX = 3,
+            // 最高速度の際の時間（秒）
+            TVMAX = 4,
+            // 最高速度（m/s）
+            VMAX = 5,
+            // カーマン・ラインを突破した際の時間（秒）
+            TKARMANLINE = 6,
+            // カーマン・ラインを突破した際の速度（m/s）
+            VKARMANLINE = 7,
+            // 外気圏を脱出した際の時間（秒）
+            TEXOSPHERE = 8,
+            // 外気圏を脱出した際の速度（m/s）
+            VEXOSPHERE = 9,
+            // 外気圏を脱出した際に第二宇宙速度以上だったかどうか（1または0）
+            SECONDESCAPE = 10
+        };
+
+        // #endregion 列挙型
+
+        // #region 定数
+
+        //! A public static member variable (constant expression).
+        /*!
+            結果の列の数
+        */
+        static std::size_t constexpr NCOLUMNS = 11;
+
+        // #endregion 定数
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            既存の結果ファイルをメモリにマップするコンストラクタ
+            \param filename 結果ファイルのファイル名
+            \param readonly 読み込み専用でマップするかどうか（trueの場合はstore()を呼び出してはならない）
+        */
+        SweepResultFile(std::string const & filename, bool readonly);
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~SweepResultFile() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public static member function.
+        /*!
+            格子の大きさに合わせて領域を確保した結果ファイルを新たに作成する（全ての実行は未完了となる）
+            \param filename 作成するファイルのファイル名
+            \param grid パラメータスイープの格子
+            \return 作成に成功したかどうか
+        */
+        static bool create(std::string const & filename, SweepGrid const & grid);
+
+        //! A public static member function.
+        /*!
+            既存の結果ファイルを開く
+            \param filename 結果ファイルのファイル名
+            \param readonly 読み込み専用で開くかどうか
+            \return 結果ファイルへのstd::unique_ptr（ファイルが存在しないか、結果ファイルでない場合はnullptr）
+        */
+        static std::unique_ptr<SweepResultFile> open(std::string const & filename, bool readonly = false);
+
+        //! A public member function (const).
+        /*!
+            列の先頭へのポインタを返す（コピーせずに、全ての実行の結果をそのまま参照できる）
+            \param column 列
+            \return 列の先頭へのポインタ
+        */
+        double const * column(SweepResultFile::Column column) const
+        {
+            return columns_ + static_cast<std::size_t>(column) * nruns_;
+        }
+
+        //! A public member function.
+        /*!
+            変更をファイルに書き出す
+        */
+        void flush()
+        {
+            region_.flush();
+        }
+
+        //! A public member function (const).
+        /*!
+            パラメータスイープの格子を返す
+            \return パラメータスイープの格子
+        */
+        SweepGrid const & grid() const
+        {
+            return *grid_;
+        }
+
+        //! A public member function (const).
+        /*!
+            i番目の実行が完了しているかどうかを返す
+            \param i 実行の番号
+            \return i番目の実行が完了しているかどうか
+        */
+        bool isdone(std::uint64_t i) const;
+
+        //! A public member function (const).
+        /*!
+            実行の総数を返す
+            \return 実行の総数
+        */
+        std::uint64_t nruns() const
+        {
+            return nruns_;
+        }
+
+        //! A public member function.
+        /*!
+            i番目の実行の結果を書き込み、完了したことを記録する
+            \param i 実行の番号
+            \param values 各列の値
+        */
+        void store(std::uint64_t i, std::array<double, SweepResultFile::NCOLUMNS> const & values);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private static member function.
+        /*!
+            実行の総数に対する、ファイル全体の大きさを返す
+            \param nruns 実行の総数
+            \return ファイル全体の大きさ（バイト）
+        */
+        static std::uint64_t filesize(std::uint64_t nruns);
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private static member variable (constant expression).
+        /*!
+            ヘッダの大きさ（バイト）（列の先頭をページ境界に揃えるため、ヘッダの中身より大きく取る）
+        */
+        static std::size_t constexpr HEADERSIZE = 4096;
+
+        //! A private static member variable (constant expression).
+        /*!
+            ファイルの先頭に書き込まれる識別子
+        */
+        static std::array<char, 8> constexpr MAGIC = { 'F', 'F', 'S', 'W', 'E', 'E', 'P', '1' };
+
+        //! A private member variable.
+        /*!
+            列の先頭へのポインタ
+        */
+        double * columns_;
+
+        //! A private member variable.
+        /*!
+            ファイルのマッピング
+        */
+        boost::interprocess::file_mapping file_;
+
+        //! A private member variable.
+        /*!
+            ヘッダ中の格子へのポインタ
+        */
+        SweepGrid const * grid_;
+
+        //! A private member variable.
+        /*!
+            実行の総数
+        */
+        std::uint64_t nruns_;
+
+        //! A private member variable (constant).
+        /*!
+            読み込み専用でマップしたかどうか
+        */
+        bool const readonly_;
+
+        //! A private member variable.
+        /*!
+            マップされた領域
+        */
+        boost::interprocess::mapped_region region_;
+
+        //! A private member variable.
+        /*!
+            各実行が完了したかどうかの列の先頭へのポインタ
+        */
+        std::uint8_t * status_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        SweepResultFile() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        SweepResultFile(SweepResultFile const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        SweepResultFile & operator=(SweepResultFile const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _SWEEPRESULTFILE_H_
@@ -0,0 +1,338 @@
+﻿/*! \file trajectorypyramid.cpp
+    \brief 軌道の点を、解像度の異なる最小値・最大値の階層とともに、チャンクに分けて記録するクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "trajectorypyramid.h"
+#include <algorithm>                                // for std::max, std::min
+#include <atomic>                                   // for std::atomic
+#include <cstdio>                                   // for std::remove
+#include <type_traits>                              // for std::is_trivially_copyable_v
+#include <boost/assert.hpp>                         // for BOOST_ASSERT
+#include <boost/filesystem/operations.hpp>          // for boost::filesystem::temp_directory_path, boost::filesystem::unique_path
+#include <boost/interprocess/file_mapping.hpp>      // for boost::interprocess::file_mapping
+
+namespace freefallsolveeom {
+    // #region コンストラクタ・デストラクタ
+
+    template <typename T>
+    TrajectoryPyramid<T>::TrajectoryPyramid() :
+        filenamebase_((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("freefalltrajectory-%%%%-%%%%-%%%%-%%%%")).string()),
+        samples_(filenamebase_ + ".0")
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Tはトリビアルにコピー可能でなければならない");
+    }
+
+    template <typename T>
+    TrajectoryPyramid<T>::~TrajectoryPyramid() = default;
+
+    template <typename T>
+    template <typename Record>
+    TrajectoryPyramid<T>::ChunkStore<Record>::~ChunkStore()
+    {
+        // マップした領域とストリームを閉じてからでないと、Windowsではファイルを削除できない
+        boost::interprocess::mapped_region().swap(region_);
+
+        if (ofs_.is_open())
+        {
+            ofs_.close();
+            std::remove(filename_.c_str());
+        }
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    template <typename T>
+    template <typename Record>
+    Record TrajectoryPyramid<T>::ChunkStore<Record>::at(std::size_t i) const
+    {
+        BOOST_ASSERT(i < size());
+
+        auto const chunk = i / TrajectoryPyramid::CHUNKSIZE;
+        if (chunk >= nspilled_)
+        {
+            return hot_[chunk - nspilled_][i % TrajectoryPyramid::CHUNKSIZE];
+        }
+
+        // 前回マップした後に書き出したチャンクを読む場合は、ファイル全体をマップし直す
+        auto const spilledsize = nspilled_ * TrajectoryPyramid::CHUNKSIZE * sizeof(Record);
+        if (region_.get_size() < (chunk + 1) * TrajectoryPyramid::CHUNKSIZE * sizeof(Record))
+        {
+            ofs_.flush();
+
+            boost::interprocess::file_mapping const file(filename_.c_str(), boost::interprocess::read_only);
+            boost::interprocess::mapped_region region(file, boost::interprocess::read_only, 0, spilledsize);
+            region_.swap(region);
+        }
+
+        return static_cast<Record const *>(region_.get_address())[i];
+    }
+
+    template <typename T>
+    template <typename Record>
+    void TrajectoryPyramid<T>::ChunkStore<Record>::push_back(Record const & record)
+    {
+        if (hot_.empty() || hot_.back().size() == TrajectoryPyramid::CHUNKSIZE)
+        {
+            // 古いチャンクをファイルに書き出して、メモリ上のチャンクの数を一定に保つ
+            if (hot_.size() == TrajectoryPyramid::HOTCHUNKS)
+            {
+                if (!ofs_.is_open())
+                {
+                    ofs_.open(filename_, std::ios::binary | std::ios::trunc);
+                }
+
+                auto const & chunk = hot_.front();
+                ofs_.write(reinterpret_cast<char const *>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(Record)));
+                BOOST_ASSERT(ofs_);
+
+                // 書き出したチャンクの領域は、新しいチャンクに使い回す
+                auto recycled = std::move(hot_.front());
+                hot_.pop_front();
+                nspilled_++;
+
+                recycled.clear();
+                hot_.push_back(std::move(recycled));
+            }
+            else
+            {
+                hot_.emplace_back();
+                hot_.back().reserve(TrajectoryPyramid::CHUNKSIZE);
+            }
+        }
+
+        hot_.back().push_back(record);
+    }
+
+    template <typename T>
+    void TrajectoryPyramid<T>::push(T t, T h, T v)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        BOOST_ASSERT(!samples_.size() || samples_.at(samples_.size() - 1)[0] <= t);
+
+        samples_.push_back({ t, h, v });
+
+        // 下の階層の区間がFANOUT個揃うごとに、上の階層の区間を一つ確定させる
+        auto bucket = Bucket{ t, t, { h, h, h, h }, { v, v, v, v } };
+        for (auto level = 0U; ; level++) {
+            if (level == open_.size())
+            {
+                open_.emplace_back(bucket, 0);
+                levels_.push_back(std::make_unique< ChunkStore<Bucket> >(filenamebase_ + "." + std::to_string(level + 1)));
+            }
+
+            auto & [open, count] = open_[level];
+            if (count)
+            {
+                TrajectoryPyramid::merge(open, bucket);
+            }
+            else
+            {
+                open = bucket;
+            }
+
+            if (++count < TrajectoryPyramid::FANOUT)
+            {
+                break;
+            }
+
+            levels_[level]->push_back(open);
+            bucket = open;
+            count = 0;
+        }
+    }
+
+    template <typename T>
+    std::vector<typename TrajectoryPyramid<T>::sampletype> TrajectoryPyramid<T>::query(T tmin, T tmax, std::size_t npixels) const
+    {
+        BOOST_ASSERT(tmin <= tmax);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto const n = samples_.size();
+        if (!n)
+        {
+            return {};
+        }
+
+        npixels = std::max(npixels, std::size_t(1));
+
+        // 範囲の外側に隣接する点を含める
+        auto const i0 = std::max(upperbound(tmin), std::size_t(1)) - 1;
+        auto const i1 = std::min(upperbound(tmax) + 1, n);
+
+        std::vector<TrajectoryPyramid::sampletype> points;
+        points.reserve(TrajectoryPyramid::maxpoints(npixels));
+
+        if (i0)
+        {
+            points.push_back(samples_.at(0));
+        }
+
+        if (i1 - i0 <= 4 * npixels)
+        {
+            for (auto i = i0; i < i1; i++) {
+                points.push_back(samples_.at(i));
+            }
+        }
+        else
+        {
+            // 区間の数がピクセル数以下となる最も細かい階層を選ぶ
+            auto level = 1U;
+            auto span = TrajectoryPyramid::FANOUT;
+            while (i1 - i0 > span * npixels) {
+                level++;
+                span *= TrajectoryPyramid::FANOUT;
+            }
+
+            for (auto k = i0 / span; k * span < i1; k++) {
+                // まとめている途中の末尾の区間は、下の階層の確定した区間から求める
+                auto const bucket = k < bucketcount(level) ? bucketat(level, k) : aggregate(level - 1, k * span, n);
+
+                auto const tm = (bucket.t0 + bucket.t1) / T(2);
+                auto const hrising = bucket.h[0] <= bucket.h[1];
+                auto const vrising = bucket.v[0] <= bucket.v[1];
+
+                points.push_back({ bucket.t0, bucket.h[0], bucket.v[0] });
+                points.push_back({ tm, bucket.h[hrising ? 2 : 3], bucket.v[vrising ? 2 : 3] });
+                points.push_back({ tm, bucket.h[hrising ? 3 : 2], bucket.v[vrising ? 3 : 2] });
+                points.push_back({ bucket.t1, bucket.h[1], bucket.v[1] });
+            }
+        }
+
+        if (i1 < n)
+        {
+            points.push_back(samples_.at(n - 1));
+        }
+
+        BOOST_ASSERT(points.size() <= TrajectoryPyramid::maxpoints(npixels));
+
+        return points;
+    }
+
+    template <typename T>
+    std::size_t TrajectoryPyramid<T>::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        return samples_.size();
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    template <typename T>
+    typename TrajectoryPyramid<T>::Bucket TrajectoryPyramid<T>::aggregate(std::size_t level, std::size_t first, std::size_t last) const
+    {
+        BOOST_ASSERT(first < last);
+
+        auto span = std::size_t(1);
+        for (auto l = 0U; l < level; l++) {
+            span *= TrajectoryPyramid::FANOUT;
+        }
+
+        BOOST_ASSERT(first % span == 0);
+
+        // 粗い階層の確定した区間から順に用い、残りをより細かい階層で埋める
+        auto bucket = bucketat(0, first);
+        auto merged = false;
+        for (auto i = first; ; span /= TrajectoryPyramid::FANOUT, level--) {
+            auto const end = std::min(last / span, bucketcount(level));
+            for (auto k = i / span; k < end; k++) {
+                if (merged)
+                {
+                    TrajectoryPyramid::merge(bucket, bucketat(level, k));
+                }
+                else
+                {
+                    bucket = bucketat(level, k);
+                    merged = true;
+                }
+            }
+
+            i = std::max(i, end * span);
+            if (!level || i >= last)
+            {
+                break;
+            }
+        }
+
+        return bucket;
+    }
+
+    template <typename T>
+    typename TrajectoryPyramid<T>::Bucket TrajectoryPyramid<T>::bucketat(std::size_t level, std::size_t k) const
+    {
+        if (level)
+        {
+            return levels_[level - 1]->at(k);
+        }
+
+        auto const [t, h, v] = samples_.at(k);
+
+        return Bucket{ t, t, { h, h, h, h }, { v, v, v, v } };
+    }
+
+    template <typename T>
+    std::size_t TrajectoryPyramid<T>::bucketcount(std::size_t level) const
+    {
+        if (!level)
+        {
+            return samples_.size();
+        }
+
+        return level <= levels_.size() ? levels_[level - 1]->size() : 0;
+    }
+
+    template <typename T>
+    void TrajectoryPyramid<T>::merge(Bucket & a, Bucket const & b)
+    {
+        using std::max;
+        using std::min;
+
+        a.t1 = b.t1;
+
+        a.h[1] = b.h[1];
+        a.h[2] = min(a.h[2], b.h[2]);
+        a.h[3] = max(a.h[3], b.h[3]);
+
+        a.v[1] = b.v[1];
+        a.v[2] = min(a.v[2], b.v[2]);
+        a.v[3] = max(a.v[3], b.v[3]);
+    }
+
+    template <typename T>
+    std::size_t TrajectoryPyramid<T>::upperbound(T t) const
+    {
+        auto first = std::size_t(0);
+        auto count = samples_.size();
+        while (count) {
+            auto const step = count / 2;
+            if (samples_.at(first + step)[0] <= t)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+
+        return first;
+    }
+
+    // #endregion privateメンバ関数
+
+    // #region templateクラスの実体化
+
+    template class TrajectoryPyramid<float>;
+    template class TrajectoryPyramid<double>;
+
+    // #endregion templateクラスの実体化
+}
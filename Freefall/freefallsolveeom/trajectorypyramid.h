@@ -0,0 +1,387 @@
+﻿/*! \file trajectorypyramid.h
+    \brief 軌道の点を、解像度の異なる最小値・最大値の階層とともに、チャンクに分けて記録するクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _TRAJECTORYPYRAMID_H_
+#define _TRAJECTORYPYRAMID_H_
+
+#pragma once
+
+#include <array>                                    // for std::array
+#include <cstddef>                                  // for std::size_t
+#include <deque>                                    // for std::deque
+#include <fstream>                                  // for std::ofstream
+#include <memory>                                   // for std::unique_ptr
+#include <mutex>                                    // for std::mutex
+#include <string>                                   // for std::string
+#include <utility>                                  // for std::pair
+#include <vector>                                   // for std::vector
+#include <boost/interprocess/mapped_region.hpp>     // for boost::interprocess::mapped_region
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        軌道の点（時刻、高度、速度）を、FANOUT個ずつまとめた区間の最初・最後・最小・最大の値の階層（タイルのピラミッドに相当する）とともに記録するクラス
+        各階層はCHUNKSIZE個ずつのチャンクに分けて保持し、新しいHOTCHUNKS個より古いチャンクは一時ファイルに書き出して、
+        読み出す際にはメモリにマップするため、長時間の計算でもメモリの使用量は点の数によらず一定に収まる
+        query()は表示する時刻の範囲と横方向のピクセル数に見合う階層を選んで点を返すため、描画の手間は点の総数ではなくピクセル数に比例する
+        push()とquery()は、別々のスレッドから同時に呼び出してよい
+        \tparam T 浮動小数点数の型（トリビアルにコピー可能でなければならない）
+    */
+    template <typename T>
+    class TrajectoryPyramid final {
+        // #region 型エイリアス
+
+    public:
+        //! A typedef.
+        /*!
+            時刻（秒）、高度（m）、速度（m/s）のstd::arrayの型
+        */
+        using sampletype = std::array<T, 3>;
+
+        // #endregion 型エイリアス
+
+    private:
+        // #region 構造体
+
+        //! A struct.
+        /*!
+            連続する点をまとめた区間を表す構造体
+        */
+        struct Bucket {
+            //! A public member variable.
+            /*!
+                区間の最初の点の時刻（秒）
+            */
+            T t0;
+
+            //! A public member variable.
+            /*!
+                区間の最後の点の時刻（秒）
+            */
+            T t1;
+
+            //! A public member variable.
+            /*!
+                区間の高度（m）の最初、最後、最小、最大の値
+            */
+            std::array<T, 4> h;
+
+            //! A public member variable.
+            /*!
+                区間の速度（m/s）の最初、最後、最小、最大の値
+            */
+            std::array<T, 4> v;
+        };
+
+        // #endregion 構造体
+
+        // #region クラス
+
+        //! A template class.
+        /*!
+            レコードをCHUNKSIZE個ずつのチャンクに分けて保持し、新しいHOTCHUNKS個より古いチャンクをファイルに書き出す、追記専用の配列
+            \tparam Record レコードの型（トリビアルにコピー可能でなければならない）
+        */
+        template <typename Record>
+        class ChunkStore final {
+        public:
+            // #region コンストラクタ・デストラクタ
+
+            //! A constructor.
+            /*!
+                唯一のコンストラクタ（ファイルは最初にチャンクを書き出す際に作成する）
+                \param filename チャンクを書き出すファイルのファイル名
+            */
+            explicit ChunkStore(std::string const & filename) : filename_(filename)
+            {
+            }
+
+            //! A destructor.
+            /*!
+                デストラクタ（チャンクを書き出したファイルを削除する）
+            */
+            ~ChunkStore();
+
+            // #endregion コンストラクタ・デストラクタ
+
+            // #region publicメンバ関数
+
+            //! A public member function (const).
+            /*!
+                i番目のレコードを返す（ファイルに書き出したレコードは、ファイルをメモリにマップして読み出す）
+                \param i レコードの番号
+                \return i番目のレコード
+            */
+            Record at(std::size_t i) const;
+
+            //! A public member function.
+            /*!
+                レコードを末尾に追加する
+                \param record 追加するレコード
+            */
+            void push_back(Record const & record);
+
+            //! A public member function (const).
+            /*!
+                レコードの数を返す
+                \return レコードの数
+            */
+            std::size_t size() const
+            {
+                return nspilled_ * TrajectoryPyramid::CHUNKSIZE + (hot_.empty() ? 0 : (hot_.size() - 1) * TrajectoryPyramid::CHUNKSIZE + hot_.back().size());
+            }
+
+            // #endregion publicメンバ関数
+
+        private:
+            // #region メンバ変数
+
+            //! A private member variable (constant).
+            /*!
+                チャンクを書き出すファイルのファイル名
+            */
+            std::string const filename_;
+
+            //! A private member variable.
+            /*!
+                メモリ上に保持しているチャンク（古い順）
+            */
+            std::deque< std::vector<Record> > hot_;
+
+            //! A private member variable.
+            /*!
+                ファイルに書き出したチャンクの数
+            */
+            std::size_t nspilled_ = 0;
+
+            //! A private member variable.
+            /*!
+                チャンクを書き出すファイルのストリーム（読み出す前に書き出した内容をフラッシュする）
+            */
+            mutable std::ofstream ofs_;
+
+            //! A private member variable.
+            /*!
+                ファイルをマップした領域（ファイルに書き出したチャンクが増えた後に読み出す際にマップし直す）
+            */
+            mutable boost::interprocess::mapped_region region_;
+
+            // #endregion メンバ変数
+
+            // #region 禁止されたコンストラクタ・メンバ関数
+
+        public:
+            //! A public constructor (deleted).
+            /*!
+                デフォルトコンストラクタ（禁止）
+            */
+            ChunkStore() = delete;
+
+            //! A public copy constructor (deleted).
+            /*!
+                コピーコンストラクタ（禁止）
+            */
+            ChunkStore(ChunkStore const &) = delete;
+
+            //! A public member function (deleted).
+            /*!
+                operator=()の宣言（禁止）
+                \return コピー元のオブジェクト
+            */
+            ChunkStore & operator=(ChunkStore const &) = delete;
+
+            // #endregion 禁止されたコンストラクタ・メンバ関数
+        };
+
+        // #endregion クラス
+
+    public:
+        // #region 定数
+
+        //! A public static member variable (constant expression).
+        /*!
+            一つ上の階層の区間にまとめる区間の数
+        */
+        static std::size_t constexpr FANOUT = 16;
+
+        //! A public static member variable (constant expression).
+        /*!
+            一つのチャンクのレコードの数
+        */
+        static std::size_t constexpr CHUNKSIZE = 4096;
+
+        //! A public static member variable (constant expression).
+        /*!
+            各階層で、ファイルに書き出さずにメモリ上に保持するチャンクの数
+        */
+        static std::size_t constexpr HOTCHUNKS = 4;
+
+        // #endregion 定数
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ（古いチャンクは、一時ディレクトリに作成する一意な名前のファイルに書き出す）
+        */
+        TrajectoryPyramid();
+
+        //! A destructor.
+        /*!
+            デストラクタ（書き出したファイルは各階層のデストラクタで削除される）
+        */
+        ~TrajectoryPyramid();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public static member function.
+        /*!
+            query()が返す点の数の上限を返す
+            \param npixels 横方向のピクセル数
+            \return query()が返す点の数の上限
+        */
+        static std::size_t maxpoints(std::size_t npixels)
+        {
+            return 4 * npixels + 6;
+        }
+
+        //! A public member function.
+        /*!
+            点を追加する（時刻は単調に増加しなければならない）
+            \param t 時刻（秒）
+            \param h 高度（m）
+            \param v 速度（m/s）
+        */
+        void push(T t, T h, T v);
+
+        //! A public member function (const).
+        /*!
+            時刻の範囲[tmin, tmax]をnpixels個のピクセルで描くのに必要な点を返す
+            範囲内の点がピクセル数の4倍以下の場合は記録した点をそのまま返し、それより多い場合は、区間の数がピクセル数以下となる最も細かい階層の各区間を、
+            最初、最小と最大（最初と最後の大小に合わせた順）、最後の4点で表す（折れ線の描く範囲は記録した点をそのまま描いた場合と変わらない）
+            範囲の外側に隣接する点と、最初と最後の点も返すため、範囲の外に向かう線と軸の自動調整は全体を描いた場合と変わらない
+            \param tmin 範囲の最初の時刻（秒）（tmax以下でなければならない）
+            \param tmax 範囲の最後の時刻（秒）
+            \param npixels 横方向のピクセル数
+            \return 時刻の昇順に並んだ点（点の数はmaxpoints(npixels)以下）
+        */
+        std::vector<TrajectoryPyramid::sampletype> query(T tmin, T tmax, std::size_t npixels) const;
+
+        //! A public member function (const).
+        /*!
+            記録した点の数を返す
+            \return 記録した点の数
+        */
+        std::size_t size() const;
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function (const).
+        /*!
+            [first, last)番目の点を、level番目の階層以下の区間を用いてまとめる（firstはlevel番目の階層の区間の境界でなければならない）
+            \param level 用いる最も粗い階層
+            \param first 最初の点の番号
+            \param last 最後の点の次の番号
+            \return まとめた区間
+        */
+        Bucket aggregate(std::size_t level, std::size_t first, std::size_t last) const;
+
+        //! A private member function (const).
+        /*!
+            level番目の階層のk番目の区間を返す（0番目の階層の区間は一つの点）
+            \param level 階層
+            \param k 区間の番号
+            \return 区間
+        */
+        Bucket bucketat(std::size_t level, std::size_t k) const;
+
+        //! A private member function (const).
+        /*!
+            level番目の階層に記録した区間の数を返す（0番目の階層は点の数）
+            \param level 階層
+            \return 区間の数
+        */
+        std::size_t bucketcount(std::size_t level) const;
+
+        //! A private static member function.
+        /*!
+            区間aの後に、続く区間bを併合する
+            \param a 併合される区間（結果を格納する）
+            \param b 続く区間
+        */
+        static void merge(Bucket & a, Bucket const & b);
+
+        //! A private member function (const).
+        /*!
+            時刻がtより大きい最初の点の番号を返す
+            \param t 時刻（秒）
+            \return 時刻がtより大きい最初の点の番号（全ての点の時刻がt以下の場合は点の数）
+        */
+        std::size_t upperbound(T t) const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private member variable (constant).
+        /*!
+            各階層のチャンクを書き出すファイルのファイル名の、階層の番号を除いた部分
+        */
+        std::string const filenamebase_;
+
+        //! A private member variable.
+        /*!
+            1番目以降の各階層の区間
+        */
+        std::vector< std::unique_ptr< ChunkStore<Bucket> > > levels_;
+
+        //! A private member variable.
+        /*!
+            push()とquery()を排他するミューテックス
+        */
+        mutable std::mutex mutex_;
+
+        //! A private member variable.
+        /*!
+            1番目以降の各階層で、まとめている途中の区間と、まとめた下の階層の区間の数
+        */
+        std::vector< std::pair<Bucket, std::size_t> > open_;
+
+        //! A private member variable.
+        /*!
+            記録した点（0番目の階層）
+        */
+        ChunkStore<TrajectoryPyramid::sampletype> samples_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        TrajectoryPyramid(TrajectoryPyramid const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        TrajectoryPyramid & operator=(TrajectoryPyramid const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _TRAJECTORYPYRAMID_H_
@@ -0,0 +1,267 @@
+﻿/*! \file trajectorywriter.cpp
+    \brief 計算結果をバックグラウンドのスレッドで圧縮しながらファイルに書き出すクラスの実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "trajectorywriter.h"
+#include <array>                // for std::array
+#include <cstring>              // for std::memcpy
+#include <utility>              // for std::make_pair, std::move
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+#include <zlib.h>               // for deflate, deflateBound, deflateEnd, deflateInit2
+
+namespace freefallsolveeom {
+    // #region コンストラクタ・デストラクタ
+
+    TrajectoryWriter::TrajectoryWriter(std::string const & filename, TrajectoryWriter::Format format, TrajectoryWriter::Compression compression, std::int32_t digits, std::size_t nextracolumns) :
+        blockcapacity_(TrajectoryWriter::BLOCKSIZE + TrajectoryWriter::ROWBUFSIZE * (1 + nextracolumns)),
+        compression_(compression),
+        filename_(filename),
+        format_(format),
+        fp_(std::fopen(filename.c_str(), format == TrajectoryWriter::Format::CSV && compression == TrajectoryWriter::Compression::NONE ? "w" : "wb"), std::fclose),
+        nextracolumns_(nextracolumns),
+        rowformat_("%." + std::to_string(digits) + "f, %.2f, %.2f\n")
+    {
+        if (!fp_)
+        {
+            return;
+        }
+
+        // 計算側のスレッドがブロックごとにヒープの確保を行わないように、使い回すブロックを全て確保しておく
+        block_.reserve(blockcapacity_);
+        for (std::size_t i = 0; i < TrajectoryWriter::MAXPENDINGBLOCKS; i++) {
+            std::string block;
+            block.reserve(blockcapacity_);
+            spare_.push(std::move(block));
+        }
+
+        thread_ = std::thread([this] { run(); });
+    }
+
+    TrajectoryWriter::~TrajectoryWriter()
+    {
+        close();
+    }
+
+    // #endregion コンストラクタ・デストラクタ
+
+    // #region publicメンバ関数
+
+    void TrajectoryWriter::close()
+    {
+        if (!thread_.joinable())
+        {
+            return;
+        }
+
+        if (!block_.empty())
+        {
+            pushblock();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            isfinished_ = true;
+        }
+        cv_.notify_all();
+
+        thread_.join();
+
+        if (std::fflush(fp_.get()) != 0)
+        {
+            isfailed_.store(true, std::memory_order_release);
+        }
+
+        // 失敗した場合は、書き出せなかったブロックを含む索引は作らない
+        if (compression_ == TrajectoryWriter::Compression::GZIP && !isfailed())
+        {
+            writeindex();
+        }
+    }
+
+    void TrajectoryWriter::write(double t, double h, double v, double const * extracolumns)
+    {
+        BOOST_ASSERT(nextracolumns_ == 0 || extracolumns);
+
+        if (!thread_.joinable() || isfailed())
+        {
+            return;
+        }
+
+        if (format_ == TrajectoryWriter::Format::CSV)
+        {
+            std::array<char, TrajectoryWriter::ROWBUFSIZE> buf;
+            auto const len = std::snprintf(buf.data(), buf.size(), rowformat_.c_str(), t, h, v);
+            block_.append(buf.data(), static_cast<std::size_t>(len));
+
+            if (nextracolumns_)
+            {
+                // 改行を取り除いてから追加の列を続ける
+                block_.pop_back();
+                for (std::size_t i = 0; i < nextracolumns_; i++) {
+                    auto const lenextra = std::snprintf(buf.data(), buf.size(), ", %.6e", extracolumns[i]);
+                    block_.append(buf.data(), static_cast<std::size_t>(lenextra));
+                }
+                block_.push_back('\n');
+            }
+        }
+        else
+        {
+            std::array<double, 3> const row = { t, h, v };
+            std::array<char, sizeof(row)> buf;
+            std::memcpy(buf.data(), row.data(), sizeof(row));
+            block_.append(buf.data(), buf.size());
+
+            for (std::size_t i = 0; i < nextracolumns_; i++) {
+                std::memcpy(buf.data(), extracolumns + i, sizeof(double));
+                block_.append(buf.data(), sizeof(double));
+            }
+        }
+
+        if (block_.size() >= TrajectoryWriter::BLOCKSIZE)
+        {
+            pushblock();
+        }
+    }
+
+    // #endregion publicメンバ関数
+
+    // #region privateメンバ関数
+
+    bool TrajectoryWriter::flushblock(std::string const & block)
+    {
+        index_.push_back(std::make_pair(byteswritten_, rawbyteswritten_));
+        rawbyteswritten_ += block.size();
+
+        if (compression_ == TrajectoryWriter::Compression::NONE)
+        {
+            auto const written = std::fwrite(block.data(), 1, block.size(), fp_.get());
+            byteswritten_ += written;
+
+            return written == block.size();
+        }
+
+        // バイナリ形式では、各列のdoubleのバイトを上位・下位ごとにまとめ直してから圧縮する
+        // （隣り合う行の値は指数部や上位の仮数部が共通なので、同じ位置のバイトを並べると圧縮率が倍程度になる）
+        std::string shuffled;
+        if (format_ == TrajectoryWriter::Format::BINARY)
+        {
+            shuffled = shuffle(block, sizeof(double) * (3 + nextracolumns_));
+        }
+        auto const & in = format_ == TrajectoryWriter::Format::BINARY ? shuffled : block;
+
+        // windowBitsに16を加えるとzlib形式ではなくgzip形式で出力される
+        z_stream zs{};
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+
+        std::vector<unsigned char> out(deflateBound(&zs, static_cast<uLong>(in.size())));
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        zs.avail_in = static_cast<uInt>(in.size());
+        zs.next_out = out.data();
+        zs.avail_out = static_cast<uInt>(out.size());
+
+        // 出力先の大きさはdeflateBoundで確保しているので、一度の呼び出しで完了するはずだが、
+        // 完了しなかった場合はブロックの途中までのgzipメンバを書き出さないように失敗とする
+        auto const res = deflate(&zs, Z_FINISH);
+        auto const compressed = static_cast<std::size_t>(zs.total_out);
+        deflateEnd(&zs);
+
+        if (res != Z_STREAM_END)
+        {
+            return false;
+        }
+
+        auto const written = std::fwrite(out.data(), 1, compressed, fp_.get());
+        byteswritten_ += written;
+
+        return written == compressed;
+    }
+
+    void TrajectoryWriter::pushblock()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            // 書き出し用のスレッドが持つブロックと待ち行列のブロックが全てでなければ、空のブロックがある
+            cv_.wait(lock, [this] { return !pending_.full() && !spare_.empty(); });
+            pending_.push(std::move(block_));
+
+            // 書き出しが終わったブロックの、確保済みの領域を再利用する
+            block_ = std::move(spare_.front());
+            spare_.pop();
+        }
+        cv_.notify_all();
+    }
+
+    void TrajectoryWriter::run()
+    {
+        while (true) {
+            std::string block;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return !pending_.empty() || isfinished_; });
+
+                if (pending_.empty())
+                {
+                    // isfinished_がtrueで、書き出すブロックが残っていない
+                    break;
+                }
+
+                block = std::move(pending_.front());
+                pending_.pop();
+            }
+            cv_.notify_all();
+
+            // 一度失敗した後は、待ち行列から取り出したブロックを捨てて、計算側のスレッドを待たせないようにする
+            if (!isfailed() && !flushblock(block))
+            {
+                isfailed_.store(true, std::memory_order_release);
+            }
+
+            // 書き出したブロックの領域を、空のブロックを待っている計算側のスレッドに返す
+            block.clear();
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if (!spare_.full())
+                {
+                    spare_.push(std::move(block));
+                }
+            }
+            cv_.notify_all();
+        }
+    }
+
+    std::string TrajectoryWriter::shuffle(std::string const & block, std::size_t rowsize)
+    {
+        BOOST_ASSERT(block.size() % rowsize == 0);
+
+        auto const nrow = block.size() / rowsize;
+        std::string shuffled(block.size(), '\0');
+        for (std::size_t i = 0; i < nrow; i++) {
+            for (std::size_t j = 0; j < rowsize; j++) {
+                shuffled[j * nrow + i] = block[i * rowsize + j];
+            }
+        }
+
+        return shuffled;
+    }
+
+    void TrajectoryWriter::writeindex() const
+    {
+        std::unique_ptr< FILE, decltype(&std::fclose) > fp(std::fopen((filename_ + ".idx").c_str(), "w"), std::fclose);
+        if (!fp)
+        {
+            return;
+        }
+
+        // 一行に「圧縮後のファイル中の位置 展開後の位置」を記録する
+        for (auto const & [offset, rawoffset] : index_) {
+            std::fprintf(fp.get(), "%llu %llu\n", static_cast<unsigned long long>(offset), static_cast<unsigned long long>(rawoffset));
+        }
+    }
+
+    // #endregion privateメンバ関数
+}
@@ -0,0 +1,321 @@
+﻿/*! \file trajectorywriter.h
+    \brief 計算結果をバックグラウンドのスレッドで圧縮しながらファイルに書き出すクラスの宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _TRAJECTORYWRITER_H_
+#define _TRAJECTORYWRITER_H_
+
+#pragma once
+
+#include "utility/ringbuffer.h"
+#include <atomic>               // for std::atomic
+#include <condition_variable>   // for std::condition_variable
+#include <cstddef>              // for std::size_t
+#include <cstdint>              // for std::int32_t, std::uint64_t
+#include <cstdio>               // for FILE, std::fclose
+#include <memory>               // for std::unique_ptr
+#include <mutex>                // for std::mutex
+#include <string>               // for std::string
+#include <thread>               // for std::thread
+#include <utility>              // for std::pair
+#include <vector>               // for std::vector
+
+namespace freefallsolveeom {
+    //! A class.
+    /*!
+        時間、高度、速度の行を固定長のブロックにまとめ、バックグラウンドのスレッドで圧縮してファイルに書き出すクラス
+        各行には時間、高度、速度の後に、コンストラクタで指定した数の追加の列（診断用の物理量など）を続けることができる
+        gzip圧縮の場合、各ブロックは独立したgzipメンバとして書き出されるため、ファイル全体を通常のgzipとして展開できるほか、
+        「ファイル名.idx」に記録されるブロックの位置から任意のブロックだけを展開することもできる
+    */
+    class TrajectoryWriter final {
+    public:
+        // #region 列挙型
+
+        //! A enumerated type
+        /*!
+            出力する形式
+        */
+        enum class Format : std::int32_t {
+            // CSV形式（「時間, 高度, 速度, 追加の列...」のテキスト）
+            CSV = 0,
+            // バイナリ形式（時間、高度、速度、追加の列のdoubleを並べたものを1行とする）
+            BINARY = 1
+        };
+
+        //! A enumerated type
+        /*!
+            圧縮の方法
+        */
+        enum class Compression : std::int32_t {
+            // 圧縮しない
+            NONE = 0,
+            // ブロックごとに独立したgzipメンバとして圧縮する（バイナリ形式の場合は、ブロック内のバイトを並べ替えてから圧縮する）
+            GZIP = 1
+        };
+
+        // #endregion 列挙型
+
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            ファイルを開き、書き出し用のスレッドを起動するコンストラクタ
+            \param filename 出力するファイルのファイル名
+            \param format 出力する形式
+            \param compression 圧縮の方法
+            \param digits CSV形式で時間を記録するときの、小数点以下の桁数
+            \param nextracolumns 時間、高度、速度に続く追加の列の数
+        */
+        TrajectoryWriter(std::string const & filename, TrajectoryWriter::Format format, TrajectoryWriter::Compression compression, std::int32_t digits, std::size_t nextracolumns);
+
+        //! A destructor.
+        /*!
+            残りのブロックをすべて書き出し、スレッドの終了を待ってファイルを閉じるデストラクタ
+        */
+        ~TrajectoryWriter();
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            残りのブロックをすべて書き出し、スレッドの終了を待ってファイルを閉じる（二度目以降の呼び出しでは何もしない）
+        */
+        void close();
+
+        //! A public member function (const).
+        /*!
+            圧縮または書き込みに失敗したかどうかを返す（失敗した後のブロックは書き出さない）
+            \return 圧縮または書き込みに失敗したかどうか
+        */
+        bool isfailed() const
+        {
+            return isfailed_.load(std::memory_order_acquire);
+        }
+
+        //! A public member function (const).
+        /*!
+            ファイルを開くことができたかどうかを返す
+            \return ファイルを開くことができたかどうか
+        */
+        bool isopen() const
+        {
+            return static_cast<bool>(fp_);
+        }
+
+        //! A public member function.
+        /*!
+            1行分の計算結果をブロックに追加する（ブロックが一杯になった場合は書き出し用のスレッドに渡す）
+            \param t 経過時間（秒）
+            \param h 高度（m）
+            \param v 速度（m/s）
+            \param extracolumns 追加の列の値の配列の先頭へのポインタ（追加の列が無い場合はnullptr）
+        */
+        void write(double t, double h, double v, double const * extracolumns);
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region privateメンバ関数
+
+        //! A private member function.
+        /*!
+            ブロックを圧縮してファイルに書き出す
+            \param block 書き出すブロック
+            \return 圧縮と書き込みに成功したかどうか
+        */
+        bool flushblock(std::string const & block);
+
+        //! A private member function.
+        /*!
+            現在のブロックを書き出し用のスレッドに渡し、空のブロックを受け取る
+            （待ち行列が一杯か、空のブロックが無い場合は空くまで待つ。ブロックは全てコンストラクタで確保済みなので、ヒープの確保は行わない）
+        */
+        void pushblock();
+
+        //! A private member function.
+        /*!
+            書き出し用のスレッドの本体
+        */
+        void run();
+
+        //! A private static member function.
+        /*!
+            バイナリ形式のブロックのバイトを、各行の同じ位置のバイトが連続するように並べ替える
+            \param block 並べ替えるブロック（大きさは1行の大きさの倍数）
+            \param rowsize 1行の大きさ（バイト）
+            \return 並べ替えたブロック（行数をnとすると、行内のj番目のバイトが[j * n, (j + 1) * n)に並ぶ）
+        */
+        static std::string shuffle(std::string const & block, std::size_t rowsize);
+
+        //! A private member function (const).
+        /*!
+            gzip圧縮の場合に、各ブロックの位置を「ファイル名.idx」に書き出す
+        */
+        void writeindex() const;
+
+        // #endregion privateメンバ関数
+
+        // #region メンバ変数
+
+        //! A private static member variable (constant expression).
+        /*!
+            1ブロックあたりの（圧縮前の）大きさの目安（バイト）
+        */
+        static std::size_t constexpr BLOCKSIZE = 1 << 20;
+
+        //! A private static member variable (constant expression).
+        /*!
+            書き出し待ちのブロックの最大数（これを超えると計算側のスレッドを待たせる）
+        */
+        static std::size_t constexpr MAXPENDINGBLOCKS = 4;
+
+        //! A private static member variable (constant expression).
+        /*!
+            CSV形式で1行の各部分を書式化するバッファの大きさ（バイト）
+        */
+        static std::size_t constexpr ROWBUFSIZE = 128;
+
+        //! A private member variable.
+        /*!
+            現在書き込み中のブロック
+        */
+        std::string block_;
+
+        //! A private member variable (constant).
+        /*!
+            ブロックにあらかじめ確保しておく大きさ（バイト）（BLOCKSIZEを1行ぶん超えても確保し直さないようにする）
+        */
+        std::size_t const blockcapacity_;
+
+        //! A private member variable.
+        /*!
+            これまでにファイルに書き出した（圧縮後の）バイト数（書き出し用のスレッドのみが触る）
+        */
+        std::uint64_t byteswritten_ = 0;
+
+        //! A private member variable (constant).
+        /*!
+            圧縮の方法
+        */
+        TrajectoryWriter::Compression const compression_;
+
+        //! A private member variable.
+        /*!
+            書き出し用のスレッドへの通知に使う条件変数
+        */
+        std::condition_variable cv_;
+
+        //! A private member variable (constant).
+        /*!
+            出力するファイルのファイル名
+        */
+        std::string const filename_;
+
+        //! A private member variable (constant).
+        /*!
+            出力する形式
+        */
+        TrajectoryWriter::Format const format_;
+
+        //! A private member variable.
+        /*!
+            出力するファイルのファイルポインタのスマートポインタ
+        */
+        std::unique_ptr< FILE, decltype(&std::fclose) > fp_;
+
+        //! A private member variable.
+        /*!
+            各ブロックの、ファイル中の位置と展開後の位置のstd::pairの配列（書き出し用のスレッドのみが触る）
+        */
+        std::vector< std::pair<std::uint64_t, std::uint64_t> > index_;
+
+        //! A private member variable.
+        /*!
+            圧縮または書き込みに失敗したかどうか（書き出し用のスレッドが書き込み、計算側のスレッドが読む）
+        */
+        std::atomic<bool> isfailed_ = false;
+
+        //! A private member variable.
+        /*!
+            これ以上ブロックが追加されないかどうか
+        */
+        bool isfinished_ = false;
+
+        //! A private member variable.
+        /*!
+            待ち行列を保護するミューテックス
+        */
+        std::mutex mtx_;
+
+        //! A private member variable (constant).
+        /*!
+            時間、高度、速度に続く追加の列の数
+        */
+        std::size_t const nextracolumns_;
+
+        //! A private member variable.
+        /*!
+            書き出し待ちのブロックの待ち行列
+        */
+        RingBuffer<std::string, TrajectoryWriter::MAXPENDINGBLOCKS> pending_;
+
+        //! A private member variable.
+        /*!
+            これまでに書き出したブロックの、圧縮前のバイト数の合計（書き出し用のスレッドのみが触る）
+        */
+        std::uint64_t rawbyteswritten_ = 0;
+
+        //! A private member variable (constant).
+        /*!
+            CSV形式で1行を出力するときの書式
+        */
+        std::string const rowformat_;
+
+        //! A private member variable.
+        /*!
+            書き出しが終わり、計算側のスレッドでの再利用を待つ空のブロック
+            （コンストラクタでMAXPENDINGBLOCKS個を確保しておき、現在のブロックと合わせてそれだけを使い回す）
+        */
+        RingBuffer<std::string, TrajectoryWriter::MAXPENDINGBLOCKS + 1> spare_;
+
+        //! A private member variable.
+        /*!
+            書き出し用のスレッド（最後に初期化する）
+        */
+        std::thread thread_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        TrajectoryWriter() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        TrajectoryWriter(TrajectoryWriter const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        TrajectoryWriter & operator=(TrajectoryWriter const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+}
+
+#endif  // _TRAJECTORYWRITER_H_
@@ -0,0 +1,266 @@
+﻿/*! \file dual.h
+    \brief 前進型自動微分のための二重数クラスの宣言と実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _DUAL_H_
+#define _DUAL_H_
+
+#pragma once
+
+#include <array>        // for std::array
+#include <cmath>        // for std::exp, std::pow, std::sqrt
+#include <cstddef>      // for std::nullptr_t, std::size_t
+#include <type_traits>  // for std::enable_if_t, std::is_arithmetic_v
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        値とN個の変数についての偏微分を同時に保持する二重数クラス
+        \tparam T 値の型
+        \tparam N 偏微分を取る変数の数
+    */
+    template <typename T, std::size_t N>
+    class Dual final {
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            0で初期化するコンストラクタ
+        */
+        Dual() : grad_{}, val_(0)
+        {
+        }
+
+        //! A constructor.
+        /*!
+            定数として初期化するコンストラクタ
+            \param val 値
+        */
+        Dual(T val) : grad_{}, val_(val)
+        {
+        }
+
+        template <typename U, std::enable_if_t<std::is_arithmetic_v<U>, std::nullptr_t> = nullptr>
+        //! A constructor.
+        /*!
+            組み込みの算術型の定数として初期化するコンストラクタ
+            （Tが多倍長浮動小数点型の場合でも、doubleのリテラルと二重数の演算を可能にする）
+            \param val 値
+        */
+        Dual(U val) : grad_{}, val_(val)
+        {
+        }
+
+        //! A constructor.
+        /*!
+            i番目の独立変数として初期化するコンストラクタ
+            \param val 値
+            \param i 独立変数の番号
+        */
+        Dual(T val, std::size_t i) : grad_{}, val_(val)
+        {
+            grad_[i] = 1;
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~Dual() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function (const).
+        /*!
+            値と導関数の値から、合成関数の二重数を生成する（連鎖律）
+            \param f 合成関数の値
+            \param dfdx 合成関数の導関数の値
+            \return 合成関数の二重数
+        */
+        Dual chain(T f, T dfdx) const
+        {
+            Dual res(f);
+            for (auto i = 0U; i < N; i++) {
+                res.grad_[i] = dfdx * grad_[i];
+            }
+
+            return res;
+        }
+
+        //! A public member function (const).
+        /*!
+            i番目の変数についての偏微分を返す
+            \param i 変数の番号
+            \return i番目の変数についての偏微分
+        */
+        T grad(std::size_t i) const
+        {
+            return grad_[i];
+        }
+
+        //! A public member function (const).
+        /*!
+            値を返す
+            \return 値
+        */
+        T value() const
+        {
+            return val_;
+        }
+
+        // #endregion publicメンバ関数
+
+        // #region 演算子
+
+        Dual & operator+=(Dual const & rhs)
+        {
+            val_ += rhs.val_;
+            for (auto i = 0U; i < N; i++) {
+                grad_[i] += rhs.grad_[i];
+            }
+
+            return *this;
+        }
+
+        Dual & operator-=(Dual const & rhs)
+        {
+            val_ -= rhs.val_;
+            for (auto i = 0U; i < N; i++) {
+                grad_[i] -= rhs.grad_[i];
+            }
+
+            return *this;
+        }
+
+        Dual & operator*=(Dual const & rhs)
+        {
+            for (auto i = 0U; i < N; i++) {
+                grad_[i] = grad_[i] * rhs.val_ + val_ * rhs.grad_[i];
+            }
+            val_ *= rhs.val_;
+
+            return *this;
+        }
+
+        Dual & operator/=(Dual const & rhs)
+        {
+            auto const inv = 1 / rhs.val_;
+            for (auto i = 0U; i < N; i++) {
+                grad_[i] = (grad_[i] - val_ * inv * rhs.grad_[i]) * inv;
+            }
+            val_ *= inv;
+
+            return *this;
+        }
+
+        Dual operator-() const
+        {
+            Dual res(*this);
+            res.val_ = -val_;
+            for (auto i = 0U; i < N; i++) {
+                res.grad_[i] = -grad_[i];
+            }
+
+            return res;
+        }
+
+        friend Dual operator+(Dual lhs, Dual const & rhs) { return lhs += rhs; }
+        friend Dual operator-(Dual lhs, Dual const & rhs) { return lhs -= rhs; }
+        friend Dual operator*(Dual lhs, Dual const & rhs) { return lhs *= rhs; }
+        friend Dual operator/(Dual lhs, Dual const & rhs) { return lhs /= rhs; }
+
+        friend bool operator<(Dual const & lhs, Dual const & rhs) { return lhs.val_ < rhs.val_; }
+        friend bool operator>(Dual const & lhs, Dual const & rhs) { return lhs.val_ > rhs.val_; }
+        friend bool operator<=(Dual const & lhs, Dual const & rhs) { return lhs.val_ <= rhs.val_; }
+        friend bool operator>=(Dual const & lhs, Dual const & rhs) { return lhs.val_ >= rhs.val_; }
+
+        // #endregion 演算子
+
+        // #region メンバ変数
+
+    private:
+        //! A private member variable.
+        /*!
+            各変数についての偏微分
+        */
+        std::array<T, N> grad_;
+
+        //! A private member variable.
+        /*!
+            値
+        */
+        T val_;
+
+        // #endregion メンバ変数
+    };
+
+    // #region 非メンバ関数
+
+    //! A function.
+    /*!
+        二重数の指数関数
+        \param x 二重数
+        \return exp(x)
+    */
+    template <typename T, std::size_t N>
+    Dual<T, N> exp(Dual<T, N> const & x)
+    {
+        using std::exp;
+
+        auto const f = exp(x.value());
+        return x.chain(f, f);
+    }
+
+    //! A function.
+    /*!
+        二重数の絶対値
+        \param x 二重数
+        \return |x|
+    */
+    template <typename T, std::size_t N>
+    Dual<T, N> fabs(Dual<T, N> const & x)
+    {
+        return x.value() < 0 ? -x : x;
+    }
+
+    //! A function.
+    /*!
+        二重数の冪乗（指数は定数）
+        \param x 二重数
+        \param y 指数
+        \return x^y
+    */
+    template <typename T, std::size_t N, typename U>
+    Dual<T, N> pow(Dual<T, N> const & x, U y)
+    {
+        using std::pow;
+
+        auto const f = pow(x.value(), static_cast<T>(y));
+        return x.chain(f, static_cast<T>(y) * pow(x.value(), static_cast<T>(y) - 1));
+    }
+
+    //! A function.
+    /*!
+        二重数の平方根
+        \param x 二重数
+        \return √x
+    */
+    template <typename T, std::size_t N>
+    Dual<T, N> sqrt(Dual<T, N> const & x)
+    {
+        using std::sqrt;
+
+        auto const f = sqrt(x.value());
+        return x.chain(f, 0.5 / f);
+    }
+
+    // #endregion 非メンバ関数
+}
+
+#endif  // _DUAL_H_
@@ -0,0 +1,36 @@
+﻿/*! \file referencetype.h
+    \brief 参照解を求めるための多倍長浮動小数点数の型の宣言
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _REFERENCETYPE_H_
+#define _REFERENCETYPE_H_
+
+#pragma once
+
+#include <boost/multiprecision/cpp_bin_float.hpp>                       // for boost::multiprecision::cpp_bin_float, boost::multiprecision::number
+#include <boost/numeric/odeint/algebra/detail/extract_value_type.hpp>   // for boost::numeric::odeint::detail::extract_value_type
+
+namespace freefallsolveeom {
+    //! A typedef.
+    /*!
+        参照解を求めるための、10進50桁の多倍長浮動小数点数の型
+        autoで受けても一時オブジェクトへの参照が残らないように、式テンプレートは無効にする
+    */
+    using referencetype = boost::multiprecision::number< boost::multiprecision::cpp_bin_float<50>, boost::multiprecision::et_off >;
+}
+
+namespace boost { namespace numeric { namespace odeint { namespace detail {
+    //! A template struct (specialization).
+    /*!
+        boost::multiprecision::numberはvalue_typeを持つため、odeintがこれをコンテナとみなさないように特殊化する
+    */
+    template <>
+    struct extract_value_type< freefallsolveeom::referencetype, void > {
+        using type = freefallsolveeom::referencetype;
+    };
+} } } }
+
+#endif  // _REFERENCETYPE_H_
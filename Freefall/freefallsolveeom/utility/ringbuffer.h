@@ -0,0 +1,179 @@
+﻿/*! \file ringbuffer.h
+    \brief 固定長のリングバッファクラスの宣言と実装
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+
+#ifndef _RINGBUFFER_H_
+#define _RINGBUFFER_H_
+
+#pragma once
+
+#include <array>                // for std::array
+#include <cstddef>              // for std::size_t
+#include <utility>              // for std::move
+#include <boost/assert.hpp>     // for BOOST_ASSERT
+
+namespace freefallsolveeom {
+    //! A template class.
+    /*!
+        最大でN個の要素を保持する、先入れ先出しのリングバッファクラス
+        要素の領域はオブジェクト自身が持つため、push()とpop()でヒープの確保は一切行わない
+        \tparam T 要素の型（デフォルトコンストラクタで構築できなければならない）
+        \tparam N 保持できる要素の最大数
+    */
+    template <typename T, std::size_t N>
+    class RingBuffer final {
+        static_assert(N > 0, "Nは1以上でなければならない");
+
+        // #region コンストラクタ・デストラクタ
+
+    public:
+        //! A constructor.
+        /*!
+            空のリングバッファを構築するコンストラクタ
+        */
+        RingBuffer() = default;
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~RingBuffer() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            最後に追加した要素を返す（empty()がfalseの場合に限り呼び出せる）
+            \return 最後に追加した要素
+        */
+        T & back()
+        {
+            BOOST_ASSERT(size_ > 0);
+
+            return buf_[(head_ + size_ - 1) % N];
+        }
+
+        //! A public member function (const).
+        /*!
+            最後に追加した要素を返す（empty()がfalseの場合に限り呼び出せる）
+            \return 最後に追加した要素
+        */
+        T const & back() const
+        {
+            BOOST_ASSERT(size_ > 0);
+
+            return buf_[(head_ + size_ - 1) % N];
+        }
+
+        //! A public member function (const).
+        /*!
+            要素が無いかどうかを返す
+            \return 要素が無いかどうか
+        */
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        //! A public member function.
+        /*!
+            最も古い要素を返す（empty()がfalseの場合に限り呼び出せる）
+            \return 最も古い要素
+        */
+        T & front()
+        {
+            BOOST_ASSERT(size_ > 0);
+
+            return buf_[head_];
+        }
+
+        //! A public member function (const).
+        /*!
+            最も古い要素を返す（empty()がfalseの場合に限り呼び出せる）
+            \return 最も古い要素
+        */
+        T const & front() const
+        {
+            BOOST_ASSERT(size_ > 0);
+
+            return buf_[head_];
+        }
+
+        //! A public member function (const).
+        /*!
+            要素がN個あるかどうかを返す
+            \return 要素がN個あるかどうか
+        */
+        bool full() const
+        {
+            return size_ == N;
+        }
+
+        //! A public member function.
+        /*!
+            最も古い要素を取り除く（empty()がfalseの場合に限り呼び出せる）
+        */
+        void pop()
+        {
+            BOOST_ASSERT(size_ > 0);
+
+            head_ = (head_ + 1) % N;
+            size_--;
+        }
+
+        //! A public member function.
+        /*!
+            要素を末尾に追加する（full()がfalseの場合に限り呼び出せる）
+            \param value 追加する要素
+        */
+        void push(T value)
+        {
+            BOOST_ASSERT(size_ < N);
+
+            buf_[(head_ + size_) % N] = std::move(value);
+            size_++;
+        }
+
+        //! A public member function (const).
+        /*!
+            要素の数を返す
+            \return 要素の数
+        */
+        std::size_t size() const
+        {
+            return size_;
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            要素の領域
+        */
+        std::array<T, N> buf_{};
+
+        //! A private member variable.
+        /*!
+            最も古い要素の位置
+        */
+        std::size_t head_ = 0;
+
+        //! A private member variable.
+        /*!
+            要素の数
+        */
+        std::size_t size_ = 0;
+
+        // #endregion メンバ変数
+    };
+}
+
+#endif  // _RINGBUFFER_H_
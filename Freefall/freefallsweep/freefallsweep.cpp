@@ -0,0 +1,328 @@
+﻿/*! \file freefallsweep.cpp
+    \brief パラメータの格子を分割し、複数のワーカープロセスで運動方程式を解くパラメータスイープのドライバ
+
+    使い方:
+        freefallsweep run 結果ファイル [--m 最初 最後 個数] [--r 最初 最後 個数] [--h0 最初 最後 個数] [--v0 最初 最後 個数]
+                      [--dt 時間刻み] [--eps 許容誤差] [--solver 数値解法] [--shards シャードの数] [--workers ワーカーの数]
+        結果ファイルが既に存在する場合は、その格子を用いて未完了の実行だけを再開する
+        freefallsweep query 結果ファイル 球の質量 球の半径 初期高度 初期速度 [--maxrelerr 許容する相対誤差]
+        結果ファイルを補間して近似的な結果と誤差の見積もりを表示する（格子の外か、誤差が大きい場合は運動方程式を解く）
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "../freefallsolveeom/solvesummary.h"
+#include "../freefallsolveeom/surrogate.h"
+#include "../freefallsolveeom/sweepresultfile.h"
+#include <array>                        // for std::array
+#include <algorithm>                    // for std::max, std::min
+#include <chrono>                       // for std::chrono::milliseconds
+#include <cstdint>                      // for std::int32_t, std::uint32_t, std::uint64_t
+#include <cstdlib>                      // for EXIT_FAILURE, EXIT_SUCCESS
+#include <iomanip>                      // for std::setprecision
+#include <iostream>                     // for std::cerr, std::cout
+#include <list>                         // for std::list
+#include <string>                       // for std::stod, std::stoi, std::stoul, std::stoull, std::string, std::to_string
+#include <thread>                       // for std::this_thread::sleep_for, std::thread::hardware_concurrency
+#include <utility>                      // for std::pair
+#include <boost/filesystem/path.hpp>    // for boost::filesystem::path
+#include <boost/process.hpp>            // for boost::process::args, boost::process::child, boost::process::exe, boost::process::search_path
+
+namespace freefallsweep {
+    using freefallsolveeom::solvesummary;
+    using freefallsolveeom::Surrogate;
+    using freefallsolveeom::SweepGrid;
+    using freefallsolveeom::SweepResultFile;
+
+    //! A struct.
+    /*!
+        シャード（連続した実行の番号の範囲）と、それを再起動した回数を表す構造体
+    */
+    struct Shard {
+        //! A public member variable.
+        /*!
+            最初の実行の番号
+        */
+        std::uint64_t begin;
+
+        //! A public member variable.
+        /*!
+            最後の実行の次の番号
+        */
+        std::uint64_t end;
+
+        //! A public member variable.
+        /*!
+            再起動した回数
+        */
+        std::int32_t retry;
+    };
+
+    // #region 関数の宣言
+
+    //! A function.
+    /*!
+        格子をシャードに分割し、各シャードをワーカープロセスで実行する（失敗したシャードは再起動する）
+        \param self この実行ファイルのパス
+        \param filename 結果ファイルのファイル名
+        \param nshards シャードの数
+        \param nworkers 同時に実行するワーカープロセスの数
+        \return 全てのシャードが完了したかどうか
+    */
+    bool coordinate(boost::filesystem::path const & self, std::string const & filename, std::uint64_t nshards, std::uint32_t nworkers);
+
+    //! A function.
+    /*!
+        ワーカープロセスとして、[begin, end)の範囲の未完了の実行を行う
+        \param filename 結果ファイルのファイル名
+        \param begin 最初の実行の番号
+        \param end 最後の実行の次の番号
+        \return 終了コード
+    */
+    std::int32_t work(std::string const & filename, std::uint64_t begin, std::uint64_t end);
+
+    //! A function.
+    /*!
+        結果ファイルを補間して問い合わせに答え、各列の値と誤差の見積もりを表示する
+        \param filename 結果ファイルのファイル名
+        \param params 球の質量m、球の半径r、初期高度h0、初期速度v0
+        \param maxrelerr 許容する相対誤差
+        \return 終了コード
+    */
+    std::int32_t query(std::string const & filename, std::array<double, 4> const & params, double maxrelerr);
+
+    // #endregion 関数の宣言
+
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        結果の列の名前
+    */
+    static std::array<char const *, SweepResultFile::NCOLUMNS> constexpr COLUMNNAMES = {
+        "timpact", "vimpact", "thmax", "hmax", "tvmax", "vmax", "tkarmanline", "vkarmanline", "texosphere", "vexosphere", "secondescape" };
+
+    //! A global variable (constant expression).
+    /*!
+        一つのシャードを再起動する最大の回数
+    */
+    static auto constexpr MAXRETRY = 3;
+
+    //! A global variable (constant expression).
+    /*!
+        問い合わせで既定で許容する相対誤差
+    */
+    static auto constexpr MAXRELERR = 1.0E-3;
+
+    // #endregion 定数
+}
+
+int main(int argc, char * argv[])
+{
+    using namespace freefallsweep;
+
+    if (argc == 5 && std::string(argv[1]) == "worker")
+    {
+        return work(argv[2], std::stoull(argv[3]), std::stoull(argv[4]));
+    }
+
+    if ((argc == 7 || argc == 9) && std::string(argv[1]) == "query")
+    {
+        if (argc == 9 && std::string(argv[7]) != "--maxrelerr")
+        {
+            std::cerr << "unknown option: " << argv[7] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return query(argv[2], { std::stod(argv[3]), std::stod(argv[4]), std::stod(argv[5]), std::stod(argv[6]) }, argc == 9 ? std::stod(argv[8]) : MAXRELERR);
+    }
+
+    if (argc < 3 || std::string(argv[1]) != "run")
+    {
+        std::cerr << "usage: freefallsweep run resultfile [--m first last n] [--r first last n] [--h0 first last n] [--v0 first last n]"
+                     " [--dt dt] [--eps eps] [--solver type] [--shards n] [--workers n]\n"
+                     "       freefallsweep query resultfile m r h0 v0 [--maxrelerr x]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string const filename(argv[2]);
+
+    // 既定の格子は、直径1cm、質量1gの球を高度0～100kmから初速0で落とす場合
+    SweepGrid grid{ { 0.001, 0.001, 1 }, { 0.005, 0.005, 1 }, { 0.0, 100000.0, 11 }, { 0.0, 0.0, 1 }, 0.01, 1.0E-8, 2 };
+    auto nworkers = std::max(std::thread::hardware_concurrency(), 1U);
+    std::uint64_t nshards = 0;
+
+    for (auto i = 3; i < argc; i++) {
+        std::string const opt(argv[i]);
+        auto const axis = opt == "--m" ? &grid.m : opt == "--r" ? &grid.r : opt == "--h0" ? &grid.h0 : opt == "--v0" ? &grid.v0 : nullptr;
+        if (axis && i + 3 < argc)
+        {
+            *axis = { std::stod(argv[i + 1]), std::stod(argv[i + 2]), std::stoull(argv[i + 3]) };
+            i += 3;
+        }
+        else if (opt == "--dt" && i + 1 < argc)
+        {
+            grid.dt = std::stod(argv[++i]);
+        }
+        else if (opt == "--eps" && i + 1 < argc)
+        {
+            grid.eps = std::stod(argv[++i]);
+        }
+        else if (opt == "--solver" && i + 1 < argc)
+        {
+            grid.ode_solver_type = std::stoi(argv[++i]);
+        }
+        else if (opt == "--shards" && i + 1 < argc)
+        {
+            nshards = std::stoull(argv[++i]);
+        }
+        else if (opt == "--workers" && i + 1 < argc)
+        {
+            nworkers = std::max(static_cast<std::uint32_t>(std::stoul(argv[++i])), 1U);
+        }
+        else
+        {
+            std::cerr << "unknown option: " << opt << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 既存の結果ファイルがあれば、それを再開する
+    auto result = SweepResultFile::open(filename);
+    if (!result)
+    {
+        if (!SweepResultFile::create(filename, grid))
+        {
+            std::cerr << "cannot create " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        result = SweepResultFile::open(filename);
+    }
+
+    auto const nruns = result->nruns();
+    result.reset();
+
+    // シャードの数を指定しなかった場合は、負荷を均すためにワーカーの数の4倍に分割する
+    nshards = std::min(nshards ? nshards : static_cast<std::uint64_t>(nworkers) * 4, nruns);
+
+    // ワーカープロセスとして、この実行ファイル自身を起動する
+    boost::filesystem::path self(argv[0]);
+    if (!self.has_parent_path())
+    {
+        self = boost::process::search_path(argv[0]);
+    }
+
+    return coordinate(self, filename, nshards, nworkers) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace freefallsweep {
+    // #region 関数の定義
+
+    bool coordinate(boost::filesystem::path const & self, std::string const & filename, std::uint64_t nshards, std::uint32_t nworkers)
+    {
+        auto const nruns = SweepResultFile::open(filename)->nruns();
+
+        std::list<Shard> waiting;
+        for (std::uint64_t k = 0; k < nshards; k++) {
+            waiting.push_back({ nruns * k / nshards, nruns * (k + 1) / nshards, 0 });
+        }
+
+        std::list< std::pair<Shard, boost::process::child> > running;
+        auto failed = false;
+
+        while (!waiting.empty() || !running.empty()) {
+            while (!waiting.empty() && running.size() < nworkers) {
+                auto const shard = waiting.front();
+                waiting.pop_front();
+
+                running.emplace_back(
+                    shard,
+                    boost::process::child(
+                        boost::process::exe = self,
+                        boost::process::args = { "worker", filename, std::to_string(shard.begin), std::to_string(shard.end) }));
+            }
+
+            for (auto itr = running.begin(); itr != running.end();) {
+                auto & [shard, child] = *itr;
+                if (child.running())
+                {
+                    ++itr;
+                    continue;
+                }
+
+                child.wait();
+                if (child.exit_code() != EXIT_SUCCESS)
+                {
+                    // 完了した実行は結果ファイルに記録されているので、再起動したワーカーは残りの実行だけを行う
+                    if (shard.retry < MAXRETRY)
+                    {
+                        std::cerr << "shard [" << shard.begin << ", " << shard.end << ") failed with exit code " << child.exit_code() << ", restarting" << std::endl;
+                        waiting.push_back({ shard.begin, shard.end, shard.retry + 1 });
+                    }
+                    else
+                    {
+                        std::cerr << "shard [" << shard.begin << ", " << shard.end << ") failed " << MAXRETRY + 1 << " times, giving up" << std::endl;
+                        failed = true;
+                    }
+                }
+
+                itr = running.erase(itr);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        // 全てのワーカーが同じファイルの固定の位置に書き込んでいるので、マージのためのコピーは不要
+        auto const result = SweepResultFile::open(filename);
+        std::uint64_t ndone = 0;
+        for (std::uint64_t i = 0; i < nruns; i++) {
+            ndone += result->isdone(i) ? 1 : 0;
+        }
+
+        std::cout << ndone << " / " << nruns << " runs completed" << std::endl;
+
+        return !failed && ndone == nruns;
+    }
+
+    std::int32_t work(std::string const & filename, std::uint64_t begin, std::uint64_t end)
+    {
+        auto const result = SweepResultFile::open(filename);
+        if (!result || begin > end || end > result->nruns())
+        {
+            return EXIT_FAILURE;
+        }
+
+        for (auto i = begin; i < end; i++) {
+            if (!result->isdone(i))
+            {
+                result->store(i, solvesummary(result->grid(), result->grid()[i]));
+            }
+        }
+
+        result->flush();
+
+        return EXIT_SUCCESS;
+    }
+
+    std::int32_t query(std::string const & filename, std::array<double, 4> const & params, double maxrelerr)
+    {
+        auto const surrogate = Surrogate::load(filename);
+        if (!surrogate)
+        {
+            std::cerr << "cannot open " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        auto const [value, error, issurrogate] = (*surrogate)(params, maxrelerr);
+
+        std::cout << std::setprecision(10) << (issurrogate ? "interpolated" : "solved") << '\n';
+        for (auto j = 0U; j < SweepResultFile::NCOLUMNS; j++) {
+            std::cout << COLUMNNAMES[j] << ' ' << value[j] << " +/- " << error[j] << '\n';
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // #endregion 関数の定義
+}
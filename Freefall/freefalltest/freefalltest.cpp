@@ -0,0 +1,591 @@
+﻿/*! \file freefalltest.cpp
+    \brief 空気抵抗のある自由落下系に対して運動方程式を解くクラスが、約束した性質を満たしているかを確かめるテスト
+
+    使い方:
+        freefalltest
+    各テストの結果を一行ずつ表示し、全てのテストが期待どおりの結果であれば0を、そうでなければ1を返す
+    PASSは期待どおりに成功、XFAILは既知の制限により期待どおりに失敗、FAILとXPASSは期待と異なる結果を表す
+    （XPASSは既知の制限が解消されたことを表すので、期待する結果を更新する）
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "../freefallsolveeom/freefallsolveeom.h"
+#include <algorithm>                    // for std::clamp, std::copy, std::max, std::min_element, std::nth_element
+#include <array>                        // for std::array
+#include <atomic>                       // for std::atomic
+#include <cmath>                        // for std::fabs, std::lround
+#include <cstdint>                      // for std::int32_t, std::uint64_t
+#include <cstdio>                       // for std::remove
+#include <cstdlib>                      // for EXIT_FAILURE, EXIT_SUCCESS, std::free, std::malloc
+#include <exception>                    // for std::exception
+#include <iostream>                     // for std::cout
+#include <new>                          // for std::bad_alloc, std::nothrow, std::nothrow_t
+#include <optional>                     // for std::optional
+#include <sstream>                      // for std::ostringstream
+#include <string>                       // for std::string, std::to_string
+#include <vector>                       // for std::vector
+
+namespace freefalltest {
+    //! A typedef.
+    /*!
+        空気抵抗のある自由落下系に対して運動方程式を解くクラスの型
+    */
+    using FreefallSolveEom = freefallsolveeom::FreefallSolveEom<>;
+
+    //! A struct.
+    /*!
+        テストに用いる条件を表す構造体
+    */
+    struct Condition {
+        //! A public member variable.
+        /*!
+            条件の名前
+        */
+        char const * name;
+
+        //! A public member variable.
+        /*!
+            球の質量（kg）
+        */
+        double m;
+
+        //! A public member variable.
+        /*!
+            球の半径（m）
+        */
+        double r;
+
+        //! A public member variable.
+        /*!
+            初期高度（m）
+        */
+        double h0;
+
+        //! A public member variable.
+        /*!
+            初期速度（m/s）
+        */
+        double v0;
+
+        //! A public member variable.
+        /*!
+            硬い条件かどうか（時間刻みが固定のAdams-Bashforth-Moulton法では発散するので除く）
+        */
+        bool isstiff;
+    };
+
+    // #region 関数の宣言
+
+    //! A function.
+    /*!
+        テストの結果を表示し、期待どおりだったかどうかを返す
+        \param name テストの名前
+        \param ispassed テストが成功したかどうか
+        \param isexpectedtofail 既知の制限により失敗すると期待しているかどうか
+        \param detail 結果の詳細
+        \return 期待どおりの結果だったかどうか
+    */
+    bool report(std::string const & name, bool ispassed, bool isexpectedtofail, std::string const & detail);
+
+    //! A function.
+    /*!
+        各条件とAUTOについて、enableadaptivesampling()で間引いた点が、グラフプロット用の時間間隔ごとの点より少なく、
+        時間刻みごとの状態の二階差分（曲がり）が最大となる時刻では点の間隔が中央値より狭く、
+        グラフプロット用の時間間隔ごとの点を結ぶだけでは許容誤差に収まらない場合はTINTERVALより狭い間隔の点を含み、
+        点を直線で結んだ折れ線から時間刻みごとの状態までのずれが、許容誤差以内であることを確かめる
+        \return 全ての結果が期待どおりだったかどうか
+    */
+    bool testadaptivesampling();
+
+    //! A function.
+    /*!
+        各条件と各数値解法と各出力の方法（出力しない、ファイルに書き出す、グラフに出力する点を間引く）について、
+        最初の数回のoperator()の後、地面に衝突するまでoperator()を呼び出す間に、計算側のスレッドでグローバルなoperator newが一度も呼ばれないことを確かめる
+        （ファイルを書き出すスレッドは、索引や圧縮の作業領域を確保するので数えない）
+        \return 全ての結果が期待どおりだったかどうか
+    */
+    bool testallocation();
+
+    //! A function.
+    /*!
+        各条件と空気抵抗が支配的な条件について、Adams-Bashforth-Moulton法からRosenbrock法までの各数値解法で、
+        parareal()が例外を投げずに地面に衝突した時刻をsummary()とMAXEVENTTIMESHIFT以内で求め、
+        反復の回数がスライスの数より少ない（粗い伝播が発散して逐次的な積分に落ちていない）ことを確かめる
+        （硬い条件では、Adams-Bashforth-Moulton法は除く）
+        \return 全ての結果が期待どおりだったかどうか
+    */
+    bool testparareal();
+
+    //! A function.
+    /*!
+        各条件と各数値解法について、enabletoleranceschedule()で許容誤差をEPSの100倍まで緩めた場合と緩めない場合とで、
+        summary()が返す各事象の有無が一致し、各事象の時刻のずれがMAXEVENTTIMESHIFT以下であることを確かめる
+        （ずれに保証された上界はないので、これらの条件について経験的に確かめる回帰テストである）
+        （Adams-Bashforth-Moulton法ではenabletoleranceschedule()は何もしないので除く）
+        \return 全ての結果が期待どおりだったかどうか
+    */
+    bool testtoleranceschedule();
+
+    // #endregion 関数の宣言
+
+    // #region 列挙型
+
+    //!  A enumerated type
+    /*!
+        testallocation()で確かめる、計算結果の出力の方法を表す列挙型
+    */
+    enum class Output : std::int32_t {
+        // 出力しない
+        NONE,
+        // ファイルに書き出す
+        FILE,
+        // グラフに出力する点を間引く
+        ADAPTIVESAMPLING
+    };
+
+    // #endregion 列挙型
+
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        テストに用いる条件（真空に近い高層からの落下と、打ち上げてからの落下と、
+        ヤコビアンのスペクトル半径と時間刻みの積がSTIFFTHRESHOLDを超え、AUTOがRosenbrock法に切り替える微小な球の落下）
+    */
+    static std::array<Condition, 3> constexpr CONDITIONS = {{
+        { "drop", 0.001, 0.005, 100000.0, 0.0, false },
+        { "launch", 0.001, 0.005, 1000.0, 100.0, false },
+        { "stiff", 1.0E-11, 1.0E-4, 0.2, 0.0, true } }};
+
+    //! A global variable (constant expression).
+    /*!
+        parareal()のテストに用いる、空気抵抗が支配的な条件（速度の緩和時間が約0.36秒で、粗い伝播の最大の時間刻みより短い）
+    */
+    static Condition constexpr DRAGDOMINATEDCONDITION = { "drag dominated", 1.0E-4, 0.01, 3000.0, 0.0, false };
+
+    //! A global variable (constant expression).
+    /*!
+        常微分方程式の数値解法の時間刻み（秒）
+    */
+    static auto constexpr DT = 0.01;
+
+    //! A global variable (constant expression).
+    /*!
+        常微分方程式の数値解法の許容誤差
+    */
+    static auto constexpr EPS = 1.0E-8;
+
+    //! A global variable (constant expression).
+    /*!
+        testallocation()で書き出すファイルのファイル名
+    */
+    static char const * const FILENAME = "freefalltest.csv";
+
+    //! A global variable (constant expression).
+    /*!
+        enableadaptivesampling()に渡す許容誤差（GUIと同じ値）
+    */
+    static auto constexpr GRAPHRELTOL = 1.0E-3;
+
+    //! A global variable (constant expression).
+    /*!
+        enableadaptivesampling()に渡す、グラフプロット用の時間間隔に対する返す点の最大の間隔の倍率（GUIと同じ値）
+    */
+    static auto constexpr GRAPHMAXGAPRATIO = 100.0;
+
+    //! A global variable (constant expression).
+    /*!
+        parareal()や、許容誤差を緩めた場合に許す、事象の時刻のずれ（秒）（GUIは時刻を小数点以下1桁で表示するので、その1/20とする）
+    */
+    static auto constexpr MAXEVENTTIMESHIFT = 5.0E-3;
+
+    //! A global variable (constant expression).
+    /*!
+        parareal()で一度に並列に積分するスライスの数
+    */
+    static std::size_t constexpr PARAREALSLICES = 16;
+
+    //! A global variable (constant expression).
+    /*!
+        enabletoleranceschedule()に渡す、元の許容誤差に対する最も緩い許容誤差の倍率（GUIと同じ値）
+    */
+    static auto constexpr TOLERANCESCHEDULERATIO = 100.0;
+
+    //! A global variable (constant expression).
+    /*!
+        グラフプロット用の時間間隔（秒）
+    */
+    static auto constexpr TINTERVAL = 0.1;
+
+    //! A global variable (constant expression).
+    /*!
+        parareal()で積分する最大の時間（秒）
+    */
+    static auto constexpr TMAX = 1.0E+6;
+
+    //! A global variable (constant expression).
+    /*!
+        ヒープの確保を数え始めるまでに呼び出すoperator()の回数（ステッパーの作業領域などは、最初の数回の呼び出しで確保してよい）
+    */
+    static auto constexpr WARMUPCALLS = 3;
+
+    // #endregion 定数
+
+    // #region 変数
+
+    //! A global variable.
+    /*!
+        このスレッドでoperator newの呼び出しを数えているかどうか
+    */
+    static thread_local bool iscounting = false;
+
+    //! A global variable.
+    /*!
+        数えたoperator newの呼び出しの回数
+    */
+    static std::atomic<std::uint64_t> nallocations = 0;
+
+    // #endregion 変数
+}
+
+// #region グローバルなoperator new・operator deleteの置き換え
+
+void * operator new(std::size_t size)
+{
+    if (freefalltest::iscounting)
+    {
+        freefalltest::nallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (auto const p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void * operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+    try {
+        return ::operator new(size);
+    }
+    catch (std::bad_alloc const &) {
+        return nullptr;
+    }
+}
+
+void * operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// #endregion グローバルなoperator new・operator deleteの置き換え
+
+int main()
+{
+    using namespace freefalltest;
+
+    auto isexpected = true;
+    isexpected = testadaptivesampling() && isexpected;
+    isexpected = testallocation() && isexpected;
+    isexpected = testparareal() && isexpected;
+    isexpected = testtoleranceschedule() && isexpected;
+
+    std::cout << (isexpected ? "all tests behaved as expected" : "some tests did not behave as expected") << std::endl;
+
+    return isexpected ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace freefalltest {
+    // #region 関数の定義
+
+    bool report(std::string const & name, bool ispassed, bool isexpectedtofail, std::string const & detail)
+    {
+        char const * const result = ispassed ? (isexpectedtofail ? "XPASS" : "PASS") : (isexpectedtofail ? "XFAIL" : "FAIL");
+        std::cout << result << ' ' << name << ": " << detail << std::endl;
+
+        return ispassed != isexpectedtofail;
+    }
+
+    bool testadaptivesampling()
+    {
+        using Ode_Solver_type = FreefallSolveEom::Ode_Solver_type;
+
+        auto isexpected = true;
+        for (auto const & condition : CONDITIONS) {
+            // 時間刻みごとの状態を、補間の節点から求める
+            FreefallSolveEom stepped(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, Ode_Solver_type::AUTO);
+            stepped.enabledenseoutput();
+            for ([[maybe_unused]] auto const & sample : stepped.samples()) {
+            }
+
+            auto const & denseoutput = *stepped.denseoutput();
+            std::vector<FreefallSolveEom::sampletype> steps;
+            for (auto i = 0; static_cast<double>(i) * DT < denseoutput.tend(); i++) {
+                auto const [h, v] = denseoutput(static_cast<double>(i) * DT);
+                steps.push_back({ static_cast<double>(i) * DT, h, v });
+            }
+
+            auto const [hend, vend] = denseoutput(denseoutput.tend());
+            steps.push_back({ denseoutput.tend(), hend, vend });
+
+            // 間引いた点を求める
+            FreefallSolveEom sampled(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, Ode_Solver_type::AUTO);
+            sampled.enableadaptivesampling(GRAPHRELTOL, GRAPHMAXGAPRATIO * TINTERVAL);
+
+            std::vector<FreefallSolveEom::sampletype> samples;
+            for (auto const & sample : sampled.samples()) {
+                samples.push_back(sample);
+            }
+
+            auto hscale = 0.0;
+            auto vscale = 0.0;
+            for (auto const & [t, h, v] : steps) {
+                hscale = std::max(hscale, std::fabs(h));
+                vscale = std::max(vscale, std::fabs(v));
+            }
+
+            // 状態sと、点aと点bを直線で結んだ折れ線とのずれを、高度と速度の最大の絶対値に対する比で求める
+            auto const deviation = [hscale, vscale](FreefallSolveEom::sampletype const & s, FreefallSolveEom::sampletype const & a, FreefallSolveEom::sampletype const & b) {
+                auto const w = b[0] > a[0] ? std::clamp((s[0] - a[0]) / (b[0] - a[0]), 0.0, 1.0) : 0.0;
+
+                return std::max(std::fabs(s[1] - (a[1] + w * (b[1] - a[1]))) / hscale, std::fabs(s[2] - (a[2] + w * (b[2] - a[2]))) / vscale);
+            };
+
+            // 規格化した二階差分（曲がり）が最大となる時刻と、グラフプロット用の時間間隔ごとの点を結ぶだけでは許容誤差に収まらないかどうかを求める
+            // （地面に衝突した点の前は時間刻みが揃わないので除く）
+            auto const nstep = static_cast<std::size_t>(std::lround(TINTERVAL / DT));
+            auto maxcurvature = 0.0;
+            auto tpeak = 0.0;
+            auto isgridtoocoarse = false;
+            for (std::size_t i = 1; i + 2 < steps.size(); i++) {
+                auto const curvature = std::max(
+                    std::fabs(steps[i + 1][1] - 2.0 * steps[i][1] + steps[i - 1][1]) / hscale,
+                    std::fabs(steps[i + 1][2] - 2.0 * steps[i][2] + steps[i - 1][2]) / vscale);
+                if (curvature > maxcurvature)
+                {
+                    maxcurvature = curvature;
+                    tpeak = steps[i][0];
+                }
+
+                auto const first = i / nstep * nstep;
+                if (first + nstep + 1 < steps.size() && deviation(steps[i], steps[first], steps[first + nstep]) > GRAPHRELTOL)
+                {
+                    isgridtoocoarse = true;
+                }
+            }
+
+            // 点の間隔の中央値と最小値、曲がりが最大となる時刻を含む間隔（時刻が点と重なる場合は両側の狭い方）を求める
+            std::vector<double> gaps;
+            auto gapatpeak = GRAPHMAXGAPRATIO * TINTERVAL;
+            for (std::size_t i = 1; i < samples.size(); i++) {
+                gaps.push_back(samples[i][0] - samples[i - 1][0]);
+                if (samples[i - 1][0] <= tpeak && tpeak <= samples[i][0])
+                {
+                    gapatpeak = std::min(gapatpeak, gaps.back());
+                }
+            }
+
+            auto const mingap = *std::min_element(gaps.begin(), gaps.end());
+            std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+            auto const mediangap = gaps[gaps.size() / 2];
+
+            // 時間刻みごとの状態から、間引いた点を直線で結んだ折れ線までのずれの最大値を求める
+            auto maxerror = 0.0;
+            std::size_t j = 1;
+            for (auto const & s : steps) {
+                while (j + 1 < samples.size() && samples[j][0] < s[0]) {
+                    j++;
+                }
+
+                maxerror = std::max(maxerror, deviation(s, samples[j - 1], samples[j]));
+            }
+
+            auto const ngrid = static_cast<std::size_t>(steps.back()[0] / TINTERVAL) + 1;
+
+            std::ostringstream detail;
+            detail << samples.size() << " samples for " << ngrid << " grid points, gap " << gapatpeak << " s at t = " << tpeak << " s (median " << mediangap
+                   << " s, min " << mingap << " s" << (isgridtoocoarse ? ", grid too coarse" : "") << "), max relative error " << maxerror;
+            isexpected = report(
+                std::string("adaptive sampling ") + condition.name,
+                samples.size() < ngrid && gapatpeak < mediangap && (!isgridtoocoarse || mingap < TINTERVAL) && maxerror <= GRAPHRELTOL,
+                false,
+                detail.str()) && isexpected;
+        }
+
+        return isexpected;
+    }
+
+    bool testallocation()
+    {
+        using Ode_Solver_type = FreefallSolveEom::Ode_Solver_type;
+
+        auto isexpected = true;
+        for (auto const & condition : CONDITIONS) {
+            auto const first = condition.isstiff ? Ode_Solver_type::BULIRSCH_STOER : Ode_Solver_type::ADAMS_BASHFORTH_MOULTON;
+            for (auto solver = static_cast<std::int32_t>(first); solver <= static_cast<std::int32_t>(Ode_Solver_type::AUTO); solver++) {
+                for (auto output = static_cast<std::int32_t>(Output::NONE); output <= static_cast<std::int32_t>(Output::ADAPTIVESAMPLING); output++) {
+                    auto const ode_solver_type = static_cast<Ode_Solver_type>(solver);
+                    std::optional<FreefallSolveEom> fse;
+                    if (static_cast<Output>(output) == Output::FILE)
+                    {
+                        fse.emplace(DT, TINTERVAL, DT, FILENAME, freefallsolveeom::TrajectoryWriter::Format::CSV, freefallsolveeom::TrajectoryWriter::Compression::NONE, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+                    }
+                    else
+                    {
+                        fse.emplace(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+                    }
+
+                    if (static_cast<Output>(output) == Output::ADAPTIVESAMPLING)
+                    {
+                        fse->enableadaptivesampling(GRAPHRELTOL, GRAPHMAXGAPRATIO * TINTERVAL);
+                    }
+
+                    for (auto i = 0; i < WARMUPCALLS && !fse->isCalculationFinished(); i++) {
+                        (*fse)();
+                    }
+
+                    // 計算が終了するまでの間だけ、このスレッドでのoperator newの呼び出しを数える
+                    std::uint64_t ncalls = 0;
+                    nallocations = 0;
+                    iscounting = true;
+                    while (!fse->isCalculationFinished()) {
+                        (*fse)();
+                        ncalls++;
+                    }
+
+                    iscounting = false;
+
+                    fse.reset();
+                    std::remove(FILENAME);
+
+                    isexpected = report(
+                        std::string("allocation ") + condition.name + " solver " + std::to_string(solver) + " output " + std::to_string(output),
+                        nallocations == 0,
+                        false,
+                        std::to_string(nallocations) + " allocations in " + std::to_string(ncalls) + " calls") && isexpected;
+                }
+            }
+        }
+
+        return isexpected;
+    }
+
+    bool testparareal()
+    {
+        using Ode_Solver_type = FreefallSolveEom::Ode_Solver_type;
+
+        std::array<Condition, CONDITIONS.size() + 1> conditions;
+        std::copy(CONDITIONS.begin(), CONDITIONS.end(), conditions.begin());
+        conditions.back() = DRAGDOMINATEDCONDITION;
+
+        auto isexpected = true;
+        for (auto const & condition : conditions) {
+            auto const first = condition.isstiff ? Ode_Solver_type::BULIRSCH_STOER : Ode_Solver_type::ADAMS_BASHFORTH_MOULTON;
+            for (auto solver = static_cast<std::int32_t>(first); solver <= static_cast<std::int32_t>(Ode_Solver_type::ROSENBROCK); solver++) {
+                auto const ode_solver_type = static_cast<Ode_Solver_type>(solver);
+                FreefallSolveEom reference(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+                FreefallSolveEom parallel(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+
+                auto const name = std::string("parareal ") + condition.name + " solver " + std::to_string(solver);
+                try {
+                    auto const expected = reference.summary();
+                    auto const actual = parallel.parareal(TMAX, PARAREALSLICES, 0);
+
+                    auto const ismatched = expected.impact.has_value() == actual.impact.has_value();
+                    auto const shift = ismatched && expected.impact ? std::fabs(std::get<0>(*expected.impact) - actual.impact->first) : 0.0;
+
+                    std::ostringstream detail;
+                    detail << (ismatched ? "impact time shift " : "impact occurrence differs, impact time shift ") << shift << " s in " << actual.iterations << " iterations";
+                    isexpected = report(
+                        name,
+                        ismatched && shift <= MAXEVENTTIMESHIFT && actual.iterations < static_cast<std::int32_t>(PARAREALSLICES),
+                        false,
+                        detail.str()) && isexpected;
+                }
+                catch (std::exception const & e) {
+                    isexpected = report(name, false, false, std::string("exception: ") + e.what()) && isexpected;
+                }
+            }
+        }
+
+        return isexpected;
+    }
+
+    bool testtoleranceschedule()
+    {
+        using Ode_Solver_type = FreefallSolveEom::Ode_Solver_type;
+
+        auto isexpected = true;
+        for (auto const & condition : CONDITIONS) {
+            for (auto solver = static_cast<std::int32_t>(Ode_Solver_type::BULIRSCH_STOER); solver <= static_cast<std::int32_t>(Ode_Solver_type::AUTO); solver++) {
+                auto const ode_solver_type = static_cast<Ode_Solver_type>(solver);
+                FreefallSolveEom reference(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+                FreefallSolveEom scheduled(DT, TINTERVAL, EPS, condition.m, condition.r, condition.h0, condition.v0, ode_solver_type);
+                scheduled.enabletoleranceschedule(EPS * TOLERANCESCHEDULERATIO);
+
+                auto const expected = reference.summary();
+                auto const actual = scheduled.summary();
+
+                // 各事象について、有無が一致しているかを確かめ、両方で起きた場合は時刻のずれの最大値を求める
+                auto ismatched = true;
+                auto maxshift = 0.0;
+                auto const compare = [&ismatched, &maxshift](auto const & lhs, auto const & rhs) {
+                    if (lhs.has_value() != rhs.has_value())
+                    {
+                        ismatched = false;
+                    }
+                    else if (lhs)
+                    {
+                        maxshift = std::max(maxshift, std::fabs(std::get<0>(*lhs) - std::get<0>(*rhs)));
+                    }
+                };
+
+                compare(expected.impact, actual.impact);
+                compare(expected.hmax, actual.hmax);
+                compare(expected.vmax, actual.vmax);
+                compare(expected.karmanline, actual.karmanline);
+                compare(expected.exosphere, actual.exosphere);
+
+                std::ostringstream detail;
+                detail << (ismatched ? "max event time shift " : "event occurrence differs, max event time shift ") << maxshift << " s";
+                isexpected = report(
+                    std::string("tolerance schedule ") + condition.name + " solver " + std::to_string(solver),
+                    ismatched && maxshift <= MAXEVENTTIMESHIFT,
+                    false,
+                    detail.str()) && isexpected;
+            }
+        }
+
+        return isexpected;
+    }
+
+    // #endregion 関数の定義
+}
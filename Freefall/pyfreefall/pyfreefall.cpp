@@ -0,0 +1,473 @@
+﻿/*! \file pyfreefall.cpp
+    \brief 空気抵抗のある自由落下系に対して運動方程式を解くクラスのPythonバインディング
+
+    使い方（Python）:
+        import pyfreefall
+        trajectory, events = pyfreefall.solve(m, r, h0, v0, dt=0.01, tinterval=0.1, eps=1.0E-8, solver=2)
+        results = pyfreefall.solvebatch(ms, rs, h0s, v0s, dt=0.01, eps=1.0E-8, solver=2)
+        trajectory, impact, iterations = pyfreefall.solveparareal(m, r, h0, v0, dt=0.01, tinterval=0.1, eps=1.0E-8, solver=2, tmax=1.0E+6, slices=64, threads=0)
+    trajectoryは「時間 高度 速度」を行とする(N, 3)の配列、eventsは要素数NCOLUMNSの配列、resultsは(実行の数, NCOLUMNS)の配列
+    impactは地面に衝突した際の時間と速度のタプル（衝突しなかった場合はNone）
+    いずれもC++側で確保したバッファをコピーせずにそのまま参照する
+    計算中はGILを解放するため、Pythonの複数のスレッドから同時に呼び出すと並列に計算される
+
+    Copyright © 2018 @dc1394 All Rights Reserved.
+    This software is released under the BSD 2-Clause License.
+*/
+#include "../freefallsolveeom/freefallsolveeom.h"
+#include "../freefallsolveeom/solvesummary.h"
+#include <algorithm>                    // for std::copy, std::max
+#include <array>                        // for std::array
+#include <cstdint>                      // for std::int32_t, std::uint32_t
+#include <memory>                       // for std::make_unique, std::shared_ptr, std::unique_ptr
+#include <optional>                     // for std::make_optional, std::nullopt
+#include <thread>                       // for std::thread::hardware_concurrency
+#include <tuple>                        // for std::get
+#include <utility>                      // for std::make_pair, std::move
+#include <vector>                       // for std::vector
+#include <boost/python.hpp>             // for BOOST_PYTHON_MODULE, boost::python::class_, boost::python::def
+#include <boost/python/numpy.hpp>       // for boost::python::numpy::from_data, boost::python::numpy::from_object, boost::python::numpy::ndarray
+
+namespace pyfreefall {
+    namespace py = boost::python;
+    namespace np = boost::python::numpy;
+
+    //! A typedef.
+    /*!
+        空気抵抗のある自由落下系に対して運動方程式を解くクラスの型
+    */
+    using FreefallSolveEom = freefallsolveeom::FreefallSolveEom<>;
+
+    // #region 定数
+
+    //! A global variable (constant expression).
+    /*!
+        事象の列の数（地面衝突時の時間、地面衝突時の速度、最高到達高度の際の時間、最高到達高度、最高速度の際の時間、最高速度、
+        カーマン・ライン突破時の時間、カーマン・ライン突破時の速度、外気圏脱出時の時間、外気圏脱出時の速度、第二宇宙速度以上だったかどうかの順で、
+        freefallsweepの結果ファイルの列と同じ並び）
+    */
+    static auto constexpr NCOLUMNS = freefallsolveeom::SweepResultFile::NCOLUMNS;
+
+    // #endregion 定数
+
+    //! A class.
+    /*!
+        C++側で確保したdoubleの配列を保持するクラス
+        NumPyの配列の所有者（base）として参照され、全ての配列が解放されるまで生存する
+    */
+    class NativeBuffer final {
+    public:
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ
+            \param data 保持する配列
+        */
+        explicit NativeBuffer(std::vector<double> && data) : data_(std::move(data))
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デフォルトデストラクタ
+        */
+        ~NativeBuffer() = default;
+
+        // #endregion コンストラクタ・デストラクタ
+
+        // #region publicメンバ関数
+
+        //! A public member function.
+        /*!
+            配列の先頭へのポインタを返す
+            \return 配列の先頭へのポインタ
+        */
+        double * data()
+        {
+            return data_.data();
+        }
+
+        //! A public member function (const).
+        /*!
+            配列の要素数を返す
+            \return 配列の要素数
+        */
+        std::size_t size() const
+        {
+            return data_.size();
+        }
+
+        // #endregion publicメンバ関数
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            保持する配列
+        */
+        std::vector<double> data_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public constructor (deleted).
+        /*!
+            デフォルトコンストラクタ（禁止）
+        */
+        NativeBuffer() = delete;
+
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        NativeBuffer(NativeBuffer const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        NativeBuffer & operator=(NativeBuffer const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    //! A class.
+    /*!
+        スコープの間だけGILを解放するクラス
+    */
+    class ScopedGILRelease final {
+    public:
+        // #region コンストラクタ・デストラクタ
+
+        //! A constructor.
+        /*!
+            唯一のコンストラクタ（GILを解放する）
+        */
+        ScopedGILRelease() : state_(PyEval_SaveThread())
+        {
+        }
+
+        //! A destructor.
+        /*!
+            デストラクタ（GILを再び取得する）
+        */
+        ~ScopedGILRelease()
+        {
+            PyEval_RestoreThread(state_);
+        }
+
+        // #endregion コンストラクタ・デストラクタ
+
+    private:
+        // #region メンバ変数
+
+        //! A private member variable.
+        /*!
+            解放したスレッドの状態
+        */
+        PyThreadState * state_;
+
+        // #endregion メンバ変数
+
+        // #region 禁止されたコンストラクタ・メンバ関数
+
+    public:
+        //! A public copy constructor (deleted).
+        /*!
+            コピーコンストラクタ（禁止）
+        */
+        ScopedGILRelease(ScopedGILRelease const &) = delete;
+
+        //! A public member function (deleted).
+        /*!
+            operator=()の宣言（禁止）
+            \return コピー元のオブジェクト
+        */
+        ScopedGILRelease & operator=(ScopedGILRelease const &) = delete;
+
+        // #endregion 禁止されたコンストラクタ・メンバ関数
+    };
+
+    // #region 関数の宣言
+
+    //! A function.
+    /*!
+        Pythonのオブジェクト（スカラーまたは1次元の配列）をdoubleの配列に変換する
+        \param obj 変換するオブジェクト
+        \param name 引数の名前（例外のメッセージに用いる）
+        \return 変換した配列
+    */
+    std::vector<double> asvector(py::object const & obj, char const * name);
+
+    //! A function.
+    /*!
+        一つの条件で運動方程式を最後まで解き、軌道と各事象の値を返す
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param dt 常微分方程式の数値解法の時間刻み（秒）
+        \param tinterval 軌道を記録する時間間隔（秒）
+        \param eps 常微分方程式の数値解法の許容誤差
+        \param solver 常微分方程式の数値解法（FreefallSolveEom::Ode_Solver_typeの値）
+        \return 軌道（(N, 3)の配列）と各事象の値（要素数NCOLUMNSの配列）のタプル
+    */
+    py::tuple solve(double m, double r, double h0, double v0, double dt, double tinterval, double eps, std::int32_t solver);
+
+    //! A function.
+    /*!
+        複数の条件で運動方程式を最後まで解き、各事象の値を返す
+        m、r、h0、v0は同じ要素数の1次元の配列で、スカラー（要素数1）の場合は全ての実行に共通の値として用いる
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param dt 常微分方程式の数値解法の時間刻み（秒）
+        \param eps 常微分方程式の数値解法の許容誤差
+        \param solver 常微分方程式の数値解法（FreefallSolveEom::Ode_Solver_typeの値）
+        \return 各事象の値（(実行の数, NCOLUMNS)の配列）
+    */
+    np::ndarray solvebatch(py::object const & m, py::object const & r, py::object const & h0, py::object const & v0, double dt, double eps, std::int32_t solver);
+
+    //! A function.
+    /*!
+        一つの条件で運動方程式をパラレアル法で時間方向に並列に解き、軌道と地面に衝突した際の状態を返す
+        \param m 球の質量（kg）
+        \param r 球の半径（m）
+        \param h0 初期高度（m）
+        \param v0 初期速度（m/s）
+        \param dt 常微分方程式の数値解法の時間刻み（秒）
+        \param tinterval 軌道を記録する時間間隔（秒）
+        \param eps 常微分方程式の数値解法の許容誤差
+        \param solver 常微分方程式の数値解法（FreefallSolveEom::Ode_Solver_typeの値）
+        \param tmax 積分する最大の時間（秒）
+        \param slices 一度に並列に積分するスライスの数
+        \param threads スレッドの数（0の場合は論理コアの数）
+        \return 軌道（(N, 3)の配列）、地面に衝突した際の時間と速度のタプル（衝突しなかった場合はNone）、反復の回数のタプル
+    */
+    py::tuple solveparareal(double m, double r, double h0, double v0, double dt, double tinterval, double eps, std::int32_t solver, double tmax, std::int32_t slices, std::int32_t threads);
+
+    //! A function.
+    /*!
+        C++側の配列の所有権をNumPyの配列に移す（要素はコピーしない）
+        \param data 配列
+        \param nrow 行の数
+        \param ncolumn 列の数（0の場合は1次元の配列とする）
+        \return 配列を参照するNumPyの配列
+    */
+    np::ndarray tondarray(std::vector<double> && data, std::size_t nrow, std::size_t ncolumn);
+
+    //! A function.
+    /*!
+        常微分方程式の数値解法の種類を検査し、列挙型に変換する
+        \param solver 常微分方程式の数値解法
+        \return 常微分方程式の数値解法
+    */
+    FreefallSolveEom::Ode_Solver_type tosolvertype(std::int32_t solver);
+
+    // #endregion 関数の宣言
+}
+
+BOOST_PYTHON_MODULE(pyfreefall)
+{
+    using namespace pyfreefall;
+
+    np::initialize();
+
+    py::class_<NativeBuffer, boost::noncopyable>("NativeBuffer", py::no_init)
+        .def("__len__", &NativeBuffer::size);
+
+    py::scope().attr("NCOLUMNS") = NCOLUMNS;
+    py::scope().attr("COLUMNS") = py::make_tuple(
+        "timpact", "vimpact", "thmax", "hmax", "tvmax", "vmax", "tkarmanline", "vkarmanline", "texosphere", "vexosphere", "secondescape");
+
+    py::def(
+        "solve",
+        &solve,
+        (py::arg("m"), py::arg("r"), py::arg("h0"), py::arg("v0"), py::arg("dt") = 0.01, py::arg("tinterval") = 0.1, py::arg("eps") = 1.0E-8, py::arg("solver") = 2));
+
+    py::def(
+        "solvebatch",
+        &solvebatch,
+        (py::arg("m"), py::arg("r"), py::arg("h0"), py::arg("v0"), py::arg("dt") = 0.01, py::arg("eps") = 1.0E-8, py::arg("solver") = 2));
+
+    py::def(
+        "solveparareal",
+        &solveparareal,
+        (py::arg("m"), py::arg("r"), py::arg("h0"), py::arg("v0"), py::arg("dt") = 0.01, py::arg("tinterval") = 0.1, py::arg("eps") = 1.0E-8, py::arg("solver") = 2,
+         py::arg("tmax") = 1.0E+6, py::arg("slices") = 64, py::arg("threads") = 0));
+}
+
+namespace pyfreefall {
+    // #region 関数の定義
+
+    std::vector<double> asvector(py::object const & obj, char const * name)
+    {
+        auto const array = np::from_object(obj, np::dtype::get_builtin<double>(), 0, 1, np::ndarray::ALIGNED);
+        auto const n = array.get_nd() ? static_cast<std::size_t>(array.shape(0)) : 1U;
+        if (!n)
+        {
+            PyErr_Format(PyExc_ValueError, "%s must not be empty", name);
+            py::throw_error_already_set();
+        }
+
+        std::vector<double> v(n);
+        auto const stride = array.get_nd() ? array.strides(0) : 0;
+        for (std::size_t i = 0; i < n; i++) {
+            v[i] = *reinterpret_cast<double const *>(array.get_data() + static_cast<std::ptrdiff_t>(i) * stride);
+        }
+
+        return v;
+    }
+
+    py::tuple solve(double m, double r, double h0, double v0, double dt, double tinterval, double eps, std::int32_t solver)
+    {
+        auto const ode_solver_type = tosolvertype(solver);
+
+        std::vector<double> trajectory;
+        std::array<double, NCOLUMNS> events;
+        {
+            ScopedGILRelease nogil;
+
+            FreefallSolveEom fse(dt, tinterval, eps, m, r, h0, v0, ode_solver_type);
+
+            // 最初の呼び出しは初期状態を返す
+            auto res = fse();
+            trajectory.insert(trajectory.end(), { std::get<0>(res), std::get<1>(res), std::get<2>(res) });
+            while (!fse.isCalculationFinished()) {
+                res = fse();
+                trajectory.insert(trajectory.end(), { std::get<0>(res), std::get<1>(res), std::get<2>(res) });
+            }
+
+            auto const & [t, h, v, stateofhmax, stateofvmax, stateofkarmanline, stateofexosphere] = res;
+
+            // 第二宇宙速度で外気圏を脱出した場合は地面に衝突しない
+            auto const isescaped = stateofexosphere && std::get<2>(*stateofexosphere);
+
+            events = freefallsolveeom::tocolumns({
+                isescaped ? std::nullopt : std::make_optional(std::make_pair(t, v)),
+                stateofhmax,
+                stateofvmax,
+                stateofkarmanline,
+                stateofexosphere });
+        }
+
+        auto const nrow = trajectory.size() / 3;
+        return py::make_tuple(
+            tondarray(std::move(trajectory), nrow, 3),
+            tondarray(std::vector<double>(events.begin(), events.end()), NCOLUMNS, 0));
+    }
+
+    np::ndarray solvebatch(py::object const & m, py::object const & r, py::object const & h0, py::object const & v0, double dt, double eps, std::int32_t solver)
+    {
+        auto const ode_solver_type = tosolvertype(solver);
+
+        // 引数の変換はGILを保持したまま行う
+        std::array<std::vector<double>, 4> const params = { asvector(m, "m"), asvector(r, "r"), asvector(h0, "h0"), asvector(v0, "v0") };
+
+        std::size_t n = 1;
+        for (auto const & param : params) {
+            n = std::max(n, param.size());
+        }
+
+        for (auto const & param : params) {
+            if (param.size() != 1 && param.size() != n)
+            {
+                PyErr_SetString(PyExc_ValueError, "m, r, h0 and v0 must have the same length or be scalars");
+                py::throw_error_already_set();
+            }
+        }
+
+        std::vector<double> results(n * NCOLUMNS);
+        {
+            ScopedGILRelease nogil;
+
+            for (std::size_t i = 0; i < n; i++) {
+                auto const at = [i](std::vector<double> const & param) { return param.size() == 1 ? param[0] : param[i]; };
+
+                // 途中の状態は用いないので、要約のみを求める（グラフプロット用の時間間隔は数値解法の自動切り替えの間隔だけを決める）
+                FreefallSolveEom fse(dt, 10.0, eps, at(params[0]), at(params[1]), at(params[2]), at(params[3]), ode_solver_type);
+
+                auto const events = freefallsolveeom::tocolumns(fse.summary());
+                std::copy(events.begin(), events.end(), results.begin() + static_cast<std::ptrdiff_t>(i * NCOLUMNS));
+            }
+        }
+
+        return tondarray(std::move(results), n, NCOLUMNS);
+    }
+
+    py::tuple solveparareal(double m, double r, double h0, double v0, double dt, double tinterval, double eps, std::int32_t solver, double tmax, std::int32_t slices, std::int32_t threads)
+    {
+        auto const ode_solver_type = tosolvertype(solver);
+        if (slices <= 0 || threads < 0)
+        {
+            PyErr_SetString(PyExc_ValueError, "slices must be positive and threads must not be negative");
+            py::throw_error_already_set();
+        }
+
+        FreefallSolveEom::pararealtype result;
+        {
+            ScopedGILRelease nogil;
+
+            FreefallSolveEom const fse(dt, tinterval, eps, m, r, h0, v0, ode_solver_type);
+            result = fse.parareal(
+                tmax,
+                static_cast<std::size_t>(slices),
+                threads ? static_cast<std::uint32_t>(threads) : std::max(std::thread::hardware_concurrency(), 1U));
+        }
+
+        std::vector<double> trajectory;
+        trajectory.reserve(result.trajectory.size() * 3);
+        for (auto const & state : result.trajectory) {
+            trajectory.insert(trajectory.end(), state.begin(), state.end());
+        }
+
+        auto const nrow = result.trajectory.size();
+        return py::make_tuple(
+            tondarray(std::move(trajectory), nrow, 3),
+            result.impact ? py::object(py::make_tuple(result.impact->first, result.impact->second)) : py::object(),
+            result.iterations);
+    }
+
+    np::ndarray tondarray(std::vector<double> && data, std::size_t nrow, std::size_t ncolumn)
+    {
+        // 配列をNativeBufferに移し、その所有権をPythonのオブジェクトに渡す
+        auto buffer = std::make_unique<NativeBuffer>(std::move(data));
+        auto const ptr = buffer->data();
+        py::object const owner(py::handle<>(py::manage_new_object::apply<NativeBuffer *>::type()(buffer.release())));
+
+        auto const dtype = np::dtype::get_builtin<double>();
+        if (ncolumn)
+        {
+            return np::from_data(
+                ptr,
+                dtype,
+                py::make_tuple(nrow, ncolumn),
+                py::make_tuple(ncolumn * sizeof(double), sizeof(double)),
+                owner);
+        }
+
+        return np::from_data(ptr, dtype, py::make_tuple(nrow), py::make_tuple(sizeof(double)), owner);
+    }
+
+    FreefallSolveEom::Ode_Solver_type tosolvertype(std::int32_t solver)
+    {
+        if (solver < static_cast<std::int32_t>(FreefallSolveEom::Ode_Solver_type::ADAMS_BASHFORTH_MOULTON) ||
+            solver > static_cast<std::int32_t>(FreefallSolveEom::Ode_Solver_type::AUTO))
+        {
+            PyErr_Format(PyExc_ValueError, "solver must be between %d and %d",
+                static_cast<int>(FreefallSolveEom::Ode_Solver_type::ADAMS_BASHFORTH_MOULTON),
+                static_cast<int>(FreefallSolveEom::Ode_Solver_type::AUTO));
+            py::throw_error_already_set();
+        }
+
+        return static_cast<FreefallSolveEom::Ode_Solver_type>(solver);
+    }
+
+    // #endregion 関数の定義
+}